@@ -0,0 +1,95 @@
+// compact form of the control commands, sent as binary websocket frames
+// [controller, command, arguments...], indexes are positions in the firmware tables
+// (order of the controllers in the parser, order of COMMANDS of every controller)
+const CONTROLLERS = {
+    engines: {
+        index: 0,
+        commands: ["forward", "backward", "stop", "faster", "slower", "keep_speed", "speed", "rotate", "setpoint"]
+    },
+    arm: {
+        index: 1,
+        commands: ["minus", "plus", "stop", "angle", "setpoint"]
+    },
+    gamepad: {
+        index: 6,
+        commands: ["frame", "assign", "reset", "bind"]
+    }
+};
+
+const SIDES = { left: 1, right: 2, both: 3 };
+// first byte of a batch: [BATCH, length, message, length, message...]
+const BATCH = 0xFF;
+// most commands the device takes in a single batch
+const BATCH_SIZE = 8;
+const SERVOS = ["base", "shoulder", "elbow", "wrist", "rotation", "claw"];
+// setpoints go as i16, -1.0 - 1.0 -> -32767 - 32767
+const FULL_SCALE = 32767;
+
+const setpointBytes = value => {
+    const scaled = Math.round(Math.max(-1, Math.min(1, value)) * FULL_SCALE);
+    return [scaled & 0xFF, (scaled >> 8) & 0xFF];
+}
+
+// message -> arguments of its command, null when it has no binary form
+const ARGUMENTS = {
+    engines: message => {
+        const sides = SIDES[message.engine];
+        if (sides === undefined) {
+            return null;
+        }
+        if (message.command === "setpoint") {
+            return [sides, ...setpointBytes(message.value)];
+        }
+        if (message.command !== "speed") {
+            return [sides];
+        }
+        return [sides, message.speed & 0xFF, (message.speed >> 8) & 0xFF];
+    },
+    arm: message => {
+        const servo = SERVOS.indexOf(message.servo);
+        if (servo < 0) {
+            return null;
+        }
+        if (message.command === "setpoint") {
+            return [servo, ...setpointBytes(message.value)];
+        }
+        return message.command === "angle" ? [servo, message.angle & 0xFF] : [servo];
+    },
+    // [buttons: u16, axes: i8 x 4], mapping is changed only with json
+    gamepad: message => {
+        if (message.command === "reset") {
+            return [];
+        }
+        if (message.command !== "frame") {
+            return null;
+        }
+        return [message.buttons & 0xFF, (message.buttons >> 8) & 0xFF, ...message.axes.map(axis => axis & 0xFF)];
+    }
+};
+
+// ArrayBuffer with the message or null, then it has to go as json
+const toBinary = (message) => {
+    const controller = CONTROLLERS[message.controller];
+    if (!controller) {
+        return null;
+    }
+    const command = controller.commands.indexOf(message.command);
+    const args = command < 0 ? null : ARGUMENTS[message.controller](message);
+    if (!args) {
+        return null;
+    }
+    return Uint8Array.from([controller.index, command, ...args]).buffer;
+}
+
+// ArrayBuffer with every message or null when one of them has no binary form
+const toBinaryBatch = (list) => {
+    const messages = list.map(message => toBinary(message));
+    if (messages.some(message => !message)) {
+        return null;
+    }
+    const bytes = [BATCH];
+    messages.forEach(message => bytes.push(message.byteLength, ...new Uint8Array(message)));
+    return Uint8Array.from(bytes).buffer;
+}
+
+export { toBinary, toBinaryBatch, BATCH_SIZE };
@@ -1,108 +1,43 @@
-let previous = null;
-
-function processGamepad(current, currentConfig) {
-
-    let messages = [];
-    let functions = [];
-
-    if (previous !== null) {
-
-        currentConfig.axesPosition.forEach(positionBeh => {
-
-            const currentPos = current.axes[positionBeh.index];
-            const previousPos = previous.axes[positionBeh.index];
-            const pivot = positionBeh.pivot;
-
-            if (currentPos < -pivot && previousPos >= -pivot) {
-                messages.push(positionBeh.onNegativeString);
-                functions.push(positionBeh.onNegativeFun);
-            } else if (currentPos > pivot && previousPos <= pivot) {
-                messages.push(positionBeh.onPositiveString);
-                functions.push(positionBeh.onPositiveFun);
-            } else if (-pivot <= currentPos && currentPos <= pivot && (previousPos > pivot || previousPos < -pivot)) {
-                messages.push(positionBeh.onIdleString);
-                functions.push(positionBeh.onIdleFun);
-            }
-        });
-
-        currentConfig.axesNumeric.forEach(numericBeh => {
-            // TODO => IMPLEMENT
-        });
+// the device turns changes of the gamepad into commands (gamepad controller), the page only
+// sends what the gamepad looks like whenever it changes
+const BUTTONS = 16;
+const AXES = 4;
+// axes go as -127 - 127
+const AXIS_SCALE = 127;
 
-        currentConfig.buttons.forEach(buttonBeh => {
-
-            const isCurrentPressed = current.buttons[buttonBeh.index];
-            const isPreviousPressed = previous.buttons[buttonBeh.index];
-
-            // if previously button wasn't pressed, but current is -> behavious onPressed
-            // same goes for button being released
-            if (!isPreviousPressed && isCurrentPressed) {
-                messages.push(buttonBeh.onPressedString);
-                functions.push(buttonBeh.onPressedFun)
-            } else if (isPreviousPressed && !isCurrentPressed) {
-                messages.push(buttonBeh.onReleasedString);
-                functions.push(buttonBeh.onReleasedFun)
-            }
-        });
-
-        currentConfig.combinations.forEach(combinationBeh => {
-
-            function helper(gamepad) {
-                return (acc, [index, expected]) => {
-                    return acc && gamepad.buttons[index] === expected;
-                }
-            }
-
-            const isCurrentCombination = combinationBeh.combination.reduce(helper(current), true);
-            const isPrevCombination = combinationBeh.combination.reduce(helper(previous), true);
+let previous = null;
 
-            if (!isPrevCombination && isCurrentCombination) {
-                messages.push(combinationBeh.onPressedString);
-                functions.push(combinationBeh.onPressedFun);
-            } else if (isPrevCombination && !isCurrentCombination) {
-                messages.push(combinationBeh.onReleasedString);
-                functions.push(combinationBeh.onReleasedFun);
-            }
-        });
+// frame message when the gamepad changed since the last one (or always when forced), null otherwise
+function gamepadFrame(current, force = false) {
+    const frame = {
+        controller: "gamepad",
+        command: "frame",
+        buttons: current.buttons.reduce((mask, pressed, index) => pressed ? mask | (1 << index) : mask, 0),
+        axes: current.axes.map(axis => Math.round(axis * AXIS_SCALE))
+    };
+    if (!force && previous !== null && previous.buttons === frame.buttons && previous.axes.every((axis, index) => axis === frame.axes[index])) {
+        return null;
     }
-    // save gamepad state
-    previous = current;
-
-    // remove nulls
-    messages = messages.filter(m => m !== null);
-    functions = functions.filter(f => f !== null);
+    previous = frame;
+    return frame;
+}
 
-    return [messages, functions];
+// nothing pressed, axes in the middle -> stops whatever the gamepad started
+function neutralFrame() {
+    previous = null;
+    return { controller: "gamepad", command: "frame", buttons: 0, axes: new Array(AXES).fill(0) };
 }
 
 function getGamepadInfo() {
     const gamepads = navigator.getGamepads();
     if (gamepads[0]) {
-        const gamepad = gamepads[0]
-        const gamepadState = {
-            axes: gamepad.axes,
-            buttons: [
-                gamepad.buttons[0].pressed,
-                gamepad.buttons[1].pressed,
-                gamepad.buttons[2].pressed,
-                gamepad.buttons[3].pressed,
-                gamepad.buttons[4].pressed,
-                gamepad.buttons[5].pressed,
-                gamepad.buttons[6].pressed,
-                gamepad.buttons[7].pressed,
-                gamepad.buttons[8].pressed,
-                gamepad.buttons[9].pressed,
-                gamepad.buttons[10].pressed,
-                gamepad.buttons[11].pressed,
-                gamepad.buttons[12].pressed,
-                gamepad.buttons[13].pressed,
-                gamepad.buttons[14].pressed,
-                gamepad.buttons[15].pressed
-            ]
+        const gamepad = gamepads[0];
+        return {
+            axes: Array.from(gamepad.axes.slice(0, AXES)),
+            buttons: gamepad.buttons.slice(0, BUTTONS).map(button => button.pressed)
         };
-        return gamepadState;
     }
     return null;
 }
 
-export { getGamepadInfo , processGamepad };
\ No newline at end of file
+export { getGamepadInfo, gamepadFrame, neutralFrame };
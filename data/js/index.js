@@ -1,22 +1,24 @@
 import { sendWS, sendWSMany, setOnRecive } from "./websocket.js";
-import { getGamepadInfo, processGamepad } from "./gamepad_processing.js";
-import { DEFAULT_CONFIG } from "./configs.js";
+import { getGamepadInfo, gamepadFrame, neutralFrame } from "./gamepad_processing.js";
 
 document.addEventListener("DOMContentLoaded", () => {
 
-    const GAMEPAD_INTERVAL = 33;
+    // up to 60 frames a second, axes bound to setpoints move smoothly with it
+    const GAMEPAD_INTERVAL = 16;
+    // unchanged gamepad is sent again after that long, setpoints on the device stop without it
+    const GAMEPAD_KEEPALIVE = 200;
+    let lastFrame = 0;
 
     setInterval(function () {
-        let gamepadState = getGamepadInfo();
-        if (gamepadState) {
-            let messages;
-            let functions;
-
-            [messages, functions] = processGamepad(gamepadState, DEFAULT_CONFIG);
-            functions.forEach(f => f());
-            messages.forEach(m => {
-                sendWS(m);
-            });
+        const gamepadState = getGamepadInfo();
+        if (!gamepadState) {
+            return;
+        }
+        const now = performance.now();
+        const frame = gamepadFrame(gamepadState, now - lastFrame >= GAMEPAD_KEEPALIVE);
+        if (frame) {
+            lastFrame = now;
+            sendWS(frame);
         }
     }, GAMEPAD_INTERVAL);
 
@@ -164,6 +166,7 @@ document.addEventListener("DOMContentLoaded", () => {
 
     window.addEventListener("gamepaddisconnected", (e) => {
         console.log("Gamepad disconnected from index %d: %s", e.gamepad.index, e.gamepad.id);
+        sendWS(neutralFrame());
         enableArrows();
     });
 
@@ -174,7 +177,8 @@ function updateGUIFromWebsocket(message) {
     const data = JSON.parse(message.data)
     console.log(data);
 
-    data.forEach(json => {
+    // state comes as an array, replies (statistics, errors) as a single object
+    (Array.isArray(data) ? data : [data]).forEach(json => {
         switch (json.name) {
             case "arm":
                 const armSliders = Array.from(document.querySelectorAll(".arm-slider"));
@@ -205,21 +209,30 @@ function updateGUIFromWebsocket(message) {
                 });
                 break;
             case "leds":
-                const intervalSlider = document.querySelector("#update-interval-slider");
-                intervalSlider.value = json.data.interval;
-                const brightnessSlider = document.querySelector("#brightness-slider");
-                brightnessSlider.value = json.data.brightness;
-                const lengthSlider = document.querySelector("#length-slider");
-                lengthSlider.max = json.data.colors.length;
-                lengthSlider.value = lengthSlider.max;
-                updateBullet(intervalSlider);
-                updateBullet(brightnessSlider);
-                updateBullet(lengthSlider);
+                // only the fields that changed since the version asked for are sent
+                if (json.data.interval !== undefined) {
+                    const intervalSlider = document.querySelector("#update-interval-slider");
+                    intervalSlider.value = json.data.interval;
+                    updateBullet(intervalSlider);
+                }
+                if (json.data.brightness !== undefined) {
+                    const brightnessSlider = document.querySelector("#brightness-slider");
+                    brightnessSlider.value = json.data.brightness;
+                    updateBullet(brightnessSlider);
+                }
+                if (json.data.colors !== undefined) {
+                    const lengthSlider = document.querySelector("#length-slider");
+                    lengthSlider.max = json.data.colors.length;
+                    lengthSlider.value = lengthSlider.max;
+                    updateBullet(lengthSlider);
+                }
                 break;
             case "mp3":
-                const slider = document.querySelector("#volume-slider");
-                slider.value = json.data.volume;
-                updateBullet(slider);
+                if (json.data.volume !== undefined) {
+                    const slider = document.querySelector("#volume-slider");
+                    slider.value = json.data.volume;
+                    updateBullet(slider);
+                }
         }
     });
 }
@@ -1,31 +1,68 @@
-// connect to websocket server
-const WS_ADDRESS = "ws://192.168.4.1/ws";
-let webSocket = new WebSocket(WS_ADDRESS);
+import { toBinary, toBinaryBatch, BATCH_SIZE } from "./binary.js";
 
-webSocket.onopen = e => {
+// driving goes over its own socket, so a state or a file on the other one never holds it up
+const CONTROL_ADDRESS = "ws://192.168.4.1/ws/ctl";
+// state, telemetry and everything else
+const BULK_ADDRESS = "ws://192.168.4.1/ws/bulk";
+// controllers the control socket takes, the device rejects the rest there
+const CONTROL_CONTROLLERS = ["engines", "arm", "gamepad"];
+// frames per second
+const TELEMETRY_RATE = 20;
+let controlSocket = new WebSocket(CONTROL_ADDRESS);
+let bulkSocket = new WebSocket(BULK_ADDRESS);
+
+controlSocket.onopen = e => {
+    console.log("Connected to WS control server");
+};
+
+bulkSocket.onopen = e => {
     console.log("Connected to WS server");
     sendWS({ controller: "config", command: "get" })
+    // changes of the state are pushed from now on
+    sendWS({ controller: "config", command: "telemetry", rate: TELEMETRY_RATE })
 };
 
-webSocket.onerror = e => {
+controlSocket.onerror = bulkSocket.onerror = e => {
     console.log("Error while connecting to WS server");
     console.log(e);
 };
 
+const isControl = (message) => CONTROL_CONTROLLERS.includes(message.controller);
+
+// control socket while it's open, bulk one otherwise (the device puts its commands behind the rest then)
+const socketFor = (messages) => {
+    const control = messages.every(isControl) && controlSocket.readyState === WebSocket.OPEN;
+    return control ? controlSocket : bulkSocket;
+}
+
+// one message for the whole list (applied by the device in the same tick), split only above BATCH_SIZE
 const sendWSMany = (list) => {
-    list.forEach(elem => sendWS(elem));
+    for (let i = 0; i < list.length; i += BATCH_SIZE) {
+        const batch = list.slice(i, i + BATCH_SIZE);
+        const stringified = JSON.stringify(batch);
+        console.log(stringified);
+        const socket = socketFor(batch);
+        if (socket.readyState === WebSocket.OPEN) {
+            const binary = toBinaryBatch(batch);
+            socket.send(binary ? binary : stringified);
+        }
+    }
 }
 
+// control commands go as binary frames, everything else as json
 const sendWS = (message) => {
     const stringified = JSON.stringify(message);
     console.log(stringified);
-    if (webSocket.readyState === WebSocket.OPEN) {
-        webSocket.send(stringified);
+    const socket = socketFor([message]);
+    if (socket.readyState === WebSocket.OPEN) {
+        const binary = toBinary(message);
+        socket.send(binary ? binary : stringified);
     }
 }
 
+// everything the device sends comes over the bulk socket
 const setOnRecive = (fun) => {
-    webSocket.onmessage = fun
+    bulkSocket.onmessage = fun
 }
 
-export { sendWS, sendWSMany, setOnRecive };
\ No newline at end of file
+export { sendWS, sendWSMany, setOnRecive };
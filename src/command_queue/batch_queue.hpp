@@ -0,0 +1,128 @@
+#ifndef __BATCH_QUEUE_HPP__
+#define __BATCH_QUEUE_HPP__
+
+#include <stdint.h>
+#include <atomic>
+#include "mpmc_ring.hpp"
+#include "commands/command.hpp"
+
+namespace command_queue
+{
+    // commands of a single message that have to be applied together and in order
+    // same scheme as command_queue: preallocated slots, rings only carry their indexes
+    //      acquire() -> decode every command into the slot -> push()
+    //      read() -> handle them -> release(), or apply() for all of that
+    template <uint8_t SIZE, size_t DEPTH>
+    class batch_queue
+    {
+        static_assert(DEPTH <= UINT8_MAX, "slot indexes are stored on a single byte");
+
+    public:
+        struct batch
+        {
+            uint8_t count;
+            // sender waits for an ack, false for streams that nobody answers (udp)
+            bool ack;
+            commands::command commands[SIZE];
+        };
+
+        struct statistics
+        {
+            uint32_t pushed;
+            uint32_t dropped;
+        };
+
+        static constexpr uint8_t size() { return SIZE; }
+
+        batch_queue()
+        {
+            for (uint8_t i = 0; i < DEPTH; i++)
+                _free.push(i);
+        }
+
+        batch_queue(const batch_queue &) = delete;
+        batch_queue &operator=(const batch_queue &) = delete;
+
+        // returns empty batch or nullptr if every slot is taken
+        batch *acquire()
+        {
+            uint8_t index;
+            if (_free.pop(index))
+            {
+                _slots[index].count = 0;
+                _slots[index].ack = true;
+                return _slots + index;
+            }
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        // hands the slot over to the consumer
+        bool push(batch *slot)
+        {
+            if (!slot)
+                return false;
+            if (!_ready.push(index_of(slot)))
+            {
+                release(slot);
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            _pushed.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // consumer side, batches come out in the order they were pushed
+        batch *read()
+        {
+            uint8_t index;
+            return _ready.pop(index) ? _slots + index : nullptr;
+        }
+
+        void release(batch *slot)
+        {
+            if (slot)
+                _free.push(index_of(slot));
+        }
+
+        // every ready batch: handle(command) for its commands in order, 1 when it was handled
+        // then acked(count, handled) if the sender waits for it, the slot is free again by then
+        template <typename H, typename A>
+        void apply(H &&handle, A &&acked)
+        {
+            while (auto *slot = read())
+            {
+                uint8_t handled = 0;
+                for (uint8_t i = 0; i < slot->count; i++)
+                    handled += handle(slot->commands[i]);
+
+                uint8_t count = slot->count;
+                bool ack = slot->ack;
+                release(slot);
+                if (ack)
+                    acked(count, handled);
+            }
+        }
+
+        uint32_t pending() const { return _ready.size(); }
+
+        statistics stats() const
+        {
+            return {_pushed.load(std::memory_order_relaxed), _dropped.load(std::memory_order_relaxed)};
+        }
+
+    private:
+        uint8_t index_of(const batch *slot) const
+        {
+            return static_cast<uint8_t>(slot - _slots);
+        }
+
+        batch _slots[DEPTH];
+        mpmc_ring<uint8_t, DEPTH> _free;
+        mpmc_ring<uint8_t, DEPTH> _ready;
+        std::atomic<uint32_t> _pushed{0};
+        std::atomic<uint32_t> _dropped{0};
+    };
+} // namespace command_queue
+
+#endif // __BATCH_QUEUE_HPP__
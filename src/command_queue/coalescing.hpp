@@ -0,0 +1,23 @@
+#ifndef __COALESCING_HPP__
+#define __COALESCING_HPP__
+
+#include <stdint.h>
+#include "commands/command.hpp"
+
+namespace command_queue
+{
+    static constexpr uint32_t NOT_COALESCED = 0U;
+
+    // commands that only carry the latest setpoint (marked as coalesced in the command tables)
+    // get a target while decoding, a newer one with the same key makes the queued one obsolete
+    inline uint32_t coalescing_key(const commands::command &command)
+    {
+        if (command.target == commands::NO_TARGET)
+            return NOT_COALESCED;
+
+        return (1U << 24) | (static_cast<uint32_t>(command.controller) << 16) |
+               (static_cast<uint32_t>(command.id) << 8) | command.target;
+    }
+} // namespace command_queue
+
+#endif // __COALESCING_HPP__
@@ -0,0 +1,304 @@
+#ifndef __COMMAND_QUEUE_HPP__
+#define __COMMAND_QUEUE_HPP__
+
+#include <stdint.h>
+#include <atomic>
+#include "mpmc_ring.hpp"
+#include "priority.hpp"
+#include "coalescing.hpp"
+#include "commands/command.hpp"
+
+namespace command_queue
+{
+    // fixed pool of preallocated commands + one ring of ready slot indexes per priority lane
+    // producers (web socket task, serial, sd scripts):
+    //      acquire() -> decode the message into the slot -> push()
+    // single consumer (main loop):
+    //      read() -> handle the command -> release()
+    // nothing is allocated on the heap after construction
+    // with coalescing enabled a newer setpoint (marked in the command tables) takes over the
+    // ring entry of a still queued older one instead of occupying another one, unless something
+    // else for the same target is queued after it -> then it's appended, so the order stays
+    template <size_t DEPTH>
+    class command_queue
+    {
+        static_assert(DEPTH <= UINT8_MAX, "slot indexes are stored on a single byte");
+        static_assert(DEPTH >= 4, "lanes need a few slots to share");
+
+    public:
+        typedef commands::command command;
+
+        struct statistics
+        {
+            uint32_t pushed;
+            uint32_t dropped;
+            uint32_t in_use;
+        };
+
+        struct lane_statistics
+        {
+            uint32_t depth;
+            uint32_t peak;
+            uint32_t pushed;
+            uint32_t dropped;
+            uint32_t coalesced;
+        };
+
+        command_queue()
+        {
+            for (uint8_t i = 0; i < DEPTH; i++)
+                _free.push(i);
+        }
+
+        command_queue(const command_queue &) = delete;
+        command_queue &operator=(const command_queue &) = delete;
+
+        // returns empty command or nullptr if every slot is taken
+        command *acquire()
+        {
+            uint8_t index;
+            if (_free.pop(index))
+            {
+                _slots[index] = command{};
+                return _slots + index;
+            }
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        // hands the slot over to the consumer, on failure slot is released
+        bool push(command *slot)
+        {
+            if (!slot)
+                return false;
+            return push(slot, slot->lane());
+        }
+
+        bool push(command *slot, priority lane)
+        {
+            if (!slot)
+                return false;
+
+            auto &current = _lanes[static_cast<uint8_t>(lane)];
+            uint8_t index = index_of(slot);
+            uint32_t key = _coalescing.load(std::memory_order_relaxed) ? coalescing_key(*slot) : NOT_COALESCED;
+            uint32_t owner = owner_of(*slot, lane);
+            if (key != NOT_COALESCED && coalesce(current, index, key, owner))
+            {
+                current.coalesced.fetch_add(1, std::memory_order_relaxed);
+                _pushed.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            // lower lanes can't take every slot, there is always room left for a stop
+            uint32_t depth = current.depth.fetch_add(1, std::memory_order_relaxed) + 1;
+            if (depth <= quota(lane) && current.ready.push_at([this, index, key, owner](uint32_t position) {
+                    mark(index, key, owner, position);
+                    return tag(position, index);
+                }))
+            {
+                current.pushed.fetch_add(1, std::memory_order_relaxed);
+                uint32_t peak = current.peak.load(std::memory_order_relaxed);
+                while (depth > peak && !current.peak.compare_exchange_weak(peak, depth, std::memory_order_relaxed))
+                    ;
+                _pushed.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            current.depth.fetch_sub(1, std::memory_order_relaxed);
+            current.dropped.fetch_add(1, std::memory_order_relaxed);
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            release(slot);
+            return false;
+        }
+
+        // copies the command into a free slot
+        bool push(const command &value)
+        {
+            command *slot = acquire();
+            if (!slot)
+                return false;
+
+            *slot = value;
+            return push(slot);
+        }
+
+        // consumer side, returns nullptr when nothing is waiting
+        // safety lane is always emptied before control, control before bulk
+        command *read()
+        {
+            uint32_t tagged;
+            for (auto &lane : _lanes)
+            {
+                if (lane.ready.pop(tagged))
+                {
+                    lane.depth.fetch_sub(1, std::memory_order_relaxed);
+                    return _slots + (tagged & INDEX_MASK);
+                }
+            }
+            return nullptr;
+        }
+
+        // commands pushed and not read yet, in every lane
+        uint32_t pending() const
+        {
+            uint32_t total = 0;
+            for (const auto &lane : _lanes)
+                total += lane.depth.load(std::memory_order_relaxed);
+            return total;
+        }
+
+        void release(command *slot)
+        {
+            if (slot)
+                _free.push(index_of(slot));
+        }
+
+        void set_coalescing(bool enabled)
+        {
+            _coalescing.store(enabled, std::memory_order_relaxed);
+        }
+
+        bool coalescing() const
+        {
+            return _coalescing.load(std::memory_order_relaxed);
+        }
+
+        statistics stats() const
+        {
+            return {_pushed.load(std::memory_order_relaxed),
+                    _dropped.load(std::memory_order_relaxed),
+                    static_cast<uint32_t>(DEPTH) - _free.size()};
+        }
+
+        lane_statistics stats(priority lane) const
+        {
+            const auto &current = _lanes[static_cast<uint8_t>(lane)];
+            return {current.depth.load(std::memory_order_relaxed),
+                    current.peak.load(std::memory_order_relaxed),
+                    current.pushed.load(std::memory_order_relaxed),
+                    current.dropped.load(std::memory_order_relaxed),
+                    current.coalesced.load(std::memory_order_relaxed)};
+        }
+
+        static constexpr size_t depth() { return DEPTH; }
+
+        static constexpr uint32_t quota(priority lane)
+        {
+            return lane == priority::SAFETY    ? DEPTH
+                   : lane == priority::CONTROL ? DEPTH - SAFETY_RESERVE
+                                               : DEPTH / 2;
+        }
+
+    private:
+        static constexpr uint32_t SAFETY_RESERVE = 2U;
+        static constexpr uint32_t INDEX_MASK = 0xFFU;
+        static constexpr uint32_t POSITION_MASK = 0x7FFFFFU;
+        static constexpr uint32_t TAGGED = 0x80000000U;
+
+        struct lane_data
+        {
+            // slot indexes tagged with their ring position
+            mpmc_ring<uint32_t, DEPTH> ready;
+            std::atomic<uint32_t> depth{0};
+            std::atomic<uint32_t> peak{0};
+            std::atomic<uint32_t> pushed{0};
+            std::atomic<uint32_t> dropped{0};
+            std::atomic<uint32_t> coalesced{0};
+        };
+
+        uint8_t index_of(const command *slot) const
+        {
+            return static_cast<uint8_t>(slot - _slots);
+        }
+
+        // never 0 (the value of a popped cell) and unique per ring position
+        static uint32_t tag(uint32_t position, uint8_t index)
+        {
+            return TAGGED | ((position & POSITION_MASK) << 8) | index;
+        }
+
+        // lane, controller and target of a queued command, whatever its key
+        static uint32_t owner_of(const command &value, priority lane)
+        {
+            return (static_cast<uint32_t>(lane) << 16) | (static_cast<uint32_t>(value.controller) << 8) | value.target;
+        }
+
+        // targets are compared as masks (engine sides) -> a few that don't overlap are kept apart too,
+        // that only costs a coalescing, no target means every target of the controller
+        static bool overlaps(uint32_t owner, uint32_t other)
+        {
+            if ((owner >> 8) != (other >> 8))
+                return false;
+            uint8_t target = owner & 0xFFU;
+            uint8_t other_target = other & 0xFFU;
+            return target == commands::NO_TARGET || other_target == commands::NO_TARGET ||
+                   target == other_target || (target & other_target);
+        }
+
+        // written before the slot becomes visible in a ring
+        void mark(uint8_t index, uint32_t key, uint32_t owner, uint32_t position)
+        {
+            _keys[index].store(key, std::memory_order_relaxed);
+            _owners[index].store(owner, std::memory_order_relaxed);
+            _positions[index].store(position, std::memory_order_release);
+        }
+
+        // something for the same target queued behind the given position -> a command put in there
+        // would run before it, positions of slots that were read already are all behind
+        bool overtakes(uint8_t queued, uint8_t index, uint32_t owner, uint32_t position) const
+        {
+            for (uint8_t other = 0; other < DEPTH; other++)
+            {
+                if (other == queued || other == index)
+                    continue;
+
+                uint32_t later = _positions[other].load(std::memory_order_acquire);
+                if (static_cast<int32_t>(later - position) > 0 &&
+                    overlaps(owner, _owners[other].load(std::memory_order_relaxed)))
+                    return true;
+            }
+            return false;
+        }
+
+        // looks for a queued slot with the same key and swaps it for the new one
+        bool coalesce(lane_data &lane, uint8_t index, uint32_t key, uint32_t owner)
+        {
+            for (uint8_t queued = 0; queued < DEPTH; queued++)
+            {
+                if (queued == index)
+                    continue;
+
+                uint32_t position = _positions[queued].load(std::memory_order_acquire);
+                if (_keys[queued].load(std::memory_order_relaxed) != key ||
+                    _owners[queued].load(std::memory_order_relaxed) != owner)
+                    continue;
+                // old one may have been read already, then the replace fails anyway
+                if (overtakes(queued, index, owner, position))
+                    continue;
+
+                mark(index, key, owner, position);
+                // fails when the old slot was read (or replaced) in the meantime
+                if (lane.ready.replace(position, tag(position, queued), tag(position, index)))
+                {
+                    release(_slots + queued);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        command _slots[DEPTH];
+        mpmc_ring<uint8_t, DEPTH> _free;
+        lane_data _lanes[LANES];
+        std::atomic<uint32_t> _keys[DEPTH] = {};
+        std::atomic<uint32_t> _positions[DEPTH] = {};
+        std::atomic<uint32_t> _owners[DEPTH] = {};
+        std::atomic<bool> _coalescing{false};
+
+        std::atomic<uint32_t> _pushed{0};
+        std::atomic<uint32_t> _dropped{0};
+    };
+} // namespace command_queue
+
+#endif // __COMMAND_QUEUE_HPP__
@@ -0,0 +1,83 @@
+#ifndef __DRAINER_HPP__
+#define __DRAINER_HPP__
+
+#include <stdint.h>
+
+namespace command_queue
+{
+    // takes as many queued commands as fit in a time budget (at least one if any is waiting)
+    // so a burst is applied in a single pass of the main loop
+    template <typename Queue>
+    class drainer
+    {
+    public:
+        // microseconds, wrapping around is fine
+        typedef uint32_t (*clock)();
+
+        struct statistics
+        {
+            // last pass
+            uint32_t drained;
+            uint32_t time_us;
+            // since start
+            uint32_t max_drained;
+            uint32_t max_time_us;
+            uint32_t total_drained;
+            uint32_t passes;
+            uint32_t overruns;
+        };
+
+        drainer(Queue &queue, clock now, uint32_t budget_us) : _queue(queue),
+                                                               _now(now),
+                                                               _budget_us(budget_us)
+        {
+        }
+
+        // handler(const command &) is called for every command, returns number of handled commands
+        template <typename Handler>
+        uint32_t run(Handler handler)
+        {
+            uint32_t start = _now();
+            uint32_t elapsed = 0;
+            uint32_t drained = 0;
+            while (drained == 0 || elapsed < _budget_us)
+            {
+                auto *command = _queue.read();
+                if (!command)
+                    break;
+
+                handler(*command);
+                _queue.release(command);
+                drained++;
+                elapsed = _now() - start;
+            }
+
+            _stats.drained = drained;
+            _stats.time_us = elapsed;
+            _stats.passes++;
+            if (drained)
+            {
+                _stats.total_drained += drained;
+                if (drained > _stats.max_drained)
+                    _stats.max_drained = drained;
+                if (elapsed > _stats.max_time_us)
+                    _stats.max_time_us = elapsed;
+                if (elapsed > _budget_us)
+                    _stats.overruns++;
+            }
+            return drained;
+        }
+
+        void set_budget(uint32_t budget_us) { _budget_us = budget_us; }
+        uint32_t budget() const { return _budget_us; }
+        const statistics &stats() const { return _stats; }
+
+    private:
+        Queue &_queue;
+        clock _now;
+        uint32_t _budget_us;
+        statistics _stats = {};
+    };
+} // namespace command_queue
+
+#endif // __DRAINER_HPP__
@@ -0,0 +1,129 @@
+#ifndef __MPMC_RING_HPP__
+#define __MPMC_RING_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+namespace command_queue
+{
+    // bounded lock-free ring (Vyukov's sequence-per-cell design)
+    // any number of producers and consumers may use it concurrently,
+    // neither side ever blocks -> push / pop simply fail when full / empty
+    template <typename T, size_t DEPTH>
+    class mpmc_ring
+    {
+        static_assert(DEPTH >= 2 && (DEPTH & (DEPTH - 1)) == 0, "ring depth has to be a power of two");
+
+    public:
+        mpmc_ring()
+        {
+            for (uint32_t i = 0; i < DEPTH; i++)
+                _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        mpmc_ring(const mpmc_ring &) = delete;
+        mpmc_ring &operator=(const mpmc_ring &) = delete;
+
+        bool push(const T &value)
+        {
+            return push_at([&value](uint32_t) { return value; });
+        }
+
+        // make_value(position) is called once the position is claimed and before
+        // the value is visible to consumers -> lets callers tag values with it
+        template <typename F>
+        bool push_at(F make_value)
+        {
+            cell *current;
+            uint32_t position = _enqueue.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                current = &_cells[position & MASK];
+                uint32_t sequence = current->sequence.load(std::memory_order_acquire);
+                int32_t difference = static_cast<int32_t>(sequence - position);
+                if (difference == 0)
+                {
+                    if (_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (difference < 0)
+                {
+                    // cell still holds a value from the previous lap -> full
+                    return false;
+                }
+                else
+                {
+                    position = _enqueue.load(std::memory_order_relaxed);
+                }
+            }
+            current->value.store(make_value(position), std::memory_order_relaxed);
+            current->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(T &value)
+        {
+            cell *current;
+            uint32_t position = _dequeue.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                current = &_cells[position & MASK];
+                uint32_t sequence = current->sequence.load(std::memory_order_acquire);
+                int32_t difference = static_cast<int32_t>(sequence - (position + 1));
+                if (difference == 0)
+                {
+                    if (_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (difference < 0)
+                {
+                    // producer has not published this cell yet -> empty
+                    return false;
+                }
+                else
+                {
+                    position = _dequeue.load(std::memory_order_relaxed);
+                }
+            }
+            // exchange -> replace() racing with this pop can't succeed afterwards
+            value = current->value.exchange(T(), std::memory_order_acquire);
+            current->sequence.store(position + MASK + 1, std::memory_order_release);
+            return true;
+        }
+
+        // swaps a value that is still waiting in the ring at given position
+        // fails if it was popped in the meantime, values have to be unique
+        // (e.g. tagged with their position) for this to be safe against reuse
+        bool replace(uint32_t position, T expected, T desired)
+        {
+            cell &current = _cells[position & MASK];
+            return current.value.compare_exchange_strong(expected, desired, std::memory_order_acq_rel);
+        }
+
+        // approximate when other threads are working on the ring
+        uint32_t size() const
+        {
+            uint32_t enqueued = _enqueue.load(std::memory_order_relaxed);
+            uint32_t dequeued = _dequeue.load(std::memory_order_relaxed);
+            return enqueued - dequeued;
+        }
+
+        static constexpr uint32_t capacity() { return DEPTH; }
+
+    private:
+        static constexpr uint32_t MASK = DEPTH - 1;
+
+        struct cell
+        {
+            std::atomic<uint32_t> sequence;
+            std::atomic<T> value;
+        };
+
+        cell _cells[DEPTH];
+        std::atomic<uint32_t> _enqueue{0};
+        std::atomic<uint32_t> _dequeue{0};
+    };
+} // namespace command_queue
+
+#endif // __MPMC_RING_HPP__
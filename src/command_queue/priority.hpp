@@ -0,0 +1,21 @@
+#ifndef __PRIORITY_HPP__
+#define __PRIORITY_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace command_queue
+{
+    // lanes are drained in this order, safety first
+    // every command gets its lane from the command table of its controller
+    enum class priority : uint8_t
+    {
+        SAFETY = 0,
+        CONTROL,
+        BULK,
+    };
+
+    static constexpr size_t LANES = 3U;
+} // namespace command_queue
+
+#endif // __PRIORITY_HPP__
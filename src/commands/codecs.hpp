@@ -0,0 +1,293 @@
+#ifndef __CODECS_HPP__
+#define __CODECS_HPP__
+
+#include <ArduinoJson.h>
+#include <string.h>
+#include "command.hpp"
+#include "setpoint/axis_filter.hpp"
+
+namespace commands
+{
+    // fills the arguments (and target) of a command from a message, false when message is invalid
+    typedef bool (*decoder)(const JsonObject &json, const char *key, command &cmd);
+    // writes the arguments back, used for logging
+    typedef void (*encoder)(const command &cmd, const char *key, JsonObject &json);
+    // same as decoder for the binary form: fixed width arguments, little endian, length has to match
+    typedef bool (*binary_decoder)(const uint8_t *data, size_t length, command &cmd);
+
+    // key is given by the command table entry, only single value codecs use it
+    struct codec
+    {
+        decoder decode;
+        encoder encode;
+        // nullptr -> command has no binary form
+        binary_decoder decode_binary = nullptr;
+    };
+
+    namespace codecs
+    {
+        static constexpr const char *ENGINE_KEY = "engine";
+        static constexpr const char *SPEED_KEY = "speed";
+        static constexpr const char *VALUE_KEY = "value";
+        static constexpr const char *INDEX_KEY = "index";
+        static constexpr const char *COLORS_KEY = "colors";
+
+        static constexpr const char *LEFT_NAME = "left";
+        static constexpr const char *RIGHT_NAME = "right";
+        static constexpr const char *BOTH_NAME = "both";
+
+        inline uint16_t read_u16(const uint8_t *data)
+        {
+            return static_cast<uint16_t>(data[0] | (data[1] << 8));
+        }
+
+        inline uint32_t read_u32(const uint8_t *data)
+        {
+            return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+                   (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+        }
+
+        inline bool decode_none(const JsonObject &json, const char *key, command &cmd)
+        {
+            cmd.target = 0;
+            return true;
+        }
+
+        inline void encode_none(const command &cmd, const char *key, JsonObject &json)
+        {
+        }
+
+        inline bool read_none(const uint8_t *data, size_t length, command &cmd)
+        {
+            cmd.target = 0;
+            return !length;
+        }
+
+        inline uint8_t sides_from_name(const char *name)
+        {
+            if (!name)
+                return 0;
+            if (!strcmp(name, BOTH_NAME))
+                return BOTH;
+            if (!strcmp(name, LEFT_NAME))
+                return LEFT;
+            if (!strcmp(name, RIGHT_NAME))
+                return RIGHT;
+            return 0;
+        }
+
+        inline const char *sides_name(uint8_t sides)
+        {
+            return sides == BOTH ? BOTH_NAME : sides == LEFT ? LEFT_NAME : RIGHT_NAME;
+        }
+
+        // {"engine": "left" | "right" | "both"}
+        inline bool decode_engine(const JsonObject &json, const char *key, command &cmd)
+        {
+            cmd.args.engine.sides = sides_from_name(json[ENGINE_KEY]);
+            cmd.args.engine.speed = 0;
+            cmd.target = cmd.args.engine.sides;
+            return cmd.args.engine.sides;
+        }
+
+        inline void encode_engine(const command &cmd, const char *key, JsonObject &json)
+        {
+            json[ENGINE_KEY] = sides_name(cmd.args.engine.sides);
+        }
+
+        // [sides: LEFT | RIGHT | BOTH]
+        inline bool read_engine(const uint8_t *data, size_t length, command &cmd)
+        {
+            if (length != 1 || !data[0] || data[0] > BOTH)
+                return false;
+            cmd.args.engine.sides = data[0];
+            cmd.args.engine.speed = 0;
+            cmd.target = cmd.args.engine.sides;
+            return true;
+        }
+
+        // {"engine": ..., "speed": 0 - 65535}, range of the engine itself is checked by the handler
+        inline bool decode_engine_speed(const JsonObject &json, const char *key, command &cmd)
+        {
+            auto speed = json[SPEED_KEY];
+            if (!decode_engine(json, key, cmd) || !speed.is<uint16_t>())
+                return false;
+            cmd.args.engine.speed = speed;
+            return true;
+        }
+
+        inline void encode_engine_speed(const command &cmd, const char *key, JsonObject &json)
+        {
+            encode_engine(cmd, key, json);
+            json[SPEED_KEY] = cmd.args.engine.speed;
+        }
+
+        // [sides, speed: u16]
+        inline bool read_engine_speed(const uint8_t *data, size_t length, command &cmd)
+        {
+            if (length != 3 || !read_engine(data, 1, cmd))
+                return false;
+            cmd.args.engine.speed = read_u16(data + 1);
+            return true;
+        }
+
+        // {key: -1.0 - 1.0}, out of range is clamped
+        inline bool decode_setpoint_value(const JsonObject &json, const char *key, command &cmd)
+        {
+            auto value = json[key];
+            if (!value.is<float>())
+                return false;
+            cmd.args.setpoint.value = setpoint::from_unit(value.as<float>());
+            return true;
+        }
+
+        inline void encode_setpoint_value(const command &cmd, const char *key, JsonObject &json)
+        {
+            json[key] = static_cast<float>(cmd.args.setpoint.value) / setpoint::FULL_SCALE;
+        }
+
+        // [value: i16], -32768 is taken as -32767
+        inline void read_setpoint_value(const uint8_t *data, command &cmd)
+        {
+            int16_t value = static_cast<int16_t>(read_u16(data));
+            cmd.args.setpoint.value = value < -setpoint::FULL_SCALE ? -setpoint::FULL_SCALE : value;
+        }
+
+        // {"engine": ..., "value": -1.0 (full backward) - 1.0 (full forward)}
+        inline bool decode_engine_setpoint(const JsonObject &json, const char *key, command &cmd)
+        {
+            cmd.args.setpoint.target = sides_from_name(json[ENGINE_KEY]);
+            cmd.target = cmd.args.setpoint.target;
+            return cmd.target && decode_setpoint_value(json, VALUE_KEY, cmd);
+        }
+
+        inline void encode_engine_setpoint(const command &cmd, const char *key, JsonObject &json)
+        {
+            json[ENGINE_KEY] = sides_name(cmd.args.setpoint.target);
+            encode_setpoint_value(cmd, VALUE_KEY, json);
+        }
+
+        // [sides, value: i16]
+        inline bool read_engine_setpoint(const uint8_t *data, size_t length, command &cmd)
+        {
+            if (length != 3 || !data[0] || data[0] > BOTH)
+                return false;
+            cmd.args.setpoint.target = data[0];
+            cmd.target = data[0];
+            read_setpoint_value(data + 1, cmd);
+            return true;
+        }
+
+        // {"index": 0 - 255, "colors": [r, g, b]}
+        inline bool decode_color(const JsonObject &json, const char *key, command &cmd)
+        {
+            auto index = json[INDEX_KEY];
+            JsonArray colors = json[COLORS_KEY];
+            if (!index.is<uint8_t>() || colors.size() < 3)
+                return false;
+            cmd.args.color.index = index;
+            cmd.args.color.red = colors[0];
+            cmd.args.color.green = colors[1];
+            cmd.args.color.blue = colors[2];
+            cmd.target = cmd.args.color.index;
+            return true;
+        }
+
+        inline void encode_color(const command &cmd, const char *key, JsonObject &json)
+        {
+            json[INDEX_KEY] = cmd.args.color.index;
+            JsonArray colors = json.createNestedArray(COLORS_KEY);
+            colors.add(cmd.args.color.red);
+            colors.add(cmd.args.color.green);
+            colors.add(cmd.args.color.blue);
+        }
+
+        // [index, red, green, blue]
+        inline bool read_color(const uint8_t *data, size_t length, command &cmd)
+        {
+            if (length != 4)
+                return false;
+            cmd.args.color.index = data[0];
+            cmd.args.color.red = data[1];
+            cmd.args.color.green = data[2];
+            cmd.args.color.blue = data[3];
+            cmd.target = cmd.args.color.index;
+            return true;
+        }
+
+        // {key: unsigned number or bool}
+        inline bool decode_optional_value(const JsonObject &json, const char *key, command &cmd)
+        {
+            auto value = json[key];
+            cmd.target = 0;
+            cmd.args.value.present = value.is<uint32_t>() || value.is<bool>();
+            cmd.args.value.value = value.is<bool>() ? value.as<bool>() : value.as<uint32_t>();
+            return value.isNull() || cmd.args.value.present;
+        }
+
+        inline bool decode_value(const JsonObject &json, const char *key, command &cmd)
+        {
+            return decode_optional_value(json, key, cmd) && cmd.args.value.present;
+        }
+
+        inline void encode_value(const command &cmd, const char *key, JsonObject &json)
+        {
+            if (cmd.args.value.present)
+                json[key] = cmd.args.value.value;
+        }
+
+        // [] or [value: u32]
+        inline bool read_optional_value(const uint8_t *data, size_t length, command &cmd)
+        {
+            if (length && length != 4)
+                return false;
+            cmd.target = 0;
+            cmd.args.value.present = length != 0;
+            cmd.args.value.value = length ? read_u32(data) : 0U;
+            return true;
+        }
+
+        inline bool read_value(const uint8_t *data, size_t length, command &cmd)
+        {
+            return length && read_optional_value(data, length, cmd);
+        }
+
+        // {key: "/file.txt"}, name has to fit in FILE_NAME_SIZE
+        inline bool decode_file(const JsonObject &json, const char *key, command &cmd)
+        {
+            const char *name = json[key];
+            if (!name || strlen(name) >= FILE_NAME_SIZE)
+                return false;
+            strcpy(cmd.args.file.name, name);
+            cmd.target = 0;
+            return true;
+        }
+
+        inline void encode_file(const command &cmd, const char *key, JsonObject &json)
+        {
+            json[key] = cmd.args.file.name;
+        }
+
+        // [name...] without the '\0'
+        inline bool read_file(const uint8_t *data, size_t length, command &cmd)
+        {
+            if (!length || length >= FILE_NAME_SIZE || memchr(data, '\0', length))
+                return false;
+            memcpy(cmd.args.file.name, data, length);
+            cmd.args.file.name[length] = '\0';
+            cmd.target = 0;
+            return true;
+        }
+
+        static constexpr codec NONE = {decode_none, encode_none, read_none};
+        static constexpr codec ENGINE = {decode_engine, encode_engine, read_engine};
+        static constexpr codec ENGINE_SPEED = {decode_engine_speed, encode_engine_speed, read_engine_speed};
+        static constexpr codec ENGINE_SETPOINT = {decode_engine_setpoint, encode_engine_setpoint, read_engine_setpoint};
+        static constexpr codec COLOR = {decode_color, encode_color, read_color};
+        static constexpr codec VALUE = {decode_value, encode_value, read_value};
+        static constexpr codec OPTIONAL_VALUE = {decode_optional_value, encode_value, read_optional_value};
+        static constexpr codec FILE_NAME = {decode_file, encode_file, read_file};
+    } // namespace codecs
+} // namespace commands
+
+#endif // __CODECS_HPP__
@@ -0,0 +1,141 @@
+#ifndef __COMMAND_HPP__
+#define __COMMAND_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "command_queue/priority.hpp"
+
+namespace commands
+{
+    // where the command came from
+    enum class origin : uint8_t
+    {
+        NETWORK = 0,
+        CONSOLE,
+        SCRIPT,
+        INTERNAL,
+    };
+
+    // engine side mask
+    static constexpr uint8_t LEFT = 1U;
+    static constexpr uint8_t RIGHT = 2U;
+    static constexpr uint8_t BOTH = LEFT | RIGHT;
+
+    // target of a command that is never coalesced
+    static constexpr uint8_t NO_TARGET = UINT8_MAX;
+    // with the terminating zero
+    static constexpr size_t FILE_NAME_SIZE = 12U;
+    static constexpr uint8_t GAMEPAD_AXES = 4U;
+    // longest binary message a gamepad input can be mapped to
+    static constexpr size_t ACTION_SIZE = 9U;
+
+    struct engine_args
+    {
+        uint8_t sides;
+        uint16_t speed;
+    };
+
+    struct servo_args
+    {
+        uint8_t servo;
+        uint8_t angle;
+    };
+
+    struct color_args
+    {
+        uint8_t index;
+        uint8_t red;
+        uint8_t green;
+        uint8_t blue;
+    };
+
+    struct value_args
+    {
+        uint32_t value;
+        // only optional values can be missing
+        bool present;
+    };
+
+    struct file_args
+    {
+        char name[FILE_NAME_SIZE];
+    };
+
+    // continuous value of an output (engine sides, servo), Q15 -32767 - 32767 (see setpoint/axis_filter.hpp)
+    struct setpoint_args
+    {
+        uint8_t target;
+        int16_t value;
+    };
+
+    // whole gamepad in a single frame, axes from -127 to 127
+    struct gamepad_args
+    {
+        uint16_t buttons;
+        int8_t axes[GAMEPAD_AXES];
+    };
+
+    // binary message (see abstract_parser::decode_binary) run on an edge of a gamepad input
+    struct mapping_args
+    {
+        uint8_t input;
+        uint8_t event;
+        uint8_t length;
+        uint8_t action[ACTION_SIZE];
+    };
+
+    // message decoded once when it enters the device, handlers never look at JSON again
+    // plain data -> copied by value, no allocations
+    struct command
+    {
+        // index of the controller in the parser
+        uint8_t controller;
+        // index in the controller's command table
+        uint8_t id;
+        // lane in the lowest 2 bits, origin in the next 2
+        uint8_t meta;
+        // which servo / engine side / led... a newer command with the same target replaces a queued one
+        uint8_t target;
+
+        union
+        {
+            engine_args engine;
+            servo_args servo;
+            color_args color;
+            value_args value;
+            file_args file;
+            setpoint_args setpoint;
+            gamepad_args gamepad;
+            mapping_args mapping;
+        } args;
+
+        command_queue::priority lane() const
+        {
+            return static_cast<command_queue::priority>(meta & LANE_MASK);
+        }
+
+        void set_lane(command_queue::priority lane)
+        {
+            meta = (meta & ~LANE_MASK) | static_cast<uint8_t>(lane);
+        }
+
+        commands::origin source() const
+        {
+            return static_cast<commands::origin>((meta >> ORIGIN_SHIFT) & ORIGIN_MASK);
+        }
+
+        void set_source(commands::origin source)
+        {
+            meta = (meta & ~(ORIGIN_MASK << ORIGIN_SHIFT)) | (static_cast<uint8_t>(source) << ORIGIN_SHIFT);
+        }
+
+    private:
+        static constexpr uint8_t LANE_MASK = 0x03U;
+        static constexpr uint8_t ORIGIN_MASK = 0x03U;
+        static constexpr uint8_t ORIGIN_SHIFT = 2U;
+    };
+
+    static_assert(sizeof(command) == 16, "command should stay small enough to be copied around freely");
+} // namespace commands
+
+#endif // __COMMAND_HPP__
@@ -0,0 +1,152 @@
+#ifndef __COMMAND_TABLE_HPP__
+#define __COMMAND_TABLE_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hash.hpp"
+#include "commands/command.hpp"
+#include "commands/codecs.hpp"
+
+namespace json_parser
+{
+    template <typename T>
+    struct command_entry
+    {
+        typedef bool (T::*event)(const commands::command &);
+
+        const char *name;
+        event fun;
+        // how arguments are read from a message
+        commands::codec codec = commands::codecs::NONE;
+        // message key of single value codecs
+        const char *key = nullptr;
+        command_queue::priority lane = command_queue::priority::BULK;
+        // newer command with the same target replaces a queued one
+        bool coalesced = false;
+    };
+
+    // only declared -> reaching them while building a table breaks the compilation
+    void duplicated_command_name();
+    void no_perfect_hash_found();
+
+    // command name -> index of the entry, built completely at compile time (ends up in flash)
+    // names are spread over a power of two table with a seed picked so that
+    // no two of them land in the same bucket, so lookup is one hash + one compare
+    template <typename T, size_t N>
+    class command_table
+    {
+    public:
+        static constexpr int16_t NOT_FOUND = -1;
+
+        constexpr command_table() : _commands{}, _buckets{}, _seed(0) {}
+
+        constexpr command_table(const command_entry<T> (&commands)[N]) : _commands{}, _buckets{}, _seed(0)
+        {
+            for (size_t i = 0; i < N; i++)
+            {
+                for (size_t j = 0; j < i; j++)
+                {
+                    if (equal(commands[i].name, commands[j].name))
+                        duplicated_command_name();
+                }
+                _commands[i] = commands[i];
+            }
+
+            while (!spread())
+            {
+                if (++_seed == MAX_SEED)
+                    no_perfect_hash_found();
+            }
+        }
+
+        constexpr int16_t find(const char *name) const
+        {
+            if (!N || !name)
+                return NOT_FOUND;
+
+            uint8_t index = _buckets[bucket(name, _seed)];
+            return index && equal(_commands[index - 1].name, name) ? index - 1 : NOT_FOUND;
+        }
+
+        constexpr const command_entry<T> &operator[](size_t index) const { return _commands[index]; }
+
+        // binary form: [index of the entry, arguments of its codec...], no lookup at all
+        bool decode_binary(const uint8_t *data, size_t length, commands::command &command) const
+        {
+            if (!length || data[0] >= N)
+                return false;
+
+            const auto &entry = _commands[data[0]];
+            if (!entry.codec.decode_binary || !entry.codec.decode_binary(data + 1, length - 1, command))
+                return false;
+
+            command.id = data[0];
+            command.set_lane(entry.lane);
+            if (!entry.coalesced)
+                command.target = commands::NO_TARGET;
+            return true;
+        }
+
+        static constexpr size_t size() { return N; }
+
+    private:
+        static constexpr size_t buckets()
+        {
+            size_t count = 1;
+            while (count < N * 4)
+                count <<= 1;
+            return count;
+        }
+
+        static constexpr size_t BUCKETS = buckets();
+        static constexpr uint32_t MAX_SEED = 1U << 12;
+
+        static_assert(N < UINT8_MAX, "bucket stores index on a single byte");
+
+        static constexpr bool equal(const char *first, const char *second)
+        {
+            while (*first && *first == *second)
+            {
+                first++;
+                second++;
+            }
+            return *first == *second;
+        }
+
+        // low bits of fnv1a are weak, high ones are folded in
+        static constexpr size_t bucket(const char *name, uint32_t seed)
+        {
+            uint32_t value = hash::fnv1a(name, hash::FNV_OFFSET ^ seed);
+            return (value ^ (value >> 16)) & (BUCKETS - 1);
+        }
+
+        // false on the first collision
+        constexpr bool spread()
+        {
+            for (auto &index : _buckets)
+                index = 0;
+
+            for (size_t i = 0; i < N; i++)
+            {
+                uint8_t &index = _buckets[bucket(_commands[i].name, _seed)];
+                if (index)
+                    return false;
+                index = static_cast<uint8_t>(i + 1);
+            }
+            return true;
+        }
+
+        command_entry<T> _commands[N ? N : 1];
+        // index + 1 of a command, 0 when empty
+        uint8_t _buckets[BUCKETS];
+        uint32_t _seed;
+    };
+
+    template <typename T, size_t N>
+    constexpr command_table<T, N> make_command_table(const command_entry<T> (&commands)[N])
+    {
+        return command_table<T, N>(commands);
+    }
+} // namespace json_parser
+
+#endif // __COMMAND_TABLE_HPP__
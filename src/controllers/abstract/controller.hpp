@@ -2,9 +2,16 @@
 #define __ICONTROLLER_HPP__
 
 #include <ArduinoJson.h>
+#include "commands/command.hpp"
+#include "scheduler/scheduler.hpp"
+#include "json_parser/json_writer.hpp"
+#include "state_stamps.hpp"
 
 namespace json_parser
 {
+    // periodic work of every controller, owned by the parser
+    typedef scheduler::scheduler<16> task_scheduler;
+
     class controller
     {
     public:
@@ -15,29 +22,54 @@ namespace json_parser
             error
         };
 
-        controller(const char *name, uint32_t json_size) : _name(name), _json_size(json_size) {}
+        explicit controller(const char *name) : _name(name) {}
         virtual ~controller() = default;
 
-        virtual handle_resoult try_handle(const JsonObject &json);
+        // decodes and handles the message right away if it is addressed to this controller
+        virtual handle_resoult try_handle(const JsonObject &json)
+        {
+            if (can_handle(json))
+            {
+                commands::command command{};
+                return decode(json, command) && handle(command) ? handle_resoult::ok : handle_resoult::error;
+            }
+            return handle_resoult::not_permited;
+        }
+        // for commands the parser already decoded and routed to this controller
+        inline handle_resoult dispatch(const commands::command &command)
+        {
+            return handle(command) ? handle_resoult::ok : handle_resoult::error;
+        }
+        // message -> command, everything but the controller index is filled
+        virtual bool decode(const JsonObject &json, commands::command &command) const = 0;
+        // binary message without the controller byte -> command, see codecs.hpp
+        virtual bool decode_binary(const uint8_t *data, size_t length, commands::command &command) const { return false; }
+        // command -> message without the controller key
+        virtual bool encode(const commands::command &command, JsonObject &json) const = 0;
+        // called with every command once subscribed with parser::add_observer
+        virtual void observe(const commands::command &command) {}
 
         inline const char *get_name() { return _name; }
-        inline uint32_t retrive_data_size() { return _json_size; }
 
-        virtual void update() = 0;
+        // registers periodic tasks, called by the parser after initialize()
+        virtual void schedule(task_scheduler &scheduler) {}
         virtual bool initialize() = 0;
-        virtual DynamicJsonDocument retrive_data() = 0;
+        // writes the "data" value (object, array or null) with fields that changed after version since
+        // (see state_stamps.hpp), every one for state_version::ALL
+        virtual void retrive_data(json_writer &json, uint32_t since) = 0;
+        // version of the last change, parser skips controllers that didn't change since
+        virtual uint32_t version() const { return state_version::FIRST; }
 
     protected:
         virtual bool can_handle(const JsonObject &json) const = 0;
         const char *const _name;
-        uint32_t _json_size;
         static constexpr const char* NAME_FIELD = "name";
         static constexpr const char* DATA_FIELD = "data";
         static constexpr const char* COMMAND_KEY = "command";
         static constexpr const char* CONTROLLER_KEY = "controller";
 
     private:
-        virtual bool handle(const JsonObject &json) = 0;
+        virtual bool handle(const commands::command &command) = 0;
     };
 } // namespace json_parser
 #endif // __ICONTROLLER_HPP__
\ No newline at end of file
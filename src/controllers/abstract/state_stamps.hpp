@@ -0,0 +1,63 @@
+#ifndef __STATE_STAMPS_HPP__
+#define __STATE_STAMPS_HPP__
+
+#include <stdint.h>
+
+namespace json_parser
+{
+    // device wide version of the state, every change of a controller field takes the next one
+    // state is only changed from the control task -> plain counter
+    class state_version
+    {
+    public:
+        // retrive_data(ALL) -> every field, whatever its version
+        static constexpr uint32_t ALL = 0U;
+        // version of fields that never changed
+        static constexpr uint32_t FIRST = 1U;
+
+        static uint32_t current() { return _current; }
+        static uint32_t next() { return ++_current; }
+
+    private:
+        static inline uint32_t _current = FIRST;
+    };
+
+    // version of the last change of every field of a controller
+    // retrive_data(since) puts in only fields that changed after since
+    template <uint8_t FIELDS>
+    class state_stamps
+    {
+    public:
+        state_stamps()
+        {
+            for (auto &stamp : _stamps)
+                stamp = state_version::FIRST;
+        }
+
+        void touch(uint8_t field)
+        {
+            _latest = _stamps[field] = state_version::next();
+        }
+
+        void touch_all()
+        {
+            _latest = state_version::next();
+            for (auto &stamp : _stamps)
+                stamp = _latest;
+        }
+
+        bool changed(uint8_t field, uint32_t since) const
+        {
+            return _stamps[field] > since;
+        }
+
+        // version of the newest field
+        uint32_t latest() const { return _latest; }
+
+    private:
+        uint32_t _stamps[FIELDS];
+        uint32_t _latest = state_version::FIRST;
+    };
+} // namespace json_parser
+
+#endif // __STATE_STAMPS_HPP__
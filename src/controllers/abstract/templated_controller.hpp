@@ -5,21 +5,28 @@
 #include <vector>
 #include <functional>
 #include "controller.hpp"
+#include "command_table.hpp"
 
 namespace json_parser
 {
+    // commands are looked up in T::COMMANDS (compile time table, see command_table.hpp) first
+    // and then in events registered at runtime with add_event
+    // name lookup and argument parsing happen once in decode, handlers get a ready command
     template<typename T>
     class templated_controller : public controller
     {
     public:
-        typedef bool (T::*event)(const JsonObject *);
+        typedef bool (T::*event)(const commands::command &);
 
         typedef struct event_data
         {
-            event_data(const char *command, event fun, unsigned long last_update, size_t interval) : command(command),
-                                                                                                     fun(fun),
-                                                                                                     last_update(last_update),
-                                                                                                     interval(interval)
+            event_data(const char *command, event fun, unsigned long last_update, size_t interval,
+                       commands::codec codec, const char *key) : command(command),
+                                                                 fun(fun),
+                                                                 last_update(last_update),
+                                                                 interval(interval),
+                                                                 codec(codec),
+                                                                 key(key)
             {
             }
 
@@ -27,23 +34,30 @@ namespace json_parser
             event fun;
             unsigned long last_update;
             size_t interval;
+            commands::codec codec;
+            const char *key;
         } event_data;
 
-        templated_controller(const char *name, uint32_t json_size) : controller(name, json_size) {}
+        explicit templated_controller(const char *name) : controller(name) {}
         virtual ~templated_controller() = default;
 
-        bool add_event(const char *command, event function, size_t interval = IDLE_INTERVAL)
+        // id of a table command (-1 if there is none), for those that build binary messages
+        static constexpr int16_t command_id(const char *command) { return T::COMMANDS.find(command); }
+
+        bool add_event(const char *command, event function, size_t interval = IDLE_INTERVAL,
+                       commands::codec codec = commands::codecs::NONE, const char *key = nullptr)
         {
-            if (command && !get_event(command) && function)
+            if (command && T::COMMANDS.find(command) == T::COMMANDS.NOT_FOUND && !get_event(command) && function)
             {
                 unsigned long curr_time = millis();
-                _events.push_back(event_data(command, function, curr_time, interval));
+                _events.push_back(event_data(command, function, curr_time, interval, codec, key));
                 return true;
             }
             else
                 return false;
         }
 
+        // only for events added with add_event
         bool set_interval(const char *command, size_t interval)
         {
             // check if command is valid
@@ -59,15 +73,6 @@ namespace json_parser
             return false;
         }
 
-        handle_resoult try_handle(const JsonObject& json)
-        {
-            if (can_handle(json))
-            {
-                return handle(json) ? handle_resoult::ok : handle_resoult::error;
-            }
-            return handle_resoult::not_permited;
-        }
-
         event_data *get_event(const char *command)
         {
             if (command)
@@ -83,6 +88,68 @@ namespace json_parser
             return nullptr;
         }
 
+        // table commands get ids 0..N-1, runtime events the ones after them
+        bool decode(const JsonObject &json, commands::command &command) const override
+        {
+            const char *name = json[COMMAND_KEY];
+            if (!name)
+                return false;
+
+            auto index = T::COMMANDS.find(name);
+            if (index != T::COMMANDS.NOT_FOUND)
+            {
+                const auto &entry = T::COMMANDS[index];
+                command.id = static_cast<uint8_t>(index);
+                command.set_lane(entry.lane);
+                if (!entry.codec.decode(json, entry.key, command))
+                    return false;
+                if (!entry.coalesced)
+                    command.target = commands::NO_TARGET;
+                return true;
+            }
+
+            for (size_t i = 0; i < _events.size(); i++)
+            {
+                const auto &event = _events[i];
+                if (!strcmp(event.command, name))
+                {
+                    command.id = static_cast<uint8_t>(T::COMMANDS.size() + i);
+                    command.set_lane(command_queue::priority::BULK);
+                    bool decoded = event.codec.decode(json, event.key, command);
+                    command.target = commands::NO_TARGET;
+                    return decoded;
+                }
+            }
+            return false;
+        }
+
+        // [command id, arguments...], runtime events have no binary form
+        bool decode_binary(const uint8_t *data, size_t length, commands::command &command) const override
+        {
+            return T::COMMANDS.decode_binary(data, length, command);
+        }
+
+        bool encode(const commands::command &command, JsonObject &json) const override
+        {
+            if (command.id < T::COMMANDS.size())
+            {
+                const auto &entry = T::COMMANDS[command.id];
+                json[COMMAND_KEY] = entry.name;
+                entry.codec.encode(command, entry.key, json);
+                return true;
+            }
+
+            size_t index = command.id - T::COMMANDS.size();
+            if (index < _events.size())
+            {
+                const auto &event = _events[index];
+                json[COMMAND_KEY] = event.command;
+                event.codec.encode(command, event.key, json);
+                return true;
+            }
+            return false;
+        }
+
     protected:
         virtual bool can_handle(const JsonObject& json) const
         {
@@ -95,20 +162,24 @@ namespace json_parser
                 return false;
         }
         std::vector<event_data> _events;
+        // hidden by controllers declaring their own table
+        static constexpr command_table<T, 0> COMMANDS{};
 
     private:
-        bool handle(const JsonObject& json) override
+        template <typename... Controllers>
+        friend class static_parser;
+
+        bool handle(const commands::command &command) override
         {
-            if (json.containsKey(COMMAND_KEY))
+            if (command.id < T::COMMANDS.size())
             {
-                const char *command = json[COMMAND_KEY];
-                for (auto &action : _events)
-                {
-                    if (!strcmp(action.command, command))
-                    {
-                        return (static_cast<T*>(this)->*action.fun)(&json);
-                    }
-                }
+                return (static_cast<T *>(this)->*T::COMMANDS[command.id].fun)(command);
+            }
+
+            size_t index = command.id - T::COMMANDS.size();
+            if (index < _events.size())
+            {
+                return (static_cast<T *>(this)->*_events[index].fun)(command);
             }
             return false;
         }
@@ -17,7 +17,7 @@
 
 namespace json_parser
 {
-    arm_controller::arm_controller() : templated_controller("arm", JSON_ARRAY_SIZE(SERVOS) + JSON_OBJECT_SIZE(SERVOS * 4) + JSON_OBJECT_SIZE(2))
+    arm_controller::arm_controller() : templated_controller("arm")
     {
     }
 
@@ -49,30 +49,100 @@ namespace json_parser
         }
     }
 
-    arm_controller::servo_data *arm_controller::get_servo_ptr(const JsonObject *json)
+    int16_t arm_controller::servo_index(const char *servo_name)
     {
-        if (json)
+        if (servo_name)
         {
-            if (json->containsKey(NAME_KEY))
+            for (uint8_t i = 0; i < SERVOS; i++)
             {
-                const char *servo_name = (*json)[NAME_KEY];
-                auto servo = get_servo_by_name(servo_name);
-                if (!servo)
+                if (!strcmp(SERVO_NAMES[i], servo_name))
                 {
-                    LOG_ARM_F("[%s] wrong servo name\n", _name)
+                    return i;
                 }
-                return servo;
-            }
-            else
-            {
-                LOG_ARM_F("[%s] no servo name field\n", _name)
             }
         }
-        else
-        {
-            LOG_ARM_F("[%s] JSON object was null\n", _name)
-        }
-        return nullptr;
+        return -1;
+    }
+
+    bool arm_controller::decode_servo(const JsonObject &json, const char *key, commands::command &command)
+    {
+        auto index = servo_index(json[NAME_KEY]);
+        if (index < 0)
+            return false;
+
+        command.args.servo.servo = static_cast<uint8_t>(index);
+        command.args.servo.angle = 0;
+        command.target = command.args.servo.servo;
+        return true;
+    }
+
+    void arm_controller::encode_servo(const commands::command &command, const char *key, JsonObject &json)
+    {
+        json[NAME_KEY] = SERVO_NAMES[command.args.servo.servo];
+    }
+
+    bool arm_controller::decode_servo_angle(const JsonObject &json, const char *key, commands::command &command)
+    {
+        auto angle = json[ANGLE_KEY];
+        if (!decode_servo(json, key, command) || !angle.is<uint8_t>())
+            return false;
+
+        command.args.servo.angle = angle;
+        return true;
+    }
+
+    void arm_controller::encode_servo_angle(const commands::command &command, const char *key, JsonObject &json)
+    {
+        encode_servo(command, key, json);
+        json[ANGLE_KEY] = command.args.servo.angle;
+    }
+
+    bool arm_controller::read_servo(const uint8_t *data, size_t length, commands::command &command)
+    {
+        if (length != 1 || data[0] >= SERVOS)
+            return false;
+
+        command.args.servo.servo = data[0];
+        command.args.servo.angle = 0;
+        command.target = command.args.servo.servo;
+        return true;
+    }
+
+    bool arm_controller::read_servo_angle(const uint8_t *data, size_t length, commands::command &command)
+    {
+        if (length != 2 || !read_servo(data, 1, command))
+            return false;
+
+        command.args.servo.angle = data[1];
+        return true;
+    }
+
+    bool arm_controller::decode_servo_setpoint(const JsonObject &json, const char *key, commands::command &command)
+    {
+        auto index = servo_index(json[NAME_KEY]);
+        if (index < 0)
+            return false;
+
+        command.args.setpoint.target = static_cast<uint8_t>(index);
+        command.target = command.args.setpoint.target;
+        return commands::codecs::decode_setpoint_value(json, VALUE_KEY, command);
+    }
+
+    void arm_controller::encode_servo_setpoint(const commands::command &command, const char *key, JsonObject &json)
+    {
+        json[NAME_KEY] = SERVO_NAMES[command.args.setpoint.target];
+        commands::codecs::encode_setpoint_value(command, VALUE_KEY, json);
+    }
+
+    bool arm_controller::read_servo_setpoint(const uint8_t *data, size_t length, commands::command &command)
+    {
+        if (length != 3 || data[0] >= SERVOS)
+            return false;
+
+        command.args.setpoint.target = data[0];
+        command.target = data[0];
+        commands::codecs::read_setpoint_value(data + 1, command);
+        return true;
     }
 
     bool arm_controller::initialize()
@@ -84,120 +154,136 @@ namespace json_parser
         for (uint8_t i = 0; i < SERVOS; i++)
             send_angle(i);
 
-        bool if_added = true;
+        return true;
+    }
 
-        if_added &= add_event(SERVO_MINUS, &arm_controller::servo_minus);
-        if_added &= add_event(SERVO_PLUS, &arm_controller::servo_plus);
-        if_added &= add_event(SERVO_STOP, &arm_controller::servo_stop);
-        if_added &= add_event(SERVO_ANGLE, &arm_controller::servo_angle);
-        
-        return if_added;
+    bool arm_controller::servo_minus(const commands::command &command)
+    {
+        _following &= ~(1U << command.args.servo.servo);
+        auto &servo = arm[command.args.servo.servo];
+        servo.destination_angle = servo.MIN_ANGLE;
+        LOG_ARM_F("[%s] servo %s moving to %d\n", _name, servo.NAME, servo.destination_angle)
+        return true;
     }
 
-    bool arm_controller::servo_minus(const JsonObject *json)
+    bool arm_controller::servo_plus(const commands::command &command)
     {
-        servo_data *servo = get_servo_ptr(json);
-        if (servo)
-        {
-            servo->destination_angle = servo->MIN_ANGLE;
-            LOG_ARM_F("[%s] servo %s moving to %d\n", _name, servo->NAME, servo->destination_angle)
-            return true;
-        }
-        return false;
+        _following &= ~(1U << command.args.servo.servo);
+        auto &servo = arm[command.args.servo.servo];
+        servo.destination_angle = servo.MAX_ANGLE;
+        LOG_ARM_F("[%s] servo %s moving to %d\n", _name, servo.NAME, servo.destination_angle)
+        return true;
     }
 
-    bool arm_controller::servo_plus(const JsonObject *json)
+    bool arm_controller::servo_stop(const commands::command &command)
     {
-        servo_data *servo = get_servo_ptr(json);
-        if (servo)
-        {
-            servo->destination_angle = servo->MAX_ANGLE;
-            LOG_ARM_F("[%s] servo %s moving to %d\n", _name, servo->NAME, servo->destination_angle)
-            return true;
-        }
-        return false;
+        _following &= ~(1U << command.args.servo.servo);
+        auto &servo = arm[command.args.servo.servo];
+        servo.destination_angle = servo.current_angle;
+        LOG_ARM_F("[%s] servo %s stopping at angle %d\n", _name, servo.NAME, servo.current_angle)
+        return true;
     }
 
-    bool arm_controller::servo_stop(const JsonObject *json)
+    bool arm_controller::servo_angle(const commands::command &command)
     {
-        servo_data *servo = get_servo_ptr(json);
-        if (servo)
+        _following &= ~(1U << command.args.servo.servo);
+        auto &servo = arm[command.args.servo.servo];
+        uint8_t new_angle = command.args.servo.angle;
+        if (new_angle >= servo.MIN_ANGLE && new_angle <= servo.MAX_ANGLE)
         {
-            servo->destination_angle = servo->current_angle;
-            LOG_ARM_F("[%s] servo %s stopping at angle %d\n", _name, servo->NAME, servo->current_angle)
+            servo.destination_angle = new_angle;
+            LOG_ARM_F("[%s] servo %s moving to %d\n", _name, servo.NAME, servo.destination_angle)
             return true;
         }
+        else
+        {
+            LOG_ARM_F("[%s] angle %d out of range for servo %s", _name, new_angle, servo.NAME)
+        }
         return false;
     }
 
-    bool arm_controller::servo_angle(const JsonObject *json)
+    bool arm_controller::servo_setpoint(const commands::command &command)
+    {
+        uint8_t index = command.args.setpoint.target;
+        uint8_t bit = 1U << index;
+        // filter starts where the servo is -> no jump when it's taken over
+        if (!(_following & bit))
+            _setpoints[index].reset(setpoint_of(index));
+        _following |= bit;
+        _setpoints[index].sample(command.args.setpoint.value, scheduler::uptime());
+        return true;
+    }
+
+    int16_t arm_controller::setpoint_of(uint8_t index) const
+    {
+        const auto &servo = arm[index];
+        int32_t range = servo.MAX_ANGLE - servo.MIN_ANGLE;
+        int32_t offset = servo.current_angle - servo.MIN_ANGLE;
+        return static_cast<int16_t>(offset * 2 * setpoint::FULL_SCALE / range - setpoint::FULL_SCALE);
+    }
+
+    uint8_t arm_controller::angle_of(uint8_t index, int16_t value) const
+    {
+        const auto &servo = arm[index];
+        int32_t range = servo.MAX_ANGLE - servo.MIN_ANGLE;
+        // rounded to the nearest degree
+        int32_t offset = ((value + setpoint::FULL_SCALE) * range + setpoint::FULL_SCALE) / (2 * setpoint::FULL_SCALE);
+        return static_cast<uint8_t>(servo.MIN_ANGLE + offset);
+    }
+
+    void arm_controller::schedule(task_scheduler &scheduler)
     {
-        servo_data *servo = get_servo_ptr(json);
-        if (servo)
+        scheduler.add<arm_controller, &arm_controller::move_servos>(*this, SERVO_TIMEOUT, SERVO_PHASE);
+    }
+
+    void arm_controller::move_servos()
+    {
+        uint32_t now = _following ? scheduler::uptime() : 0U;
+        for (uint8_t i = 0; i < SERVOS; i++)
         {
-            if (json->containsKey(ANGLE_KEY))
+            auto &servo = arm[i];
+            bool send_changes = false;
+            if (_following & (1U << i))
             {
-                uint8_t new_angle = (*json)[ANGLE_KEY];
-                if (new_angle >= servo->MIN_ANGLE && new_angle <= servo->MAX_ANGLE)
-                {
-                    servo->destination_angle = new_angle;
-                    LOG_ARM_F("[%s] servo %s moving to %d\n", _name, servo->NAME, servo->destination_angle)
-                    return true;
-                }
-                else
-                {
-                    LOG_ARM_F("[%s] angle %d out of range for servo %s", _name, new_angle, servo->NAME)
-                }
+                // whole way to the filtered angle, the filter already keeps the steps small
+                uint8_t angle = angle_of(i, _setpoints[i].update(now));
+                send_changes = angle != servo.current_angle;
+                servo.destination_angle = servo.current_angle = angle;
             }
-            else
+            else if (servo.destination_angle > servo.current_angle && servo.current_angle < servo.MAX_ANGLE)
             {
-                LOG_ARM_F("[%s] no angle field\n", _name)
+                servo.current_angle++;
+                send_changes = true;
             }
-        }
-        return false;
-    }
-
-    void arm_controller::update()
-    {
-        static unsigned long timer = millis();
-        if (millis() - timer > SERVO_TIMEOUT)
-        {
-            for (uint8_t i = 0; i < SERVOS; i++)
+            else if (servo.destination_angle < servo.current_angle && servo.current_angle > servo.MIN_ANGLE)
             {
-                auto &servo = arm[i];
-                bool send_changes = false;
-                if (servo.destination_angle > servo.current_angle && servo.current_angle < servo.MAX_ANGLE)
-                {
-                    servo.current_angle++;
-                    send_changes = true;
-                }
-                else if (servo.destination_angle < servo.current_angle && servo.current_angle > servo.MIN_ANGLE)
-                {
-                    servo.current_angle--;
-                    send_changes = true;
-                }
-                if (send_changes)
-                    send_angle(i);
+                servo.current_angle--;
+                send_changes = true;
+            }
+            if (send_changes)
+            {
+                send_angle(i);
+                _state.touch(i);
             }
-            timer = millis();
         }
     }
 
 
-    DynamicJsonDocument arm_controller::retrive_data()
+    void arm_controller::retrive_data(json_writer &json, uint32_t since)
     {
-        DynamicJsonDocument json(_json_size);
-        json[NAME_FIELD] = _name;
-        JsonArray data = json.createNestedArray(DATA_FIELD);
-
+        json.begin_array();
         for(uint8_t i = 0; i < SERVOS; i++)
         {
-            JsonObject servo = data.createNestedObject();
-            servo["servo"] = arm[i].NAME;
-            servo["min"] = arm[i].MIN_ANGLE;
-            servo["max"] = arm[i].MAX_ANGLE;
-            servo["angle"] = arm[i].current_angle;
+            if (!_state.changed(i, since))
+                continue;
+
+            json.begin_object();
+            json.member("servo", arm[i].NAME);
+            json.member("min", arm[i].MIN_ANGLE);
+            json.member("max", arm[i].MAX_ANGLE);
+            json.member("angle", arm[i].current_angle);
+            json.end_object();
         }
-        return json;
+        json.end_array();
     }
 } // namespace json_parser
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <ArduinoJson.h>
 #include <Adafruit_PWMServoDriver.h>
 #include "abstract/templated_controller.hpp"
+#include "setpoint/axis_filter.hpp"
 
 namespace json_parser
 {
@@ -25,43 +26,94 @@ namespace json_parser
         explicit arm_controller();
 
         bool initialize() override;
-        void update() override;
-        DynamicJsonDocument retrive_data() override;
+        void schedule(task_scheduler &scheduler) override;
+        void retrive_data(json_writer &json, uint32_t since) override;
+        uint32_t version() const override { return _state.latest(); }
         servo_data* get_servo_by_name(const char* servo_name);
 
     private:
-        bool servo_minus(const JsonObject *json);
-        bool servo_plus(const JsonObject *json);
-        bool servo_stop(const JsonObject *json);
-        bool servo_angle(const JsonObject *json);
+        bool servo_minus(const commands::command &command);
+        bool servo_plus(const commands::command &command);
+        bool servo_stop(const commands::command &command);
+        bool servo_angle(const commands::command &command);
+        // -1.0 (MIN_ANGLE) - 1.0 (MAX_ANGLE), the servo follows it until another command takes it over
+        bool servo_setpoint(const commands::command &command);
 
         void send_angle(uint8_t index);
-        servo_data *get_servo_ptr(const JsonObject *json);
+        // periodic task, moves every servo a degree closer to its destination
+        void move_servos();
+        int16_t setpoint_of(uint8_t index) const;
+        uint8_t angle_of(uint8_t index, int16_t value) const;
+
+        // -1 for unknown servo
+        static int16_t servo_index(const char *servo_name);
+        // {"servo": name}
+        static bool decode_servo(const JsonObject &json, const char *key, commands::command &command);
+        static void encode_servo(const commands::command &command, const char *key, JsonObject &json);
+        // {"servo": name, "angle": 0 - 255}, range of the servo itself is checked by the handler
+        static bool decode_servo_angle(const JsonObject &json, const char *key, commands::command &command);
+        static void encode_servo_angle(const commands::command &command, const char *key, JsonObject &json);
+        // [servo index] and [servo index, angle]
+        static bool read_servo(const uint8_t *data, size_t length, commands::command &command);
+        static bool read_servo_angle(const uint8_t *data, size_t length, commands::command &command);
+        // {"servo": name, "value": -1.0 - 1.0} and [servo index, value: i16]
+        static bool decode_servo_setpoint(const JsonObject &json, const char *key, commands::command &command);
+        static void encode_servo_setpoint(const commands::command &command, const char *key, JsonObject &json);
+        static bool read_servo_setpoint(const uint8_t *data, size_t length, commands::command &command);
 
         static constexpr const char *SERVO_MINUS = "minus";
         static constexpr const char *SERVO_PLUS = "plus";
         static constexpr const char *SERVO_STOP = "stop";
         static constexpr const char *SERVO_ANGLE = "angle";
+        static constexpr const char *SERVO_SETPOINT = "setpoint";
+
+        static constexpr commands::codec SERVO_CODEC = {decode_servo, encode_servo, read_servo};
+        static constexpr commands::codec SERVO_ANGLE_CODEC = {decode_servo_angle, encode_servo_angle, read_servo_angle};
+        static constexpr commands::codec SERVO_SETPOINT_CODEC = {decode_servo_setpoint, encode_servo_setpoint, read_servo_setpoint};
+
+        friend class templated_controller<arm_controller>;
+        static constexpr auto COMMANDS = make_command_table<arm_controller>({
+            {SERVO_MINUS, &arm_controller::servo_minus, SERVO_CODEC, nullptr, command_queue::priority::CONTROL},
+            {SERVO_PLUS, &arm_controller::servo_plus, SERVO_CODEC, nullptr, command_queue::priority::CONTROL},
+            {SERVO_STOP, &arm_controller::servo_stop, SERVO_CODEC, nullptr, command_queue::priority::CONTROL},
+            {SERVO_ANGLE, &arm_controller::servo_angle, SERVO_ANGLE_CODEC, nullptr, command_queue::priority::CONTROL, true},
+            {SERVO_SETPOINT, &arm_controller::servo_setpoint, SERVO_SETPOINT_CODEC, nullptr, command_queue::priority::CONTROL, true},
+        });
+
         static constexpr uint8_t SERVOS = 6;
+        static constexpr const char *SERVO_NAMES[SERVOS] = {"base", "shoulder", "elbow", "wrist", "rotation", "claw"};
 
         static constexpr uint32_t PULSE_MS_MIN = 600U;
         static constexpr uint32_t PULSE_MS_MAX = 2500U;
         static constexpr uint8_t PULSES_FREQUENCY = 50U;
         static constexpr uint32_t SERVO_TIMEOUT = 20U;
+        // offset from the other controllers' tasks, so they don't all fall on the same tick
+        static constexpr uint32_t SERVO_PHASE = 1U;
+        // servos hold their position when the sender is gone
+        static constexpr setpoint::shape SETPOINT_SHAPE = {0, 0U, 96U, 0U};
 
         static constexpr const char *NAME_KEY = "servo";
         static constexpr const char *ANGLE_KEY = "angle";
+        static constexpr const char *VALUE_KEY = "value";
 
         Adafruit_PWMServoDriver _pwm;
 
         servo_data arm[SERVOS] = {
-            servo_data{"base", 5, 175, 90, 90, 0},
-            servo_data{"shoulder", 0, 150, 140, 140, 3},
-            servo_data{"elbow", 0, 130, 120, 120, 7},
-            servo_data{"wrist", 70, 180, 90, 90, 8},
-            servo_data{"rotation", 0, 180, 90, 90, 12},
-            servo_data{"claw", 5, 60, 15, 15, 11},
+            servo_data{SERVO_NAMES[0], 5, 175, 90, 90, 0},
+            servo_data{SERVO_NAMES[1], 0, 150, 140, 140, 3},
+            servo_data{SERVO_NAMES[2], 0, 130, 120, 120, 7},
+            servo_data{SERVO_NAMES[3], 70, 180, 90, 90, 8},
+            servo_data{SERVO_NAMES[4], 0, 180, 90, 90, 12},
+            servo_data{SERVO_NAMES[5], 5, 60, 15, 15, 11},
+        };
+        setpoint::axis_filter _setpoints[SERVOS] = {
+            setpoint::axis_filter{SETPOINT_SHAPE}, setpoint::axis_filter{SETPOINT_SHAPE}, setpoint::axis_filter{SETPOINT_SHAPE},
+            setpoint::axis_filter{SETPOINT_SHAPE}, setpoint::axis_filter{SETPOINT_SHAPE}, setpoint::axis_filter{SETPOINT_SHAPE},
         };
+        // bit of every servo that follows its setpoint
+        uint8_t _following = 0;
+        // every servo is sent whole, index of the servo is its field
+        state_stamps<SERVOS> _state;
     };
 } // namespace json_parser
 
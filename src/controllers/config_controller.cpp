@@ -2,6 +2,9 @@
 #include "debug.hpp"
 #include "config_controller.hpp"
 #include "webserver.hpp"
+#include "global_queue.hpp"
+#include "profiler/profiler.hpp"
+#include "udp_control/udp_control.hpp"
 
 #if CONFIG_DEBUG
 
@@ -21,29 +24,349 @@
 
 namespace json_parser
 {
-    config_controller::config_controller(const parser &parser) : templated_controller("config", JSON_OBJECT_SIZE(2)),
-                                                                 _parser(parser)
+    config_controller::config_controller(const abstract_parser &parser) : templated_controller("config"),
+                                                                 _parser(parser),
+                                                                 _telemetry([]() -> uint32_t { return micros(); })
     {
     }
 
     bool config_controller::initialize()
     {
-        return add_event(GET_DATA, &config_controller::get_data);
+        return true;
+    }
+
+    void config_controller::schedule(task_scheduler &scheduler)
+    {
+        _scheduler = &scheduler;
+        _telemetry_task = scheduler.add<config_controller, &config_controller::publish_telemetry>(*this, 1000U, TELEMETRY_PHASE);
+        // until a client asks for it
+        scheduler.suspend(_telemetry_task);
+    }
+
+    void config_controller::publish_telemetry()
+    {
+        if (!webserver::has_clients())
+        {
+            _telemetry.resync();
+            return;
+        }
+
+        auto write = [this](json_writer &json, uint32_t since) { _parser.retrive_data(json, since); };
+        char *frame = _telemetry.frame(write);
+        if (frame && !webserver::publish_telemetry(frame))
+            _telemetry.drop();
+        // only the clients that missed a frame get the whole state, the rest keeps getting the changes
+        // one that doesn't get there is asked for again with the next frame
+        if (webserver::take_missed_frame())
+            webserver::publish_resync(_telemetry.whole_frame(write));
+    }
+
+    bool config_controller::get_data(const commands::command &command)
+    {
+        // "since" -> only what changed after the version from the previous answer
+        uint32_t since = command.args.value.present ? command.args.value.value : state_version::ALL;
+        // written straight into the message, nothing else is allocated
+        char *message = write_to_heap([this, since](json_writer &json) { _parser.retrive_data(json, since); });
+        if (!message)
+        {
+            LOG_CONFIG_NL("[config] no memory for the state")
+            return false;
+        }
+        LOG_CONFIG_F("[config] state: %u bytes, free heap: %u\n", strlen(message), esp_get_free_heap_size())
+        webserver::send_ws(message);
+        return true;
+    }
+
+    bool config_controller::queue_stats(const commands::command &command)
+    {
+        static constexpr const char *LANE_NAMES[] = {"safety", "control", "bulk"};
+
+        DynamicJsonDocument stats(JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(command_queue::LANES) +
+                                  command_queue::LANES * JSON_OBJECT_SIZE(5));
+        auto total = global_queue::queue.stats();
+        stats[NAME_FIELD] = QUEUE_STATS;
+        JsonObject data = stats.createNestedObject(DATA_FIELD);
+        data["dropped"] = total.dropped;
+        data["in_use"] = total.in_use;
+        data[COALESCING] = global_queue::queue.coalescing();
+        JsonObject lanes = data.createNestedObject("lanes");
+        for (uint8_t i = 0; i < command_queue::LANES; i++)
+        {
+            auto lane = global_queue::queue.stats(static_cast<command_queue::priority>(i));
+            JsonObject lane_json = lanes.createNestedObject(LANE_NAMES[i]);
+            lane_json["depth"] = lane.depth;
+            lane_json["peak"] = lane.peak;
+            lane_json["pushed"] = lane.pushed;
+            lane_json["dropped"] = lane.dropped;
+            lane_json["coalesced"] = lane.coalesced;
+        }
+        LOG_CONFIG_JSON_PRETTY(stats)
+        webserver::send_ws(stats);
+        return true;
+    }
+
+    bool config_controller::coalescing(const commands::command &command)
+    {
+        bool enabled = command.args.value.value;
+        global_queue::queue.set_coalescing(enabled);
+        LOG_CONFIG_F("[%s] coalescing: %s\n", _name, enabled ? "on" : "off")
+        return true;
+    }
+
+    // optional budget key sets new budget, current statistics are always sent back
+    bool config_controller::drain(const commands::command &command)
+    {
+        if (command.args.value.present)
+        {
+            uint32_t budget = command.args.value.value;
+            global_queue::drain.set_budget(budget);
+            LOG_CONFIG_F("[%s] new drain budget: %u us\n", _name, budget)
+        }
+
+        const auto &drain_stats = global_queue::drain.stats();
+        StaticJsonDocument<JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(8)> stats;
+        stats[NAME_FIELD] = DRAIN;
+        JsonObject data = stats.createNestedObject(DATA_FIELD);
+        data[BUDGET_KEY] = global_queue::drain.budget();
+        data["drained"] = drain_stats.drained;
+        data["time"] = drain_stats.time_us;
+        data["max_drained"] = drain_stats.max_drained;
+        data["max_time"] = drain_stats.max_time_us;
+        data["total_drained"] = drain_stats.total_drained;
+        data["passes"] = drain_stats.passes;
+        data["overruns"] = drain_stats.overruns;
+        LOG_CONFIG_JSON_PRETTY(stats)
+        webserver::send_ws(stats);
+        return true;
+    }
+
+    // how much of the time the control task was blocked and how late controller tasks ran
+    bool config_controller::idle(const commands::command &command)
+    {
+        const auto &idle_stats = global_queue::idle.stats();
+        const auto &task_stats = _parser.tasks().stats();
+        StaticJsonDocument<JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(3)> stats;
+        stats[NAME_FIELD] = IDLE;
+        JsonObject data = stats.createNestedObject(DATA_FIELD);
+        data["percent"] = idle_stats.idle_percent;
+        data["waits"] = idle_stats.waits;
+        data["early_wakeups"] = idle_stats.early_wakeups;
+        data["max_sleep"] = idle_stats.max_sleep_us;
+        // servo steps and speed ramps that started after their deadline
+        JsonObject tasks = data.createNestedObject("tasks");
+        tasks["runs"] = task_stats.runs;
+        tasks["late"] = task_stats.late;
+        tasks["max_late"] = task_stats.max_late_ms;
+        LOG_CONFIG_JSON_PRETTY(stats)
+        webserver::send_ws(stats);
+        return true;
+    }
+
+    // optional budget key sets new budget (us), timings of every controller are sent back
+    // {name, handle: {count, min, avg, max, p99, over}, tasks: {...}, data: {...}}
+    // data is one pass per message, measuring it before writing takes about as long again
+    bool config_controller::profile(const commands::command &command)
+    {
+#if PROFILING
+        static constexpr const char *KIND_NAMES[profiler::KINDS] = {"handle", "tasks", "data"};
+        static constexpr size_t CALLS_SIZE = JSON_OBJECT_SIZE(6);
+        static constexpr size_t CONTROLLER_SIZE = JSON_OBJECT_SIZE(1 + profiler::KINDS) + profiler::KINDS * CALLS_SIZE;
+
+        auto &timings = profiler::instance;
+        if (command.args.value.present)
+        {
+            timings.set_budget(command.args.value.value);
+            LOG_CONFIG_F("[%s] new profile budget: %u us\n", _name, timings.budget())
+        }
+
+        DynamicJsonDocument stats(JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(3) +
+                                  JSON_ARRAY_SIZE(timings.size()) + timings.size() * CONTROLLER_SIZE);
+        stats[NAME_FIELD] = PROFILE;
+        JsonObject data = stats.createNestedObject(DATA_FIELD);
+        data[BUDGET_KEY] = timings.budget();
+        data["overruns"] = timings.overruns();
+        // data samples cover the writing pass only, not the measuring one
+        data["data_pass"] = "write";
+        if (timings.overruns())
+        {
+            const auto &last = timings.last_overrun();
+            const auto *owner = timings.get(last.controller);
+            JsonObject last_json = data.createNestedObject("last_overrun");
+            last_json[NAME_FIELD] = owner ? owner->name : nullptr;
+            last_json["kind"] = KIND_NAMES[static_cast<uint8_t>(last.type)];
+            last_json["time"] = last.time_us;
+        }
+
+        JsonArray controllers = data.createNestedArray("controllers");
+        for (uint8_t i = 0; i < timings.size(); i++)
+        {
+            const auto *controller = timings.get(i);
+            if (!controller)
+                continue;
+
+            JsonObject controller_json = controllers.createNestedObject();
+            controller_json[NAME_FIELD] = controller->name;
+            for (uint8_t kind = 0; kind < profiler::KINDS; kind++)
+            {
+                const auto &calls = controller->calls[kind];
+                JsonObject calls_json = controller_json.createNestedObject(KIND_NAMES[kind]);
+                calls_json["count"] = calls.count();
+                calls_json["min"] = calls.min();
+                calls_json["avg"] = calls.average();
+                calls_json["max"] = calls.max();
+                calls_json["p99"] = calls.percentile(99);
+                calls_json["over"] = calls.over_budget();
+            }
+        }
+        LOG_CONFIG_JSON_PRETTY(stats)
+        webserver::send_ws(stats);
+        return true;
+#else
+        LOG_CONFIG_F("[%s] profiling is compiled out (PROFILING=0)\n", _name)
+        return false;
+#endif // PROFILING
+    }
+
+    bool config_controller::profile_reset(const commands::command &command)
+    {
+#if PROFILING
+        profiler::instance.reset();
+        LOG_CONFIG_F("[%s] profile reset\n", _name)
+        return true;
+#else
+        return false;
+#endif // PROFILING
+    }
+
+    // optional rate key sets frames per second (0 stops them), cost of the frames is sent back
+    bool config_controller::telemetry(const commands::command &command)
+    {
+        if (command.args.value.present)
+        {
+            _telemetry.set_rate(command.args.value.value);
+            if (_scheduler && _telemetry.rate())
+            {
+                _scheduler->set_period(_telemetry_task, _telemetry.period_ms());
+                _scheduler->resume(_telemetry_task);
+            }
+            else if (_scheduler)
+            {
+                _scheduler->suspend(_telemetry_task);
+            }
+            LOG_CONFIG_F("[%s] telemetry rate: %u\n", _name, _telemetry.rate())
+        }
+
+        StaticJsonDocument<JSON_OBJECT_SIZE(2) + telemetry::REPORT_SIZE> stats;
+        stats[NAME_FIELD] = TELEMETRY;
+        telemetry::report(_telemetry, webserver::skipped_clients(), stats.createNestedObject(DATA_FIELD));
+        LOG_CONFIG_JSON_PRETTY(stats)
+        webserver::send_ws(stats);
+        return true;
+    }
+
+    // loss and reordering seen on the udp control port
+    bool config_controller::udp(const commands::command &command)
+    {
+        auto channel = udp_control::control_port::stats();
+        StaticJsonDocument<JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(10)> stats;
+        stats[NAME_FIELD] = UDP;
+        JsonObject data = stats.createNestedObject(DATA_FIELD);
+        data["enabled"] = static_cast<bool>(UDP_CONTROL);
+        data["received"] = channel.received;
+        data["applied"] = channel.applied;
+        data["lost"] = channel.lost;
+        data["reordered"] = channel.reordered;
+        data["stale"] = channel.stale;
+        data["duplicates"] = channel.duplicates;
+        data["invalid"] = channel.invalid;
+        data["restarts"] = channel.restarts;
+        data["failsafes"] = udp_control::control_port::failsafes();
+        LOG_CONFIG_JSON_PRETTY(stats)
+        webserver::send_ws(stats);
+        return true;
+    }
+
+    // limits of every class of websocket traffic and what each client got through
+    bool config_controller::throttle(const commands::command &command)
+    {
+        static constexpr const char *CLASSES[ingress::TRAFFIC_CLASSES] = {"control", "bulk", "config"};
+
+        webserver::client_throttle::client_stats clients[webserver::MAX_CLIENTS];
+        uint8_t count = webserver::throttle_stats(clients);
+        webserver::control_throttle::client_stats drivers[webserver::MAX_CONTROL_CLIENTS];
+        uint8_t driver_count = webserver::throttle_stats(drivers);
+        StaticJsonDocument<JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(4) + JSON_OBJECT_SIZE(ingress::TRAFFIC_CLASSES) +
+                           ingress::TRAFFIC_CLASSES * JSON_OBJECT_SIZE(2) + JSON_ARRAY_SIZE(webserver::MAX_CLIENTS) +
+                           webserver::MAX_CLIENTS * JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(webserver::MAX_CONTROL_CLIENTS) +
+                           webserver::MAX_CONTROL_CLIENTS * JSON_OBJECT_SIZE(3)>
+            stats;
+        stats[NAME_FIELD] = THROTTLE;
+        JsonObject data = stats.createNestedObject(DATA_FIELD);
+        JsonObject limits = data.createNestedObject("limits");
+        for (uint8_t i = 0; i < ingress::TRAFFIC_CLASSES; i++)
+        {
+            const auto &limit = webserver::throttle_limit(static_cast<ingress::traffic>(i));
+            JsonObject type = limits.createNestedObject(CLASSES[i]);
+            type[RATE_KEY] = limit.rate;
+            type["burst"] = limit.burst;
+        }
+        JsonArray per_client = data.createNestedArray("clients");
+        for (uint8_t i = 0; i < count; i++)
+        {
+            JsonObject client = per_client.createNestedObject();
+            client["id"] = clients[i].client;
+            client["admitted"] = clients[i].admitted;
+            client["throttled"] = clients[i].throttled;
+        }
+        // same for the control endpoint, its ids are counted apart from the bulk ones
+        JsonArray per_driver = data.createNestedArray("control_clients");
+        for (uint8_t i = 0; i < driver_count; i++)
+        {
+            JsonObject client = per_driver.createNestedObject();
+            client["id"] = drivers[i].client;
+            client["admitted"] = drivers[i].admitted;
+            client["throttled"] = drivers[i].throttled;
+        }
+        data["no_slot"] = webserver::throttle_no_slot();
+        LOG_CONFIG_JSON_PRETTY(stats)
+        webserver::send_ws(stats);
+        return true;
     }
 
-    bool config_controller::get_data(const JsonObject *json)
+    // what waits for every client, what it didn't get and how long it took
+    bool config_controller::outgoing(const commands::command &command)
     {
-        auto retrived_json = _parser.retrive_data();
-        LOG_CONFIG_JSON_PRETTY(retrived_json)
-        webserver::send_ws(retrived_json);
+        webserver::client_queues::statistics clients[webserver::MAX_CLIENTS];
+        uint8_t count = webserver::outgoing_stats(clients);
+        StaticJsonDocument<JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(2) + JSON_ARRAY_SIZE(webserver::MAX_CLIENTS) +
+                           webserver::MAX_CLIENTS * (JSON_OBJECT_SIZE(7) + JSON_OBJECT_SIZE(3))>
+            stats;
+        stats[NAME_FIELD] = OUTGOING;
+        JsonObject data = stats.createNestedObject(DATA_FIELD);
+        JsonArray per_client = data.createNestedArray("clients");
+        for (uint8_t i = 0; i < count; i++)
+        {
+            JsonObject client = per_client.createNestedObject();
+            client["id"] = clients[i].client;
+            client["depth"] = clients[i].depth;
+            client["bytes"] = clients[i].bytes;
+            client["sent"] = clients[i].sent;
+            client["dropped"] = clients[i].dropped;
+            client["replaced"] = clients[i].replaced;
+            JsonObject latency = client.createNestedObject("latency");
+            latency["last"] = clients[i].last_latency_us;
+            latency["avg"] = clients[i].average_latency_us;
+            latency["max"] = clients[i].max_latency_us;
+        }
+        // state frames some client didn't get
+        data["missed_frames"] = webserver::skipped_clients();
+        LOG_CONFIG_JSON_PRETTY(stats)
+        webserver::send_ws(stats);
         return true;
     }
 
-    DynamicJsonDocument config_controller::retrive_data()
+    void config_controller::retrive_data(json_writer &json, uint32_t since)
     {
-        DynamicJsonDocument json(_json_size);
-        json[NAME_FIELD] = _name;
-        json[DATA_FIELD] = nullptr;
-        return json;
+        json.value(nullptr);
     }
 } // namespace json_parser
@@ -3,24 +3,74 @@
 
 #include <ArduinoJson.h>
 #include "abstract/templated_controller.hpp"
-#include "json_parser/parser.hpp"
+#include "json_parser/abstract_parser.hpp"
+#include "telemetry/publisher.hpp"
+#include "telemetry/report.hpp"
 
 namespace json_parser
 {
     class config_controller final : public templated_controller<config_controller> {
     public:
 
-        explicit config_controller(const parser& parser);
+        explicit config_controller(const abstract_parser& parser);
         bool initialize() override;
-        void update() override {}
-        DynamicJsonDocument retrive_data() override;
+        void schedule(task_scheduler &scheduler) override;
+        void retrive_data(json_writer &json, uint32_t since) override;
 
     private:
         static constexpr const char* GET_DATA = "get";
+        static constexpr const char* SINCE_KEY = "since";
+        static constexpr const char* QUEUE_STATS = "queue";
+        static constexpr const char* COALESCING = "coalescing";
+        static constexpr const char* ENABLED_KEY = "enabled";
+        static constexpr const char* DRAIN = "drain";
+        static constexpr const char* BUDGET_KEY = "budget";
+        static constexpr const char* IDLE = "idle";
+        static constexpr const char* PROFILE = "profile";
+        static constexpr const char* PROFILE_RESET = "profile_reset";
+        static constexpr const char* TELEMETRY = "telemetry";
+        static constexpr const char* RATE_KEY = "rate";
+        static constexpr const char* UDP = "udp";
+        static constexpr const char* THROTTLE = "throttle";
+        static constexpr const char* OUTGOING = "outgoing";
 
-        bool get_data(const JsonObject *json);
+        bool get_data(const commands::command &command);
+        bool queue_stats(const commands::command &command);
+        bool coalescing(const commands::command &command);
+        bool drain(const commands::command &command);
+        bool idle(const commands::command &command);
+        bool profile(const commands::command &command);
+        bool profile_reset(const commands::command &command);
+        bool telemetry(const commands::command &command);
+        bool udp(const commands::command &command);
+        bool throttle(const commands::command &command);
+        bool outgoing(const commands::command &command);
 
-        const parser& _parser;
+        void publish_telemetry();
+
+        friend class templated_controller<config_controller>;
+        static constexpr auto COMMANDS = make_command_table<config_controller>({
+            {GET_DATA, &config_controller::get_data, commands::codecs::OPTIONAL_VALUE, SINCE_KEY},
+            {QUEUE_STATS, &config_controller::queue_stats},
+            {COALESCING, &config_controller::coalescing, commands::codecs::VALUE, ENABLED_KEY},
+            {DRAIN, &config_controller::drain, commands::codecs::OPTIONAL_VALUE, BUDGET_KEY},
+            {IDLE, &config_controller::idle},
+            {PROFILE, &config_controller::profile, commands::codecs::OPTIONAL_VALUE, BUDGET_KEY},
+            {PROFILE_RESET, &config_controller::profile_reset},
+            {TELEMETRY, &config_controller::telemetry, commands::codecs::OPTIONAL_VALUE, RATE_KEY},
+            {UDP, &config_controller::udp},
+            {THROTTLE, &config_controller::throttle},
+            {OUTGOING, &config_controller::outgoing},
+        });
+
+        // after the controllers, with the state they changed in this tick
+        static constexpr uint32_t TELEMETRY_PHASE = 4U;
+
+        const abstract_parser& _parser;
+        telemetry::publisher _telemetry;
+        // telemetry changes period of the task
+        task_scheduler *_scheduler = nullptr;
+        int16_t _telemetry_task = task_scheduler::NO_TASK;
     };
 }
 
@@ -17,7 +17,7 @@
 
 namespace json_parser
 {
-    engines_controller::engines_controller() : templated_controller("engines", JSON_OBJECT_SIZE(14) + JSON_ARRAY_SIZE(2))
+    engines_controller::engines_controller() : templated_controller("engines")
     {
     }
 
@@ -76,136 +76,106 @@ namespace json_parser
 #endif
         LOG_ENGINE_F("[%s] initialized engine pins\n", _name)
 
-        bool if_added = true;
-
-        if_added &= add_event(FORWARD, &engines_controller::forward);
-        if_added &= add_event(BACKWARD, &engines_controller::backward);
-        if_added &= add_event(STOP, &engines_controller::stop);
-        if_added &= add_event(FASTER, &engines_controller::faster);
-        if_added &= add_event(SLOWER, &engines_controller::slower);
-        if_added &= add_event(KEEP_SPEED, &engines_controller::keep_speed);
-        if_added &= add_event(SPEED, &engines_controller::set_speed);
-        if_added &= add_event(ROTATE, &engines_controller::rotate);
-
         return true;
     }
 
-    bool engines_controller::forward(const JsonObject *json)
+    bool engines_controller::forward(const commands::command &command)
     {
-        bool if_executed = false;
-        const char *engines = get_engine_from_json(json);
-        if (engines)
-        {
-            if (!strcmp(engines, BOTH))
-            {
-                forward_left();
-                forward_right();
-                if_executed = true;
-            }
-            else if (!strcmp(engines, LEFT))
-            {
-                forward_left();
-                if_executed = true;
-            }
-            else if (!strcmp(engines, RIGHT))
-            {
-                forward_right();
-                if_executed = true;
-            }
-        }
-        return if_executed;
+        release_setpoints(command.args.engine.sides);
+        if (command.args.engine.sides & commands::LEFT)
+            forward_left();
+        if (command.args.engine.sides & commands::RIGHT)
+            forward_right();
+        return true;
     }
 
     void engines_controller::forward_left()
     {
+        // already going that way -> only the speed, the pins stay and nothing changes state
+        if (_direction_left == direction::FORWARD)
+        {
+            enable_speed_left();
+            return;
+        }
+
         disable_speed_left();
         digitalWrite(PIN_FRONT_LEFT, HIGH);
         digitalWrite(PIN_BACK_LEFT, LOW);
         _direction_left = direction::FORWARD;
+        _state.touch(LEFT_STATE);
         enable_speed_left();
         LOG_ENGINE_F("[%s] forward left\n", _name)
     }
 
     void engines_controller::forward_right()
     {
+        if (_direction_right == direction::FORWARD)
+        {
+            enable_speed_right();
+            return;
+        }
+
         disable_speed_right();
         digitalWrite(PIN_FRONT_RIGHT, HIGH);
         digitalWrite(PIN_BACK_RIGHT, LOW);
         _direction_right = direction::FORWARD;
+        _state.touch(RIGHT_STATE);
         enable_speed_right();
         LOG_ENGINE_F("[%s] forward right\n", _name)
     }
 
-    bool engines_controller::backward(const JsonObject *json)
+    bool engines_controller::backward(const commands::command &command)
     {
-        bool if_executed = false;
-        const char *engines = get_engine_from_json(json);
-        if (engines)
-        {
-            if (!strcmp(engines, BOTH))
-            {
-                backward_left();
-                backward_right();
-                if_executed = true;
-            }
-            else if (!strcmp(engines, LEFT))
-            {
-                backward_left();
-                if_executed = true;
-            }
-            else if (!strcmp(engines, RIGHT))
-            {
-                backward_right();
-                if_executed = true;
-            }
-        }
-        return if_executed;
+        release_setpoints(command.args.engine.sides);
+        if (command.args.engine.sides & commands::LEFT)
+            backward_left();
+        if (command.args.engine.sides & commands::RIGHT)
+            backward_right();
+        return true;
     }
 
     void engines_controller::backward_left()
     {
+        if (_direction_left == direction::BACKWARD)
+        {
+            enable_speed_left();
+            return;
+        }
+
         disable_speed_left();
         digitalWrite(PIN_FRONT_LEFT, LOW);
         digitalWrite(PIN_BACK_LEFT, HIGH);
         _direction_left = direction::BACKWARD;
+        _state.touch(LEFT_STATE);
         enable_speed_left();
         LOG_ENGINE_F("[%s] backward left\n", _name)
     }
 
     void engines_controller::backward_right()
     {
+        if (_direction_right == direction::BACKWARD)
+        {
+            enable_speed_right();
+            return;
+        }
+
         disable_speed_right();
         digitalWrite(PIN_FRONT_RIGHT, LOW);
         digitalWrite(PIN_BACK_RIGHT, HIGH);
         _direction_right = direction::BACKWARD;
+        _state.touch(RIGHT_STATE);
         enable_speed_right();
         LOG_ENGINE_F("[%s] backward right\n", _name)
     }
 
-    bool engines_controller::stop(const JsonObject *json)
+    bool engines_controller::stop(const commands::command &command)
     {
-        bool if_executed = false;
-        const char *engines = get_engine_from_json(json);
-        if (engines)
-        {
-            if (!strcmp(engines, BOTH))
-            {
-                stop_left();
-                stop_right();
-                if_executed = true;
-            }
-            else if (!strcmp(engines, LEFT))
-            {
-                stop_left();
-                if_executed = true;
-            }
-            else if (!strcmp(engines, RIGHT))
-            {
-                stop_right();
-                if_executed = true;
-            }
-        }
-        return if_executed;
+        release_setpoints(command.args.engine.sides);
+        if (command.args.engine.sides & commands::LEFT)
+            stop_left();
+        if (command.args.engine.sides & commands::RIGHT)
+            stop_right();
+        return true;
     }
 
     void engines_controller::stop_left()
@@ -213,6 +183,9 @@ namespace json_parser
         disable_speed_left();
         digitalWrite(PIN_FRONT_LEFT, LOW);
         digitalWrite(PIN_BACK_LEFT, LOW);
+        // pins are written whatever they were, a stop is never skipped
+        if (_direction_left != direction::STOP)
+            _state.touch(LEFT_STATE);
         _direction_left = direction::STOP;
         LOG_ENGINE_F("[%s] stop left\n", _name)
     }
@@ -222,28 +195,27 @@ namespace json_parser
         disable_speed_right();
         digitalWrite(PIN_FRONT_RIGHT, LOW);
         digitalWrite(PIN_BACK_RIGHT, LOW);
+        if (_direction_right != direction::STOP)
+            _state.touch(RIGHT_STATE);
         _direction_right = direction::STOP;
         LOG_ENGINE_F("[%s] stop right\n", _name)
     }
 
-    bool engines_controller::rotate(const JsonObject *json)
+    bool engines_controller::rotate(const commands::command &command)
     {
-        bool if_executed = false;
-        const char *engines = get_engine_from_json(json);
-        if (engines)
+        release_setpoints(commands::BOTH);
+        if (command.args.engine.sides == commands::LEFT)
+        {
+            rotate_left();
+            return true;
+        }
+        else if (command.args.engine.sides == commands::RIGHT)
         {
-            if (!strcmp(engines, LEFT))
-            {
-                rotate_left();
-                if_executed = true;
-            }
-            else if (!strcmp(engines, RIGHT))
-            {
-                rotate_right();
-                if_executed = true;
-            }
+            rotate_right();
+            return true;
         }
-        return if_executed;
+        LOG_ENGINE_F("[%s] can't rotate both sides\n", _name)
+        return false;
     }
 
     void engines_controller::rotate_left()
@@ -260,275 +232,284 @@ namespace json_parser
         LOG_ENGINE_F("[%s] rotate right\n", _name)
     }
 
-    bool engines_controller::slower(const JsonObject *json)
+    bool engines_controller::slower(const commands::command &command)
     {
-        bool if_executed = false;
-        const char *engines = get_engine_from_json(json);
-        if (engines)
-        {
-            if (!strcmp(engines, BOTH))
-            {
-                slower_left();
-                slower_right();
-                if_executed = true;
-            }
-            else if (!strcmp(engines, LEFT))
-            {
-                slower_left();
-                if_executed = true;
-            }
-            else if (!strcmp(engines, RIGHT))
-            {
-                slower_right();
-                if_executed = true;
-            }
-        }
-        return if_executed;
+        release_setpoints(command.args.engine.sides);
+        if (command.args.engine.sides & commands::LEFT)
+            slower_left();
+        if (command.args.engine.sides & commands::RIGHT)
+            slower_right();
+        return true;
     }
 
     void engines_controller::slower_left()
     {
         _speed_controll_left = speed_controll::SLOWER;
+        _state.touch(LEFT_STATE);
         LOG_ENGINE_F("[%s] slower left\n", _name)
     }
 
     void engines_controller::slower_right()
     {
         _speed_controll_right = speed_controll::SLOWER;
+        _state.touch(RIGHT_STATE);
         LOG_ENGINE_F("[%s] slower right\n", _name)
     }
 
-    bool engines_controller::faster(const JsonObject *json)
+    bool engines_controller::faster(const commands::command &command)
     {
-        bool if_executed = false;
-        const char *engines = get_engine_from_json(json);
-        if (engines)
-        {
-            if (!strcmp(engines, BOTH))
-            {
-                faster_left();
-                faster_right();
-                if_executed = true;
-            }
-            else if (!strcmp(engines, LEFT))
-            {
-                faster_left();
-                if_executed = true;
-            }
-            else if (!strcmp(engines, RIGHT))
-            {
-                faster_right();
-                if_executed = true;
-            }
-        }
-        return if_executed;
+        release_setpoints(command.args.engine.sides);
+        if (command.args.engine.sides & commands::LEFT)
+            faster_left();
+        if (command.args.engine.sides & commands::RIGHT)
+            faster_right();
+        return true;
     }
 
     void engines_controller::faster_left()
     {
         _speed_controll_left = speed_controll::FASTER;
+        _state.touch(LEFT_STATE);
         LOG_ENGINE_F("[%s] faster left\n", _name)
     }
 
     void engines_controller::faster_right()
     {
         _speed_controll_right = speed_controll::FASTER;
+        _state.touch(RIGHT_STATE);
         LOG_ENGINE_F("[%s] faster right\n", _name)
     }
 
-    bool engines_controller::keep_speed(const JsonObject *json)
+    bool engines_controller::keep_speed(const commands::command &command)
     {
-        bool if_executed = false;
-        const char *engines = get_engine_from_json(json);
-        if (engines)
-        {
-            if (!strcmp(engines, BOTH))
-            {
-                keep_speed_left();
-                keep_speed_right();
-                if_executed = true;
-            }
-            else if (!strcmp(engines, LEFT))
-            {
-                keep_speed_left();
-                if_executed = true;
-            }
-            else if (!strcmp(engines, RIGHT))
-            {
-                keep_speed_right();
-                if_executed = true;
-            }
-        }
-        return if_executed;
+        release_setpoints(command.args.engine.sides);
+        if (command.args.engine.sides & commands::LEFT)
+            keep_speed_left();
+        if (command.args.engine.sides & commands::RIGHT)
+            keep_speed_right();
+        return true;
     }
 
     void engines_controller::keep_speed_left()
     {
         _speed_controll_left = speed_controll::KEEP_SPEED;
+        _state.touch(LEFT_STATE);
         LOG_ENGINE_F("[%s] left keeps speed\n", _name)
     }
 
     void engines_controller::keep_speed_right()
     {
         _speed_controll_right = speed_controll::KEEP_SPEED;
+        _state.touch(RIGHT_STATE);
         LOG_ENGINE_F("[%s] right keeps speed\n", _name)
     }
 
-    size_t engines_controller::get_speed_from_json(const JsonObject *json, bool *succ)
+    bool engines_controller::set_speed(const commands::command &command)
     {
-        if (json)
+        uint32_t new_speed = command.args.engine.speed;
+        if (new_speed > SPEED_MAX)
         {
-            if (json->containsKey(SPEED_KEY))
-            {
-                uint32_t new_speed = (*json)[SPEED_KEY];
-                if (new_speed <= SPEED_MAX)
-                {
-                    (*succ) = true;
-                    LOG_ENGINE_F("[%s] got speed %d\n", _name, new_speed)
-                    return new_speed;
-                }
-                else
-                {
-                    LOG_ENGINE_F("[%s] too fast %d\n", _name, new_speed)
-                }
-            }
-            else
-            {
-                LOG_ENGINE_F("[%s] no speed key\n", _name)
-            }
+            LOG_ENGINE_F("[%s] too fast %d\n", _name, new_speed)
+            return false;
         }
-        else
-        {
-            LOG_ENGINE_F("[%s] no json\n", _name)
-        }
-        (*succ) = false;
-        return 0U;
-    }
 
-    bool engines_controller::set_speed(const JsonObject *json)
-    {
-        bool if_executed = false;
-        bool succ = false;
-        size_t new_speed = get_speed_from_json(json, &succ);
-        const char *engines = get_engine_from_json(json);
-        if (succ && engines)
-        {
-            if (!strcmp(engines, BOTH))
-            {
-                set_speed_left(new_speed);
-                set_speed_right(new_speed);
-                if_executed = true;
-            }
-            else if (!strcmp(engines, LEFT))
-            {
-                set_speed_left(new_speed);
-                if_executed = true;
-            }
-            else if (!strcmp(engines, RIGHT))
-            {
-                set_speed_right(new_speed);
-                if_executed = true;
-            }
-        }
-        return if_executed;
+        LOG_ENGINE_F("[%s] got speed %d\n", _name, new_speed)
+        release_setpoints(command.args.engine.sides);
+        if (command.args.engine.sides & commands::LEFT)
+            set_speed_left(new_speed);
+        if (command.args.engine.sides & commands::RIGHT)
+            set_speed_right(new_speed);
+        return true;
     }
 
     void engines_controller::set_speed_left(uint32_t new_speed)
     {
+        if (_speed_left != new_speed)
+            _state.touch(LEFT_STATE);
         _speed_left = new_speed;
     }
 
     void engines_controller::set_speed_right(uint32_t new_speed)
     {
+        if (_speed_right != new_speed)
+            _state.touch(RIGHT_STATE);
         _speed_right = new_speed;
     }
 
-    const char *engines_controller::get_engine_from_json(const JsonObject *json)
+    void engines_controller::schedule(task_scheduler &scheduler)
+    {
+        scheduler.add<engines_controller, &engines_controller::change_speed>(*this, SPEED_CHANGE_INTERVAL, SPEED_CHANGE_PHASE);
+        scheduler.add<engines_controller, &engines_controller::follow_setpoints>(*this, SETPOINT_INTERVAL, SETPOINT_PHASE);
+    }
+
+    void engines_controller::change_speed()
     {
-        if (json)
+        bool left_speed_changed = false;
+        bool right_speed_changed = false;
+
+        if (_speed_controll_left == speed_controll::SLOWER && _speed_left > 0U)
         {
-            if (json->containsKey(ENGINE_KEY))
-            {
-                return (*json)[ENGINE_KEY];
-            }
-            else
-            {
-                LOG_ENGINE_F("[%s] no engine key\n", _name)
-            }
+            _speed_left--;
+            left_speed_changed = true;
         }
-        else
+        else if (_speed_controll_left == speed_controll::FASTER && _speed_left < SPEED_MAX)
+        {
+            _speed_left++;
+            left_speed_changed = true;
+        }
+
+        if (_speed_controll_right == speed_controll::SLOWER && _speed_right > 0U)
         {
-            LOG_ENGINE_F("[%s] no json\n", _name)
+            _speed_right--;
+            right_speed_changed = true;
+        }
+        else if (_speed_controll_right == speed_controll::FASTER && _speed_right < SPEED_MAX)
+        {
+            _speed_right++;
+            right_speed_changed = true;
+        }
+
+        if (left_speed_changed)
+        {
+            _state.touch(LEFT_STATE);
+            LOG_ENGINE_F("[%s] new left speed: %d\n", _name, _speed_left)
+        }
+        if (right_speed_changed)
+        {
+            _state.touch(RIGHT_STATE);
+            LOG_ENGINE_F("[%s] new right speed: %d\n", _name, _speed_right)
         }
-        return nullptr;
     }
 
-    void engines_controller::update()
+    bool engines_controller::set_setpoint(const commands::command &command)
     {
-        static unsigned long last_update = millis();
-        if (millis() - last_update > SPEED_CHANGE_INTERVAL)
+        uint8_t sides = command.args.setpoint.target;
+        uint32_t now = scheduler::uptime();
+        if (sides & commands::LEFT)
+        {
+            // filter starts where the engine is -> no jump when it's taken over
+            if (!_follows_left)
+                _setpoint_left.reset(setpoint_of(_direction_left, _speed_left));
+            _follows_left = true;
+            _speed_controll_left = speed_controll::KEEP_SPEED;
+            _setpoint_left.sample(command.args.setpoint.value, now);
+        }
+        if (sides & commands::RIGHT)
         {
-            bool left_speed_changed = false;
-            bool right_speed_changed = false;
-
-            if (_speed_controll_left == speed_controll::SLOWER && _speed_left > 0U)
-            {
-                _speed_left--;
-                left_speed_changed = true;
-            }
-            else if (_speed_controll_left == speed_controll::FASTER && _speed_left < SPEED_MAX)
-            {
-                _speed_left++;
-                left_speed_changed = true;
-            }
-
-            if (_speed_controll_right == speed_controll::SLOWER && _speed_right > 0U)
-            {
-                _speed_right--;
-                right_speed_changed = true;
-            }
-            else if (_speed_controll_right == speed_controll::FASTER && _speed_right < SPEED_MAX)
-            {
-                _speed_right++;
-                right_speed_changed = true;
-            }
-
-            if (left_speed_changed)
-            {
-                LOG_ENGINE_F("[%s] new left speed: %d\n", _name, _speed_left)
-            }
-            if (right_speed_changed)
-            {
-                LOG_ENGINE_F("[%s] new right speed: %d\n", _name, _speed_right)
-            }
-
-            last_update = millis();
+            if (!_follows_right)
+                _setpoint_right.reset(setpoint_of(_direction_right, _speed_right));
+            _follows_right = true;
+            _speed_controll_right = speed_controll::KEEP_SPEED;
+            _setpoint_right.sample(command.args.setpoint.value, now);
         }
+        return true;
+    }
+
+    void engines_controller::release_setpoints(uint8_t sides)
+    {
+        if (sides & commands::LEFT)
+            _follows_left = false;
+        if (sides & commands::RIGHT)
+            _follows_right = false;
     }
 
-    DynamicJsonDocument engines_controller::retrive_data()
+    void engines_controller::follow_setpoints()
     {
-        DynamicJsonDocument json(_json_size);
-        json[NAME_FIELD] = _name;
-        JsonArray data = json.createNestedArray(DATA_FIELD);
+        if (!_follows_left && !_follows_right)
+            return;
 
-        JsonObject left = data.createNestedObject();
+        uint32_t now = scheduler::uptime();
+        if (_follows_left)
+            apply_setpoint_left(_setpoint_left.update(now));
+        if (_follows_right)
+            apply_setpoint_right(_setpoint_right.update(now));
+    }
 
-        left[ENGINE_KEY] = LEFT;
-        left["min"] = 0;
-        left["max"] = SPEED_MAX;
-        left[SPEED_KEY] = _speed_left;
-        left[DIRECTION_KEY] = static_cast<int>(_direction_left);
-        left[SPEED_CONTROLL_KEY] = static_cast<int>(_direction_left);
+    void engines_controller::apply_setpoint_left(int16_t value)
+    {
+        // speed of a stopped engine is kept for the next forward / backward
+        if (!value)
+        {
+            if (_direction_left != direction::STOP)
+                stop_left();
+            return;
+        }
 
-        JsonObject right = data.createNestedObject();
+        uint32_t new_speed = static_cast<uint32_t>(value < 0 ? -value : value) * SPEED_MAX / setpoint::FULL_SCALE;
+        direction new_direction = value > 0 ? direction::FORWARD : direction::BACKWARD;
+        if (new_direction == _direction_left && new_speed == _speed_left)
+            return;
 
-        right[ENGINE_KEY] = RIGHT;
-        right["min"] = 0;
-        right["max"] = SPEED_MAX;
-        right[SPEED_KEY] = _speed_right;
-        right[DIRECTION_KEY] = static_cast<int>(_direction_right);
-        right[SPEED_CONTROLL_KEY] = static_cast<int>(_direction_right);
-        return json;
+        _speed_left = new_speed;
+        if (new_direction == _direction_left)
+        {
+            enable_speed_left();
+            _state.touch(LEFT_STATE);
+        }
+        else if (new_direction == direction::FORWARD)
+            forward_left();
+        else
+            backward_left();
+    }
+
+    void engines_controller::apply_setpoint_right(int16_t value)
+    {
+        if (!value)
+        {
+            if (_direction_right != direction::STOP)
+                stop_right();
+            return;
+        }
+
+        uint32_t new_speed = static_cast<uint32_t>(value < 0 ? -value : value) * SPEED_MAX / setpoint::FULL_SCALE;
+        direction new_direction = value > 0 ? direction::FORWARD : direction::BACKWARD;
+        if (new_direction == _direction_right && new_speed == _speed_right)
+            return;
+
+        _speed_right = new_speed;
+        if (new_direction == _direction_right)
+        {
+            enable_speed_right();
+            _state.touch(RIGHT_STATE);
+        }
+        else if (new_direction == direction::FORWARD)
+            forward_right();
+        else
+            backward_right();
+    }
+
+    int16_t engines_controller::setpoint_of(direction current, uint32_t speed)
+    {
+        int32_t value = static_cast<int32_t>(speed * setpoint::FULL_SCALE / SPEED_MAX);
+        return static_cast<int16_t>(static_cast<int>(current) * value);
+    }
+
+    void engines_controller::retrive_data(json_writer &json, uint32_t since)
+    {
+        json.begin_array();
+        if (_state.changed(LEFT_STATE, since))
+        {
+            json.begin_object();
+            json.member(ENGINE_KEY, LEFT);
+            json.member("min", 0);
+            json.member("max", SPEED_MAX);
+            json.member(SPEED_KEY, _speed_left);
+            json.member(DIRECTION_KEY, static_cast<int>(_direction_left));
+            json.member(SPEED_CONTROLL_KEY, static_cast<int>(_direction_left));
+            json.end_object();
+        }
+
+        if (_state.changed(RIGHT_STATE, since))
+        {
+            json.begin_object();
+            json.member(ENGINE_KEY, RIGHT);
+            json.member("min", 0);
+            json.member("max", SPEED_MAX);
+            json.member(SPEED_KEY, _speed_right);
+            json.member(DIRECTION_KEY, static_cast<int>(_direction_right));
+            json.member(SPEED_CONTROLL_KEY, static_cast<int>(_direction_right));
+            json.end_object();
+        }
+        json.end_array();
     }
 } // namespace json_parser
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include "abstract/templated_controller.hpp"
+#include "setpoint/axis_filter.hpp"
 
 namespace json_parser
 {
@@ -12,8 +13,9 @@ namespace json_parser
 
         explicit engines_controller();
         bool initialize() override;
-        void update() override;
-        DynamicJsonDocument retrive_data() override;
+        void schedule(task_scheduler &scheduler) override;
+        void retrive_data(json_writer &json, uint32_t since) override;
+        uint32_t version() const override { return _state.latest(); }
 
         enum class speed_controll
         {
@@ -44,40 +46,49 @@ namespace json_parser
         void disable_speed_right();
         void enable_speed_right();
 
-        bool forward(const JsonObject *json);
+        bool forward(const commands::command &command);
         void forward_left();
         void forward_right();
 
-        bool backward(const JsonObject *json);
+        bool backward(const commands::command &command);
         void backward_left();
         void backward_right();
 
-        bool stop(const JsonObject *json);
+        bool stop(const commands::command &command);
         void stop_left();
         void stop_right();
 
-        bool rotate(const JsonObject *json);
+        bool rotate(const commands::command &command);
         void rotate_left();
         void rotate_right();
 
-        bool slower(const JsonObject *json);
+        bool slower(const commands::command &command);
         void slower_left();
         void slower_right();
 
-        bool faster(const JsonObject *json);
+        bool faster(const commands::command &command);
         void faster_left();
         void faster_right();
 
-        bool keep_speed(const JsonObject *json);
+        bool keep_speed(const commands::command &command);
         void keep_speed_left();
         void keep_speed_right();
 
-        bool set_speed(const JsonObject *json);
+        bool set_speed(const commands::command &command);
         void set_speed_left(uint32_t new_speed);
         void set_speed_right(uint32_t new_speed);
-
-        const char *get_engine_from_json(const JsonObject *json);
-        size_t get_speed_from_json(const JsonObject *json, bool *succ);
+        // periodic task, speeds up / slows down by a single step
+        void change_speed();
+
+        // -1.0 - 1.0 per side, the side follows it until another command takes it over
+        bool set_setpoint(const commands::command &command);
+        // sides given to discrete commands again
+        void release_setpoints(uint8_t sides);
+        // periodic task, filtered setpoint -> direction and speed of the sides that follow one
+        void follow_setpoints();
+        void apply_setpoint_left(int16_t value);
+        void apply_setpoint_right(int16_t value);
+        static int16_t setpoint_of(direction current, uint32_t speed);
 
         static constexpr const char *FORWARD = "forward";
         static constexpr const char *BACKWARD = "backward";
@@ -87,6 +98,20 @@ namespace json_parser
         static constexpr const char *KEEP_SPEED = "keep_speed";
         static constexpr const char *SPEED = "speed";
         static constexpr const char *ROTATE = "rotate";
+        static constexpr const char *SETPOINT = "setpoint";
+
+        friend class templated_controller<engines_controller>;
+        static constexpr auto COMMANDS = make_command_table<engines_controller>({
+            {FORWARD, &engines_controller::forward, commands::codecs::ENGINE, nullptr, command_queue::priority::CONTROL},
+            {BACKWARD, &engines_controller::backward, commands::codecs::ENGINE, nullptr, command_queue::priority::CONTROL},
+            {STOP, &engines_controller::stop, commands::codecs::ENGINE, nullptr, command_queue::priority::SAFETY},
+            {FASTER, &engines_controller::faster, commands::codecs::ENGINE, nullptr, command_queue::priority::CONTROL},
+            {SLOWER, &engines_controller::slower, commands::codecs::ENGINE, nullptr, command_queue::priority::CONTROL},
+            {KEEP_SPEED, &engines_controller::keep_speed, commands::codecs::ENGINE, nullptr, command_queue::priority::CONTROL},
+            {SPEED, &engines_controller::set_speed, commands::codecs::ENGINE_SPEED, nullptr, command_queue::priority::CONTROL, true},
+            {ROTATE, &engines_controller::rotate, commands::codecs::ENGINE, nullptr, command_queue::priority::CONTROL},
+            {SETPOINT, &engines_controller::set_setpoint, commands::codecs::ENGINE_SETPOINT, nullptr, command_queue::priority::CONTROL, true},
+        });
 
         static constexpr const char *LEFT = "left";
         static constexpr const char *RIGHT = "right";
@@ -108,6 +133,11 @@ namespace json_parser
         static constexpr uint32_t SPEED_MAX = 1023U;
         static constexpr uint32_t SPEED_DEFAULT = SPEED_MAX;
         static constexpr uint32_t SPEED_CHANGE_INTERVAL = 5U;
+        static constexpr uint32_t SPEED_CHANGE_PHASE = 0U;
+        static constexpr uint32_t SETPOINT_INTERVAL = 5U;
+        static constexpr uint32_t SETPOINT_PHASE = 2U;
+        // small deadzone for sticks that don't center exactly, sender gone for half a second -> stop
+        static constexpr setpoint::shape SETPOINT_SHAPE = {2600, 96U, 64U, 500U};
 #ifdef ESP32
         static constexpr uint8_t PWM_CHANNEL_LEFT = 1U;
         static constexpr uint8_t PWM_CHANNEL_RIGHT = 2U;
@@ -122,6 +152,16 @@ namespace json_parser
 
         uint32_t _speed_left = SPEED_DEFAULT;
         uint32_t _speed_right = SPEED_DEFAULT;
+
+        setpoint::axis_filter _setpoint_left{SETPOINT_SHAPE};
+        setpoint::axis_filter _setpoint_right{SETPOINT_SHAPE};
+        bool _follows_left = false;
+        bool _follows_right = false;
+
+        // every engine is sent whole
+        static constexpr uint8_t LEFT_STATE = 0U;
+        static constexpr uint8_t RIGHT_STATE = 1U;
+        state_stamps<2> _state;
     };
 } // namespace json_parser
 
@@ -0,0 +1,328 @@
+#include "gamepad_controller.hpp"
+#include "debug.hpp"
+#include "setpoint/axis_filter.hpp"
+
+#if GAMEPAD_DEBUG
+
+#define LOG_GAMEPAD(message) LOG(message)
+#define LOG_GAMEPAD_NL(message) LOG_NL(message)
+#define LOG_GAMEPAD_F(...) LOG_F(__VA_ARGS__)
+
+#else
+
+#define LOG_GAMEPAD(message)
+#define LOG_GAMEPAD_NL(message)
+#define LOG_GAMEPAD_F(...)
+
+#endif // GAMEPAD_DEBUG
+
+namespace json_parser
+{
+    namespace
+    {
+        using gamepad::event;
+        namespace buttons = gamepad::buttons;
+        namespace axes = gamepad::axes;
+
+        struct default_action
+        {
+            uint8_t input;
+            event on;
+            const char *message;
+        };
+
+        // what the browser used to send (data/js/configs.js before the mapping moved here)
+        constexpr default_action DEFAULT_ACTIONS[] = {
+            {gamepad::AXIS_INPUT + axes::LEFT_HORIZONTAL, event::POSITIVE, R"({"controller":"arm","command":"minus","servo":"base"})"},
+            {gamepad::AXIS_INPUT + axes::LEFT_HORIZONTAL, event::IDLE, R"({"controller":"arm","command":"stop","servo":"base"})"},
+            {gamepad::AXIS_INPUT + axes::LEFT_HORIZONTAL, event::NEGATIVE, R"({"controller":"arm","command":"plus","servo":"base"})"},
+            {gamepad::AXIS_INPUT + axes::LEFT_VERTICAL, event::POSITIVE, R"({"controller":"arm","command":"plus","servo":"shoulder"})"},
+            {gamepad::AXIS_INPUT + axes::LEFT_VERTICAL, event::IDLE, R"({"controller":"arm","command":"stop","servo":"shoulder"})"},
+            {gamepad::AXIS_INPUT + axes::LEFT_VERTICAL, event::NEGATIVE, R"({"controller":"arm","command":"minus","servo":"shoulder"})"},
+            {gamepad::AXIS_INPUT + axes::RIGHT_HORIZONTAL, event::POSITIVE, R"({"controller":"arm","command":"plus","servo":"rotation"})"},
+            {gamepad::AXIS_INPUT + axes::RIGHT_HORIZONTAL, event::IDLE, R"({"controller":"arm","command":"stop","servo":"rotation"})"},
+            {gamepad::AXIS_INPUT + axes::RIGHT_HORIZONTAL, event::NEGATIVE, R"({"controller":"arm","command":"minus","servo":"rotation"})"},
+            {gamepad::AXIS_INPUT + axes::RIGHT_VERTICAL, event::POSITIVE, R"({"controller":"arm","command":"plus","servo":"claw"})"},
+            {gamepad::AXIS_INPUT + axes::RIGHT_VERTICAL, event::IDLE, R"({"controller":"arm","command":"stop","servo":"claw"})"},
+            {gamepad::AXIS_INPUT + axes::RIGHT_VERTICAL, event::NEGATIVE, R"({"controller":"arm","command":"minus","servo":"claw"})"},
+            {buttons::LT, event::PRESSED, R"({"controller":"engines","command":"forward","engine":"left"})"},
+            {buttons::LB, event::PRESSED, R"({"controller":"engines","command":"backward","engine":"left"})"},
+            {buttons::RT, event::PRESSED, R"({"controller":"engines","command":"forward","engine":"right"})"},
+            {buttons::RB, event::PRESSED, R"({"controller":"engines","command":"backward","engine":"right"})"},
+            {buttons::A, event::PRESSED, R"({"controller":"arm","command":"minus","servo":"elbow"})"},
+            {buttons::X, event::PRESSED, R"({"controller":"arm","command":"plus","servo":"elbow"})"},
+            {buttons::Y, event::PRESSED, R"({"controller":"arm","command":"plus","servo":"wrist"})"},
+            {buttons::B, event::PRESSED, R"({"controller":"arm","command":"minus","servo":"wrist"})"},
+        };
+
+        // both buttons released -> stop
+        struct default_combination
+        {
+            uint8_t first;
+            uint8_t second;
+            const char *message;
+        };
+
+        constexpr default_combination DEFAULT_COMBINATIONS[] = {
+            {buttons::LT, buttons::LB, R"({"controller":"engines","command":"stop","engine":"left"})"},
+            {buttons::RT, buttons::RB, R"({"controller":"engines","command":"stop","engine":"right"})"},
+            {buttons::X, buttons::A, R"({"controller":"arm","command":"stop","servo":"elbow"})"},
+            {buttons::Y, buttons::B, R"({"controller":"arm","command":"stop","servo":"wrist"})"},
+        };
+
+        bool decode_message(const abstract_parser &parser, const char *message, commands::command &command)
+        {
+            StaticJsonDocument<192> json;
+            return !deserializeJson(json, message) && parser.decode(json.as<JsonObject>(), command);
+        }
+    } // namespace
+
+    gamepad_controller::gamepad_controller(const abstract_parser &parser) : templated_controller("gamepad"),
+                                                                             _parser(parser)
+    {
+    }
+
+    bool gamepad_controller::initialize()
+    {
+        bool if_ok = true;
+        commands::command command{};
+        for (const auto &action : DEFAULT_ACTIONS)
+        {
+            bool decoded = decode_message(_parser, action.message, command);
+            if_ok &= decoded && _mapping.assign(action.input, action.on, command);
+        }
+        for (const auto &combination : DEFAULT_COMBINATIONS)
+        {
+            int16_t input = _mapping.add_combination((1U << combination.first) | (1U << combination.second), 0);
+            bool decoded = decode_message(_parser, combination.message, command);
+            if_ok &= input >= 0 && decoded && _mapping.assign(input, gamepad::event::PRESSED, command);
+        }
+        LOG_GAMEPAD_F("[%s] default mapping: %s\n", _name, if_ok ? "success" : "failed")
+        return if_ok;
+    }
+
+    bool gamepad_controller::frame(const commands::command &command)
+    {
+        uint8_t actions = _mapping.process(command.args.gamepad, [this, &command](const commands::command &action) {
+            commands::command copy = action;
+            copy.set_source(command.source());
+            _parser.dispatch(copy);
+        });
+        if (actions)
+        {
+            LOG_GAMEPAD_F("[%s] buttons %04x -> %u commands\n", _name, command.args.gamepad.buttons, actions)
+        }
+
+        // every frame, not only on changes -> keeps the setpoint from timing out while the axis is held
+        commands::command bound{};
+        for (uint8_t i = 0; i < gamepad::AXES; i++)
+        {
+            if (!_bindings[i].length || !bound_command(i, setpoint::from_axis(command.args.gamepad.axes[i]), bound))
+                continue;
+            bound.set_source(command.source());
+            _parser.dispatch(bound);
+        }
+        return true;
+    }
+
+    bool gamepad_controller::assign(const commands::command &command)
+    {
+        const auto &mapping = command.args.mapping;
+        auto on = static_cast<gamepad::event>(mapping.event);
+        if (!mapping.length)
+            return _mapping.clear(mapping.input, on);
+
+        commands::command action{};
+        // gamepad running itself would never end
+        if (!_parser.decode_binary(mapping.action, mapping.length, action) || action.controller == _parser.index_of(_name))
+            return false;
+
+        LOG_GAMEPAD_F("[%s] input %u %s -> controller %u command %u\n", _name, mapping.input, EVENT_NAMES[mapping.event],
+                      action.controller, action.id)
+        return _mapping.assign(mapping.input, on, action);
+    }
+
+    bool gamepad_controller::reset(const commands::command &command)
+    {
+        _mapping.reset();
+        return true;
+    }
+
+    bool gamepad_controller::bind(const commands::command &command)
+    {
+        const auto &mapping = command.args.mapping;
+        auto &target = _bindings[mapping.input];
+        if (!mapping.length)
+        {
+            target.length = 0;
+            return true;
+        }
+
+        binding previous = target;
+        target.length = mapping.length;
+        memcpy(target.action, mapping.action, mapping.length);
+        // has to take the value, gamepad running itself would never end
+        commands::command check{};
+        if (!bound_command(mapping.input, 0, check) || check.controller == _parser.index_of(_name))
+        {
+            target = previous;
+            return false;
+        }
+
+        LOG_GAMEPAD_F("[%s] axis %u -> controller %u command %u\n", _name, mapping.input, check.controller, check.id)
+        return true;
+    }
+
+    bool gamepad_controller::bound_command(uint8_t axis, int16_t value, commands::command &command) const
+    {
+        const auto &target = _bindings[axis];
+        uint8_t message[commands::ACTION_SIZE];
+        memcpy(message, target.action, target.length);
+        message[target.length] = static_cast<uint8_t>(value);
+        message[target.length + 1U] = static_cast<uint8_t>(static_cast<uint16_t>(value) >> 8);
+        return _parser.decode_binary(message, target.length + 2U, command);
+    }
+
+    bool gamepad_controller::decode_frame(const JsonObject &json, const char *key, commands::command &command)
+    {
+        auto buttons = json[BUTTONS_KEY];
+        JsonArray axes = json[AXES_KEY];
+        if (!buttons.is<uint16_t>() || axes.size() != gamepad::AXES)
+            return false;
+
+        command.args.gamepad.buttons = buttons;
+        for (uint8_t i = 0; i < gamepad::AXES; i++)
+        {
+            if (!axes[i].is<int8_t>() || axes[i].as<int8_t>() < -127)
+                return false;
+            command.args.gamepad.axes[i] = axes[i];
+        }
+        command.target = 0;
+        return true;
+    }
+
+    void gamepad_controller::encode_frame(const commands::command &command, const char *key, JsonObject &json)
+    {
+        json[BUTTONS_KEY] = command.args.gamepad.buttons;
+        JsonArray axes = json.createNestedArray(AXES_KEY);
+        for (auto axis : command.args.gamepad.axes)
+            axes.add(axis);
+    }
+
+    bool gamepad_controller::read_frame(const uint8_t *data, size_t length, commands::command &command)
+    {
+        if (length != 2U + gamepad::AXES)
+            return false;
+
+        command.args.gamepad.buttons = commands::codecs::read_u16(data);
+        for (uint8_t i = 0; i < gamepad::AXES; i++)
+        {
+            command.args.gamepad.axes[i] = static_cast<int8_t>(data[2U + i]);
+            if (command.args.gamepad.axes[i] < -127)
+                return false;
+        }
+        command.target = 0;
+        return true;
+    }
+
+    bool gamepad_controller::decode_mapping(const JsonObject &json, const char *key, commands::command &command)
+    {
+        auto input = json[INPUT_KEY];
+        const char *event_name = json[EVENT_KEY];
+        JsonArray action = json[ACTION_KEY];
+        if (!input.is<uint8_t>() || !event_name || action.size() > commands::ACTION_SIZE)
+            return false;
+
+        auto &mapping = command.args.mapping;
+        mapping.event = gamepad::EVENTS;
+        for (uint8_t i = 0; i < gamepad::EVENTS; i++)
+            if (!strcmp(EVENT_NAMES[i], event_name))
+                mapping.event = i;
+        if (mapping.event == gamepad::EVENTS)
+            return false;
+
+        mapping.input = input;
+        mapping.length = static_cast<uint8_t>(action.size());
+        for (uint8_t i = 0; i < mapping.length; i++)
+        {
+            if (!action[i].is<uint8_t>())
+                return false;
+            mapping.action[i] = action[i];
+        }
+        command.target = 0;
+        return true;
+    }
+
+    void gamepad_controller::encode_mapping(const commands::command &command, const char *key, JsonObject &json)
+    {
+        const auto &mapping = command.args.mapping;
+        json[INPUT_KEY] = mapping.input;
+        json[EVENT_KEY] = mapping.event < gamepad::EVENTS ? EVENT_NAMES[mapping.event] : "";
+        JsonArray action = json.createNestedArray(ACTION_KEY);
+        for (uint8_t i = 0; i < mapping.length; i++)
+            action.add(mapping.action[i]);
+    }
+
+    bool gamepad_controller::read_mapping(const uint8_t *data, size_t length, commands::command &command)
+    {
+        if (length < 2U || length - 2U > commands::ACTION_SIZE || data[1] >= gamepad::EVENTS)
+            return false;
+
+        auto &mapping = command.args.mapping;
+        mapping.input = data[0];
+        mapping.event = data[1];
+        mapping.length = static_cast<uint8_t>(length - 2U);
+        memcpy(mapping.action, data + 2, mapping.length);
+        command.target = 0;
+        return true;
+    }
+
+    bool gamepad_controller::decode_binding(const JsonObject &json, const char *key, commands::command &command)
+    {
+        auto axis = json[AXIS_KEY];
+        JsonArray action = json[ACTION_KEY];
+        if (!axis.is<uint8_t>() || axis.as<uint8_t>() >= gamepad::AXES || action.size() > BINDING_SIZE)
+            return false;
+
+        auto &mapping = command.args.mapping;
+        mapping.input = axis;
+        mapping.event = 0;
+        mapping.length = static_cast<uint8_t>(action.size());
+        for (uint8_t i = 0; i < mapping.length; i++)
+        {
+            if (!action[i].is<uint8_t>())
+                return false;
+            mapping.action[i] = action[i];
+        }
+        command.target = mapping.input;
+        return true;
+    }
+
+    void gamepad_controller::encode_binding(const commands::command &command, const char *key, JsonObject &json)
+    {
+        const auto &mapping = command.args.mapping;
+        json[AXIS_KEY] = mapping.input;
+        JsonArray action = json.createNestedArray(ACTION_KEY);
+        for (uint8_t i = 0; i < mapping.length; i++)
+            action.add(mapping.action[i]);
+    }
+
+    bool gamepad_controller::read_binding(const uint8_t *data, size_t length, commands::command &command)
+    {
+        if (!length || length - 1U > BINDING_SIZE || data[0] >= gamepad::AXES)
+            return false;
+
+        auto &mapping = command.args.mapping;
+        mapping.input = data[0];
+        mapping.event = 0;
+        mapping.length = static_cast<uint8_t>(length - 1U);
+        memcpy(mapping.action, data + 1, mapping.length);
+        command.target = mapping.input;
+        return true;
+    }
+
+    void gamepad_controller::retrive_data(json_writer &json, uint32_t since)
+    {
+        json.value(nullptr);
+    }
+} // namespace json_parser
@@ -0,0 +1,88 @@
+#ifndef __GAMEPAD_CONTROLLER_HPP__
+#define __GAMEPAD_CONTROLLER_HPP__
+
+#include <ArduinoJson.h>
+#include "abstract/templated_controller.hpp"
+#include "json_parser/abstract_parser.hpp"
+#include "gamepad/mapping.hpp"
+
+namespace json_parser
+{
+    // whole gamepad comes in a single frame every tick, edges of its inputs are turned into commands
+    // here (gamepad/mapping.hpp) and handled right away, mapping can be changed with assign
+    // axes can also be bound to a setpoint command, it gets the position of the axis with every frame
+    class gamepad_controller final : public templated_controller<gamepad_controller>
+    {
+    public:
+        explicit gamepad_controller(const abstract_parser &parser);
+        // default mapping is decoded once every controller is added
+        bool initialize() override;
+        void retrive_data(json_writer &json, uint32_t since) override;
+
+    private:
+        bool frame(const commands::command &command);
+        bool assign(const commands::command &command);
+        bool reset(const commands::command &command);
+        bool bind(const commands::command &command);
+        // [action..., value: i16] -> command, false when it doesn't decode
+        bool bound_command(uint8_t axis, int16_t value, commands::command &command) const;
+
+        // {"buttons": bitmask, "axes": [-127 - 127 x 4]}
+        static bool decode_frame(const JsonObject &json, const char *key, commands::command &command);
+        static void encode_frame(const commands::command &command, const char *key, JsonObject &json);
+        // [buttons: u16, axes: i8 x 4]
+        static bool read_frame(const uint8_t *data, size_t length, commands::command &command);
+        // {"input": 0 - 39, "event": "pressed" ..., "action": [binary message]}, empty action clears the input
+        static bool decode_mapping(const JsonObject &json, const char *key, commands::command &command);
+        static void encode_mapping(const commands::command &command, const char *key, JsonObject &json);
+        // [input, event, action...]
+        static bool read_mapping(const uint8_t *data, size_t length, commands::command &command);
+        // {"axis": 0 - 3, "action": [binary message without the value]}, empty action unbinds the axis
+        static bool decode_binding(const JsonObject &json, const char *key, commands::command &command);
+        static void encode_binding(const commands::command &command, const char *key, JsonObject &json);
+        // [axis, action...]
+        static bool read_binding(const uint8_t *data, size_t length, commands::command &command);
+
+        static constexpr const char *FRAME = "frame";
+        static constexpr const char *ASSIGN = "assign";
+        static constexpr const char *RESET = "reset";
+        static constexpr const char *BIND = "bind";
+
+        static constexpr const char *BUTTONS_KEY = "buttons";
+        static constexpr const char *AXES_KEY = "axes";
+        static constexpr const char *INPUT_KEY = "input";
+        static constexpr const char *EVENT_KEY = "event";
+        static constexpr const char *ACTION_KEY = "action";
+        static constexpr const char *AXIS_KEY = "axis";
+        // value of the axis (i16) is appended to the bound action
+        static constexpr size_t BINDING_SIZE = commands::ACTION_SIZE - 2U;
+        // by gamepad::event
+        static constexpr const char *EVENT_NAMES[gamepad::EVENTS] = {"pressed", "released", "negative", "idle", "positive"};
+
+        static constexpr commands::codec FRAME_CODEC = {decode_frame, encode_frame, read_frame};
+        static constexpr commands::codec MAPPING_CODEC = {decode_mapping, encode_mapping, read_mapping};
+        static constexpr commands::codec BINDING_CODEC = {decode_binding, encode_binding, read_binding};
+
+        // frames are never coalesced, every edge counts
+        friend class templated_controller<gamepad_controller>;
+        static constexpr auto COMMANDS = make_command_table<gamepad_controller>({
+            {FRAME, &gamepad_controller::frame, FRAME_CODEC, nullptr, command_queue::priority::CONTROL},
+            {ASSIGN, &gamepad_controller::assign, MAPPING_CODEC},
+            {RESET, &gamepad_controller::reset, commands::codecs::NONE, nullptr, command_queue::priority::CONTROL},
+            {BIND, &gamepad_controller::bind, BINDING_CODEC},
+        });
+
+        struct binding
+        {
+            // 0 -> axis isn't bound
+            uint8_t length;
+            uint8_t action[BINDING_SIZE];
+        };
+
+        const abstract_parser &_parser;
+        gamepad::mapping _mapping;
+        binding _bindings[gamepad::AXES] = {};
+    };
+} // namespace json_parser
+
+#endif // __GAMEPAD_CONTROLLER_HPP__
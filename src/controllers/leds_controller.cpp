@@ -18,7 +18,7 @@
 
 namespace json_parser
 {
-    leds_controller::leds_controller() : templated_controller("leds", JSON_OBJECT_SIZE(5) + JSON_ARRAY_SIZE(NUM_LEDS))
+    leds_controller::leds_controller() : templated_controller("leds")
     {
     }
 
@@ -28,28 +28,10 @@ namespace json_parser
         FastLED.setBrightness(_brightness);
         show_leds();
 
-        bool if_added = true;
-
-        if_added &= add_event(EUROBEAT, &leds_controller::eurobeat);
-        if_added &= add_event(CUSTOM, &leds_controller::custom);
-        if_added &= add_event(RANDOM, &leds_controller::random);
-        if_added &= add_event(FORWARD, &leds_controller::forward);
-        if_added &= add_event(BACKWARD, &leds_controller::backward);
-        if_added &= add_event(STOP, &leds_controller::stop);
-        if_added &= add_event(OFF, &leds_controller::off);
-
-        if_added &= add_event(CUSTOM_COLOR, &leds_controller::custom_color);
-        if_added &= add_event(LENGTH, &leds_controller::length);
-        if_added &= add_event(BRIGHTNESS, &leds_controller::brightness);
-        if_added &= add_event(UPDATE_INTERVAL, &leds_controller::update_interval);
-        if_added &= add_event(REPETITIONS, &leds_controller::repetitions);
-        if_added &= add_event(COLOR_LENGTH, &leds_controller::color_length);
-        if_added &= add_event(RESTORE_DEFAULT, &leds_controller::restore_default);
-
-        return if_added;
+        return true;
     }
 
-    bool leds_controller::eurobeat(const JsonObject *json)
+    bool leds_controller::eurobeat(const commands::command &command)
     {
         LOG_LEDS_F("[%s] set eurobeat animation\n", _name)
         _current_animation = &leds_controller::rainbow_factory;
@@ -57,7 +39,7 @@ namespace json_parser
         return true;
     }
 
-    bool leds_controller::custom(const JsonObject *json)
+    bool leds_controller::custom(const commands::command &command)
     {
         LOG_LEDS_F("[%s] set custiom animation\n", _name)
         _current_animation = &leds_controller::custom_factory;
@@ -65,7 +47,7 @@ namespace json_parser
         return true;
     }
 
-    bool leds_controller::random(const JsonObject *json)
+    bool leds_controller::random(const commands::command &command)
     {
         LOG_LEDS_F("[%s] set random animation\n", _name)
         _current_animation = &leds_controller::random_factory;
@@ -73,96 +55,60 @@ namespace json_parser
         return true;
     }
 
-    bool leds_controller::custom_color(const JsonObject *json)
+    bool leds_controller::custom_color(const commands::command &command)
     {
-        if (json)
+        const auto &color = command.args.color;
+        if (color.index < NUM_LEDS)
         {
-            if (json->containsKey(COLORS_KEY) && json->containsKey(INDEX_KEY))
-            {
-                uint32_t index = (*json)[INDEX_KEY];
-                if (index < NUM_LEDS)
-                {
-                    uint8_t red = (*json)[COLORS_KEY][0];
-                    uint8_t green = (*json)[COLORS_KEY][1];
-                    uint8_t blue = (*json)[COLORS_KEY][2];
+            _custom_colors[color.index] = CRGB(color.red, color.green, color.blue);
 
-                    _custom_colors[index] = CRGB(red, green, blue);
-
-                    LOG_LEDS_F("[%s] new color r: %u, g: %u, b: %u, i: %u\n", _name, red, green, blue, index)
-                    return true;
-                }
-                else
-                {
-                    LOG_LEDS_F("[%s] index too big: %u\n", _name, index)
-                }
-            }
-            else
-            {
-                LOG_LEDS_F("[%s] no keys: %s: %u, %s: %u\n", _name, COLORS_KEY,
-                           json->containsKey(COLORS_KEY), INDEX_KEY, json->containsKey(INDEX_KEY))
-            }
+            LOG_LEDS_F("[%s] new color r: %u, g: %u, b: %u, i: %u\n", _name, color.red, color.green, color.blue, color.index)
+            return true;
         }
         else
         {
-            LOG_LEDS_F("[%s] JSON was null\n", _name)
+            LOG_LEDS_F("[%s] index too big: %u\n", _name, color.index)
         }
         return false;
     }
 
-    bool leds_controller::brightness(const JsonObject *json)
+    bool leds_controller::brightness(const commands::command &command)
     {
-        if (json)
+        uint32_t brightness = command.args.value.value;
+        if (brightness <= UINT8_MAX)
         {
-            if (json->containsKey(BRIGHTNESS_KEY))
-            {
-                _brightness = (*json)[BRIGHTNESS_KEY];
-                LOG_LEDS_F("new brightness: %u\n", _brightness)
-                FastLED.setBrightness(_brightness);
-                show_leds();
-                return true;
-            }
-            else
-            {
-                LOG_LEDS_F("[%s] JSON didn'thave brightness key\n", _name)
-            }
+            _brightness = brightness;
+            _state.touch(BRIGHTNESS_STATE);
+            LOG_LEDS_F("new brightness: %u\n", _brightness)
+            FastLED.setBrightness(_brightness);
+            show_leds();
+            return true;
         }
         else
         {
-            LOG_LEDS_F("[%s] JSON was null\n", _name)
+            LOG_LEDS_F("[%s] brightness too big: %u\n", _name, brightness)
         }
         return false;
     }
 
-    bool leds_controller::update_interval(const JsonObject *json)
+    bool leds_controller::update_interval(const commands::command &command)
     {
-        if (json)
-        {
-            if (json->containsKey(INTERVAL_KEY))
-            {
-                _animation_updates_interval = (*json)[INTERVAL_KEY];
-                LOG_LEDS_F("New update interval: %u\n", _animation_updates_interval);
-                return true;
-            }
-            else
-            {
-                LOG_LEDS_F("[%s] no interval key\n", _name)
-            }
-        }
-        else
-        {
-            LOG_LEDS_F("[%s] JSON was null\n", _name)
-        }
-        return false;
+        _animation_updates_interval = command.args.value.value;
+        _state.touch(INTERVAL_STATE);
+        if (_scheduler)
+            _scheduler->set_period(_animation_task, _animation_updates_interval);
+        LOG_LEDS_F("New update interval: %u\n", _animation_updates_interval);
+        return true;
     }
 
-    bool leds_controller::stop(const JsonObject *json)
+    bool leds_controller::stop(const commands::command &command)
     {
         LOG_LEDS_F("[%s] stop animation\n", _name)
         _direction = animation_direction::STOP;
         return true;
     }
 
-    bool leds_controller::off(const JsonObject *json)
+    bool leds_controller::off(const commands::command &command)
     {
         LOG_LEDS_F("[%s] turn off leds\n", _name);
         _current_animation = nullptr;
@@ -170,103 +116,60 @@ namespace json_parser
         return true;
     }
 
-    bool leds_controller::forward(const JsonObject *json)
+    bool leds_controller::forward(const commands::command &command)
     {
         LOG_LEDS_F("[%s] animate forward\n", _name);
         _direction = animation_direction::FORWARD;
         return true;
     }
 
-    bool leds_controller::backward(const JsonObject *json)
+    bool leds_controller::backward(const commands::command &command)
     {
         LOG_LEDS_F("[%s] animate backward\n", _name);
         _direction = animation_direction::BACKWARD;
         return true;
     }
 
-    bool leds_controller::length(const JsonObject *json)
+    bool leds_controller::length(const commands::command &command)
     {
-        if (json)
+        uint32_t length = command.args.value.value;
+        if (length <= NUM_LEDS)
         {
-            if (json->containsKey(LENGTH_KEY))
-            {
-                uint32_t length = (*json)[LENGTH_KEY];
-                if (length <= NUM_LEDS)
-                {
-                    _length = length;
-                    LOG_F("[%s] new length: %u\n", _name, _length)
-                    return true;
-                }
-                else
-                {
-                    LOG_LEDS_F("[%s] length was too big\n", _name)
-                }
-            }
-            else
-            {
-                LOG_LEDS_F("[%s] no length key\n", _name)
-            }
+            _length = length;
+            LOG_F("[%s] new length: %u\n", _name, _length)
+            return true;
         }
         else
         {
-            LOG_LEDS_F("[%s] JSON was null\n", _name)
+            LOG_LEDS_F("[%s] length was too big\n", _name)
         }
         return false;
     }
 
-    bool leds_controller::color_length(const JsonObject *json)
+    bool leds_controller::color_length(const commands::command &command)
     {
-        if (json)
+        uint32_t length = command.args.value.value;
+        if (length < NUM_LEDS)
         {
-            if (json->containsKey(LENGTH_KEY))
-            {
-                uint32_t length = (*json)[LENGTH_KEY];
-                if (length < NUM_LEDS)
-                {
-                    _color_length = length;
-                    LOG_F("[%s] new length: %u\n", _name, _length)
-                    return true;
-                }
-                else
-                {
-                    LOG_LEDS_F("[%s] length was too big\n", _name)
-                }
-            }
-            else
-            {
-                LOG_LEDS_F("[%s] no length key\n", _name)
-            }
+            _color_length = length;
+            LOG_F("[%s] new length: %u\n", _name, _length)
+            return true;
         }
         else
         {
-            LOG_LEDS_F("[%s] JSON was null\n", _name)
+            LOG_LEDS_F("[%s] length was too big\n", _name)
         }
         return false;
     }
 
-    bool leds_controller::repetitions(const JsonObject *json)
+    bool leds_controller::repetitions(const commands::command &command)
     {
-        if (json)
-        {
-            if (json->containsKey(REPEPTIONS_KEY))
-            {
-                _repetitions = (*json)[REPEPTIONS_KEY];
-                LOG_F("[%s] new repetitions: %u\n", _name, _repetitions)
-                return true;
-            }
-            else
-            {
-                LOG_LEDS_F("[%s] no interval key\n", _name)
-            }
-        }
-        else
-        {
-            LOG_LEDS_F("[%s] JSON was null\n", _name)
-        }
-        return false;
+        _repetitions = command.args.value.value;
+        LOG_F("[%s] new repetitions: %u\n", _name, _repetitions)
+        return true;
     }
 
-    bool leds_controller::restore_default(const JsonObject *json)
+    bool leds_controller::restore_default(const commands::command &command)
     {
         LOG_LEDS_F("[%s] restored default\n", _name)
         _length = DEF_LENGTH;
@@ -302,6 +205,7 @@ namespace json_parser
                 _leds[i] = CRGB::Black;
         }
         FastLED.show();
+        _state.touch(COLORS_STATE);
     }
 
     CRGB leds_controller::rainbow_factory(uint32_t index)
@@ -320,49 +224,54 @@ namespace json_parser
         return _custom_colors[index];
     }
 
-    void leds_controller::update()
+    void leds_controller::schedule(task_scheduler &scheduler)
     {
-        static unsigned long last_measute = millis();
-
-        if (_direction != animation_direction::STOP && _current_animation && millis() - last_measute > _animation_updates_interval)
-        {
-            if (_direction == animation_direction::FORWARD)
-            {
-                _animation_index = (_animation_index + 1U) % (UINT32_MAX - NUM_LEDS);
-            }
-            else if (_direction == animation_direction::BACKWARD)
-            {
-                if (_animation_index == 0U)
-                    _animation_index = UINT32_MAX - 1U - NUM_LEDS;
-                else
-                    _animation_index--;
-            }
+        _scheduler = &scheduler;
+        _animation_task = scheduler.add<leds_controller, &leds_controller::animate>(*this, _animation_updates_interval, ANIMATION_PHASE);
+    }
 
-            LOG_LEDS_F("[%s] animation index: %u\n", _name, _animation_index)
-            show_leds();
+    void leds_controller::animate()
+    {
+        if (_direction == animation_direction::STOP || !_current_animation)
+            return;
 
-            last_measute = millis();
+        if (_direction == animation_direction::FORWARD)
+        {
+            _animation_index = (_animation_index + 1U) % (UINT32_MAX - NUM_LEDS);
+        }
+        else if (_direction == animation_direction::BACKWARD)
+        {
+            if (_animation_index == 0U)
+                _animation_index = UINT32_MAX - 1U - NUM_LEDS;
+            else
+                _animation_index--;
         }
+
+        LOG_LEDS_F("[%s] animation index: %u\n", _name, _animation_index)
+        show_leds();
     }
 
-    DynamicJsonDocument leds_controller::retrive_data()
+    void leds_controller::retrive_data(json_writer &json, uint32_t since)
     {
-        DynamicJsonDocument json(_json_size);
-        json[NAME_FIELD] = _name;
-        JsonObject data = json.createNestedObject(DATA_FIELD);
-
-        data[BRIGHTNESS_KEY] = _brightness;
-        data[INTERVAL_KEY] = _animation_updates_interval;
-        JsonArray array = data.createNestedArray(COLORS_KEY);
-        for (uint8_t i = 0; i < NUM_LEDS; i++)
+        json.begin_object();
+        if (_state.changed(BRIGHTNESS_STATE, since))
+            json.member(BRIGHTNESS_KEY, _brightness);
+        if (_state.changed(INTERVAL_STATE, since))
+            json.member(INTERVAL_KEY, _animation_updates_interval);
+        if (_state.changed(COLORS_STATE, since))
         {
-            auto &color = _leds[i];
-            uint32_t buffer = color.red;
-            buffer |= static_cast<uint32_t>(color.green) >> 8;
-            buffer |= static_cast<uint32_t>(color.blue) >> 16;
+            json.key(COLORS_KEY).begin_array();
+            for (uint8_t i = 0; i < NUM_LEDS; i++)
+            {
+                auto &color = _leds[i];
+                uint32_t buffer = color.red;
+                buffer |= static_cast<uint32_t>(color.green) >> 8;
+                buffer |= static_cast<uint32_t>(color.blue) >> 16;
 
-            array.add(buffer);
+                json.value(buffer);
+            }
+            json.end_array();
         }
-        return json;
+        json.end_object();
     }
 } // namespace json_parser
\ No newline at end of file
@@ -13,27 +13,30 @@ namespace json_parser
     public:
         explicit leds_controller();
         bool initialize() override;
-        void update() override;
-        DynamicJsonDocument retrive_data() override;
+        void schedule(task_scheduler &scheduler) override;
+        void retrive_data(json_writer &json, uint32_t since) override;
+        uint32_t version() const override { return _state.latest(); }
 
     private:
-        bool eurobeat(const JsonObject *json);
-        bool custom(const JsonObject *json);
-        bool random(const JsonObject *json);
-        bool forward(const JsonObject *json);
-        bool backward(const JsonObject *json);
-        bool stop(const JsonObject *json);
-        bool off(const JsonObject *json);
-
-        bool custom_color(const JsonObject *json);
-        bool brightness(const JsonObject *json);
-        bool update_interval(const JsonObject *json);
-        bool length(const JsonObject *json);
-        bool color_length(const JsonObject *json);
-        bool repetitions(const JsonObject *json);
-        bool restore_default(const JsonObject *json);
+        bool eurobeat(const commands::command &command);
+        bool custom(const commands::command &command);
+        bool random(const commands::command &command);
+        bool forward(const commands::command &command);
+        bool backward(const commands::command &command);
+        bool stop(const commands::command &command);
+        bool off(const commands::command &command);
+
+        bool custom_color(const commands::command &command);
+        bool brightness(const commands::command &command);
+        bool update_interval(const commands::command &command);
+        bool length(const commands::command &command);
+        bool color_length(const commands::command &command);
+        bool repetitions(const commands::command &command);
+        bool restore_default(const commands::command &command);
 
         void show_leds();
+        // periodic task, moves the animation by one led
+        void animate();
 
         CRGB rainbow_factory(uint32_t index);
         CRGB random_factory(uint32_t index);
@@ -83,6 +86,24 @@ namespace json_parser
         static constexpr const char *LENGTH_KEY = LENGTH;
         static constexpr const char *REPEPTIONS_KEY = REPETITIONS;
 
+        friend class templated_controller<leds_controller>;
+        static constexpr auto COMMANDS = make_command_table<leds_controller>({
+            {EUROBEAT, &leds_controller::eurobeat},
+            {CUSTOM, &leds_controller::custom},
+            {RANDOM, &leds_controller::random},
+            {FORWARD, &leds_controller::forward},
+            {BACKWARD, &leds_controller::backward},
+            {STOP, &leds_controller::stop},
+            {OFF, &leds_controller::off},
+            {CUSTOM_COLOR, &leds_controller::custom_color, commands::codecs::COLOR, nullptr, command_queue::priority::BULK, true},
+            {LENGTH, &leds_controller::length, commands::codecs::VALUE, LENGTH_KEY},
+            {BRIGHTNESS, &leds_controller::brightness, commands::codecs::VALUE, BRIGHTNESS_KEY, command_queue::priority::BULK, true},
+            {UPDATE_INTERVAL, &leds_controller::update_interval, commands::codecs::VALUE, INTERVAL_KEY},
+            {REPETITIONS, &leds_controller::repetitions, commands::codecs::VALUE, REPEPTIONS_KEY},
+            {COLOR_LENGTH, &leds_controller::color_length, commands::codecs::VALUE, LENGTH_KEY},
+            {RESTORE_DEFAULT, &leds_controller::restore_default},
+        });
+
         static constexpr uint32_t NUM_LEDS = 90U;
         static constexpr uint8_t DATA_PIN = 4U;
         static constexpr EOrder COLOR_ODER = GRB;
@@ -90,6 +111,7 @@ namespace json_parser
         static constexpr uint32_t DEF_LENGTH = NUM_LEDS;
         static constexpr uint32_t DEF_REPETITIONS = 0;
         static constexpr uint32_t DEF_COLOR_LENGTH = 0;
+        static constexpr uint32_t ANIMATION_PHASE = 2U;
 
         CRGB _leds[NUM_LEDS];
         uint32_t _length = DEF_LENGTH;
@@ -103,6 +125,16 @@ namespace json_parser
 
         animation_direction _direction = animation_direction::STOP;
         CRGB(leds_controller::*_current_animation)(uint32_t index) = nullptr;
+
+        // update_interval changes period of the task
+        task_scheduler *_scheduler = nullptr;
+        int16_t _animation_task = task_scheduler::NO_TASK;
+
+        static constexpr uint8_t BRIGHTNESS_STATE = 0U;
+        static constexpr uint8_t INTERVAL_STATE = 1U;
+        // every time the leds are shown
+        static constexpr uint8_t COLORS_STATE = 2U;
+        state_stamps<3> _state;
     };
 } // namespace json_parser
 
@@ -12,40 +12,39 @@ namespace json_parser
     public:
         explicit mp3_controller();
         bool initialize() override;
-        void update() override
-        {}
-        DynamicJsonDocument retrive_data() override;
+        void retrive_data(json_writer &json, uint32_t since) override;
+        uint32_t version() const override { return _state.latest(); }
 
     private:
-        bool stop_playing(const JsonObject *json);
-        bool set_volume(const JsonObject *json);
-        bool resume(const JsonObject *json);
+        bool stop_playing(const commands::command &command);
+        bool set_volume(const commands::command &command);
+        bool resume(const commands::command &command);
 
-        bool windows_xp(const JsonObject *json);
-        bool mighty_polish_tank(const JsonObject *json);
-        bool high_ground(const JsonObject *json);
-        bool fine_addition(const JsonObject *json);
-        bool i_dont_like_sand(const JsonObject *json);
-        bool hello_there(const JsonObject *json);
-        bool im_the_senate(const JsonObject *json);
-        bool forever_young(const JsonObject *json);
-        bool revenge(const JsonObject *json);
-        bool silhouette(const JsonObject *json);
-        bool the_bad_touch(const JsonObject *json);
-        bool hero(const JsonObject *json);
-        bool gas_gas_gas(const JsonObject *json);
-        bool running_in_the_90s(const JsonObject *json);
-        bool deja_vu(const JsonObject *json);
-        bool running_in_the_90s_short(const JsonObject *json);
-        bool deja_vu_short(const JsonObject *json);
-        bool true_survivor(const JsonObject *json);
-        bool propaganda(const JsonObject *json);
-        bool giorno(const JsonObject *json);
-        bool noble_pope(const JsonObject *json);
-        bool torture_dance(const JsonObject *json);
-        bool awaken(const JsonObject *json);
-        bool dio_vs_jotaro(const JsonObject *json);
-        bool error(const JsonObject* json);
+        bool windows_xp(const commands::command &command);
+        bool mighty_polish_tank(const commands::command &command);
+        bool high_ground(const commands::command &command);
+        bool fine_addition(const commands::command &command);
+        bool i_dont_like_sand(const commands::command &command);
+        bool hello_there(const commands::command &command);
+        bool im_the_senate(const commands::command &command);
+        bool forever_young(const commands::command &command);
+        bool revenge(const commands::command &command);
+        bool silhouette(const commands::command &command);
+        bool the_bad_touch(const commands::command &command);
+        bool hero(const commands::command &command);
+        bool gas_gas_gas(const commands::command &command);
+        bool running_in_the_90s(const commands::command &command);
+        bool deja_vu(const commands::command &command);
+        bool running_in_the_90s_short(const commands::command &command);
+        bool deja_vu_short(const commands::command &command);
+        bool true_survivor(const commands::command &command);
+        bool propaganda(const commands::command &command);
+        bool giorno(const commands::command &command);
+        bool noble_pope(const commands::command &command);
+        bool torture_dance(const commands::command &command);
+        bool awaken(const commands::command &command);
+        bool dio_vs_jotaro(const commands::command &command);
+        bool error(const commands::command &command);
 
         static constexpr const char *MIGHTY_POLISH_TANK = "mighty_polish_tank";
         static constexpr const char *WINDOWS_XP = "windows_xp";
@@ -79,9 +78,45 @@ namespace json_parser
 
         static constexpr const char *VOLUME_KEY = SET_VOLUME;
 
+        friend class templated_controller<mp3_controller>;
+        static constexpr auto COMMANDS = make_command_table<mp3_controller>({
+            {WINDOWS_XP, &mp3_controller::windows_xp},
+            {MIGHTY_POLISH_TANK, &mp3_controller::mighty_polish_tank},
+            {HIGH_GROUND, &mp3_controller::high_ground},
+            {FINE_ADDITION, &mp3_controller::fine_addition},
+            {I_DONT_LIKE_SAND, &mp3_controller::i_dont_like_sand},
+            {HELLO_THERE, &mp3_controller::hello_there},
+            {IM_THE_SENATE, &mp3_controller::im_the_senate},
+            {FOREVER_YOUNG, &mp3_controller::forever_young},
+            {REVENGE, &mp3_controller::revenge},
+            {SILHOUETTE, &mp3_controller::silhouette},
+            {THE_BAD_TOUCH, &mp3_controller::the_bad_touch},
+            {HERO, &mp3_controller::hero},
+            {GAS_GAS_GAS, &mp3_controller::gas_gas_gas},
+            {RUNNING_IN_THE_90S, &mp3_controller::running_in_the_90s},
+            {DEJA_VU, &mp3_controller::deja_vu},
+            {RUNNING_IN_THE_90S_SHORT, &mp3_controller::running_in_the_90s_short},
+            {DEJA_VU_SHORT, &mp3_controller::deja_vu_short},
+            {TRUE_SURVIVOR, &mp3_controller::true_survivor},
+            {PROPAGANDA, &mp3_controller::propaganda},
+            {GIORNO, &mp3_controller::giorno},
+            {NOBLE_POPE, &mp3_controller::noble_pope},
+            {TORTURE_DANCE, &mp3_controller::torture_dance},
+            {AWAKEN, &mp3_controller::awaken},
+            {DIO_VS_JOTARO, &mp3_controller::dio_vs_jotaro},
+            {ERROR, &mp3_controller::error},
+            {STOP, &mp3_controller::stop_playing},
+            {SET_VOLUME, &mp3_controller::set_volume, commands::codecs::VALUE, VOLUME_KEY, command_queue::priority::BULK, true},
+            {RESUME, &mp3_controller::resume},
+        });
+
         MD_YX5300 _mp3;
         uint8_t _volume = 15;
         const char *_last_song = nullptr;
+
+        static constexpr uint8_t SONG_STATE = 0U;
+        static constexpr uint8_t VOLUME_STATE = 1U;
+        state_stamps<2> _state;
     };
 } // namespace json_parser
 
@@ -21,13 +21,14 @@
 
 namespace json_parser
 {
-    sd_controller::sd_controller() : controller("sd", JSON_OBJECT_SIZE(2))
+    sd_controller::sd_controller(const abstract_parser &parser) : controller("sd"),
+                                                                  _parser(parser)
     {
     }
 
     sd_controller::~sd_controller()
     {
-        delete_json();
+        delete_step();
     }
 
     bool sd_controller::initialize()
@@ -42,26 +43,56 @@ namespace json_parser
                 if (temp_file)
                     temp_file.close();
             }
+            _log = SD.open(LOG_FILE, "a");
+            if (!_log)
+            {
+                LOG_SD_F("[%s] unable to open logs file\n", _name)
+            }
         }
         return succ;
     }
 
     bool sd_controller::can_handle(const JsonObject &json) const
     {
-        if (json.containsKey(TIME_KEY))
+        if (json.containsKey(CONTROLLER_KEY))
         {
-            return false;
+            const char *controller = json[CONTROLLER_KEY];
+            return !strcmp(controller, _name);
         }
-        return true;
+        return false;
+    }
+
+    void sd_controller::schedule(task_scheduler &scheduler)
+    {
+        _scheduler = &scheduler;
+        _script_task = scheduler.add<sd_controller, &sd_controller::run_script>(*this, SCRIPT_INTERVAL, SCRIPT_PHASE);
+        // nothing to do until execute arrives
+        if (!_execute)
+            scheduler.suspend(_script_task);
+        scheduler.add<sd_controller, &sd_controller::flush_log>(*this, LOG_INTERVAL, LOG_PHASE);
     }
 
-    void sd_controller::update()
+    void sd_controller::flush_log()
+    {
+        if (!_log_used)
+            return;
+
+        if (_log)
+        {
+            _log.write(reinterpret_cast<const uint8_t *>(_log_buffer), _log_used);
+            _log.flush();
+            LOG_SD_F("[%s] flushed %u bytes of logs\n", _name, static_cast<unsigned>(_log_used))
+        }
+        _log_used = 0;
+    }
+
+    void sd_controller::run_script()
     {
         if (_execute)
         {
             if (!_file_to_execute.isEmpty() && !_file)
             {
-                delete_json();
+                delete_step();
                 LOG_SD_F("[%s] opening file to execute: %s\n", _name, _file_to_execute.c_str())
                 _file = SD.open(_file_to_execute);
                 _file_to_execute.clear();
@@ -79,35 +110,41 @@ namespace json_parser
 
             if (_file)
             {
-                // there is a json -> needs to be handled (maybe waiting or smth)
-                if (_json)
+                // there is a step -> needs to be handled (maybe waiting or smth)
+                if (_has_step)
                 {
-                    handle_current_json();
+                    handle_current_step();
                 }
-                else // create new json from file
+                else // decode next step from file
                 {
                     LOG_SD_F("[%s] peek int: %d\n", _name, _file.peek())
                     if (_file.peek() != -1)
                     {
-                        _json = new DynamicJsonDocument(512);
-                        auto error = deserializeJson(*_json, _file);
+                        global_queue::document json;
+                        auto error = deserializeJson(json, _file);
+                        _step = commands::command{};
 
                         if (error)
                         {
                             LOG_SD_F("[%s] error: %s\n", _name, error.c_str())
-                            delete_json();
                             _file.close();
                             _execute = false;
                         }
-                        else if (!_json->containsKey(TIME_KEY))
+                        else if (!json.containsKey(TIME_KEY))
                         {
                             LOG_SD_F("[%s] error, not time key in script\n", _name);
-                            delete_json();
+                        }
+                        else if (!_parser.decode(json.as<JsonObject>(), _step))
+                        {
+                            LOG_SD_F("[%s] error, invalid command in script\n", _name);
                         }
                         else
                         {
-                            LOG_SD_JSON_PRETTY(*_json)
-                            handle_current_json();
+                            LOG_SD_JSON_PRETTY(json)
+                            _step_time = json[TIME_KEY];
+                            _step.set_source(commands::origin::SCRIPT);
+                            _has_step = true;
+                            handle_current_step();
                         }
                     }
                     else
@@ -123,17 +160,19 @@ namespace json_parser
                 _execute = false;
             }
         }
+
+        if (!_execute)
+            _scheduler->suspend(_script_task);
     }
 
-    void sd_controller::handle_current_json()
+    void sd_controller::handle_current_step()
     {
-        uint32_t interval = (*_json)[TIME_KEY];
-        if (millis() - _last_executed >= interval)
+        if (millis() - _last_executed >= _step_time)
         {
-            if (global_queue::queue.push(&_json))
+            if (global_queue::push(_step))
             {
-                LOG_SD_F("[%s] sent json\n", _name)
-                _json = nullptr;
+                LOG_SD_F("[%s] sent command\n", _name)
+                delete_step();
                 _last_executed = millis();
             }
             else
@@ -143,70 +182,99 @@ namespace json_parser
         }
     }
 
-    bool sd_controller::handle(const JsonObject &json)
+    bool sd_controller::decode(const JsonObject &json, commands::command &command) const
     {
-        if (!json.containsKey(TIME_KEY))
-        {
-            if (json.containsKey(COMMAND_KEY) && !strcmp(json[COMMAND_KEY].as<const char *>(), EXECUTE))
-            {
-                LOG_SD_F("[%s] recived execute command\n", _name)
-                if (json.containsKey(FILE_KEY))
-                {
-                    _file_to_execute = json[FILE_KEY].as<String>();
-                    _file.close();
-                    _execute = true;
-                    return true;
-                }
-            }
-            else
-            {
-                LOG_SD_F("[%s] logging message\n", _name)
-                _file.close();
+        const char *name = json[COMMAND_KEY];
+        if (!name || strcmp(name, EXECUTE))
+            return false;
 
-                _file = SD.open(LOG_FILE, "a");
-                if (_file)
-                {
-                    auto time_point = millis();
-                    json[TIME_KEY] = time_point - _last_log;
-                    _last_log = time_point;
-
-                    WriteBufferingStream bufferedFile(_file, 64);
-                    serializeJson(json, _file);
-                    bufferedFile.write('\n');
-                    bufferedFile.flush();
-                    _file.close();
-                    LOG_SD_F("[%s] serialized JSON\n", _name)
-                    return true;
-                }
-                else
-                {
-                    LOG_SD_F("[%s] unable to open the file\n", _name)
-                }
-            }
-        }
-        else
+        command.id = EXECUTE_ID;
+        command.set_lane(command_queue::priority::BULK);
+        bool decoded = commands::codecs::FILE_NAME.decode(json, FILE_KEY, command);
+        command.target = commands::NO_TARGET;
+        return decoded;
+    }
+
+    bool sd_controller::decode_binary(const uint8_t *data, size_t length, commands::command &command) const
+    {
+        if (!length || data[0] != EXECUTE_ID)
+            return false;
+
+        command.id = EXECUTE_ID;
+        command.set_lane(command_queue::priority::BULK);
+        bool decoded = commands::codecs::FILE_NAME.decode_binary(data + 1, length - 1, command);
+        command.target = commands::NO_TARGET;
+        return decoded;
+    }
+
+    bool sd_controller::encode(const commands::command &command, JsonObject &json) const
+    {
+        if (command.id != EXECUTE_ID)
+            return false;
+
+        json[COMMAND_KEY] = EXECUTE;
+        commands::codecs::FILE_NAME.encode(command, FILE_KEY, json);
+        return true;
+    }
+
+    bool sd_controller::handle(const commands::command &command)
+    {
+        if (command.id == EXECUTE_ID)
         {
-            LOG_SD_F("[%s] not handling to prevent loop\n", _name)
+            LOG_SD_F("[%s] recived execute command\n", _name)
+            _file_to_execute = command.args.file.name;
+            _file.close();
+            _execute = true;
+            if (_scheduler)
+                _scheduler->resume(_script_task);
+            return true;
         }
-
         return false;
     }
 
-    void sd_controller::delete_json()
+    void sd_controller::observe(const commands::command &command)
     {
-        LOG_SD_F("[%s] deleting json\n", _name)
-        if (_json)
+        if (command.source() == commands::origin::SCRIPT)
+        {
+            LOG_SD_F("[%s] not logging to prevent loop\n", _name)
+            return;
+        }
+
+        if (!_log)
+            return;
+
+        global_queue::document json;
+        JsonObject message = json.to<JsonObject>();
+        if (!_parser.encode(command, message) || can_handle(message))
+            return;
+
+        auto time_point = millis();
+        json[TIME_KEY] = time_point - _last_log;
+
+        // one line and its newline, serializeJson needs room for the terminator too
+        size_t length = measureJson(json);
+        if (_log_used + length + 1 > LOG_BUFFER)
         {
-            delete _json;
-            _json = nullptr;
+            ++_log_dropped;
+            LOG_SD_F("[%s] log buffer full, dropped %u lines\n", _name, _log_dropped)
+            return;
         }
+
+        serializeJson(json, _log_buffer + _log_used, LOG_BUFFER - _log_used);
+        _log_used += length;
+        _log_buffer[_log_used++] = '\n';
+        _last_log = time_point;
+        LOG_SD_F("[%s] buffered message\n", _name)
+    }
+
+    void sd_controller::delete_step()
+    {
+        LOG_SD_F("[%s] deleting step\n", _name)
+        _has_step = false;
     }
 
-    DynamicJsonDocument sd_controller::retrive_data()
+    void sd_controller::retrive_data(json_writer &json, uint32_t since)
     {
-        DynamicJsonDocument json(_json_size);
-        json[NAME_FIELD] = _name;
-        json[DATA_FIELD] = nullptr;
-        return json;
+        json.value(nullptr);
     }
 } // namespace json_parser
\ No newline at end of file
@@ -1,38 +1,73 @@
 #include <Arduino.h>
 #include <SD.h>
 #include "abstract/controller.hpp"
+#include "commands/codecs.hpp"
+#include "json_parser/abstract_parser.hpp"
+#include "global_queue.hpp"
 
 namespace json_parser
 {
     class sd_controller final : public controller
     {
     public:
-        explicit sd_controller();
+        explicit sd_controller(const abstract_parser &parser);
         ~sd_controller();
         bool initialize() override;
-        void update() override;
-        DynamicJsonDocument retrive_data() override;
+        void schedule(task_scheduler &scheduler) override;
+        void retrive_data(json_writer &json, uint32_t since) override;
+        bool decode(const JsonObject &json, commands::command &command) const override;
+        bool decode_binary(const uint8_t *data, size_t length, commands::command &command) const override;
+        bool encode(const commands::command &command, JsonObject &json) const override;
+        // buffers every command for the log, written by flush_log
+        void observe(const commands::command &command) override;
 
     private:
+        template <typename... Controllers>
+        friend class static_parser;
+
         bool can_handle(const JsonObject &json) const override;
-        bool handle(const JsonObject &json) override;
-        void handle_current_json();
-        void delete_json();
+        bool handle(const commands::command &command) override;
+        // periodic task, only active while a script is executed
+        void run_script();
+        // periodic task, appends the buffered log lines to the card
+        void flush_log();
+        void handle_current_step();
+        void delete_step();
 
         static constexpr uint8_t CHIP_SELECT = 5U;
         static constexpr const char *EXECUTE = "execute";
+        static constexpr uint8_t EXECUTE_ID = 0U;
         static constexpr const char *FILE_KEY = "file";
 
         static constexpr const char *LOG_FILE = "/logs.txt";
+        // lines that do not fit until the next flush are dropped
+        static constexpr size_t LOG_BUFFER = 2048U;
+        static constexpr uint32_t LOG_INTERVAL = 250U;
+        static constexpr uint32_t LOG_PHASE = 3U;
 
         static constexpr const char *TIME_KEY = "time";
 
+        static constexpr uint32_t SCRIPT_INTERVAL = 1U;
+        static constexpr uint32_t SCRIPT_PHASE = 3U;
+
         File _file;
+        // kept open, so observing a command never touches the card
+        File _log;
+        char _log_buffer[LOG_BUFFER];
+        size_t _log_used = 0;
+        uint32_t _log_dropped = 0;
         bool _execute = false;
         String _file_to_execute;
 
         unsigned long _last_log = 0;
         unsigned long _last_executed = 0;
-        DynamicJsonDocument *_json = nullptr;
+        const abstract_parser &_parser;
+        // script step waiting for its time, decoded as soon as it is read
+        commands::command _step{};
+        uint32_t _step_time = 0;
+        bool _has_step = false;
+
+        task_scheduler *_scheduler = nullptr;
+        int16_t _script_task = task_scheduler::NO_TASK;
     };
 } // namespace json_parser
\ No newline at end of file
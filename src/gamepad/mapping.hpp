@@ -0,0 +1,234 @@
+#ifndef __GAMEPAD_MAPPING_HPP__
+#define __GAMEPAD_MAPPING_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "commands/command.hpp"
+
+namespace gamepad
+{
+    static constexpr uint8_t BUTTONS = 16U;
+    static constexpr uint8_t AXES = commands::GAMEPAD_AXES;
+    static constexpr uint8_t COMBINATIONS = 8U;
+
+    // inputs are numbered: buttons 0 - 15, axes from AXIS_INPUT, combinations from COMBINATION_INPUT
+    static constexpr uint8_t AXIS_INPUT = 16U;
+    static constexpr uint8_t COMBINATION_INPUT = 32U;
+
+    enum class event : uint8_t
+    {
+        // buttons and combinations
+        PRESSED = 0,
+        RELEASED,
+        // axes, when the axis moves into the zone
+        NEGATIVE,
+        IDLE,
+        POSITIVE,
+    };
+
+    static constexpr uint8_t EVENTS = 5U;
+
+    // standard gamepad layout (browser Gamepad API)
+    namespace buttons
+    {
+        static constexpr uint8_t A = 0U;
+        static constexpr uint8_t B = 1U;
+        static constexpr uint8_t X = 2U;
+        static constexpr uint8_t Y = 3U;
+        static constexpr uint8_t LB = 4U;
+        static constexpr uint8_t RB = 5U;
+        static constexpr uint8_t LT = 6U;
+        static constexpr uint8_t RT = 7U;
+    } // namespace buttons
+
+    namespace axes
+    {
+        static constexpr uint8_t LEFT_HORIZONTAL = 0U;
+        static constexpr uint8_t LEFT_VERTICAL = 1U;
+        static constexpr uint8_t RIGHT_HORIZONTAL = 2U;
+        static constexpr uint8_t RIGHT_VERTICAL = 3U;
+    } // namespace axes
+
+    // what happens on the edges of every input, frames are compared with the previous one
+    // a combination is a set of buttons (mask) in the given state (pressed), entered and left like a button
+    // frame is processed like the browser did it: axes, buttons, combinations
+    class mapping
+    {
+    public:
+        // axis is in the middle zone between -pivot and pivot
+        static constexpr int8_t DEFAULT_PIVOT = 89;
+
+        mapping()
+        {
+            for (auto &axis : _axes)
+                axis.pivot = DEFAULT_PIVOT;
+            reset();
+        }
+
+        // command run on the event, false when that input doesn't have such event
+        bool assign(uint8_t input, event on, const commands::command &command)
+        {
+            action *target = find(input, on);
+            if (!target)
+                return false;
+            *target = {command, true};
+            return true;
+        }
+
+        bool clear(uint8_t input, event on)
+        {
+            action *target = find(input, on);
+            if (!target)
+                return false;
+            target->set = false;
+            return true;
+        }
+
+        bool set_pivot(uint8_t axis, int8_t pivot)
+        {
+            if (axis >= AXES || pivot < 0)
+                return false;
+            _axes[axis].pivot = pivot;
+            return true;
+        }
+
+        // returns its input number (COMBINATION_INPUT + i), -1 when there is no room
+        int16_t add_combination(uint16_t mask, uint16_t pressed)
+        {
+            for (uint8_t i = 0; i < COMBINATIONS; i++)
+            {
+                if (_combinations[i].mask)
+                    continue;
+                _combinations[i] = {mask, static_cast<uint16_t>(pressed & mask), {}, {}};
+                return COMBINATION_INPUT + i;
+            }
+            return -1;
+        }
+
+        // gamepad let go -> next frame is compared with nothing pressed, axes in the middle
+        void reset()
+        {
+            _previous = {};
+        }
+
+        // dispatch(command) for every edge, returns how many there were
+        template <typename F>
+        uint8_t process(const commands::gamepad_args &current, F &&dispatch)
+        {
+            uint8_t count = 0;
+            auto run = [&dispatch, &count](const action &target) {
+                if (target.set)
+                {
+                    dispatch(target.command);
+                    count++;
+                }
+            };
+
+            for (uint8_t i = 0; i < AXES; i++)
+            {
+                const axis_rule &rule = _axes[i];
+                int8_t zone = zone_of(current.axes[i], rule.pivot);
+                if (zone == zone_of(_previous.axes[i], rule.pivot))
+                    continue;
+                run(zone < 0 ? rule.negative : zone > 0 ? rule.positive : rule.idle);
+            }
+
+            uint16_t changed = current.buttons ^ _previous.buttons;
+            for (uint8_t i = 0; changed && i < BUTTONS; i++)
+            {
+                uint16_t bit = 1U << i;
+                if (changed & bit)
+                    run(current.buttons & bit ? _buttons[i].pressed : _buttons[i].released);
+            }
+
+            for (const auto &rule : _combinations)
+            {
+                if (!rule.mask)
+                    continue;
+                bool now = (current.buttons & rule.mask) == rule.pressed;
+                bool before = (_previous.buttons & rule.mask) == rule.pressed;
+                if (now != before)
+                    run(now ? rule.entered : rule.left);
+            }
+
+            _previous = current;
+            return count;
+        }
+
+        const commands::gamepad_args &previous() const { return _previous; }
+
+    private:
+        struct action
+        {
+            commands::command command;
+            bool set;
+        };
+
+        struct button_rule
+        {
+            action pressed;
+            action released;
+        };
+
+        struct axis_rule
+        {
+            int8_t pivot;
+            action negative;
+            action idle;
+            action positive;
+        };
+
+        struct combination_rule
+        {
+            // 0 -> free
+            uint16_t mask;
+            uint16_t pressed;
+            action entered;
+            action left;
+        };
+
+        static int8_t zone_of(int8_t position, int8_t pivot)
+        {
+            return position < -pivot ? -1 : position > pivot ? 1 : 0;
+        }
+
+        action *find(uint8_t input, event on)
+        {
+            if (input < BUTTONS)
+            {
+                if (on == event::PRESSED)
+                    return &_buttons[input].pressed;
+                if (on == event::RELEASED)
+                    return &_buttons[input].released;
+            }
+            else if (input >= AXIS_INPUT && input < AXIS_INPUT + AXES)
+            {
+                axis_rule &rule = _axes[input - AXIS_INPUT];
+                if (on == event::NEGATIVE)
+                    return &rule.negative;
+                if (on == event::IDLE)
+                    return &rule.idle;
+                if (on == event::POSITIVE)
+                    return &rule.positive;
+            }
+            else if (input >= COMBINATION_INPUT && input < COMBINATION_INPUT + COMBINATIONS)
+            {
+                combination_rule &rule = _combinations[input - COMBINATION_INPUT];
+                if (!rule.mask)
+                    return nullptr;
+                if (on == event::PRESSED)
+                    return &rule.entered;
+                if (on == event::RELEASED)
+                    return &rule.left;
+            }
+            return nullptr;
+        }
+
+        button_rule _buttons[BUTTONS] = {};
+        axis_rule _axes[AXES] = {};
+        combination_rule _combinations[COMBINATIONS] = {};
+        commands::gamepad_args _previous;
+    };
+} // namespace gamepad
+
+#endif // __GAMEPAD_MAPPING_HPP__
@@ -1,6 +1,187 @@
+#include <Arduino.h>
+#include <atomic>
 #include "global_queue.hpp"
+#include "json_parser/abstract_parser.hpp"
 
 namespace global_queue
 {
     global_queue queue;
-}
\ No newline at end of file
+    drainer drain(queue, []() -> uint32_t { return micros(); }, DRAIN_BUDGET_US);
+    scheduler::idle_meter idle([]() -> uint32_t { return micros(); });
+    batch_queue batches;
+
+    static const json_parser::abstract_parser *decoder = nullptr;
+    // task blocked in wait(), only one consumer
+    static std::atomic<TaskHandle_t> waiting{nullptr};
+
+    void attach(const json_parser::abstract_parser &parser)
+    {
+        decoder = &parser;
+    }
+
+    int16_t index_of(const char *name)
+    {
+        return decoder ? decoder->index_of(name) : -1;
+    }
+
+    // fill(command) decodes straight into a queue slot
+    template <typename F>
+    static commands::command *decode(F &&fill, commands::origin source)
+    {
+        if (!decoder)
+            return nullptr;
+
+        auto *command = queue.acquire();
+        if (command && !fill(*command))
+        {
+            queue.release(command);
+            return nullptr;
+        }
+
+        if (command)
+            command->set_source(source);
+        return command;
+    }
+
+    static bool woken(bool pushed)
+    {
+        if (pushed)
+            wake();
+        return pushed;
+    }
+
+    static commands::command *decode(const JsonObject &json, commands::origin source)
+    {
+        return decode([&json](commands::command &command) { return decoder->decode(json, command); }, source);
+    }
+
+    bool push(const JsonObject &json, commands::origin source)
+    {
+        return woken(queue.push(decode(json, source)));
+    }
+
+    bool push(const JsonObject &json, commands::origin source, command_queue::priority lane)
+    {
+        return woken(queue.push(decode(json, source), lane));
+    }
+
+    // fill(command) decodes the next command of the batch, called count times in order
+    template <typename F>
+    static bool push_batch(size_t count, F &&fill, commands::origin source, bool ack = true)
+    {
+        if (!decoder || !count || count > BATCH_SIZE)
+            return false;
+
+        auto *batch = batches.acquire();
+        if (!batch)
+            return false;
+
+        for (uint8_t i = 0; i < count; i++)
+        {
+            auto &command = batch->commands[i];
+            command = commands::command{};
+            if (!fill(command))
+            {
+                batches.release(batch);
+                return false;
+            }
+            command.set_source(source);
+        }
+        batch->count = static_cast<uint8_t>(count);
+        batch->ack = ack;
+        return woken(batches.push(batch));
+    }
+
+    bool push(const JsonArray &json, commands::origin source)
+    {
+        size_t index = 0;
+        return push_batch(json.size(), [&json, &index](commands::command &command) {
+            JsonObject message = json[index++];
+            return decoder->decode(message, command);
+        }, source);
+    }
+
+    // every message has its length in front, lengths have to add up to the whole batch
+    static bool push_batch(const uint8_t *data, size_t length, commands::origin source, bool ack = true)
+    {
+        size_t count = 0;
+        for (size_t offset = 0; offset < length; offset += data[offset] + 1U)
+        {
+            if (++count > BATCH_SIZE || offset + data[offset] + 1U > length)
+                return false;
+        }
+
+        size_t offset = 0;
+        return push_batch(count, [data, &offset](commands::command &command) {
+            const uint8_t *message = data + offset + 1U;
+            size_t size = data[offset];
+            offset += size + 1U;
+            return decoder->decode_binary(message, size, command);
+        }, source, ack);
+    }
+
+    bool push(const uint8_t *data, size_t length, commands::origin source)
+    {
+        if (length && data[0] == BATCH)
+            return push_batch(data + 1, length - 1, source);
+
+        return woken(queue.push(decode([data, length](commands::command &command) {
+            return decoder->decode_binary(data, length, command);
+        }, source)));
+    }
+
+    bool push_unacked(const uint8_t *data, size_t length, commands::origin source)
+    {
+        if (length && data[0] == BATCH)
+            return push_batch(data + 1, length - 1, source, false);
+        return push(data, length, source);
+    }
+
+    bool push(const commands::command &command)
+    {
+        return woken(queue.push(command));
+    }
+
+    static bool push_bulk(commands::command *command)
+    {
+        if (!command)
+            return false;
+        auto lane = command->lane() == command_queue::priority::SAFETY ? command_queue::priority::SAFETY
+                                                                        : command_queue::priority::BULK;
+        return woken(queue.push(command, lane));
+    }
+
+    bool push_bulk(const JsonObject &json, commands::origin source)
+    {
+        return push_bulk(decode(json, source));
+    }
+
+    // batches are applied after the queue anyway
+    bool push_bulk(const uint8_t *data, size_t length, commands::origin source)
+    {
+        if (length && data[0] == BATCH)
+            return push_batch(data + 1, length - 1, source);
+
+        return push_bulk(decode([data, length](commands::command &command) {
+            return decoder->decode_binary(data, length, command);
+        }, source));
+    }
+
+    void wake()
+    {
+        TaskHandle_t task = waiting.load(std::memory_order_acquire);
+        if (task)
+            xTaskNotifyGive(task);
+    }
+
+    bool wait(uint32_t timeout_ms)
+    {
+        waiting.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+        idle.sleep();
+        // notifications given since the last wait are counted, so a push that came
+        // while the task was busy ends this wait right away
+        bool early = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms)) > 0;
+        idle.wake(early);
+        return early;
+    }
+} // namespace global_queue
@@ -2,42 +2,76 @@
 #define __GLOBAL_QUEUE_HPP__
 
 #include <ArduinoJson.h>
-#include <queue>
+#include "command_queue/command_queue.hpp"
+#include "command_queue/drainer.hpp"
+#include "command_queue/batch_queue.hpp"
+#include "commands/command.hpp"
+#include "scheduler/idle_meter.hpp"
+
+// latest-wins merging of queued setpoints, can be switched at runtime with config/coalescing
+#ifndef QUEUE_COALESCING
+#define QUEUE_COALESCING 0
+#endif
+
+// how long a single loop() pass may spend applying queued commands
+#ifndef DRAIN_BUDGET_US
+#define DRAIN_BUDGET_US 2000
+#endif
+
+namespace json_parser
+{
+    class abstract_parser;
+}
 
 namespace global_queue
 {
-    class global_queue
-    {
-    public:
-        bool initialize()
-        {
-            _queue = xQueueCreate(10, sizeof(DynamicJsonDocument *));
-            _semaphore = xSemaphoreCreateMutex();
-            return _queue && _semaphore;
-        }
-
-        bool push(DynamicJsonDocument **json)
-        {
-            if (xSemaphoreTake(_semaphore, (TickType_t)10) == pdTRUE)
-            {
-                bool succ = xQueueSend(_queue, json, (TickType_t)0) == pdPASS;
-                xSemaphoreGive(_semaphore);
-                return succ;
-            }
-            return false;
-        }
-
-        bool read(DynamicJsonDocument **json)
-        {
-            return xQueueReceive(_queue, json, (TickType_t)0) == pdPASS;
-        }
-
-    private:
-        xQueueHandle _queue;
-        SemaphoreHandle_t _semaphore;
-    };
+    static constexpr size_t QUEUE_DEPTH = 16U;
+    // biggest incoming message
+    static constexpr size_t JSON_SIZE = 256U;
+
+    typedef command_queue::command_queue<QUEUE_DEPTH> global_queue;
+    typedef StaticJsonDocument<JSON_SIZE> document;
+    typedef command_queue::drainer<global_queue> drainer;
+
+    // commands of a single message (json array or binary batch), applied whole, in order, in one pass
+    static constexpr uint8_t BATCH_SIZE = 8U;
+    static constexpr size_t BATCH_DEPTH = 4U;
+    // first byte of a binary batch: [BATCH, length, message, length, message...]
+    static constexpr uint8_t BATCH = 0xFFU;
+
+    typedef command_queue::batch_queue<BATCH_SIZE, BATCH_DEPTH> batch_queue;
 
     extern global_queue queue;
+    extern drainer drain;
+    extern batch_queue batches;
+    // time the control task spends in wait()
+    extern scheduler::idle_meter idle;
+
+    // parser that decodes incoming messages, has to be set before anything is pushed
+    void attach(const json_parser::abstract_parser &parser);
+    // position of the controller in that parser, -1 if there is none (or no parser yet)
+    int16_t index_of(const char *name);
+    // message is decoded straight into a queue slot, false if it is invalid or there is no room
+    bool push(const JsonObject &json, commands::origin source);
+    bool push(const JsonObject &json, commands::origin source, command_queue::priority lane);
+    // array of messages -> batch, nothing is queued unless every one of them is valid
+    bool push(const JsonArray &json, commands::origin source);
+    // binary message (see abstract_parser::decode_binary) or batch of them, same dispatch as json
+    bool push(const uint8_t *data, size_t length, commands::origin source);
+    // same, but a batch isn't acked -> for streams (udp) that would flood the websocket with acks
+    bool push_unacked(const uint8_t *data, size_t length, commands::origin source);
+    // already decoded command (script steps)
+    bool push(const commands::command &command);
+    // same decoding, but nothing goes above the bulk lane except a stop -> for the bulk endpoint,
+    // whatever comes in over it can't get in front of the driver
+    bool push_bulk(const JsonObject &json, commands::origin source);
+    bool push_bulk(const uint8_t *data, size_t length, commands::origin source);
+
+    // every successful push wakes the task blocked in wait()
+    void wake();
+    // blocks the calling task until something is pushed or timeout_ms passes
+    // returns true when it was woken up by a push
+    bool wait(uint32_t timeout_ms);
 } // namespace global_queue
 
-#endif // __GLOBAL_QUEUE_HPP__
\ No newline at end of file
+#endif // __GLOBAL_QUEUE_HPP__
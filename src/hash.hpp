@@ -0,0 +1,18 @@
+#ifndef __HASH_HPP__
+#define __HASH_HPP__
+
+#include <stdint.h>
+
+namespace hash
+{
+    static constexpr uint32_t FNV_OFFSET = 2166136261U;
+    static constexpr uint32_t FNV_PRIME = 16777619U;
+
+    // usable at compile time as well
+    constexpr uint32_t fnv1a(const char *string, uint32_t hash = FNV_OFFSET)
+    {
+        return *string ? fnv1a(string + 1, (hash ^ static_cast<uint8_t>(*string)) * FNV_PRIME) : hash;
+    }
+} // namespace hash
+
+#endif // __HASH_HPP__
@@ -0,0 +1,144 @@
+#ifndef __THROTTLE_HPP__
+#define __THROTTLE_HPP__
+
+#include <stdint.h>
+#include <atomic>
+#include "token_bucket.hpp"
+
+namespace ingress
+{
+    // token buckets of every client, one for each class of traffic, so a client flooding
+    // one class neither starves the other clients nor its own traffic of another class
+    // admit() and forget() only from the socket event handler, stats from anywhere
+    template <uint8_t CLIENTS, uint8_t CLASSES>
+    class throttle
+    {
+    public:
+        enum class result : uint8_t
+        {
+            admitted,
+            // one of the buckets doesn't have enough tokens, nothing was taken
+            throttled,
+            // more clients than CLIENTS
+            no_slot
+        };
+
+        struct client_stats
+        {
+            uint32_t client;
+            uint32_t admitted;
+            uint32_t throttled;
+        };
+
+        static constexpr uint8_t clients() { return CLIENTS; }
+        static constexpr uint8_t classes() { return CLASSES; }
+
+        // before the first message, every client shares the limits of a class
+        void configure(uint8_t traffic, const limit &limits)
+        {
+            if (traffic < CLASSES)
+                _limits[traffic] = limits;
+        }
+
+        const limit &limits(uint8_t traffic) const { return _limits[traffic]; }
+
+        // cost -> commands of every class in the message, all of them or none are let through
+        result admit(uint32_t client, const uint8_t (&cost)[CLASSES], uint32_t now_ms)
+        {
+            entry *target = acquire(client, now_ms);
+            if (!target)
+            {
+                _no_slot.fetch_add(1, std::memory_order_relaxed);
+                return result::no_slot;
+            }
+
+            for (uint8_t i = 0; i < CLASSES; i++)
+                target->buckets[i].refill(_limits[i], now_ms);
+
+            for (uint8_t i = 0; i < CLASSES; i++)
+            {
+                if (!target->buckets[i].has(_limits[i], cost[i]))
+                {
+                    target->throttled.fetch_add(1, std::memory_order_relaxed);
+                    return result::throttled;
+                }
+            }
+
+            for (uint8_t i = 0; i < CLASSES; i++)
+                target->buckets[i].take(_limits[i], cost[i]);
+            target->admitted.fetch_add(1, std::memory_order_relaxed);
+            return result::admitted;
+        }
+
+        // client disconnected, its slot is free for the next one
+        void forget(uint32_t client)
+        {
+            entry *target = find(client);
+            if (target)
+                target->used.store(false, std::memory_order_release);
+        }
+
+        // counters of the connected clients, returns how many were written
+        uint8_t stats(client_stats (&out)[CLIENTS]) const
+        {
+            uint8_t count = 0;
+            for (const auto &candidate : _entries)
+            {
+                if (!candidate.used.load(std::memory_order_acquire))
+                    continue;
+                out[count++] = {candidate.client.load(std::memory_order_relaxed),
+                                candidate.admitted.load(std::memory_order_relaxed),
+                                candidate.throttled.load(std::memory_order_relaxed)};
+            }
+            return count;
+        }
+
+        uint32_t no_slot() const { return _no_slot.load(std::memory_order_relaxed); }
+
+    private:
+        struct entry
+        {
+            std::atomic<uint32_t> client{0};
+            std::atomic<uint32_t> admitted{0};
+            std::atomic<uint32_t> throttled{0};
+            std::atomic<bool> used{false};
+            token_bucket buckets[CLASSES];
+        };
+
+        entry *find(uint32_t client)
+        {
+            for (auto &candidate : _entries)
+                if (candidate.used.load(std::memory_order_relaxed) && candidate.client.load(std::memory_order_relaxed) == client)
+                    return &candidate;
+            return nullptr;
+        }
+
+        // new client starts with full buckets
+        entry *acquire(uint32_t client, uint32_t now_ms)
+        {
+            entry *target = find(client);
+            if (target)
+                return target;
+
+            for (auto &candidate : _entries)
+            {
+                if (candidate.used.load(std::memory_order_relaxed))
+                    continue;
+                candidate.client.store(client, std::memory_order_relaxed);
+                candidate.admitted.store(0, std::memory_order_relaxed);
+                candidate.throttled.store(0, std::memory_order_relaxed);
+                for (uint8_t i = 0; i < CLASSES; i++)
+                    candidate.buckets[i].fill(_limits[i], now_ms);
+                candidate.used.store(true, std::memory_order_release);
+                return &candidate;
+            }
+            return nullptr;
+        }
+
+        entry _entries[CLIENTS];
+        limit _limits[CLASSES] = {};
+        std::atomic<uint32_t> _no_slot{0};
+    };
+} // namespace ingress
+
+#endif // __THROTTLE_HPP__
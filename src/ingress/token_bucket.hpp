@@ -0,0 +1,64 @@
+#ifndef __TOKEN_BUCKET_HPP__
+#define __TOKEN_BUCKET_HPP__
+
+#include <stdint.h>
+
+namespace ingress
+{
+    // commands per second and how many of them may come at once
+    // rate 0 -> not limited
+    struct limit
+    {
+        uint16_t rate;
+        uint16_t burst;
+    };
+
+    // tokens are kept in thousandths -> rate per second times milliseconds, no division
+    class token_bucket
+    {
+    public:
+        static constexpr uint32_t UNIT = 1000U;
+
+        void fill(const limit &limits, uint32_t now_ms)
+        {
+            _tokens = limits.burst * UNIT;
+            _last_ms = now_ms;
+        }
+
+        void refill(const limit &limits, uint32_t now_ms)
+        {
+            uint32_t elapsed = now_ms - _last_ms;
+            _last_ms = now_ms;
+            if (!limits.rate)
+                return;
+
+            uint32_t capacity = limits.burst * UNIT;
+            // long enough to fill it up, also keeps elapsed * rate from overflowing
+            if (elapsed >= capacity / limits.rate + 1U)
+                _tokens = capacity;
+            else if (_tokens + elapsed * limits.rate >= capacity)
+                _tokens = capacity;
+            else
+                _tokens += elapsed * limits.rate;
+        }
+
+        bool has(const limit &limits, uint8_t cost) const
+        {
+            return !limits.rate || _tokens >= cost * UNIT;
+        }
+
+        void take(const limit &limits, uint8_t cost)
+        {
+            if (limits.rate)
+                _tokens -= cost * UNIT;
+        }
+
+        uint32_t tokens() const { return _tokens / UNIT; }
+
+    private:
+        uint32_t _tokens = 0;
+        uint32_t _last_ms = 0;
+    };
+} // namespace ingress
+
+#endif // __TOKEN_BUCKET_HPP__
@@ -0,0 +1,119 @@
+#ifndef __TRAFFIC_HPP__
+#define __TRAFFIC_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace ingress
+{
+    // what a message is charged to, by the controllers its commands go to
+    enum class traffic : uint8_t
+    {
+        // driving, has to keep its share whatever else comes in
+        CONTROL = 0,
+        // leds, sound, files
+        BULK,
+        CONFIG,
+    };
+
+    static constexpr uint8_t TRAFFIC_CLASSES = 3U;
+
+    typedef uint8_t costs[TRAFFIC_CLASSES];
+
+    // cheap look at a message before it is parsed -> commands of every class in it
+    // anything that can't be told apart is charged as a single bulk command, the parser rejects it later
+    class traffic_meter
+    {
+    public:
+        // by_name(name, length) -> traffic of the controller, for every "controller" key of a json message
+        template <typename F>
+        static void text(const char *text, size_t length, F &&by_name, costs &cost)
+        {
+            clear(cost);
+            static constexpr char KEY[] = "\"controller\"";
+            static constexpr size_t KEY_LENGTH = sizeof(KEY) - 1U;
+
+            bool found = false;
+            for (size_t i = 0; i + KEY_LENGTH <= length; i++)
+            {
+                if (text[i] != '"' || memcmp(text + i, KEY, KEY_LENGTH) != 0)
+                    continue;
+
+                size_t position = skip_spaces(text, length, i + KEY_LENGTH);
+                // "controller" as a value, not a key
+                if (position >= length || text[position] != ':')
+                    continue;
+                position = skip_spaces(text, length, position + 1U);
+                if (position >= length || text[position] != '"')
+                    continue;
+
+                size_t start = position + 1U;
+                size_t end = start;
+                while (end < length && text[end] != '"')
+                    end++;
+                if (end >= length)
+                    break;
+
+                add(cost, by_name(text + start, end - start));
+                found = true;
+                i = end;
+            }
+
+            if (!found)
+                add(cost, traffic::BULK);
+        }
+
+        // by_index(controller) -> traffic, for a binary message or every message of a binary batch
+        template <typename F>
+        static void binary(const uint8_t *data, size_t length, uint8_t batch_marker, F &&by_index, costs &cost)
+        {
+            clear(cost);
+            if (!length)
+            {
+                add(cost, traffic::BULK);
+                return;
+            }
+            if (data[0] != batch_marker)
+            {
+                add(cost, by_index(data[0]));
+                return;
+            }
+
+            bool found = false;
+            for (size_t offset = 1U; offset < length; offset += data[offset] + 1U)
+            {
+                if (!data[offset] || offset + data[offset] + 1U > length)
+                    break;
+                add(cost, by_index(data[offset + 1U]));
+                found = true;
+            }
+
+            if (!found)
+                add(cost, traffic::BULK);
+        }
+
+    private:
+        static void clear(costs &cost)
+        {
+            for (auto &count : cost)
+                count = 0;
+        }
+
+        static void add(costs &cost, traffic type)
+        {
+            uint8_t &count = cost[static_cast<uint8_t>(type)];
+            if (count < UINT8_MAX)
+                count++;
+        }
+
+        static size_t skip_spaces(const char *text, size_t length, size_t position)
+        {
+            while (position < length && (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r'))
+                position++;
+            return position;
+        }
+    };
+} // namespace ingress
+
+#endif // __TRAFFIC_HPP__
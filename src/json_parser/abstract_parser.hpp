@@ -0,0 +1,63 @@
+#ifndef __ABSTRACT_PARSER_HPP__
+#define __ABSTRACT_PARSER_HPP__
+
+#include <ArduinoJson.h>
+#include "commands/command.hpp"
+#include "controllers/abstract/controller.hpp"
+
+namespace json_parser
+{
+    // part of the parser that controllers (sd, config) and the queue ingress hold on to,
+    // so they work with both parser and static_parser
+    class abstract_parser
+    {
+    public:
+        virtual ~abstract_parser() = default;
+
+        // message -> command, safe to call from other tasks once every controller is added
+        virtual bool decode(const JsonObject &json, commands::command &command) const = 0;
+        // [controller index, command id, arguments...] -> command, indexes are positions in the
+        // parser and in the command tables, no strings and no allocations
+        virtual bool decode_binary(const uint8_t *data, size_t length, commands::command &command) const = 0;
+        // command -> message with the controller key
+        virtual bool encode(const commands::command &command, JsonObject &json) const = 0;
+        // array with the state of the controllers that changed after since (state_version::ALL -> every one),
+        // last element is the version to ask from the next time
+        virtual void retrive_data(json_writer &json, uint32_t since) const = 0;
+        // position of the controller, the one binary messages start with, -1 if there is none
+        virtual int16_t index_of(const char *name) const = 0;
+        // handles right away on the calling task, skips the queue -> for controllers that make commands
+        // of their own (gamepad), returns how many controllers handled it
+        virtual uint8_t dispatch(const commands::command &command) const = 0;
+        // periodic tasks of the controllers, statistics show how late they run
+        virtual const task_scheduler &tasks() const = 0;
+
+    protected:
+        static bool changed(const controller &target, uint32_t since)
+        {
+            return since == state_version::ALL || target.version() > since;
+        }
+
+        // {"name": ..., "data": ...}, the controller writes the data
+        // static_parser passes the real type -> direct call
+        template <typename C>
+        static void add(json_writer &json, C &target, uint32_t since)
+        {
+            json.begin_object();
+            json.member("name", target.get_name());
+            json.key("data");
+            target.retrive_data(json, since);
+            json.end_object();
+        }
+
+        static void add_version(json_writer &json)
+        {
+            json.begin_object();
+            json.member("name", "version");
+            json.member("data", state_version::current());
+            json.end_object();
+        }
+    };
+} // namespace json_parser
+
+#endif // __ABSTRACT_PARSER_HPP__
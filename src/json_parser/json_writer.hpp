@@ -0,0 +1,221 @@
+#ifndef __JSON_WRITER_HPP__
+#define __JSON_WRITER_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <type_traits>
+
+namespace json_parser
+{
+    // writes json text straight into a buffer, no document in between
+    // commas are put in by the writer, the caller only opens and closes objects / arrays
+    // without a buffer it only counts -> the same writes twice: measure, allocate, write
+    class json_writer
+    {
+    public:
+        static constexpr uint8_t MAX_DEPTH = 32U;
+
+        json_writer() = default;
+        // capacity includes the '\0'
+        json_writer(char *buffer, size_t capacity) : _buffer(buffer), _capacity(capacity)
+        {
+            if (_buffer && _capacity)
+                _buffer[0] = '\0';
+        }
+
+        json_writer &begin_object() { return open('{'); }
+        json_writer &end_object() { return close('}'); }
+        json_writer &begin_array() { return open('['); }
+        json_writer &end_array() { return close(']'); }
+
+        json_writer &key(const char *name)
+        {
+            separate();
+            string(name);
+            put(':');
+            _after_key = true;
+            return *this;
+        }
+
+        // nullptr -> null, like ArduinoJson
+        json_writer &value(const char *text)
+        {
+            separate();
+            if (text)
+                string(text);
+            else
+                put("null");
+            return *this;
+        }
+
+        json_writer &value(bool flag)
+        {
+            separate();
+            put(flag ? "true" : "false");
+            return *this;
+        }
+
+        json_writer &value(std::nullptr_t)
+        {
+            separate();
+            put("null");
+            return *this;
+        }
+
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value, json_writer &>::type value(T number)
+        {
+            static_assert(sizeof(T) <= sizeof(uint32_t), "only up to 32 bit numbers");
+            separate();
+            if constexpr (std::is_signed<T>::value)
+            {
+                if (number < 0)
+                {
+                    put('-');
+                    digits(0U - static_cast<uint32_t>(number));
+                    return *this;
+                }
+            }
+            digits(static_cast<uint32_t>(number));
+            return *this;
+        }
+
+        template <typename T>
+        json_writer &member(const char *name, T data)
+        {
+            key(name);
+            return value(data);
+        }
+
+        // characters written (or that would be written when counting), without the '\0'
+        size_t length() const { return _length; }
+        // buffer was too small, text is cut
+        bool overflowed() const { return _buffer && _length >= _capacity; }
+        const char *c_str() const { return _buffer; }
+        // no buffer, only counting the characters
+        bool measuring() const { return !_buffer; }
+
+    private:
+        json_writer &open(char bracket)
+        {
+            separate();
+            put(bracket);
+            if (_depth < MAX_DEPTH)
+                _first |= 1UL << _depth;
+            _depth++;
+            return *this;
+        }
+
+        json_writer &close(char bracket)
+        {
+            if (_depth)
+                _depth--;
+            put(bracket);
+            return *this;
+        }
+
+        // comma before every element of a container but the first one, nothing after a key
+        void separate()
+        {
+            if (_after_key)
+            {
+                _after_key = false;
+                return;
+            }
+            if (!_depth || _depth > MAX_DEPTH)
+                return;
+
+            uint32_t first = 1UL << (_depth - 1U);
+            if (_first & first)
+                _first &= ~first;
+            else
+                put(',');
+        }
+
+        void string(const char *text)
+        {
+            static constexpr const char *HEX_DIGITS = "0123456789abcdef";
+
+            put('"');
+            for (; *text; text++)
+            {
+                char c = *text;
+                if (c == '"' || c == '\\')
+                {
+                    put('\\');
+                    put(c);
+                }
+                else if (static_cast<uint8_t>(c) < 0x20U)
+                {
+                    put("\\u00");
+                    put(HEX_DIGITS[c >> 4]);
+                    put(HEX_DIGITS[c & 0xF]);
+                }
+                else
+                {
+                    put(c);
+                }
+            }
+            put('"');
+        }
+
+        void digits(uint32_t number)
+        {
+            char reversed[10];
+            uint8_t count = 0;
+            do
+            {
+                reversed[count++] = static_cast<char>('0' + number % 10U);
+                number /= 10U;
+            } while (number);
+
+            while (count)
+                put(reversed[--count]);
+        }
+
+        void put(const char *text)
+        {
+            for (; *text; text++)
+                put(*text);
+        }
+
+        void put(char c)
+        {
+            if (_buffer && _length + 1U < _capacity)
+            {
+                _buffer[_length] = c;
+                _buffer[_length + 1U] = '\0';
+            }
+            _length++;
+        }
+
+        char *_buffer = nullptr;
+        size_t _capacity = 0;
+        size_t _length = 0;
+        // bit i -> nothing was written yet in the container at depth i
+        uint32_t _first = 0;
+        uint8_t _depth = 0;
+        bool _after_key = false;
+    };
+
+    // runs write(json_writer &) twice: to measure and into a buffer of exactly that size
+    // -> the only allocation, nullptr when there is no memory for it, free() the result
+    template <typename F>
+    char *write_to_heap(F &&write)
+    {
+        json_writer measure;
+        write(measure);
+
+        size_t capacity = measure.length() + 1U;
+        char *buffer = static_cast<char *>(malloc(capacity));
+        if (!buffer)
+            return nullptr;
+
+        json_writer json(buffer, capacity);
+        write(json);
+        return buffer;
+    }
+} // namespace json_parser
+
+#endif // __JSON_WRITER_HPP__
@@ -1,5 +1,6 @@
 #include "parser.hpp"
 #include "debug.hpp"
+#include "profiler/profiler.hpp"
 
 #if PARSER_DEBUG
 
@@ -17,38 +18,104 @@
 
 namespace json_parser
 {
+    parser::parser(task_scheduler::clock now) : _scheduler(now)
+    {
+    }
+
     std::pair<uint8_t, uint8_t> parser::handle(const JsonObject &json) const
+    {
+        commands::command command{};
+        if (!decode(json, command))
+        {
+            const char *name = json[CONTROLLER_KEY];
+            return {_routes.find(name) != _routes.NOT_FOUND, 0};
+        }
+        return handle(command);
+    }
+
+    std::pair<uint8_t, uint8_t> parser::handle(const commands::command &command) const
     {
         uint8_t permited = 0;
         uint8_t handled = 0;
         LOG_PARSER_NL("[parser] trying to handle...")
-        for (const auto &controller : _controllers)
+        for (auto observer : _observers)
+            observer->observe(command);
+
+        if (command.controller < _controllers.size())
         {
-            auto res = controller->try_handle(json);
-            if (res == controller::handle_resoult::error)
-            {
-                permited++;
-            }
-
-            if (res == controller::handle_resoult::ok)
-            {
-                permited++;
+            permited++;
+            PROFILE_SCOPE(command.controller, HANDLE)
+            if (_controllers[command.controller]->dispatch(command) == controller::handle_resoult::ok)
                 handled++;
-            }
         }
         LOG_PARSER_F("[parser] permited: %d handled: %d\n", permited, handled)
         return {permited, handled};
     }
 
+    bool parser::decode(const JsonObject &json, commands::command &command) const
+    {
+        const char *name = json[CONTROLLER_KEY];
+        auto index = _routes.find(name);
+        if (index == _routes.NOT_FOUND)
+        {
+            LOG_PARSER_F("[parser] no controller named %s\n", name ? name : "(null)")
+            return false;
+        }
+
+        command.controller = static_cast<uint8_t>(index);
+        if (!_controllers[index]->decode(json, command))
+        {
+            LOG_PARSER_F("[parser] %s: invalid command\n", name)
+            return false;
+        }
+        return true;
+    }
+
+    bool parser::decode_binary(const uint8_t *data, size_t length, commands::command &command) const
+    {
+        if (length < 2 || data[0] >= _controllers.size())
+        {
+            LOG_PARSER_NL("[parser] invalid binary message")
+            return false;
+        }
+
+        command.controller = data[0];
+        if (!_controllers[data[0]]->decode_binary(data + 1, length - 1, command))
+        {
+            LOG_PARSER_F("[parser] %s: invalid binary command\n", _controllers[data[0]]->get_name())
+            return false;
+        }
+        return true;
+    }
+
+    bool parser::encode(const commands::command &command, JsonObject &json) const
+    {
+        if (command.controller >= _controllers.size())
+            return false;
+
+        const auto &controller = _controllers[command.controller];
+        json[CONTROLLER_KEY] = controller->get_name();
+        return controller->encode(command, json);
+    }
+
     void parser::handle_updates() const
     {
-        for (const auto &controller : _controllers)
-            controller->update();
+#if PROFILING
+        _scheduler.run(profiler::timed_task);
+#else
+        _scheduler.run();
+#endif
+    }
+
+    uint32_t parser::until_next_update() const
+    {
+        return _scheduler.until_next();
     }
 
     bool parser::add_controller(std::unique_ptr<controller> &&controller)
     {
-        if (controller)
+        if (controller && _controllers.size() < MAX_CONTROLLERS &&
+            _routes.add(controller->get_name(), static_cast<uint8_t>(_controllers.size())))
         {
             _controllers.push_back(std::move(controller));
             return true;
@@ -56,34 +123,50 @@ namespace json_parser
         return false;
     }
 
+    bool parser::add_observer(const char *name)
+    {
+        auto index = _routes.find(name);
+        if (index != _routes.NOT_FOUND)
+        {
+            _observers.push_back(_controllers[index].get());
+            return true;
+        }
+        return false;
+    }
+
     bool parser::initialize_all() const
     {
         if (!_controllers.size())
             return false;
 
         bool res = true;
-        for (auto &controller : _controllers)
+        for (uint8_t i = 0; i < _controllers.size(); i++)
         {
+            auto &controller = _controllers[i];
             LOG_PARSER_F("[parser] initializing %s\n", controller->get_name())
             bool init_res = controller->initialize();
             LOG_PARSER_F("[parser] initializing %s: %s\n", controller->get_name(), init_res ? "successful" : "error");
+            size_t first_task = _scheduler.size();
+            controller->schedule(_scheduler);
+            PROFILE_CONTROLLER(i, controller->get_name(), first_task, _scheduler.size())
 
             res &= init_res;
         }
         return res;
     }
 
-    DynamicJsonDocument parser::retrive_data() const
+    void parser::retrive_data(json_writer &json, uint32_t since) const
     {
-        uint32_t json_size = 0;
-        for (auto &controller : _controllers)
-            json_size += controller->retrive_data_size();
-
-        DynamicJsonDocument json(json_size + JSON_ARRAY_SIZE(_controllers.size()));
-
-        for (auto &controller : _controllers)
-            json.add(controller->retrive_data());
-
-        return json;
+        json.begin_array();
+        for (uint8_t i = 0; i < _controllers.size(); i++)
+        {
+            if (!changed(*_controllers[i], since))
+                continue;
+            // write_to_heap runs this twice, only the writing pass is timed
+            PROFILE_SCOPE(json.measuring() ? profiler::profiler::NOT_PROFILED : i, DATA)
+            add(json, *_controllers[i], since);
+        }
+        add_version(json);
+        json.end_array();
     }
 } // namespace json_parser
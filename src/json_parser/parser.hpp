@@ -7,20 +7,44 @@
 #include <memory>
 #include <utility>
 #include "controllers/abstract/controller.hpp"
+#include "abstract_parser.hpp"
+#include "routing_table.hpp"
 
 namespace json_parser
 {
-    class parser
+    class parser final : public abstract_parser
     {
     public:
+        explicit parser(task_scheduler::clock now = scheduler::uptime);
+
+        // decodes and handles right away, returns (permited, handled)
         std::pair<uint8_t, uint8_t> handle(const JsonObject& json) const;
+        std::pair<uint8_t, uint8_t> handle(const commands::command& command) const;
+        bool decode(const JsonObject& json, commands::command& command) const override;
+        bool decode_binary(const uint8_t* data, size_t length, commands::command& command) const override;
+        bool encode(const commands::command& command, JsonObject& json) const override;
+        // runs periodic tasks of controllers that are due
         void handle_updates() const;
+        // ms until the next task is due, task_scheduler::IDLE when there are none
+        uint32_t until_next_update() const;
+        const task_scheduler &tasks() const override { return _scheduler; }
+        int16_t index_of(const char* name) const override { return _routes.find(name); }
+        uint8_t dispatch(const commands::command& command) const override { return handle(command).second; }
         bool add_controller(std::unique_ptr<controller>&& controller);
+        // controller (already added) gets every command, whoever it is addressed to
+        bool add_observer(const char* name);
         bool initialize_all() const;
-        DynamicJsonDocument retrive_data() const;
+        void retrive_data(json_writer &json, uint32_t since) const override;
 
     private:
+        static constexpr const char* CONTROLLER_KEY = "controller";
+        static constexpr size_t MAX_CONTROLLERS = 16U;
+
         std::vector<std::unique_ptr<controller>> _controllers;
+        std::vector<controller*> _observers;
+        routing_table<MAX_CONTROLLERS * 2> _routes;
+        // api is const, running tasks changes the scheduler
+        mutable task_scheduler _scheduler;
     };
 } // namespace parser
 #endif // __PARSER_HPP__
\ No newline at end of file
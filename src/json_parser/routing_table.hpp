@@ -0,0 +1,81 @@
+#ifndef __ROUTING_TABLE_HPP__
+#define __ROUTING_TABLE_HPP__
+
+#include <stdint.h>
+#include <string.h>
+#include "hash.hpp"
+
+namespace json_parser
+{
+    // smallest capacity that fits count names
+    constexpr size_t routing_capacity(size_t count)
+    {
+        size_t capacity = 2;
+        while (capacity * 3 / 4 < count)
+            capacity <<= 1;
+        return capacity;
+    }
+
+    // open addressing hash table: controller name -> controller index
+    // lookup costs one hash + (almost always) one strcmp no matter how many names are stored
+    template <size_t CAPACITY>
+    class routing_table
+    {
+        static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "capacity has to be a power of two");
+
+    public:
+        static constexpr int16_t NOT_FOUND = -1;
+
+        // false when name is already taken or table is too full
+        bool add(const char *name, uint8_t value)
+        {
+            if (!name || _size >= MAX_LOAD || find(name) != NOT_FOUND)
+                return false;
+
+            uint32_t name_hash = hash::fnv1a(name);
+            for (uint32_t i = name_hash & MASK;; i = (i + 1) & MASK)
+            {
+                if (!_entries[i].name)
+                {
+                    _entries[i] = {name, name_hash, value};
+                    _size++;
+                    return true;
+                }
+            }
+        }
+
+        int16_t find(const char *name) const
+        {
+            if (!name)
+                return NOT_FOUND;
+
+            uint32_t name_hash = hash::fnv1a(name);
+            for (uint32_t i = name_hash & MASK; _entries[i].name; i = (i + 1) & MASK)
+            {
+                const entry &current = _entries[i];
+                if (current.hash == name_hash && !strcmp(current.name, name))
+                    return current.value;
+            }
+            return NOT_FOUND;
+        }
+
+        size_t size() const { return _size; }
+
+    private:
+        // keeps at least one empty entry so lookups always terminate
+        static constexpr size_t MAX_LOAD = CAPACITY * 3 / 4;
+        static constexpr uint32_t MASK = CAPACITY - 1;
+
+        struct entry
+        {
+            const char *name;
+            uint32_t hash;
+            uint8_t value;
+        };
+
+        entry _entries[CAPACITY] = {};
+        size_t _size = 0;
+    };
+} // namespace json_parser
+
+#endif // __ROUTING_TABLE_HPP__
@@ -0,0 +1,228 @@
+#ifndef __STATIC_PARSER_HPP__
+#define __STATIC_PARSER_HPP__
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "controllers/abstract/controller.hpp"
+#include "abstract_parser.hpp"
+#include "routing_table.hpp"
+#include "profiler/profiler.hpp"
+
+namespace json_parser
+{
+    // same api as parser, but the controllers are fixed at compile time and live
+    // inside the parser (static storage when the parser is global, nothing on the heap)
+    // controllers are final -> every call on them is a direct one that can be inlined,
+    // loops over them are unrolled with fold expressions
+    // controllers constructible from const abstract_parser& get this parser
+    // (the class declaring handle has to befriend static_parser, templated_controller does)
+    template <typename... Controllers>
+    class static_parser final : public abstract_parser
+    {
+        static_assert(sizeof...(Controllers) > 0, "parser needs at least one controller");
+        static_assert(sizeof...(Controllers) <= 32, "observers are kept in a 32 bit mask");
+        static_assert((std::is_base_of<controller, Controllers>::value && ...), "only controllers can be added");
+        static_assert((std::is_final<Controllers>::value && ...), "calls are direct only on final controllers");
+
+    public:
+        explicit static_parser(task_scheduler::clock now = scheduler::uptime) : _controllers(make<Controllers>(*this)...),
+                                                                               _scheduler(now)
+        {
+            add_routes(indexes{});
+        }
+
+        // decodes and handles right away, returns (permited, handled)
+        std::pair<uint8_t, uint8_t> handle(const JsonObject &json) const
+        {
+            commands::command command{};
+            if (!decode(json, command))
+            {
+                const char *name = json[CONTROLLER_KEY];
+                return {_routes.find(name) != _routes.NOT_FOUND, 0};
+            }
+            return handle(command);
+        }
+
+        std::pair<uint8_t, uint8_t> handle(const commands::command &command) const
+        {
+            if (_observers)
+                observe(command, indexes{});
+            if (command.controller >= COUNT)
+                return {0, 0};
+
+            // qualified -> handle of that exact controller, not a virtual call
+            return {1, visit(command.controller, [&command](auto &target) {
+                        typedef std::remove_reference_t<decltype(target)> type;
+                        PROFILE_SCOPE(command.controller, HANDLE)
+                        return target.type::handle(command);
+                    })};
+        }
+
+        bool decode(const JsonObject &json, commands::command &command) const override
+        {
+            const char *name = json[CONTROLLER_KEY];
+            auto index = _routes.find(name);
+            if (index == _routes.NOT_FOUND)
+                return false;
+
+            command.controller = static_cast<uint8_t>(index);
+            return visit(command.controller, [&json, &command](auto &target) {
+                return target.decode(json, command);
+            });
+        }
+
+        bool decode_binary(const uint8_t *data, size_t length, commands::command &command) const override
+        {
+            if (length < 2 || data[0] >= COUNT)
+                return false;
+
+            command.controller = data[0];
+            return visit(command.controller, [data, length, &command](auto &target) {
+                typedef std::remove_reference_t<decltype(target)> type;
+                return target.type::decode_binary(data + 1, length - 1, command);
+            });
+        }
+
+        bool encode(const commands::command &command, JsonObject &json) const override
+        {
+            return visit(command.controller, [&command, &json](auto &target) {
+                json[CONTROLLER_KEY] = target.get_name();
+                return target.encode(command, json);
+            });
+        }
+
+        // runs periodic tasks of controllers that are due
+        void handle_updates() const
+        {
+#if PROFILING
+            _scheduler.run(profiler::timed_task);
+#else
+            _scheduler.run();
+#endif
+        }
+
+        // ms until the next task is due, task_scheduler::IDLE when there are none
+        uint32_t until_next_update() const
+        {
+            return _scheduler.until_next();
+        }
+
+        const task_scheduler &tasks() const override { return _scheduler; }
+        int16_t index_of(const char *name) const override { return _routes.find(name); }
+        uint8_t dispatch(const commands::command &command) const override { return handle(command).second; }
+
+        // controller gets every command, whoever it is addressed to
+        bool add_observer(const char *name)
+        {
+            auto index = _routes.find(name);
+            if (index == _routes.NOT_FOUND)
+                return false;
+
+            _observers |= 1UL << index;
+            return true;
+        }
+
+        bool initialize_all() const
+        {
+            return initialize(indexes{});
+        }
+
+        void retrive_data(json_writer &json, uint32_t since) const override
+        {
+            json.begin_array();
+            retrive_data(json, since, indexes{});
+            add_version(json);
+            json.end_array();
+        }
+
+    private:
+        typedef std::index_sequence_for<Controllers...> indexes;
+
+        static constexpr const char *CONTROLLER_KEY = "controller";
+        static constexpr size_t COUNT = sizeof...(Controllers);
+
+        template <typename C>
+        static C make(const abstract_parser &parser)
+        {
+            if constexpr (std::is_constructible<C, const abstract_parser &>::value)
+                return C(parser);
+            else
+                return C();
+        }
+
+        template <size_t... I>
+        void add_routes(std::index_sequence<I...>)
+        {
+            (_routes.add(std::get<I>(_controllers).get_name(), I), ...);
+        }
+
+        // calls fun with the controller at index, false when there is no such controller
+        // fun is instantiated for every controller type -> calls inside it are direct
+        template <typename F>
+        bool visit(uint8_t index, F &&fun) const
+        {
+            return visit(index, fun, indexes{});
+        }
+
+        template <typename F, size_t... I>
+        bool visit(uint8_t index, F &fun, std::index_sequence<I...>) const
+        {
+            bool res = false;
+            ((index == I && (res = fun(std::get<I>(_controllers)), true)) || ...);
+            return res;
+        }
+
+        template <size_t... I>
+        void observe(const commands::command &command, std::index_sequence<I...>) const
+        {
+            ((_observers & (1UL << I) ? std::get<I>(_controllers).observe(command) : void()), ...);
+        }
+
+        template <size_t... I>
+        bool initialize(std::index_sequence<I...>) const
+        {
+            bool res = true;
+            ((res &= initialize<I>()), ...);
+            return res;
+        }
+
+        template <size_t I>
+        bool initialize() const
+        {
+            auto &target = std::get<I>(_controllers);
+            bool res = target.initialize();
+            size_t first_task = _scheduler.size();
+            target.schedule(_scheduler);
+            PROFILE_CONTROLLER(I, target.get_name(), first_task, _scheduler.size())
+            return res;
+        }
+
+        template <size_t... I>
+        void retrive_data(json_writer &json, uint32_t since, std::index_sequence<I...>) const
+        {
+            (retrive_data<I>(json, since), ...);
+        }
+
+        template <size_t I>
+        void retrive_data(json_writer &json, uint32_t since) const
+        {
+            auto &target = std::get<I>(_controllers);
+            if (!changed(target, since))
+                return;
+            // write_to_heap runs this twice, only the writing pass is timed
+            PROFILE_SCOPE(json.measuring() ? profiler::profiler::NOT_PROFILED : I, DATA)
+            add(json, target, since);
+        }
+
+        // api of the parser is const, handling still changes the controllers
+        mutable std::tuple<Controllers...> _controllers;
+        uint32_t _observers = 0;
+        routing_table<routing_capacity(COUNT)> _routes;
+        mutable task_scheduler _scheduler;
+    };
+} // namespace json_parser
+
+#endif // __STATIC_PARSER_HPP__
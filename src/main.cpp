@@ -12,73 +12,232 @@
 #include "controllers/mp3_controller.hpp"
 #include "controllers/sd_controller.hpp"
 #include "controllers/config_controller.hpp"
+#include "controllers/gamepad_controller.hpp"
 #include "json_parser/parser.hpp"
+#include "json_parser/static_parser.hpp"
 #include "global_queue.hpp"
+#include "udp_control/udp_control.hpp"
 
+// controllers fixed at compile time -> no heap, no virtual calls when dispatching and updating
+#ifndef STATIC_PARSER
+#define STATIC_PARSER 0
+#endif
+
+#if STATIC_PARSER
+json_parser::static_parser<json_parser::engines_controller,
+                           json_parser::arm_controller,
+                           json_parser::leds_controller,
+                           json_parser::mp3_controller,
+                           json_parser::sd_controller,
+                           json_parser::config_controller,
+                           json_parser::gamepad_controller>
+    parser;
+#else
 json_parser::parser parser;
+#endif
 
-void setup()
+// loop() blocks until a command is pushed or the next controller task is due instead of spinning
+#ifndef EVENT_LOOP
+#define EVENT_LOOP 0
+#endif
+
+// longest single wait, dns (and serial in debug) are still polled from loop()
+#ifndef EVENT_LOOP_MAX_SLEEP_MS
+#define EVENT_LOOP_MAX_SLEEP_MS 10
+#endif
+
+// network (dns, outgoing messages, serial console) and control (queue, controller tasks)
+// run in their own tasks pinned to different cores, loop() is not used
+// control task always blocks between passes like with EVENT_LOOP
+#ifndef DUAL_CORE
+#define DUAL_CORE 0
+#endif
+
+// wifi and async_tcp live on core 0 (CONFIG_ASYNC_TCP_RUNNING_CORE in platformio.ini)
+#ifndef NETWORK_TASK_CORE
+#define NETWORK_TASK_CORE 0
+#endif
+#ifndef NETWORK_TASK_PRIORITY
+#define NETWORK_TASK_PRIORITY 1
+#endif
+#ifndef NETWORK_TASK_STACK
+#define NETWORK_TASK_STACK 4096
+#endif
+// dns is polled at least this often
+#ifndef NETWORK_POLL_MS
+#define NETWORK_POLL_MS 10
+#endif
+
+#ifndef CONTROL_TASK_CORE
+#define CONTROL_TASK_CORE 1
+#endif
+// above loopTask (1), nothing else on this core should delay a servo step
+#ifndef CONTROL_TASK_PRIORITY
+#define CONTROL_TASK_PRIORITY 5
+#endif
+#ifndef CONTROL_TASK_STACK
+#define CONTROL_TASK_STACK 8192
+#endif
+// nothing but the queue wakes the control task, this only bounds a single wait
+#ifndef CONTROL_MAX_SLEEP_MS
+#define CONTROL_MAX_SLEEP_MS 1000
+#endif
+
+// dns, outgoing messages and the serial console
+void network_pass()
 {
-    INIT_LOG
+    webserver::process_web();
+#if UDP_CONTROL
+    udp_control::control_port::watch(millis());
+#endif
+
+#ifdef SMART_TANK_DEBUG
+    if (Serial.available())
+    {
+        global_queue::document json;
+        if (deserializeJson(json, Serial))
+        {
+            // drop the rest of the line so it doesn't get stuck in the buffer
+            while (Serial.available())
+                Serial.read();
+        }
+        else
+        {
+            LOG_JSON_PRETTY(json);
+            if (json.is<JsonArray>())
+                global_queue::push(json.as<JsonArray>(), commands::origin::CONSOLE);
+            else
+                global_queue::push(json.as<JsonObject>(), commands::origin::CONSOLE);
+        }
+    }
+#endif // SMART_TANK_DEBUG
+}
+
+// batches go after the queue (a stop sent on its own is still first), every one of them whole
+// and in order -> a preset changes everything in the same tick, one ack per batch
+// (none for udp setpoints, nobody on the websocket waits for them)
+void apply_batches()
+{
+    global_queue::batches.apply([](const commands::command &command) { return parser.handle(command).second; },
+                                [](uint8_t count, uint8_t handled) {
+                                    StaticJsonDocument<JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(2)> ack;
+                                    ack["name"] = "batch";
+                                    JsonObject data = ack.createNestedObject("data");
+                                    data["commands"] = count;
+                                    data["handled"] = handled;
+                                    webserver::send_ws(ack);
+                                });
+}
+
+// queued commands and controller tasks, then blocks until the next one (at most max_sleep_ms)
+void control_pass(uint32_t max_sleep_ms)
+{
+    global_queue::drain.run([](const commands::command &command) { parser.handle(command); });
+    apply_batches();
+    parser.handle_updates();
+
+    uint32_t timeout = parser.until_next_update();
+    if (timeout > max_sleep_ms)
+        timeout = max_sleep_ms;
+    // commands left over after the drain budget ran out -> next pass right away
+    if (global_queue::queue.pending())
+        timeout = 0;
+    global_queue::wait(timeout);
+}
 
-    LOG_NL("[main] initing global queue...")
-    if(!global_queue::queue.initialize())
+#if DUAL_CORE
+void network_task(void *)
+{
+    for (;;)
     {
-        LOG_NL("[main] could not create queue")
-        return;
+        network_pass();
+        // woken up early by send_ws
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NETWORK_POLL_MS));
     }
+}
+
+void control_task(void *)
+{
+    for (;;)
+        control_pass(CONTROL_MAX_SLEEP_MS);
+}
+
+void start_tasks()
+{
+    TaskHandle_t network = nullptr;
+    bool started = xTaskCreatePinnedToCore(network_task, "network", NETWORK_TASK_STACK, nullptr,
+                                           NETWORK_TASK_PRIORITY, &network, NETWORK_TASK_CORE) == pdPASS;
+    webserver::set_network_task(network);
+    started &= xTaskCreatePinnedToCore(control_task, "control", CONTROL_TASK_STACK, nullptr,
+                                       CONTROL_TASK_PRIORITY, nullptr, CONTROL_TASK_CORE) == pdPASS;
+    LOG_F("[main] starting tasks: %s\n", started ? "success" : "failed")
+}
+#endif // DUAL_CORE
+
+void setup()
+{
+    INIT_LOG
+
+    global_queue::queue.set_coalescing(QUEUE_COALESCING);
+    global_queue::attach(parser);
 
     LOG_NL("[main] adding controllers...")
     bool if_ok = true;
+#if !STATIC_PARSER
     if_ok &= parser.add_controller(std::unique_ptr<json_parser::controller>(new json_parser::engines_controller()));
     if_ok &= parser.add_controller(std::unique_ptr<json_parser::controller>(new json_parser::arm_controller()));
     if_ok &= parser.add_controller(std::unique_ptr<json_parser::controller>(new json_parser::leds_controller()));
     if_ok &= parser.add_controller(std::unique_ptr<json_parser::controller>(new json_parser::mp3_controller()));
-    if_ok &= parser.add_controller(std::unique_ptr<json_parser::controller>(new json_parser::sd_controller()));
+    if_ok &= parser.add_controller(std::unique_ptr<json_parser::controller>(new json_parser::sd_controller(parser)));
     if_ok &= parser.add_controller(std::unique_ptr<json_parser::controller>(new json_parser::config_controller(parser)));
+    if_ok &= parser.add_controller(std::unique_ptr<json_parser::controller>(new json_parser::gamepad_controller(parser)));
+#endif
+    if_ok &= parser.add_observer("sd");
     LOG_F("[main] adding controllers: %s\n", if_ok ? "success" : "failed")
 
     if_ok = parser.initialize_all();
     LOG_NL("[main] creating WiFi...")
     webserver::init_entire_web();
+#if UDP_CONTROL
+    if (!udp_control::control_port::begin(parser))
+        LOG_NL("[main] udp control port couldn't be opened")
+#endif
 
-    DynamicJsonDocument* mp3_json = new DynamicJsonDocument(256);
-    (*mp3_json)["controller"] = "mp3";
+    StaticJsonDocument<JSON_OBJECT_SIZE(2)> mp3_json;
+    mp3_json["controller"] = "mp3";
     if(if_ok)
-        (*mp3_json)["command"] = "windows_xp";
+        mp3_json["command"] = "windows_xp";
     else
-        (*mp3_json)["command"] = "error";
-    
-    if(!global_queue::queue.push(&mp3_json))
-        delete mp3_json;
+        mp3_json["command"] = "error";
+    global_queue::push(mp3_json.as<JsonObject>(), commands::origin::INTERNAL);
 
     LOG_F("[main] memory usage before: %d\n", esp_get_free_heap_size())
-    auto device_state = parser.retrive_data();
+    char *device_state = json_parser::write_to_heap([](json_parser::json_writer &json) {
+        parser.retrive_data(json, json_parser::state_version::ALL);
+    });
     LOG_F("[main] memory usage after: %d\n", esp_get_free_heap_size())
-    LOG_JSON_PRETTY(device_state);
+    LOG_NL(device_state)
+    free(device_state);
+
+#if DUAL_CORE
+    start_tasks();
+#else
+    // outgoing messages end the wait in loop()
+    webserver::set_network_task(xTaskGetCurrentTaskHandle());
+#endif
     LOG_NL("[main] end of setup");
 }
 
 void loop()
 {
-    webserver::process_web();
-    DynamicJsonDocument* json = nullptr;
-    if(global_queue::queue.read(&json))
-    {
-        parser.handle(json->as<JsonObject>());
-        delete json;
-    }
-    parser.handle_updates();
-
-#ifdef SMART_TANK_DEBUG
-    if (Serial.available())
-    {
-        json = new DynamicJsonDocument(256);
-        deserializeJson(*json, Serial);
-        LOG_JSON_PRETTY(*json);
-        global_queue::queue.push(&json);
-    }
-#endif // SMART_TANK_DEBUG
+#if DUAL_CORE
+    // everything runs in network_task and control_task
+    vTaskDelete(nullptr);
+#else
+    network_pass();
+    // without EVENT_LOOP the wait only picks up notifications and returns
+    control_pass(EVENT_LOOP ? EVENT_LOOP_MAX_SLEEP_MS : 0);
+#endif
 }
 
 #endif // UNIT_TEST
\ No newline at end of file
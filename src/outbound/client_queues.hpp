@@ -0,0 +1,365 @@
+#ifndef __CLIENT_QUEUES_HPP__
+#define __CLIENT_QUEUES_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+namespace outbound
+{
+    enum class kind : uint8_t
+    {
+        // replies, acks, errors -> every one has to get there
+        EVENT,
+        // state frame with what changed since the previous one, for the clients that got all of them
+        STATE,
+        // whole state, only for the clients that missed a state frame
+        RESYNC,
+    };
+
+    // outgoing messages of every client, so a slow one (weak signal) doesn't pile them up in the socket library
+    //      post() -> text is shared by the queues of all clients, freed once the last one sent it
+    //      flush() -> hands them to the clients that can take them right now
+    // a client keeps at most one state frame waiting, one that comes while it waits isn't queued
+    // -> the client missed changes and takes the next RESYNC frame (in the same place) instead
+    // of the changes, the others keep getting only the changes
+    // events over DEPTH messages or BUDGET bytes are dropped
+    // everything but stats() only from the network task
+    template <uint8_t CLIENTS, uint8_t DEPTH, size_t BUDGET>
+    class client_queues
+    {
+    public:
+        struct statistics
+        {
+            uint32_t client;
+            // waiting right now
+            uint8_t depth;
+            uint32_t bytes;
+            uint32_t sent;
+            uint32_t dropped;
+            // state frames it didn't get because the previous one still waited
+            uint32_t replaced;
+            // from post() until the client got it
+            uint32_t last_latency_us;
+            uint32_t average_latency_us;
+            uint32_t max_latency_us;
+        };
+
+        client_queues() = default;
+        client_queues(const client_queues &) = delete;
+        client_queues &operator=(const client_queues &) = delete;
+
+        ~client_queues()
+        {
+            for (auto &target : _queues)
+                clear(target);
+        }
+
+        // clients that are connected now -> queues of the ones that left are emptied
+        void sync(const uint32_t *clients, uint8_t count)
+        {
+            for (auto &target : _queues)
+            {
+                if (!target.used.load(std::memory_order_relaxed))
+                    continue;
+                bool connected = false;
+                for (uint8_t i = 0; i < count && !connected; i++)
+                    connected = clients[i] == target.client.load(std::memory_order_relaxed);
+                if (!connected)
+                {
+                    clear(target);
+                    target.used.store(false, std::memory_order_release);
+                }
+            }
+
+            for (uint8_t i = 0; i < count; i++)
+                if (!find(clients[i]))
+                    acquire(clients[i]);
+        }
+
+        // takes the text over (malloc), false when no client took it -> it is freed already
+        bool post(char *text, kind type, uint32_t now_us)
+        {
+            if (!text)
+                return false;
+
+            int16_t index = allocate();
+            if (index < 0)
+            {
+                for (auto &target : _queues)
+                    if (target.used.load(std::memory_order_relaxed) && wants(target, type))
+                        drop(target, type);
+                free(text);
+                return false;
+            }
+
+            message &posted = _messages[index];
+            posted = {text, strlen(text), now_us, 0, type, true};
+            for (auto &target : _queues)
+                if (target.used.load(std::memory_order_relaxed))
+                    enqueue(target, static_cast<uint8_t>(index));
+
+            if (!posted.references)
+                release(static_cast<uint8_t>(index));
+            return _messages[index].used;
+        }
+
+        // ready(client, length) -> client can take a message of that length right now
+        // send(client, text, length) -> hands it over, oldest first
+        template <typename R, typename S>
+        void flush(R &&ready, S &&send, uint32_t now_us)
+        {
+            for (auto &target : _queues)
+            {
+                if (!target.used.load(std::memory_order_relaxed))
+                    continue;
+                uint32_t client = target.client.load(std::memory_order_relaxed);
+                while (target.count)
+                {
+                    message &next = _messages[target.items[target.head]];
+                    if (!ready(client, next.length))
+                        break;
+                    send(client, next.text, next.length);
+                    measure(target, now_us - next.posted_us);
+                    target.sent.fetch_add(1, std::memory_order_relaxed);
+                    pop(target);
+                }
+            }
+        }
+
+        // true once after a client didn't get a state frame -> a RESYNC frame should be posted
+        bool take_missed_state() { return _missed.exchange(false); }
+        // state frames that some client didn't get
+        uint32_t missed_states() const { return _missed_states.load(std::memory_order_relaxed); }
+        // clients waiting for a RESYNC frame
+        uint8_t resyncing() const
+        {
+            uint8_t count = 0;
+            for (const auto &target : _queues)
+                count += target.used.load(std::memory_order_acquire) && target.resync.load(std::memory_order_relaxed);
+            return count;
+        }
+
+        // counters of the connected clients, returns how many were written
+        uint8_t stats(statistics (&out)[CLIENTS]) const
+        {
+            uint8_t count = 0;
+            for (const auto &target : _queues)
+            {
+                if (!target.used.load(std::memory_order_acquire))
+                    continue;
+                out[count++] = {target.client.load(std::memory_order_relaxed),
+                                target.depth.load(std::memory_order_relaxed),
+                                target.bytes.load(std::memory_order_relaxed),
+                                target.sent.load(std::memory_order_relaxed),
+                                target.dropped.load(std::memory_order_relaxed),
+                                target.replaced.load(std::memory_order_relaxed),
+                                target.last_latency_us.load(std::memory_order_relaxed),
+                                target.average_latency_us.load(std::memory_order_relaxed),
+                                target.max_latency_us.load(std::memory_order_relaxed)};
+            }
+            return count;
+        }
+
+    private:
+        // every one of them is in at least one queue -> one more than all queues can hold
+        static constexpr size_t MESSAGES = CLIENTS * DEPTH + 1U;
+        static_assert(MESSAGES <= UINT8_MAX, "message indexes are stored on a single byte");
+
+        struct message
+        {
+            char *text;
+            size_t length;
+            uint32_t posted_us;
+            // queues it is in
+            uint8_t references;
+            kind type;
+            bool used;
+        };
+
+        // ring of message indexes, counters are atomic for stats()
+        struct queue
+        {
+            uint8_t items[DEPTH];
+            uint8_t head;
+            uint8_t count;
+            std::atomic<uint32_t> client{0};
+            std::atomic<bool> used{false};
+            // missed a state frame, takes nothing but RESYNC until it gets one
+            std::atomic<bool> resync{false};
+            std::atomic<uint8_t> depth{0};
+            std::atomic<uint32_t> bytes{0};
+            std::atomic<uint32_t> sent{0};
+            std::atomic<uint32_t> dropped{0};
+            std::atomic<uint32_t> replaced{0};
+            std::atomic<uint32_t> last_latency_us{0};
+            std::atomic<uint32_t> average_latency_us{0};
+            std::atomic<uint32_t> max_latency_us{0};
+        };
+
+        queue *find(uint32_t client)
+        {
+            for (auto &target : _queues)
+                if (target.used.load(std::memory_order_relaxed) && target.client.load(std::memory_order_relaxed) == client)
+                    return &target;
+            return nullptr;
+        }
+
+        void acquire(uint32_t client)
+        {
+            for (auto &target : _queues)
+            {
+                if (target.used.load(std::memory_order_relaxed))
+                    continue;
+                target.head = 0;
+                target.count = 0;
+                target.client.store(client, std::memory_order_relaxed);
+                target.resync.store(false, std::memory_order_relaxed);
+                target.depth.store(0, std::memory_order_relaxed);
+                target.bytes.store(0, std::memory_order_relaxed);
+                target.sent.store(0, std::memory_order_relaxed);
+                target.dropped.store(0, std::memory_order_relaxed);
+                target.replaced.store(0, std::memory_order_relaxed);
+                target.last_latency_us.store(0, std::memory_order_relaxed);
+                target.average_latency_us.store(0, std::memory_order_relaxed);
+                target.max_latency_us.store(0, std::memory_order_relaxed);
+                target.used.store(true, std::memory_order_release);
+                return;
+            }
+        }
+
+        int16_t allocate() const
+        {
+            for (size_t i = 0; i < MESSAGES; i++)
+                if (!_messages[i].used)
+                    return static_cast<int16_t>(i);
+            return -1;
+        }
+
+        void enqueue(queue &target, uint8_t index)
+        {
+            message &posted = _messages[index];
+            if (!wants(target, posted.type))
+            {
+                // still waiting for the whole state -> asked for again until a RESYNC frame gets queued
+                if (posted.type == kind::STATE)
+                    _missed.store(true, std::memory_order_relaxed);
+                return;
+            }
+
+            uint32_t bytes = target.bytes.load(std::memory_order_relaxed);
+
+            if (posted.type != kind::EVENT)
+            {
+                bool resync = posted.type == kind::RESYNC;
+
+                for (uint8_t i = 0; i < target.count; i++)
+                {
+                    uint8_t &item = target.items[(target.head + i) % DEPTH];
+                    if (_messages[item].type == kind::EVENT)
+                        continue;
+                    if (!resync)
+                    {
+                        // previous one still waits -> this one is missed, the whole state goes in its place later
+                        target.replaced.fetch_add(1, std::memory_order_relaxed);
+                        miss(target);
+                        return;
+                    }
+                    // in the same place, the client gets the whole state as soon as it would have got the old one
+                    bytes = bytes - _messages[item].length + posted.length;
+                    unreference(item);
+                    item = index;
+                    posted.references++;
+                    target.bytes.store(bytes, std::memory_order_relaxed);
+                    target.resync.store(false, std::memory_order_relaxed);
+                    return;
+                }
+            }
+
+            // a single message bigger than the budget still goes when nothing waits
+            if (target.count >= DEPTH || (target.count && bytes + posted.length > BUDGET))
+            {
+                drop(target, posted.type);
+                return;
+            }
+
+            target.items[(target.head + target.count) % DEPTH] = index;
+            target.count++;
+            posted.references++;
+            target.depth.store(target.count, std::memory_order_relaxed);
+            target.bytes.store(bytes + posted.length, std::memory_order_relaxed);
+            if (posted.type == kind::RESYNC)
+                target.resync.store(false, std::memory_order_relaxed);
+        }
+
+        // changes aren't enough for a client that missed some, the whole state isn't needed by the rest
+        static bool wants(const queue &target, kind type)
+        {
+            return type == kind::EVENT || target.resync.load(std::memory_order_relaxed) == (type == kind::RESYNC);
+        }
+
+        void pop(queue &target)
+        {
+            uint8_t index = target.items[target.head];
+            target.head = (target.head + 1U) % DEPTH;
+            target.count--;
+            target.depth.store(target.count, std::memory_order_relaxed);
+            target.bytes.fetch_sub(_messages[index].length, std::memory_order_relaxed);
+            unreference(index);
+        }
+
+        void clear(queue &target)
+        {
+            while (target.count)
+                pop(target);
+        }
+
+        void drop(queue &target, kind type)
+        {
+            target.dropped.fetch_add(1, std::memory_order_relaxed);
+            if (type != kind::EVENT)
+                miss(target);
+        }
+
+        void miss(queue &target)
+        {
+            target.resync.store(true, std::memory_order_relaxed);
+            _missed_states.fetch_add(1, std::memory_order_relaxed);
+            _missed.store(true, std::memory_order_relaxed);
+        }
+
+        void measure(queue &target, uint32_t latency_us)
+        {
+            target.last_latency_us.store(latency_us, std::memory_order_relaxed);
+            if (latency_us > target.max_latency_us.load(std::memory_order_relaxed))
+                target.max_latency_us.store(latency_us, std::memory_order_relaxed);
+            // moving average over ~8 messages
+            uint32_t average = target.average_latency_us.load(std::memory_order_relaxed);
+            int32_t difference = static_cast<int32_t>(latency_us - average) / 8;
+            target.average_latency_us.store(target.sent.load(std::memory_order_relaxed) ? average + difference : latency_us,
+                                            std::memory_order_relaxed);
+        }
+
+        void unreference(uint8_t index)
+        {
+            if (!--_messages[index].references)
+                release(index);
+        }
+
+        void release(uint8_t index)
+        {
+            free(_messages[index].text);
+            _messages[index].text = nullptr;
+            _messages[index].used = false;
+        }
+
+        queue _queues[CLIENTS];
+        message _messages[MESSAGES] = {};
+        std::atomic<bool> _missed{false};
+        std::atomic<uint32_t> _missed_states{0};
+    };
+} // namespace outbound
+
+#endif // __CLIENT_QUEUES_HPP__
@@ -0,0 +1,11 @@
+#include <Arduino.h>
+#include "profiler.hpp"
+
+#if PROFILING
+
+namespace profiler
+{
+    profiler instance([]() -> uint32_t { return ESP.getCycleCount(); }, F_CPU / 1000000U, PROFILE_BUDGET_US);
+} // namespace profiler
+
+#endif // PROFILING
@@ -0,0 +1,267 @@
+#ifndef __PROFILER_HPP__
+#define __PROFILER_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// times every handle, controller task and retrive_data call of the parser,
+// retrive_data only when it writes (the measuring pass of write_to_heap costs about the same),
+// compiled out (no code, no memory) when 0
+#ifndef PROFILING
+#define PROFILING 0
+#endif
+
+// calls longer than this are counted as overruns, can be changed with config/profile
+#ifndef PROFILE_BUDGET_US
+#define PROFILE_BUDGET_US 1000
+#endif
+
+namespace profiler
+{
+    enum class kind : uint8_t
+    {
+        HANDLE = 0,
+        TASK,
+        DATA,
+    };
+
+    static constexpr uint8_t KINDS = 3U;
+
+    // durations in microseconds, log-linear buckets (2 per power of two) in fixed memory
+    // min / max / avg are exact, percentiles are the upper bound of a bucket
+    class histogram
+    {
+    public:
+        static constexpr uint8_t SUB_BITS = 1U;
+        static constexpr uint8_t SUB_BUCKETS = 1U << SUB_BITS;
+        // anything above ~1 s lands in the last bucket
+        static constexpr uint8_t OCTAVES = 20U;
+        static constexpr uint8_t BUCKETS = SUB_BUCKETS + (OCTAVES - SUB_BITS) * SUB_BUCKETS + 1U;
+
+        void record(uint32_t value, uint32_t budget)
+        {
+            if (!_count || value < _min)
+                _min = value;
+            if (value > _max)
+                _max = value;
+            _count++;
+            _total += value;
+            if (value > budget)
+                _over_budget++;
+
+            uint16_t &bucket = _buckets[index(value)];
+            // keeps the shape, newer calls weigh more from now on
+            if (bucket == UINT16_MAX)
+            {
+                for (auto &other : _buckets)
+                    other /= 2;
+            }
+            bucket++;
+        }
+
+        // smallest value that percent% of calls didn't exceed
+        uint32_t percentile(uint8_t percent) const
+        {
+            uint32_t total = 0;
+            for (auto bucket : _buckets)
+                total += bucket;
+            if (!total)
+                return 0;
+
+            uint32_t needed = (total * percent + 99U) / 100U;
+            uint32_t seen = 0;
+            for (uint8_t i = 0; i < BUCKETS; i++)
+            {
+                seen += _buckets[i];
+                if (seen >= needed)
+                    return upper_bound(i) < _max ? upper_bound(i) : _max;
+            }
+            return _max;
+        }
+
+        uint32_t count() const { return _count; }
+        uint32_t min() const { return _min; }
+        uint32_t max() const { return _max; }
+        uint32_t average() const { return _count ? static_cast<uint32_t>(_total / _count) : 0U; }
+        uint32_t over_budget() const { return _over_budget; }
+
+        static uint8_t index(uint32_t value)
+        {
+            if (value < SUB_BUCKETS)
+                return static_cast<uint8_t>(value);
+
+            uint8_t msb = 31U - static_cast<uint8_t>(__builtin_clz(value));
+            uint8_t shift = msb - SUB_BITS;
+            uint32_t position = SUB_BUCKETS + (shift * SUB_BUCKETS) + ((value >> shift) & (SUB_BUCKETS - 1U));
+            return position < BUCKETS ? static_cast<uint8_t>(position) : BUCKETS - 1U;
+        }
+
+        // biggest value that falls into bucket i
+        static uint32_t upper_bound(uint8_t i)
+        {
+            if (i < SUB_BUCKETS)
+                return i;
+            if (i == BUCKETS - 1U)
+                return UINT32_MAX;
+
+            uint8_t shift = (i - SUB_BUCKETS) / SUB_BUCKETS;
+            uint32_t sub = (i - SUB_BUCKETS) % SUB_BUCKETS;
+            return ((SUB_BUCKETS + sub + 1U) << shift) - 1U;
+        }
+
+    private:
+        uint16_t _buckets[BUCKETS] = {};
+        uint32_t _count = 0;
+        uint32_t _min = 0;
+        uint32_t _max = 0;
+        uint64_t _total = 0;
+        uint32_t _over_budget = 0;
+    };
+
+    struct controller_profile
+    {
+        const char *name;
+        histogram calls[KINDS];
+    };
+
+    struct overrun
+    {
+        uint8_t controller;
+        kind type;
+        uint32_t time_us;
+    };
+
+    class profiler
+    {
+    public:
+        // cycle counter, wrapping around is fine
+        typedef uint32_t (*clock)();
+
+        static constexpr uint8_t MAX_CONTROLLERS = 8U;
+        static constexpr uint8_t MAX_TASKS = 32U;
+        static constexpr uint8_t NOT_PROFILED = UINT8_MAX;
+
+        profiler(clock now, uint32_t cycles_per_us, uint32_t budget_us) : _now(now),
+                                                                          _cycles_per_us(cycles_per_us ? cycles_per_us : 1U),
+                                                                          _budget_us(budget_us)
+        {
+            for (auto &owner : _task_owners)
+                owner = NOT_PROFILED;
+        }
+
+        // controller at index owns tasks with ids first_task ... last_task - 1
+        void add(uint8_t index, const char *name, size_t first_task, size_t last_task)
+        {
+            if (index >= MAX_CONTROLLERS)
+                return;
+
+            _controllers[index].name = name;
+            if (index >= _count)
+                _count = index + 1U;
+            for (size_t id = first_task; id < last_task && id < MAX_TASKS; id++)
+                _task_owners[id] = index;
+        }
+
+        uint32_t start() const { return _now(); }
+
+        void stop(uint8_t index, kind type, uint32_t start)
+        {
+            if (index >= MAX_CONTROLLERS)
+                return;
+
+            uint32_t time_us = (_now() - start) / _cycles_per_us;
+            _controllers[index].calls[static_cast<uint8_t>(type)].record(time_us, _budget_us);
+            if (time_us > _budget_us)
+            {
+                _last_overrun = {index, type, time_us};
+                _overruns++;
+            }
+        }
+
+        uint8_t task_owner(int16_t id) const
+        {
+            return id >= 0 && id < MAX_TASKS ? _task_owners[id] : NOT_PROFILED;
+        }
+
+        // nullptr for controllers that weren't added
+        const controller_profile *get(uint8_t index) const
+        {
+            return index < _count && _controllers[index].name ? &_controllers[index] : nullptr;
+        }
+
+        // keeps names and tasks, drops the measurements
+        void reset()
+        {
+            for (auto &controller : _controllers)
+            {
+                for (auto &calls : controller.calls)
+                    calls = histogram();
+            }
+            _overruns = 0;
+            _last_overrun = {};
+        }
+
+        uint8_t size() const { return _count; }
+        void set_budget(uint32_t budget_us) { _budget_us = budget_us; }
+        uint32_t budget() const { return _budget_us; }
+        uint32_t overruns() const { return _overruns; }
+        const overrun &last_overrun() const { return _last_overrun; }
+
+    private:
+        clock _now;
+        uint32_t _cycles_per_us;
+        uint32_t _budget_us;
+        controller_profile _controllers[MAX_CONTROLLERS] = {};
+        uint8_t _task_owners[MAX_TASKS];
+        uint8_t _count = 0;
+        uint32_t _overruns = 0;
+        overrun _last_overrun = {};
+    };
+
+    // measures until the end of the scope
+    class scope
+    {
+    public:
+        scope(profiler &target, uint8_t index, kind type) : _target(target),
+                                                            _index(index),
+                                                            _type(type),
+                                                            _start(target.start())
+        {
+        }
+
+        ~scope() { _target.stop(_index, _type, _start); }
+
+    private:
+        profiler &_target;
+        uint8_t _index;
+        kind _type;
+        uint32_t _start;
+    };
+
+#if PROFILING
+    // the one the parsers report to (cycle counter of the cpu)
+    extern profiler instance;
+
+    // scheduler::run() invoker, times the task for the controller that added it
+    inline void timed_task(int16_t id, void (*fun)(void *), void *context)
+    {
+        scope measured(instance, instance.task_owner(id), kind::TASK);
+        fun(context);
+    }
+#endif // PROFILING
+} // namespace profiler
+
+#if PROFILING
+
+#define PROFILE_SCOPE(index, type) profiler::scope profiled_scope(profiler::instance, index, profiler::kind::type);
+#define PROFILE_CONTROLLER(index, name, first_task, last_task) profiler::instance.add(index, name, first_task, last_task);
+
+#else
+
+#define PROFILE_SCOPE(index, type)
+// caller counted the tasks already, unused otherwise
+#define PROFILE_CONTROLLER(index, name, first_task, last_task) (void)first_task;
+
+#endif // PROFILING
+
+#endif // __PROFILER_HPP__
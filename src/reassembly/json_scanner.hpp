@@ -0,0 +1,133 @@
+#ifndef __JSON_SCANNER_HPP__
+#define __JSON_SCANNER_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace reassembly
+{
+    // follows the structure of a json message fragment by fragment, before the whole of it is there
+    // -> broken messages are rejected early and the document for it is sized exactly once it's complete
+    class json_scanner
+    {
+    public:
+        enum class state : uint8_t
+        {
+            // root container isn't closed yet
+            incomplete,
+            complete,
+            malformed
+        };
+
+        static constexpr uint8_t MAX_DEPTH = 32U;
+
+        void reset() { *this = json_scanner(); }
+
+        state feed(const char *text, size_t length)
+        {
+            for (size_t i = 0; i < length && _state != state::malformed; i++)
+                feed(text[i]);
+            return _state;
+        }
+
+        state current() const { return _state; }
+        // elements of arrays and members of objects, root not included -> slots of the document
+        size_t values() const { return _values; }
+
+    private:
+        void feed(char c)
+        {
+            if (_in_string)
+            {
+                if (_escaped)
+                    _escaped = false;
+                else if (c == '\\')
+                    _escaped = true;
+                else if (c == '"')
+                    _in_string = false;
+                return;
+            }
+
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+                return;
+
+            // anything but whitespace after the root
+            if (_state == state::complete)
+            {
+                _state = state::malformed;
+                return;
+            }
+
+            bool closing = c == '}' || c == ']';
+            if (_opened && !closing)
+                _values++;
+            _opened = false;
+
+            switch (c)
+            {
+            case '"':
+                if (!_depth)
+                    _state = state::malformed;
+                _in_string = true;
+                break;
+            case '{':
+            case '[':
+                open(c == '{');
+                break;
+            case '}':
+            case ']':
+                close(c == '}');
+                break;
+            case ',':
+                if (!_depth)
+                    _state = state::malformed;
+                _values++;
+                break;
+            default:
+                // root has to be a container
+                if (!_depth)
+                    _state = state::malformed;
+                break;
+            }
+        }
+
+        void open(bool object)
+        {
+            if (_depth >= MAX_DEPTH)
+            {
+                _state = state::malformed;
+                return;
+            }
+            if (object)
+                _objects |= 1UL << _depth;
+            else
+                _objects &= ~(1UL << _depth);
+            _depth++;
+            _opened = true;
+        }
+
+        void close(bool object)
+        {
+            if (!_depth || static_cast<bool>(_objects & (1UL << (_depth - 1U))) != object)
+            {
+                _state = state::malformed;
+                return;
+            }
+            _depth--;
+            if (!_depth)
+                _state = state::complete;
+        }
+
+        size_t _values = 0;
+        // bit i -> container at depth i is an object
+        uint32_t _objects = 0;
+        uint8_t _depth = 0;
+        state _state = state::incomplete;
+        bool _in_string = false;
+        bool _escaped = false;
+        // container was just opened, next token is its first value (or its end)
+        bool _opened = false;
+    };
+} // namespace reassembly
+
+#endif // __JSON_SCANNER_HPP__
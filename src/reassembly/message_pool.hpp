@@ -0,0 +1,185 @@
+#ifndef __MESSAGE_POOL_HPP__
+#define __MESSAGE_POOL_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "json_scanner.hpp"
+
+namespace reassembly
+{
+    // buffers for text messages that come in more than one piece (fragments or frames),
+    // a slot per client that is in the middle of one, all of them allocated up front
+    // messages that fit in a single piece never get here
+    // only used from the socket event handler -> no locking
+    template <uint8_t SLOTS, size_t CAPACITY>
+    class message_pool
+    {
+    public:
+        enum class result : uint8_t
+        {
+            // waiting for the rest
+            incomplete,
+            // message(client) is ready, release(client) once it's handled
+            complete,
+            // rejected, the rest of the message is ignored -> error reply is sent only for these
+            too_long,
+            malformed,
+            no_slot,
+            // piece of a message that was already rejected
+            ignored
+        };
+
+        struct statistics
+        {
+            uint32_t completed;
+            uint32_t too_long;
+            uint32_t malformed;
+            uint32_t no_slot;
+            // longest message put together
+            size_t max_length;
+        };
+
+        // first -> beginning of a message, last -> its final piece
+        result append(uint32_t client, const char *data, size_t length, bool first, bool last)
+        {
+            slot *target = first ? acquire(client) : find(client);
+            if (!target)
+            {
+                if (!first)
+                    return result::ignored;
+                _stats.no_slot++;
+                return result::no_slot;
+            }
+
+            if (target->rejected)
+                return finish(*target, last, result::ignored);
+
+            if (target->length + length > CAPACITY)
+            {
+                _stats.too_long++;
+                return reject(*target, last, result::too_long);
+            }
+
+            memcpy(target->buffer + target->length, data, length);
+            target->length += length;
+            if (target->scanner.feed(data, length) == json_scanner::state::malformed)
+            {
+                _stats.malformed++;
+                return reject(*target, last, result::malformed);
+            }
+
+            if (!last)
+                return result::incomplete;
+
+            target->buffer[target->length] = '\0';
+            if (target->scanner.current() != json_scanner::state::complete)
+            {
+                _stats.malformed++;
+                return reject(*target, last, result::malformed);
+            }
+
+            _stats.completed++;
+            if (target->length > _stats.max_length)
+                _stats.max_length = target->length;
+            return result::complete;
+        }
+
+        // complete message, '\0' terminated and writable (ArduinoJson parses it in place)
+        char *message(uint32_t client)
+        {
+            slot *target = find(client);
+            return target ? target->buffer : nullptr;
+        }
+
+        size_t length(uint32_t client)
+        {
+            slot *target = find(client);
+            return target ? target->length : 0U;
+        }
+
+        // slots of the document for the complete message (see json_scanner)
+        size_t values(uint32_t client)
+        {
+            slot *target = find(client);
+            return target ? target->scanner.values() : 0U;
+        }
+
+        // message was handled or the client disconnected
+        void release(uint32_t client)
+        {
+            slot *target = find(client);
+            if (target)
+                target->used = false;
+        }
+
+        uint8_t in_use() const
+        {
+            uint8_t count = 0;
+            for (const auto &candidate : _slots)
+                count += candidate.used;
+            return count;
+        }
+
+        const statistics &stats() const { return _stats; }
+
+    private:
+        struct slot
+        {
+            uint32_t client;
+            size_t length;
+            bool used;
+            bool rejected;
+            json_scanner scanner;
+            // with the '\0'
+            char buffer[CAPACITY + 1];
+        };
+
+        slot *find(uint32_t client)
+        {
+            for (auto &candidate : _slots)
+                if (candidate.used && candidate.client == client)
+                    return &candidate;
+            return nullptr;
+        }
+
+        // new message of a client drops its unfinished one
+        slot *acquire(uint32_t client)
+        {
+            slot *target = find(client);
+            for (uint8_t i = 0; !target && i < SLOTS; i++)
+                if (!_slots[i].used)
+                    target = &_slots[i];
+
+            if (target)
+            {
+                target->client = client;
+                target->length = 0;
+                target->used = true;
+                target->rejected = false;
+                target->scanner.reset();
+            }
+            return target;
+        }
+
+        // slot is kept until the last piece, so the rest of the message isn't taken for a new one
+        result reject(slot &target, bool last, result reason)
+        {
+            target.rejected = true;
+            finish(target, last, reason);
+            return reason;
+        }
+
+        result finish(slot &target, bool last, result reason)
+        {
+            if (last)
+                target.used = false;
+            return reason;
+        }
+
+        slot _slots[SLOTS] = {};
+        statistics _stats = {};
+    };
+} // namespace reassembly
+
+#endif // __MESSAGE_POOL_HPP__
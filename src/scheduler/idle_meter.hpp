@@ -0,0 +1,81 @@
+#ifndef __IDLE_METER_HPP__
+#define __IDLE_METER_HPP__
+
+#include <stdint.h>
+
+namespace scheduler
+{
+    // share of time the control task spends blocked, measured over fixed windows
+    // sleep() / wake() are called around every wait of the loop, waits with no timeout included
+    class idle_meter
+    {
+    public:
+        // microseconds, wrapping around is fine
+        typedef uint32_t (*clock)();
+
+        struct statistics
+        {
+            // last finished window, 0 - 100
+            uint8_t idle_percent;
+            uint32_t waits;
+            // woken up by a command before the timeout ran out
+            uint32_t early_wakeups;
+            uint32_t max_sleep_us;
+        };
+
+        static constexpr uint32_t DEFAULT_WINDOW_US = 1000000U;
+
+        explicit idle_meter(clock now, uint32_t window_us = DEFAULT_WINDOW_US) : _now(now),
+                                                                                 _window_us(window_us ? window_us : 1U),
+                                                                                 _window_start(now())
+        {
+        }
+
+        void sleep()
+        {
+            _sleep_start = _now();
+            roll(_sleep_start);
+        }
+
+        // early -> something was pushed before the deadline
+        void wake(bool early)
+        {
+            uint32_t now = _now();
+            uint32_t slept = now - _sleep_start;
+            _idle_us += slept;
+            _stats.waits++;
+            if (early)
+                _stats.early_wakeups++;
+            if (slept > _stats.max_sleep_us)
+                _stats.max_sleep_us = slept;
+            roll(now);
+        }
+
+        const statistics &stats() const { return _stats; }
+        uint8_t idle_percent() const { return _stats.idle_percent; }
+
+    private:
+        void roll(uint32_t now)
+        {
+            uint32_t elapsed = now - _window_start;
+            if (elapsed < _window_us)
+                return;
+
+            // a sleep that started in the previous window is counted whole in this one
+            if (_idle_us > elapsed)
+                _idle_us = elapsed;
+            _stats.idle_percent = static_cast<uint8_t>(static_cast<uint64_t>(_idle_us) * 100U / elapsed);
+            _idle_us = 0;
+            _window_start = now;
+        }
+
+        clock _now;
+        uint32_t _window_us;
+        uint32_t _window_start;
+        uint32_t _sleep_start = 0;
+        uint32_t _idle_us = 0;
+        statistics _stats = {};
+    };
+} // namespace scheduler
+
+#endif // __IDLE_METER_HPP__
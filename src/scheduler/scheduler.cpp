@@ -0,0 +1,10 @@
+#include <Arduino.h>
+#include "scheduler.hpp"
+
+namespace scheduler
+{
+    uint32_t uptime()
+    {
+        return millis();
+    }
+} // namespace scheduler
@@ -0,0 +1,254 @@
+#ifndef __SCHEDULER_HPP__
+#define __SCHEDULER_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace scheduler
+{
+    // milliseconds since start, millis() on the device
+    uint32_t uptime();
+
+    // periodic tasks in a min-heap ordered by their next deadline
+    // run() only looks at the top of the heap -> a pass with nothing due costs a single compare
+    // no matter how many tasks there are, nothing is allocated
+    template <size_t CAPACITY>
+    class scheduler
+    {
+        static_assert(CAPACITY > 0 && CAPACITY < INT16_MAX, "task ids are stored on int16_t");
+
+    public:
+        // milliseconds, wrapping around is fine
+        typedef uint32_t (*clock)();
+        typedef void (*callback)(void *context);
+
+        static constexpr int16_t NO_TASK = -1;
+        // until_next() when no task is waiting
+        static constexpr uint32_t IDLE = UINT32_MAX;
+
+        struct statistics
+        {
+            uint32_t runs;
+            // runs that started after their deadline had already passed
+            uint32_t late;
+            uint32_t max_late_ms;
+        };
+
+        explicit scheduler(clock now) : _now(now) {}
+
+        // first run after phase ms, then every period ms (at least 1)
+        // returns id of the task, NO_TASK when there is no room
+        int16_t add(callback fun, void *context, uint32_t period, uint32_t phase = 0)
+        {
+            if (!fun || _count >= CAPACITY)
+                return NO_TASK;
+
+            int16_t id = static_cast<int16_t>(_count++);
+            _tasks[id] = {fun, context, period ? period : 1U, _now() + phase, NOT_QUEUED};
+            push(id);
+            return id;
+        }
+
+        // member function as a task: add<leds_controller, &leds_controller::animate>(*this, 50)
+        template <typename T, void (T::*method)()>
+        int16_t add(T &object, uint32_t period, uint32_t phase = 0)
+        {
+            return add([](void *context) { (static_cast<T *>(context)->*method)(); }, &object, period, phase);
+        }
+
+        // next run is one new period from now (if the task isn't suspended)
+        bool set_period(int16_t id, uint32_t period)
+        {
+            if (!valid(id))
+                return false;
+
+            task &current = _tasks[id];
+            current.period = period ? period : 1U;
+            if (current.position != NOT_QUEUED)
+            {
+                current.deadline = _now() + current.period;
+                update(id);
+            }
+            return true;
+        }
+
+        // task doesn't run until it is resumed
+        bool suspend(int16_t id)
+        {
+            if (!valid(id))
+                return false;
+
+            if (_tasks[id].position != NOT_QUEUED)
+                remove(id);
+            return true;
+        }
+
+        // runs after delay ms and periodically again
+        bool resume(int16_t id, uint32_t delay = 0)
+        {
+            if (!valid(id))
+                return false;
+
+            task &current = _tasks[id];
+            current.deadline = _now() + delay;
+            if (current.position == NOT_QUEUED)
+                push(id);
+            else
+                update(id);
+            return true;
+        }
+
+        // runs every task that is due, each at most once, returns how many ran
+        uint32_t run()
+        {
+            return run([](int16_t, callback fun, void *context) { fun(context); });
+        }
+
+        // invoke(id, fun, context) has to call fun(context), lets the caller wrap every run (profiling)
+        template <typename Invoke>
+        uint32_t run(Invoke &&invoke)
+        {
+            uint32_t now = _now();
+            uint32_t ran = 0;
+            while (_size && due(_tasks[_heap[0]].deadline, now))
+            {
+                int16_t id = _heap[0];
+                task &current = _tasks[id];
+                uint32_t late = now - current.deadline;
+                if (late)
+                {
+                    _stats.late++;
+                    if (late > _stats.max_late_ms)
+                        _stats.max_late_ms = late;
+                }
+
+                // missed periods are skipped, task keeps its phase
+                // rescheduled before the call, so the task can suspend or resume itself
+                current.deadline += current.period * (late / current.period + 1);
+                update(id);
+                invoke(id, current.fun, current.context);
+                ran++;
+            }
+            _stats.runs += ran;
+            return ran;
+        }
+
+        // ms until the earliest task is due, 0 when one already is, IDLE without tasks
+        uint32_t until_next() const
+        {
+            if (!_size)
+                return IDLE;
+
+            uint32_t now = _now();
+            uint32_t deadline = _tasks[_heap[0]].deadline;
+            return due(deadline, now) ? 0U : deadline - now;
+        }
+
+        size_t size() const { return _count; }
+        // tasks that aren't suspended
+        size_t active() const { return _size; }
+        const statistics &stats() const { return _stats; }
+        static constexpr size_t capacity() { return CAPACITY; }
+
+    private:
+        static constexpr int16_t NOT_QUEUED = -1;
+
+        struct task
+        {
+            callback fun;
+            void *context;
+            uint32_t period;
+            uint32_t deadline;
+            // index in the heap
+            int16_t position;
+        };
+
+        // wrapping safe -> works as long as deadlines are less than ~24 days apart
+        static bool due(uint32_t deadline, uint32_t now)
+        {
+            return static_cast<int32_t>(now - deadline) >= 0;
+        }
+
+        bool before(int16_t first, int16_t second) const
+        {
+            return static_cast<int32_t>(_tasks[first].deadline - _tasks[second].deadline) < 0;
+        }
+
+        bool valid(int16_t id) const
+        {
+            return id >= 0 && static_cast<size_t>(id) < _count;
+        }
+
+        void place(size_t position, int16_t id)
+        {
+            _heap[position] = id;
+            _tasks[id].position = static_cast<int16_t>(position);
+        }
+
+        void push(int16_t id)
+        {
+            place(_size++, id);
+            sift_up(_tasks[id].position);
+        }
+
+        void remove(int16_t id)
+        {
+            size_t position = _tasks[id].position;
+            _tasks[id].position = NOT_QUEUED;
+            int16_t last = _heap[--_size];
+            if (position == _size)
+                return;
+
+            place(position, last);
+            update(last);
+        }
+
+        // after the deadline of a queued task changed
+        void update(int16_t id)
+        {
+            sift_up(_tasks[id].position);
+            sift_down(_tasks[id].position);
+        }
+
+        void sift_up(size_t position)
+        {
+            int16_t id = _heap[position];
+            while (position)
+            {
+                size_t parent = (position - 1) / 2;
+                if (!before(id, _heap[parent]))
+                    break;
+                place(position, _heap[parent]);
+                position = parent;
+            }
+            place(position, id);
+        }
+
+        void sift_down(size_t position)
+        {
+            int16_t id = _heap[position];
+            for (;;)
+            {
+                size_t child = position * 2 + 1;
+                if (child >= _size)
+                    break;
+                if (child + 1 < _size && before(_heap[child + 1], _heap[child]))
+                    child++;
+                if (!before(_heap[child], id))
+                    break;
+                place(position, _heap[child]);
+                position = child;
+            }
+            place(position, id);
+        }
+
+        clock _now;
+        task _tasks[CAPACITY] = {};
+        int16_t _heap[CAPACITY] = {};
+        size_t _count = 0;
+        size_t _size = 0;
+        statistics _stats = {};
+    };
+} // namespace scheduler
+
+#endif // __SCHEDULER_HPP__
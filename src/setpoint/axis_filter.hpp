@@ -0,0 +1,168 @@
+#ifndef __AXIS_FILTER_HPP__
+#define __AXIS_FILTER_HPP__
+
+#include <stdint.h>
+
+namespace setpoint
+{
+    // normalized values are Q15: -32767 (-1.0) - 32767 (1.0), 0 -> nothing moves
+    static constexpr int16_t FULL_SCALE = 32767;
+
+    // -127 - 127 (gamepad frame) -> Q15
+    inline int16_t from_axis(int8_t axis)
+    {
+        int16_t clamped = axis < -127 ? -127 : axis;
+        return static_cast<int16_t>(clamped * FULL_SCALE / 127);
+    }
+
+    // -1.0 - 1.0 -> Q15, out of range is clamped
+    inline int16_t from_unit(float value)
+    {
+        if (value > 1.0F)
+            value = 1.0F;
+        else if (value < -1.0F)
+            value = -1.0F;
+        return static_cast<int16_t>(value * FULL_SCALE);
+    }
+
+    struct shape
+    {
+        // Q15, everything below it is 0, the rest is stretched back over the full range
+        int16_t deadzone;
+        // 0 - 256, share of the cubic curve -> finer control around the middle
+        uint16_t expo;
+        // 0 - 256, share of the remaining distance the output covers every update (0 and 256 -> no low-pass)
+        uint16_t smoothing;
+        // no sample for that long -> back to 0, 0 never times out
+        uint16_t timeout_ms;
+    };
+
+    // continuous setpoint of a single output (engine, servo) sent at up to 60 Hz
+    // sample() takes the value as it came from the network, update() runs on every tick of the output:
+    //      raw -> deadzone -> expo -> interpolated between samples -> low-pass -> output
+    // samples are spread over the interval they usually come in, so the output keeps moving between
+    // them instead of jumping when one comes and standing still until the next (network jitter)
+    // fixed point only, no floats on the way
+    class axis_filter
+    {
+    public:
+        // estimated interval between samples is kept in this range
+        static constexpr uint16_t MIN_INTERVAL = 5U;
+        static constexpr uint16_t MAX_INTERVAL = 100U;
+        static constexpr uint16_t DEFAULT_INTERVAL = 33U;
+
+        explicit axis_filter(const shape &config = {0, 0, 256U, 0}) : _shape(config)
+        {
+        }
+
+        void configure(const shape &config) { _shape = config; }
+        const shape &config() const { return _shape; }
+
+        // deadzone and expo of a single value
+        static int16_t shaped(int16_t raw, const shape &config)
+        {
+            int32_t magnitude = raw < 0 ? -static_cast<int32_t>(raw) : raw;
+            if (magnitude > FULL_SCALE)
+                magnitude = FULL_SCALE;
+            if (magnitude <= config.deadzone)
+                return 0;
+
+            magnitude = (magnitude - config.deadzone) * FULL_SCALE / (FULL_SCALE - config.deadzone);
+            // divided rather than shifted -> full scale stays full scale
+            int32_t cube = magnitude * magnitude / FULL_SCALE * magnitude / FULL_SCALE;
+            uint16_t expo = config.expo > 256U ? 256U : config.expo;
+            magnitude = (magnitude * (256 - expo) + cube * expo) >> 8;
+            return static_cast<int16_t>(raw < 0 ? -magnitude : magnitude);
+        }
+
+        void sample(int16_t raw, uint32_t now_ms)
+        {
+            // taken before the interval changes -> the output goes on from where it is
+            int16_t from = interpolated(now_ms);
+            if (_sampled)
+            {
+                uint32_t gap = now_ms - _last_sample;
+                // long pause -> the next one isn't late, the sender just had nothing to say
+                if (gap <= MAX_INTERVAL)
+                {
+                    int32_t interval = _interval + ((static_cast<int32_t>(gap) << INTERVAL_FRACTION) - _interval) / 4;
+                    _interval = static_cast<uint16_t>(interval < (MIN_INTERVAL << INTERVAL_FRACTION) ? MIN_INTERVAL << INTERVAL_FRACTION : interval);
+                }
+            }
+            _sampled = true;
+            _timed_out = false;
+            _last_sample = now_ms;
+            retarget(from, shaped(raw, _shape), now_ms);
+        }
+
+        // output now, called periodically by the owner
+        int16_t update(uint32_t now_ms)
+        {
+            if (_sampled && !_timed_out && _shape.timeout_ms && now_ms - _last_sample >= _shape.timeout_ms)
+            {
+                _timed_out = true;
+                retarget(interpolated(now_ms), 0, now_ms);
+            }
+
+            int32_t goal = static_cast<int32_t>(interpolated(now_ms)) << FRACTION;
+            int32_t step = (goal - _state) * _shape.smoothing >> 8;
+            // last fraction that the low-pass never covers
+            _state = step ? _state + step : goal;
+            return output();
+        }
+
+        // starts from the given value with nothing pending, when the output is taken over
+        void reset(int16_t value = 0)
+        {
+            _from = value;
+            _to = value;
+            _state = static_cast<int32_t>(value) << FRACTION;
+            _sampled = false;
+            _timed_out = false;
+            _interval = DEFAULT_INTERVAL << INTERVAL_FRACTION;
+        }
+
+        int16_t output() const { return static_cast<int16_t>(_state >> FRACTION); }
+        // where it's going, after deadzone and expo
+        int16_t target() const { return _to; }
+        // nothing left to do until the next sample (or the timeout)
+        bool settled() const { return (_state >> FRACTION) == _to && !(_state & ((1 << FRACTION) - 1)); }
+        bool timed_out() const { return _timed_out; }
+        uint16_t interval() const { return _interval >> INTERVAL_FRACTION; }
+
+    private:
+        // bits below Q15 kept by the low-pass
+        static constexpr uint8_t FRACTION = 4U;
+        // interval is kept in 1/16 ms, so the average doesn't stop a few ms short
+        static constexpr uint8_t INTERVAL_FRACTION = 4U;
+
+        void retarget(int16_t from, int16_t target, uint32_t now_ms)
+        {
+            _from = from;
+            _to = target;
+            _start = now_ms;
+        }
+
+        int16_t interpolated(uint32_t now_ms) const
+        {
+            uint32_t elapsed = now_ms - _start;
+            if (elapsed >= static_cast<uint32_t>(_interval >> INTERVAL_FRACTION))
+                return _to;
+            int32_t progress = static_cast<int32_t>(elapsed << INTERVAL_FRACTION);
+            return static_cast<int16_t>(_from + (static_cast<int32_t>(_to) - _from) * progress / _interval);
+        }
+
+        shape _shape;
+        int16_t _from = 0;
+        int16_t _to = 0;
+        uint32_t _start = 0;
+        uint32_t _last_sample = 0;
+        uint16_t _interval = DEFAULT_INTERVAL << INTERVAL_FRACTION;
+        // output in Q15 << FRACTION
+        int32_t _state = 0;
+        bool _sampled = false;
+        bool _timed_out = false;
+    };
+} // namespace setpoint
+
+#endif // __AXIS_FILTER_HPP__
@@ -0,0 +1,125 @@
+#ifndef __PUBLISHER_HPP__
+#define __PUBLISHER_HPP__
+
+#include <stdint.h>
+#include <string.h>
+#include "json_parser/json_writer.hpp"
+#include "controllers/abstract/state_stamps.hpp"
+
+namespace telemetry
+{
+    // frames with the state that changed since the previous frame, sent at a fixed rate
+    // the first frame (and the one after a frame was dropped) has the whole state,
+    // a client that missed a frame on its own gets a whole_frame() of its own
+    class publisher
+    {
+    public:
+        // microseconds, wrapping around is fine
+        typedef uint32_t (*clock)();
+
+        struct statistics
+        {
+            uint32_t frames;
+            // nothing changed since the previous frame -> nothing was sent
+            uint32_t unchanged;
+            // no memory or the outbox was full
+            uint32_t dropped;
+            uint32_t full_frames;
+            uint32_t last_bytes;
+            uint32_t max_bytes;
+            uint64_t total_bytes;
+            uint32_t last_time_us;
+            uint32_t max_time_us;
+            uint64_t total_time_us;
+        };
+
+        static constexpr uint8_t MAX_RATE = 50U;
+
+        explicit publisher(clock now) : _now(now) {}
+
+        // frames per second, 0 stops the stream
+        void set_rate(uint32_t rate)
+        {
+            _rate = rate > MAX_RATE ? MAX_RATE : static_cast<uint8_t>(rate);
+            resync();
+        }
+
+        uint8_t rate() const { return _rate; }
+        uint32_t period_ms() const { return _rate ? 1000U / _rate : 0U; }
+
+        // next frame has the whole state
+        void resync() { _since = json_parser::state_version::ALL; }
+
+        // write(json_writer &, since) puts the state that changed after since in the frame
+        // nullptr when nothing changed or there was no memory, free() the frame
+        template <typename F>
+        char *frame(F &&write)
+        {
+            if (_since != json_parser::state_version::ALL && _since == json_parser::state_version::current())
+            {
+                _stats.unchanged++;
+                return nullptr;
+            }
+
+            uint32_t since = _since;
+            uint32_t version = json_parser::state_version::current();
+            char *text = write_frame(write, since);
+            if (text)
+                _since = version;
+            return text;
+        }
+
+        // whole state, the changes that go in the next frame() stay the same
+        template <typename F>
+        char *whole_frame(F &&write)
+        {
+            return write_frame(write, json_parser::state_version::ALL);
+        }
+
+        // frame was written but couldn't be sent -> clients miss the changes in it
+        void drop()
+        {
+            _stats.dropped++;
+            resync();
+        }
+
+        const statistics &stats() const { return _stats; }
+        uint32_t average_bytes() const { return _stats.frames ? static_cast<uint32_t>(_stats.total_bytes / _stats.frames) : 0U; }
+        uint32_t average_time_us() const { return _stats.frames ? static_cast<uint32_t>(_stats.total_time_us / _stats.frames) : 0U; }
+
+    private:
+        template <typename F>
+        char *write_frame(F &&write, uint32_t since)
+        {
+            uint32_t start = _now();
+            char *text = json_parser::write_to_heap([&write, since](json_parser::json_writer &json) { write(json, since); });
+            if (!text)
+            {
+                _stats.dropped++;
+                return nullptr;
+            }
+
+            uint32_t time_us = _now() - start;
+            uint32_t bytes = strlen(text);
+            _stats.frames++;
+            if (since == json_parser::state_version::ALL)
+                _stats.full_frames++;
+            _stats.last_bytes = bytes;
+            _stats.total_bytes += bytes;
+            if (bytes > _stats.max_bytes)
+                _stats.max_bytes = bytes;
+            _stats.last_time_us = time_us;
+            _stats.total_time_us += time_us;
+            if (time_us > _stats.max_time_us)
+                _stats.max_time_us = time_us;
+            return text;
+        }
+
+        clock _now;
+        uint8_t _rate = 0;
+        uint32_t _since = json_parser::state_version::ALL;
+        statistics _stats = {};
+    };
+} // namespace telemetry
+
+#endif // __PUBLISHER_HPP__
@@ -0,0 +1,35 @@
+#ifndef __REPORT_HPP__
+#define __REPORT_HPP__
+
+#include <ArduinoJson.h>
+#include "publisher.hpp"
+
+namespace telemetry
+{
+    // data of the config/telemetry reply, 9 members and the 2 nested objects
+    static constexpr size_t REPORT_SIZE = JSON_OBJECT_SIZE(9) + 2 * JSON_OBJECT_SIZE(3);
+
+    // cost of the frames, skipped -> slow clients that didn't get a frame
+    inline void report(const publisher &frames, uint32_t skipped, JsonObject data)
+    {
+        const auto &stats = frames.stats();
+        data["rate"] = frames.rate();
+        data["frames"] = stats.frames;
+        data["full_frames"] = stats.full_frames;
+        data["unchanged"] = stats.unchanged;
+        data["dropped"] = stats.dropped;
+        data["skipped"] = skipped;
+        // bytes per second for every client at this rate
+        data["bandwidth"] = frames.average_bytes() * frames.rate();
+        JsonObject bytes = data.createNestedObject("bytes");
+        bytes["last"] = stats.last_bytes;
+        bytes["avg"] = frames.average_bytes();
+        bytes["max"] = stats.max_bytes;
+        JsonObject time = data.createNestedObject("time");
+        time["last"] = stats.last_time_us;
+        time["avg"] = frames.average_time_us();
+        time["max"] = stats.max_time_us;
+    }
+} // namespace telemetry
+
+#endif // __REPORT_HPP__
@@ -0,0 +1,46 @@
+#ifndef __DEADMAN_HPP__
+#define __DEADMAN_HPP__
+
+#include <stdint.h>
+#include <atomic>
+
+namespace udp_control
+{
+    // sender that went quiet -> expired() is true once, then not again until the next datagram
+    // fed by the udp task, checked by another one
+    class deadman
+    {
+    public:
+        explicit deadman(uint32_t timeout_ms) : _timeout(timeout_ms)
+        {
+        }
+
+        void feed(uint32_t now_ms)
+        {
+            _last.store(now_ms, std::memory_order_relaxed);
+            _armed.store(true, std::memory_order_release);
+        }
+
+        // a datagram that comes right as it expires may be stopped too, the one after it starts again
+        bool expired(uint32_t now_ms)
+        {
+            if (!_armed.load(std::memory_order_acquire) || now_ms - _last.load(std::memory_order_relaxed) < _timeout)
+                return false;
+            if (!_armed.exchange(false, std::memory_order_acq_rel))
+                return false;
+            _trips.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        uint32_t timeout() const { return _timeout; }
+        uint32_t trips() const { return _trips.load(std::memory_order_relaxed); }
+
+    private:
+        const uint32_t _timeout;
+        std::atomic<uint32_t> _last{0};
+        std::atomic<bool> _armed{false};
+        std::atomic<uint32_t> _trips{0};
+    };
+} // namespace udp_control
+
+#endif // __DEADMAN_HPP__
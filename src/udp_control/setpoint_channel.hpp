@@ -0,0 +1,154 @@
+#ifndef __SETPOINT_CHANNEL_HPP__
+#define __SETPOINT_CHANNEL_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace udp_control
+{
+    // everything the driver controls, sent whole in every datagram -> a lost one is made up by the next
+    struct setpoint
+    {
+        static constexpr uint8_t SIDES = 2U;
+        static constexpr uint8_t SERVOS = 6U;
+        // servo angle that leaves the servo where it is
+        static constexpr uint8_t KEEP = 0xFFU;
+
+        // -1 backward, 0 stop, 1 forward, left then right
+        int8_t direction[SIDES];
+        uint16_t speed[SIDES];
+        uint8_t angle[SERVOS];
+    };
+
+    // datagrams of the udp control port: [sequence: u32][left: direction i8, speed u16]
+    // [right: direction i8, speed u16][servo angles: u8 x 6], little endian
+    // only a datagram newer than every one before it is applied, the rest is counted and dropped
+    class setpoint_channel
+    {
+    public:
+        static constexpr size_t DATAGRAM_SIZE = 16U;
+        // sequence that far behind -> sender started over, not a late datagram
+        static constexpr uint32_t RESTART_GAP = 1000U;
+
+        enum class result : uint8_t
+        {
+            applied,
+            // older than the last applied one
+            stale,
+            duplicate,
+            invalid
+        };
+
+        struct statistics
+        {
+            uint32_t received;
+            uint32_t applied;
+            uint32_t stale;
+            uint32_t duplicates;
+            uint32_t invalid;
+            // sequence numbers skipped and not seen later
+            uint32_t lost;
+            // came after a newer one
+            uint32_t reordered;
+            uint32_t restarts;
+        };
+
+        // value is written only when the datagram is applied
+        result receive(const uint8_t *data, size_t length, setpoint &value)
+        {
+            _stats.received++;
+            setpoint decoded;
+            if (length != DATAGRAM_SIZE || !read(data, decoded))
+            {
+                _stats.invalid++;
+                return result::invalid;
+            }
+
+            uint32_t sequence = read_u32(data);
+            if (_started)
+            {
+                uint32_t ahead = sequence - _last;
+                uint32_t behind = _last - sequence;
+                if (!ahead)
+                {
+                    _stats.duplicates++;
+                    return result::duplicate;
+                }
+                if (behind < RESTART_GAP)
+                {
+                    // counted as lost when the gap showed up
+                    _stats.reordered++;
+                    _stats.stale++;
+                    if (_stats.lost)
+                        _stats.lost--;
+                    return result::stale;
+                }
+                if (ahead < UINT32_MAX / 2U)
+                    _stats.lost += ahead - 1U;
+                else
+                    _stats.restarts++;
+            }
+
+            _started = true;
+            _last = sequence;
+            _stats.applied++;
+            value = decoded;
+            return result::applied;
+        }
+
+        // sender side
+        static void write(uint32_t sequence, const setpoint &value, uint8_t *data)
+        {
+            write_u32(data, sequence);
+            for (uint8_t side = 0; side < setpoint::SIDES; side++)
+            {
+                uint8_t *side_data = data + 4U + side * 3U;
+                side_data[0] = static_cast<uint8_t>(value.direction[side]);
+                side_data[1] = static_cast<uint8_t>(value.speed[side]);
+                side_data[2] = static_cast<uint8_t>(value.speed[side] >> 8);
+            }
+            for (uint8_t servo = 0; servo < setpoint::SERVOS; servo++)
+                data[10U + servo] = value.angle[servo];
+        }
+
+        // next datagram is applied whatever its sequence
+        void restart() { _started = false; }
+
+        uint32_t last_sequence() const { return _last; }
+        const statistics &stats() const { return _stats; }
+
+    private:
+        static bool read(const uint8_t *data, setpoint &decoded)
+        {
+            for (uint8_t side = 0; side < setpoint::SIDES; side++)
+            {
+                const uint8_t *side_data = data + 4U + side * 3U;
+                decoded.direction[side] = static_cast<int8_t>(side_data[0]);
+                if (decoded.direction[side] < -1 || decoded.direction[side] > 1)
+                    return false;
+                decoded.speed[side] = static_cast<uint16_t>(side_data[1] | (side_data[2] << 8));
+            }
+            for (uint8_t servo = 0; servo < setpoint::SERVOS; servo++)
+                decoded.angle[servo] = data[10U + servo];
+            return true;
+        }
+
+        static uint32_t read_u32(const uint8_t *data)
+        {
+            return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+                   (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+        }
+
+        static void write_u32(uint8_t *data, uint32_t number)
+        {
+            for (uint8_t i = 0; i < 4U; i++)
+                data[i] = static_cast<uint8_t>(number >> (8U * i));
+        }
+
+        uint32_t _last = 0;
+        bool _started = false;
+        statistics _stats = {};
+    };
+} // namespace udp_control
+
+#endif // __SETPOINT_CHANNEL_HPP__
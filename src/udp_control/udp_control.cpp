@@ -0,0 +1,139 @@
+#include <Arduino.h>
+#include <string.h>
+#include "udp_control.hpp"
+#include "debug.hpp"
+#include "global_queue.hpp"
+#include "controllers/engines_controller.hpp"
+#include "controllers/arm_controller.hpp"
+
+#if UDP_DEBUG
+
+#define LOG_UDP_F(...) LOG_F(__VA_ARGS__)
+
+#else
+
+#define LOG_UDP_F(...)
+
+#endif
+
+namespace udp_control
+{
+    AsyncUDP control_port::udp;
+    setpoint_channel control_port::channel;
+    deadman control_port::sender(control_port::DEADMAN_MS);
+    int16_t control_port::engines = -1;
+    int16_t control_port::arm = -1;
+
+    // ids of the binary commands, checked by the compiler against the command tables
+    static constexpr int16_t FORWARD = json_parser::engines_controller::command_id("forward");
+    static constexpr int16_t BACKWARD = json_parser::engines_controller::command_id("backward");
+    static constexpr int16_t STOP = json_parser::engines_controller::command_id("stop");
+    static constexpr int16_t SPEED = json_parser::engines_controller::command_id("speed");
+    static constexpr int16_t ANGLE = json_parser::arm_controller::command_id("angle");
+    static_assert(FORWARD >= 0 && BACKWARD >= 0 && STOP >= 0 && SPEED >= 0 && ANGLE >= 0, "commands are in the tables");
+
+    // by direction + 1
+    static constexpr uint8_t DIRECTIONS[] = {BACKWARD, STOP, FORWARD};
+    static constexpr uint8_t SIDES[setpoint::SIDES] = {commands::LEFT, commands::RIGHT};
+    // [BATCH] + 2 sides x (direction, speed) or 6 servos, every message [length, controller, id, args...]
+    static constexpr size_t BATCH_BYTES = 1U + setpoint::SERVOS * 5U;
+
+    static size_t add(uint8_t *batch, size_t length, uint8_t controller, uint8_t id, const uint8_t *args, uint8_t args_length)
+    {
+        batch[length++] = 2U + args_length;
+        batch[length++] = controller;
+        batch[length++] = id;
+        memcpy(batch + length, args, args_length);
+        return length + args_length;
+    }
+
+    bool control_port::begin(const json_parser::abstract_parser &parser, uint16_t port)
+    {
+        engines = parser.index_of("engines");
+        arm = parser.index_of("arm");
+        if (engines < 0 || arm < 0 || !udp.listen(port))
+            return false;
+
+        udp.onPacket(receive);
+        LOG_UDP_F("[udp] control port %u\n", port)
+        return true;
+    }
+
+    setpoint_channel::statistics control_port::stats()
+    {
+        return channel.stats();
+    }
+
+    void control_port::watch(uint32_t now_ms)
+    {
+        if (!sender.expired(now_ms))
+            return;
+
+        uint8_t stop[] = {static_cast<uint8_t>(engines), STOP, commands::BOTH};
+        // stop is on the safety lane, in front of whatever the last datagrams queued
+        global_queue::push(stop, sizeof(stop), commands::origin::INTERNAL);
+        LOG_UDP_F("[udp] nothing for %u ms, engines stopped\n", sender.timeout())
+    }
+
+    uint32_t control_port::failsafes()
+    {
+        return sender.trips();
+    }
+
+    void control_port::receive(AsyncUDPPacket &packet)
+    {
+        setpoint value;
+        auto result = channel.receive(packet.data(), packet.length(), value);
+        if (result != setpoint_channel::result::applied)
+        {
+            LOG_UDP_F("[udp] dropped datagram (%u), last sequence %u\n", static_cast<unsigned>(result), channel.last_sequence())
+            return;
+        }
+
+        sender.feed(millis());
+        // queue full -> the next datagram carries all of it again
+        if (!apply_engines(value) || !apply_arm(value))
+        {
+            LOG_UDP_F("[udp] setpoint %u didn't fit in the queue\n", channel.last_sequence())
+        }
+    }
+
+    // speed before direction -> a side that keeps its direction gets the new speed on the pins right away
+    // both sides share the commands when they are the same
+    bool control_port::apply_engines(const setpoint &value)
+    {
+        uint8_t batch[BATCH_BYTES];
+        size_t length = 0;
+        batch[length++] = global_queue::BATCH;
+
+        bool same = value.direction[0] == value.direction[1] && value.speed[0] == value.speed[1];
+        for (uint8_t side = 0; side < (same ? 1U : setpoint::SIDES); side++)
+        {
+            uint8_t sides = same ? commands::BOTH : SIDES[side];
+            uint8_t speed[] = {sides, static_cast<uint8_t>(value.speed[side]), static_cast<uint8_t>(value.speed[side] >> 8)};
+            length = add(batch, length, engines, SPEED, speed, sizeof(speed));
+            uint8_t direction[] = {sides};
+            length = add(batch, length, engines, DIRECTIONS[value.direction[side] + 1], direction, sizeof(direction));
+        }
+        return global_queue::push_unacked(batch, length, commands::origin::NETWORK);
+    }
+
+    bool control_port::apply_arm(const setpoint &value)
+    {
+        uint8_t batch[BATCH_BYTES];
+        size_t length = 0;
+        batch[length++] = global_queue::BATCH;
+
+        for (uint8_t servo = 0; servo < setpoint::SERVOS; servo++)
+        {
+            uint8_t angle = value.angle[servo];
+            if (angle != setpoint::KEEP)
+            {
+                uint8_t args[] = {servo, angle};
+                length = add(batch, length, arm, ANGLE, args, sizeof(args));
+            }
+        }
+
+        return length == 1U || global_queue::push_unacked(batch, length, commands::origin::NETWORK);
+    }
+} // namespace udp_control
@@ -0,0 +1,49 @@
+#ifndef __UDP_CONTROL_HPP__
+#define __UDP_CONTROL_HPP__
+
+#include <AsyncUDP.h>
+#include "setpoint_channel.hpp"
+#include "deadman.hpp"
+#include "json_parser/abstract_parser.hpp"
+
+// control port next to the websocket, a lost datagram doesn't hold back the ones after it
+#ifndef UDP_CONTROL
+#define UDP_CONTROL 0
+#endif
+
+namespace udp_control
+{
+    // newest setpoint -> batches of binary commands (engines, arm), same queue and dispatch as the websocket
+    // all of it every datagram, the controllers skip what is in place already -> a stop that came from
+    // elsewhere is undone by the next datagram, the engines still aren't restarted every time
+    class control_port
+    {
+    public:
+        static constexpr uint16_t PORT = 4210U;
+        // nothing valid for that long (sender crashed, link lost) -> engines stop
+        static constexpr uint32_t DEADMAN_MS = 500U;
+
+        // controllers are looked up once, false when they are missing or the port can't be opened
+        static bool begin(const json_parser::abstract_parser &parser, uint16_t port = PORT);
+        // counters are written by the udp task, a copy may be a datagram behind
+        static setpoint_channel::statistics stats();
+        // called periodically (network task), stops the engines once the sender is gone
+        static void watch(uint32_t now_ms);
+        // times the engines were stopped by watch()
+        static uint32_t failsafes();
+
+    private:
+        static void receive(AsyncUDPPacket &packet);
+        // false when the batch didn't fit in the queue, the next datagram tries again
+        static bool apply_engines(const setpoint &value);
+        static bool apply_arm(const setpoint &value);
+
+        static AsyncUDP udp;
+        static setpoint_channel channel;
+        static deadman sender;
+        static int16_t engines;
+        static int16_t arm;
+    };
+} // namespace udp_control
+
+#endif // __UDP_CONTROL_HPP__
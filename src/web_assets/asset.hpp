@@ -0,0 +1,79 @@
+#ifndef __ASSET_HPP__
+#define __ASSET_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace web_assets
+{
+    // file of the web page, embedded by tools/embed_assets.py (see generated_assets.hpp)
+    struct asset
+    {
+        const char *path;
+        const char *type;
+        const uint8_t *data;
+        size_t length;
+        // quoted hash of the content, strong
+        const char *etag;
+        // what the other files ask for it with (?v=...)
+        const char *version;
+        // data is gzip, sent with Content-Encoding: gzip
+        bool gzipped;
+    };
+
+    static constexpr const char *INDEX = "/index.html";
+    // url with the right version never changes, anything else is asked for again every time (304 if it didn't change)
+    static constexpr const char *CACHE_IMMUTABLE = "public, max-age=31536000, immutable";
+    static constexpr const char *CACHE_REVALIDATE = "no-cache";
+
+    // "/" -> index.html, nullptr if there is no such file
+    template <size_t N>
+    const asset *find(const asset (&table)[N], const char *path)
+    {
+        if (!strcmp(path, "/"))
+            path = INDEX;
+        for (const auto &candidate : table)
+            if (!strcmp(candidate.path, path))
+                return &candidate;
+        return nullptr;
+    }
+
+    // version -> value of ?v=, nullptr when there was none
+    inline const char *cache_control(const asset &file, const char *version)
+    {
+        return version && !strcmp(version, file.version) ? CACHE_IMMUTABLE : CACHE_REVALIDATE;
+    }
+
+    // If-None-Match: "a", W/"b" or * -> true if the browser has this etag already (weak comparison, RFC 7232)
+    inline bool etag_matches(const char *header, const char *etag)
+    {
+        size_t etag_length = strlen(etag);
+        const char *position = header;
+        while (*position)
+        {
+            if (*position == ' ' || *position == '\t' || *position == ',')
+            {
+                position++;
+                continue;
+            }
+            if (*position == '*')
+                return true;
+            if (position[0] == 'W' && position[1] == '/')
+                position += 2;
+            if (*position != '"')
+                return false;
+
+            const char *end = strchr(position + 1, '"');
+            if (!end)
+                return false;
+            size_t length = end - position + 1;
+            if (length == etag_length && !memcmp(position, etag, length))
+                return true;
+            position = end + 1;
+        }
+        return false;
+    }
+} // namespace web_assets
+
+#endif // __ASSET_HPP__
@@ -1,8 +1,10 @@
 #include <ArduinoJson.h>
 #include <StreamUtils.h>
+#include <algorithm>
 #include "webserver.hpp"
 #include "debug.hpp"
 #include "global_queue.hpp"
+#include "web_assets/generated_assets.hpp"
 
 #if WEB_SERVER_DEBUG
 
@@ -21,36 +23,76 @@
 #endif
 
 AsyncWebServer webserver::web_server(HTTP_PORT);
-AsyncWebSocket webserver::web_socket(WEB_SOCKET_ROOT);
+AsyncWebSocket webserver::control_socket(CONTROL_ROOT);
+AsyncWebSocket webserver::bulk_socket(BULK_ROOT);
 DNSServer webserver::dns;
+command_queue::mpmc_ring<webserver::outgoing, webserver::OUTBOX_DEPTH> webserver::outbox;
+reassembly::message_pool<webserver::REASSEMBLY_SLOTS, webserver::MESSAGE_CAPACITY> webserver::fragments;
+webserver::client_throttle webserver::throttle;
+webserver::control_throttle webserver::control_buckets;
+webserver::client_queues webserver::queues;
+ingress::traffic webserver::traffic_of[webserver::MAX_CONTROLLERS];
+std::atomic<uint8_t> webserver::control_clients(0);
+std::atomic<uint8_t> webserver::bulk_clients(0);
+TaskHandle_t webserver::network_task = nullptr;
 
-void webserver::init_entire_web()
+// controllers that aren't here are bulk
+static constexpr struct
 {
-    LOG_WEBSERVER_F("[%s] initing file system...\n", SSID)
-    if (SPIFFS.begin())
-    {
-        LOG_WEBSERVER_F("[%s] initing access points...\n", SSID)
-        init_access_point();
-        LOG_WEBSERVER_F("[%s] initing web server...\n", SSID);
-        init_web_server();
-        LOG_WEBSERVER_F("[%s] initing web socket...\n", SSID)
-        init_web_socket();
-        LOG_WEBSERVER_F("[%s] initing DNS...\n", SSID)
-        init_dns();
-        LOG_WEBSERVER_F("[%s] starting server...\n", SSID)
-        web_server.begin();
-        LOG_WEBSERVER_F("[%s] good to go!\n", SSID)
-    }
-    else
+    const char *controller;
+    ingress::traffic type;
+} TRAFFIC[] = {
+    {"engines", ingress::traffic::CONTROL},
+    {"arm", ingress::traffic::CONTROL},
+    {"gamepad", ingress::traffic::CONTROL},
+    {"config", ingress::traffic::CONFIG},
+};
+
+// by ingress::traffic, commands per second and at once for every client
+// gamepad sends up to 60 frames a second, changes of it come as single commands
+static constexpr ingress::limit LIMITS[ingress::TRAFFIC_CLASSES] = {
+    {200U, 40U},
+    {20U, 20U},
+    {10U, 10U},
+};
+
+static ingress::traffic traffic_by_name(const char *name, size_t length)
+{
+    for (const auto &entry : TRAFFIC)
     {
-        LOG_WEBSERVER_F("[%s] error occured while initing SPIFFS\n", SSID)
+        if (strlen(entry.controller) == length && memcmp(entry.controller, name, length) == 0)
+            return entry.type;
     }
+    return ingress::traffic::BULK;
+}
+
+void webserver::init_entire_web()
+{
+    // page is in flash (web_assets) -> nothing to mount first
+    LOG_WEBSERVER_F("[%s] initing access points...\n", SSID)
+    init_access_point();
+    LOG_WEBSERVER_F("[%s] initing web server...\n", SSID);
+    init_web_server();
+    LOG_WEBSERVER_F("[%s] initing web socket...\n", SSID)
+    init_web_socket();
+    LOG_WEBSERVER_F("[%s] initing DNS...\n", SSID)
+    init_dns();
+    LOG_WEBSERVER_F("[%s] starting server...\n", SSID)
+    web_server.begin();
+    LOG_WEBSERVER_F("[%s] good to go!\n", SSID)
 }
 
 void webserver::process_web()
 {
     dns.processNextRequest();
-    web_socket.cleanupClients();
+    flush_ws();
+    control_socket.cleanupClients();
+    bulk_socket.cleanupClients();
+}
+
+void webserver::set_network_task(TaskHandle_t task)
+{
+    network_task = task;
 }
 
 void webserver::init_access_point()
@@ -58,98 +100,196 @@ void webserver::init_access_point()
     WiFi.softAP(SSID, PASSWORD);
 }
 
+// every file of the page goes through serve_asset, the socket handlers take /ws/ctl and /ws/bulk before it
 void webserver::init_web_server()
 {
-    web_server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
-        request->send(SPIFFS, "/index.html", "text/html");
-    });
-
-    web_server.on("/index.html", HTTP_GET, [](AsyncWebServerRequest *request) {
-        request->send(SPIFFS, "/index.html", "text/html");
-    });
-
-    web_server.on("/js/index.js", HTTP_GET, [](AsyncWebServerRequest *request) {
-        request->send(SPIFFS, "/js/index.js", "text/javascript");
-    });
-
-    web_server.on("/styles/styles.css", HTTP_GET, [](AsyncWebServerRequest *request) {
-        request->send(SPIFFS, "/styles/styles.css", "text/css");
-    });
-
-    web_server.on("/styles/mobile.css", HTTP_GET, [](AsyncWebServerRequest *request) {
-        request->send(SPIFFS, "/styles/mobile.css", "text/css");
-    });
-
-    web_server.on("/js/configs.js", HTTP_GET, [](AsyncWebServerRequest *request) {
-        request->send(SPIFFS, "/js/configs.js", "text/javascript");
-    });
-
-    web_server.on("/js/gamepad_processing.js", HTTP_GET, [](AsyncWebServerRequest *request) {
-        request->send(SPIFFS, "/js/gamepad_processing.js", "text/javascript");
-    });
+    web_server.onNotFound(serve_asset);
+}
 
-    web_server.on("/js/websocket.js", HTTP_GET, [](AsyncWebServerRequest *request) {
-        request->send(SPIFFS, "/js/websocket.js", "text/javascript");
-    });
+// gzip straight from flash, 304 when the browser has this version already
+void webserver::serve_asset(AsyncWebServerRequest *request)
+{
+    const web_assets::asset *file = nullptr;
+    if (request->method() == HTTP_GET)
+        file = web_assets::find(web_assets::ASSETS, request->url().c_str());
+    if (!file)
+    {
+        request->send(404);
+        return;
+    }
 
-    web_server.on("/favicon.ico", HTTP_GET, [](AsyncWebServerRequest *request) {
-        request->send(SPIFFS, "/favicon.ico", "image/png");
-    });
+    const char *version = request->hasParam("v") ? request->getParam("v")->value().c_str() : nullptr;
+    AsyncWebHeader *cached = request->getHeader("If-None-Match");
+    AsyncWebServerResponse *response;
+    if (cached && web_assets::etag_matches(cached->value().c_str(), file->etag))
+    {
+        response = request->beginResponse(304);
+    }
+    else
+    {
+        response = request->beginResponse_P(200, file->type, file->data, file->length);
+        if (file->gzipped)
+            response->addHeader("Content-Encoding", "gzip");
+    }
+    response->addHeader("ETag", file->etag);
+    response->addHeader("Cache-Control", web_assets::cache_control(*file, version));
+    request->send(response);
 }
 
 void webserver::init_web_socket()
 {
-    web_socket.onEvent(handle_web_socket);
-    web_server.addHandler(&web_socket);
+    init_throttle();
+    control_socket.onEvent(handle_control_socket);
+    bulk_socket.onEvent(handle_bulk_socket);
+    web_server.addHandler(&control_socket);
+    web_server.addHandler(&bulk_socket);
+}
+
+// controllers are added by now -> their positions are known
+void webserver::init_throttle()
+{
+    for (auto &type : traffic_of)
+        type = ingress::traffic::BULK;
+    for (const auto &entry : TRAFFIC)
+    {
+        int16_t index = global_queue::index_of(entry.controller);
+        if (index >= 0 && static_cast<size_t>(index) < MAX_CONTROLLERS)
+            traffic_of[index] = entry.type;
+    }
+    for (uint8_t i = 0; i < ingress::TRAFFIC_CLASSES; i++)
+    {
+        throttle.configure(i, LIMITS[i]);
+        control_buckets.configure(i, LIMITS[i]);
+    }
 }
 
-void webserver::handle_web_socket(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)
+// driving only, whole frames -> nothing to put together, nothing that takes long to parse
+void webserver::handle_control_socket(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)
 {
     if (type == WS_EVT_DATA)
     {
         AwsFrameInfo *frame = (AwsFrameInfo *)arg;
+        bool whole = frame->final && frame->index == 0 && frame->len == len;
+        // empty one costs nothing and has no controller, nothing to do with it
+        if (!len)
+            return;
+        if (!whole || len > CONTROL_MESSAGE_CAPACITY)
+        {
+            // answered once, not for every piece of it
+            if (frame->num == 0 && frame->index == 0)
+                reply_error(client, "message too long", CONTROL_MESSAGE_CAPACITY);
+            return;
+        }
+
+        ingress::costs cost;
         if (frame->opcode == WS_TEXT)
+            ingress::traffic_meter::text((const char *)data, len, traffic_by_name, cost);
+        else if (frame->opcode == WS_BINARY)
+            ingress::traffic_meter::binary(data, len, global_queue::BATCH, [](uint8_t index) {
+                return index < MAX_CONTROLLERS ? traffic_of[index] : ingress::traffic::BULK;
+            }, cost);
+        else
+            return;
+
+        if (!control_only(cost))
         {
-            // 1st case -> entire message was sent in a single frame
-            if (frame->final && frame->index == 0 && frame->len == len)
-            {
-                DynamicJsonDocument* json = new DynamicJsonDocument(256);
-                auto error = deserializeJson(*json, (const char*) data, len);
-                if(!error)
-                {
-                    LOG_WEBSERVER_JSON_PRETTY(*json)
-                }
+            reply_error(client, "not a control message", CONTROL_MESSAGE_CAPACITY);
+            return;
+        }
+        if (!admit(control_buckets, client, cost))
+            return;
 
-                if(error || !global_queue::queue.push(&json))
-                {
-                    LOG_WEBSERVER_F("[%s] error: %s (might be queue fault)", SSID, error.c_str())
-                    delete json;
-                }
-            }
+        if (frame->opcode == WS_TEXT)
+        {
+            handle_whole(client, (const char *)data, len, endpoint::CONTROL);
         }
+        else if (!global_queue::push(data, len, commands::origin::NETWORK))
+        {
+            LOG_WEBSERVER_F("[%s] error: invalid binary command or queue is full\n", SSID)
+            if (data[0] == global_queue::BATCH)
+                reply_error(client, "invalid batch", CONTROL_MESSAGE_CAPACITY);
+        }
+    }
+    else if (type == WS_EVT_CONNECT)
+    {
+        LOG_WEBSERVER_F("[%s] ctl[%u] connect\n", SSID, client->id());
+        control_clients++;
     }
     else if (type == WS_EVT_DISCONNECT)
     {
-        LOG_WEBSERVER_F("[%s] ws[%u] disconnect\n", SSID, client->id());
-        size_t clients = server->getClients().length();
-        if (!clients)
+        LOG_WEBSERVER_F("[%s] ctl[%u] disconnect\n", SSID, client->id());
+        control_buckets.forget(client->id());
+        if (control_clients)
+            control_clients--;
+        handle_disconnect();
+    }
+#if WEB_SERVER_DEBUG
+    else if (type == WS_EVT_ERROR)
+    {
+        LOG_WEBSERVER_F("[%s] ctl[%u] error(%u): %s\n", SSID, client->id(), *((uint16_t *)arg), (char *)data);
+    }
+#endif // WEB_SERVER_DEBUG
+}
+
+// state, telemetry, config, files, everything that may be big or slow
+void webserver::handle_bulk_socket(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)
+{
+    if (type == WS_EVT_DATA)
+    {
+        AwsFrameInfo *frame = (AwsFrameInfo *)arg;
+        bool whole = frame->final && frame->index == 0 && frame->len == len;
+        if (frame->opcode == WS_TEXT && whole)
+        {
+            // 1st case -> entire message was sent in a single frame, parsed from the socket buffer
+            ingress::costs cost;
+            ingress::traffic_meter::text((const char *)data, len, traffic_by_name, cost);
+            if (admit(throttle, client, cost))
+                handle_whole(client, (const char *)data, len, endpoint::BULK);
+        }
+        else if (frame->message_opcode == WS_TEXT)
         {
-            DynamicJsonDocument* json = new DynamicJsonDocument(256);
-            (*json)["controller"] = "engines";
-            (*json)["command"] = "STOP";
-            (*json)["engines"] = "both";
-            if(!global_queue::queue.push(&json))
+            // 2nd case -> fragments of a frame or more frames, put together in a pool slot
+            reassemble(client, frame, data, len);
+        }
+        else if (frame->opcode == WS_BINARY)
+        {
+            // compact form of the same commands, see abstract_parser::decode_binary
+            if (whole)
             {
-                delete json;
+                ingress::costs cost;
+                ingress::traffic_meter::binary(data, len, global_queue::BATCH, [](uint8_t index) {
+                    return index < MAX_CONTROLLERS ? traffic_of[index] : ingress::traffic::BULK;
+                }, cost);
+                if (!admit(throttle, client, cost))
+                    return;
+
+                if (!global_queue::push_bulk(data, len, commands::origin::NETWORK))
+                {
+                    LOG_WEBSERVER_F("[%s] error: invalid binary command or queue is full\n", SSID)
+                    if (len && data[0] == global_queue::BATCH)
+                        reply_error(client, "invalid batch", MESSAGE_CAPACITY);
+                }
             }
         }
     }
-#if WEB_SERVER_DEBUG
     else if (type == WS_EVT_CONNECT)
     {
         LOG_WEBSERVER_F("[%s] ws[%u] connect\n", SSID, client->id());
+        bulk_clients++;
+#if WEB_SERVER_DEBUG
         client->ping();
+#endif // WEB_SERVER_DEBUG
+    }
+    else if (type == WS_EVT_DISCONNECT)
+    {
+        LOG_WEBSERVER_F("[%s] ws[%u] disconnect\n", SSID, client->id());
+        fragments.release(client->id());
+        throttle.forget(client->id());
+        if (bulk_clients)
+            bulk_clients--;
+        handle_disconnect();
     }
+#if WEB_SERVER_DEBUG
     else if (type == WS_EVT_ERROR)
     {
         LOG_WEBSERVER_F("[%s] ws[%u] error(%u): %s\n", SSID, client->id(), *((uint16_t *)arg), (char *)data);
@@ -161,15 +301,260 @@ void webserver::handle_web_socket(AsyncWebSocket *server, AsyncWebSocketClient *
 #endif // WEB_SERVER_DEBUG
 }
 
+// nobody left to drive -> nobody left to stop it either
+void webserver::handle_disconnect()
+{
+    if (control_clients)
+        return;
+    StaticJsonDocument<JSON_OBJECT_SIZE(3)> json;
+    json["controller"] = "engines";
+    json["command"] = "stop";
+    json["engine"] = "both";
+    global_queue::push(json.as<JsonObject>(), commands::origin::INTERNAL, command_queue::priority::SAFETY);
+}
+
+// no reply when throttled -> a flooding client doesn't get the socket busy with answers too
+template <typename T>
+bool webserver::admit(T &throttle, AsyncWebSocketClient *client, const ingress::costs &cost)
+{
+    switch (throttle.admit(client->id(), cost, millis()))
+    {
+    case T::result::admitted:
+        return true;
+    case T::result::throttled:
+        LOG_WEBSERVER_F("[%s] ws[%u] throttled\n", SSID, client->id())
+        return false;
+    case T::result::no_slot:
+        LOG_WEBSERVER_F("[%s] ws[%u] no throttle slot\n", SSID, client->id())
+        return false;
+    }
+    return false;
+}
+
+bool webserver::control_only(const ingress::costs &cost)
+{
+    return !cost[static_cast<uint8_t>(ingress::traffic::BULK)] && !cost[static_cast<uint8_t>(ingress::traffic::CONFIG)];
+}
+
+void webserver::handle_whole(AsyncWebSocketClient *client, const char *text, size_t len, endpoint source)
+{
+    global_queue::document json;
+    auto error = deserializeJson(json, text, len);
+    if (error == DeserializationError::NoMemory)
+    {
+        // more than a single command (a batch) -> document of the size the scanner counts
+        reassembly::json_scanner scanner;
+        scanner.feed(text, len);
+        DynamicJsonDocument sized(JSON_ARRAY_SIZE(scanner.values()) + len);
+        error = deserializeJson(sized, text, len);
+        if (!error)
+            handle_json(client, sized, source);
+    }
+    else if (!error)
+    {
+        handle_json(client, json, source);
+    }
+
+    if (error)
+    {
+        LOG_WEBSERVER_F("[%s] error: %s\n", SSID, error.c_str())
+    }
+}
+
+void webserver::handle_text(AsyncWebSocketClient *client, char *text, size_t len, size_t values)
+{
+    // strings stay in the message (parsed in place) -> document only needs a slot for every value
+    DynamicJsonDocument json(JSON_ARRAY_SIZE(values));
+    auto error = deserializeJson(json, text, len);
+    if (error)
+    {
+        LOG_WEBSERVER_F("[%s] error: %s\n", SSID, error.c_str())
+    }
+    else
+    {
+        handle_json(client, json, endpoint::BULK);
+    }
+}
+
+// array -> batch, all of its commands or none of them, acked by the control task once applied
+void webserver::handle_json(AsyncWebSocketClient *client, JsonDocument &json, endpoint source)
+{
+    LOG_WEBSERVER_JSON_PRETTY(json)
+    bool control = source == endpoint::CONTROL;
+    if (json.is<JsonArray>())
+    {
+        if (!global_queue::push(json.as<JsonArray>(), commands::origin::NETWORK))
+            reply_error(client, "invalid batch", control ? CONTROL_MESSAGE_CAPACITY : MESSAGE_CAPACITY);
+    }
+    else if (!(control ? global_queue::push(json.as<JsonObject>(), commands::origin::NETWORK)
+                       : global_queue::push_bulk(json.as<JsonObject>(), commands::origin::NETWORK)))
+    {
+        LOG_WEBSERVER_F("[%s] error: invalid command or queue is full\n", SSID)
+    }
+}
+
+void webserver::reassemble(AsyncWebSocketClient *client, AwsFrameInfo *frame, uint8_t *data, size_t len)
+{
+    typedef reassembly::message_pool<REASSEMBLY_SLOTS, MESSAGE_CAPACITY>::result result;
+
+    uint32_t id = client->id();
+    bool first = frame->num == 0 && frame->index == 0;
+    bool last = frame->final && frame->index + len == frame->len;
+    switch (fragments.append(id, (const char *)data, len, first, last))
+    {
+    case result::complete:
+    {
+        LOG_WEBSERVER_F("[%s] ws[%u] message of %u bytes put together\n", SSID, id, fragments.length(id))
+        ingress::costs cost;
+        ingress::traffic_meter::text(fragments.message(id), fragments.length(id), traffic_by_name, cost);
+        if (admit(throttle, client, cost))
+            handle_text(client, fragments.message(id), fragments.length(id), fragments.values(id));
+        fragments.release(id);
+        break;
+    }
+    case result::too_long:
+        reply_error(client, "message too long", MESSAGE_CAPACITY);
+        break;
+    case result::malformed:
+        reply_error(client, "invalid json", MESSAGE_CAPACITY);
+        break;
+    case result::no_slot:
+        reply_error(client, "busy", MESSAGE_CAPACITY);
+        break;
+    case result::incomplete:
+    case result::ignored:
+        break;
+    }
+}
+
+// right away, in the socket task -> the client can be used here
+void webserver::reply_error(AsyncWebSocketClient *client, const char *reason, size_t limit)
+{
+    LOG_WEBSERVER_F("[%s] ws[%u] message rejected: %s\n", SSID, client->id(), reason)
+    char reply[96];
+    snprintf(reply, sizeof(reply), "{\"name\":\"error\",\"data\":{\"reason\":\"%s\",\"limit\":%u}}",
+             reason, static_cast<unsigned>(limit));
+    client->text(reply);
+}
+
 void webserver::init_dns()
 {
     dns.start(53, "*", WiFi.softAPIP());
 }
 
-void webserver::send_ws(const DynamicJsonDocument &json)
+void webserver::send_ws(const JsonDocument &json)
 {
-    String buffer;
-    serializeJson(json, buffer);
-    LOG_WEBSERVER_F("[%s] string size: %d\n", SSID, buffer.length());
-    web_socket.textAll(buffer);
-}
\ No newline at end of file
+    size_t length = measureJson(json);
+    char *message = static_cast<char *>(malloc(length + 1));
+    if (!message)
+    {
+        LOG_WEBSERVER_F("[%s] no memory for message of size: %d\n", SSID, length)
+        return;
+    }
+
+    serializeJson(json, message, length + 1);
+    send_ws(message);
+}
+
+void webserver::send_ws(char *message)
+{
+    if (!message)
+        return;
+
+    LOG_WEBSERVER_F("[%s] string size: %d\n", SSID, strlen(message));
+    post({message, outbound::kind::EVENT});
+}
+
+bool webserver::publish_telemetry(char *frame)
+{
+    return frame && post({frame, outbound::kind::STATE});
+}
+
+bool webserver::publish_resync(char *frame)
+{
+    return frame && post({frame, outbound::kind::RESYNC});
+}
+
+bool webserver::post(const outgoing &message)
+{
+    if (!outbox.push(message))
+    {
+        LOG_WEBSERVER_F("[%s] outbox is full, message dropped\n", SSID)
+        free(message.message);
+        return false;
+    }
+
+    if (network_task)
+        xTaskNotifyGive(network_task);
+    return true;
+}
+
+bool webserver::has_clients()
+{
+    return bulk_clients.load(std::memory_order_relaxed);
+}
+
+bool webserver::take_missed_frame()
+{
+    return queues.take_missed_state();
+}
+
+uint32_t webserver::skipped_clients()
+{
+    return queues.missed_states();
+}
+
+uint8_t webserver::throttle_stats(client_throttle::client_stats (&out)[MAX_CLIENTS])
+{
+    return throttle.stats(out);
+}
+
+uint8_t webserver::throttle_stats(control_throttle::client_stats (&out)[MAX_CONTROL_CLIENTS])
+{
+    return control_buckets.stats(out);
+}
+
+uint32_t webserver::throttle_no_slot()
+{
+    return throttle.no_slot() + control_buckets.no_slot();
+}
+
+const ingress::limit &webserver::throttle_limit(ingress::traffic type)
+{
+    return throttle.limits(static_cast<uint8_t>(type));
+}
+
+uint8_t webserver::outgoing_stats(client_queues::statistics (&out)[MAX_CLIENTS])
+{
+    return queues.stats(out);
+}
+
+// messages wait in the queue of every client until its socket can take them right away,
+// so the library doesn't pile them up for a slow client
+void webserver::flush_ws()
+{
+    uint32_t connected[MAX_CLIENTS];
+    uint8_t count = 0;
+    for (auto &client : bulk_socket.getClients())
+    {
+        if (client->status() == WS_CONNECTED && count < MAX_CLIENTS)
+            connected[count++] = client->id();
+    }
+    queues.sync(connected, count);
+
+    outgoing message;
+    uint32_t now = micros();
+    while (outbox.pop(message))
+        queues.post(message.message, message.type, now);
+
+    queues.flush(
+        [](uint32_t id, size_t length) {
+            AsyncWebSocketClient *client = bulk_socket.client(id);
+            return client && client->status() == WS_CONNECTED && !client->queueIsFull() &&
+                   client->client()->space() >= std::min(length, SEND_WINDOW);
+        },
+        [](uint32_t id, const char *text, size_t length) {
+            bulk_socket.client(id)->text(text, length);
+        },
+        micros());
+}
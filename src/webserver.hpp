@@ -3,33 +3,126 @@
 
 #include <AsyncWebSocket.h>
 #include <ArduinoJson.h>
-#include <SPIFFS.h>
 #include <ESPAsyncWebServer.h>
-#include <SPIFFSEditor.h>
 #include <DNSServer.h>
+#include <atomic>
+#include "command_queue/mpmc_ring.hpp"
+#include "reassembly/message_pool.hpp"
+#include "ingress/throttle.hpp"
+#include "ingress/traffic.hpp"
+#include "outbound/client_queues.hpp"
 
 class webserver {
 public:
     static void init_entire_web();
     static void process_web();
-    static void send_ws(const DynamicJsonDocument& json);
+    // safe to call from any task, message is serialized here and sent by process_web()
+    static void send_ws(const JsonDocument& json);
+    // same for a message that is already serialized, takes it over (malloc, see json_parser::write_to_heap)
+    static void send_ws(char *message);
+    // telemetry frame for the clients that got every previous one, takes it over like send_ws
+    static bool publish_telemetry(char *frame);
+    // whole state for the clients that missed a frame, the others don't get it
+    static bool publish_resync(char *frame);
+    // telemetry isn't written when nobody listens on the bulk endpoint
+    static bool has_clients();
+    // true once after a client missed a frame -> it needs publish_resync()
+    static bool take_missed_frame();
+    static uint32_t skipped_clients();
+    // as many as the bulk socket lets connect, every one gets token buckets and an outgoing queue of its own
+    static constexpr uint8_t MAX_CLIENTS = 8U;
+    // drivers, only token buckets, nothing is sent to them but errors
+    static constexpr uint8_t MAX_CONTROL_CLIENTS = 4U;
+    static constexpr uint8_t CLIENT_QUEUE_DEPTH = 8U;
+    static constexpr size_t CLIENT_QUEUE_BYTES = 4096U;
+    typedef ingress::throttle<MAX_CLIENTS, ingress::TRAFFIC_CLASSES> client_throttle;
+    typedef ingress::throttle<MAX_CONTROL_CLIENTS, ingress::TRAFFIC_CLASSES> control_throttle;
+    typedef outbound::client_queues<MAX_CLIENTS, CLIENT_QUEUE_DEPTH, CLIENT_QUEUE_BYTES> client_queues;
+
+    // messages let through and rejected for every connected client, returns how many were written
+    static uint8_t throttle_stats(client_throttle::client_stats (&out)[MAX_CLIENTS]);
+    static uint8_t throttle_stats(control_throttle::client_stats (&out)[MAX_CONTROL_CLIENTS]);
+    // clients over MAX_CLIENTS (or MAX_CONTROL_CLIENTS), their messages were rejected
+    static uint32_t throttle_no_slot();
+    static const ingress::limit &throttle_limit(ingress::traffic type);
+    // waiting messages, drops and latency of every connected client, returns how many were written
+    static uint8_t outgoing_stats(client_queues::statistics (&out)[MAX_CLIENTS]);
+    // task that calls process_web(), woken up when there is something to send
+    static void set_network_task(TaskHandle_t task);
 
 private:
+    // control endpoint takes small driving messages only, the rest goes to bulk
+    // -> a file or a state that is being sent never holds up a setpoint
+    enum class endpoint : uint8_t
+    {
+        CONTROL,
+        BULK
+    };
+
+    struct outgoing
+    {
+        char *message;
+        outbound::kind type;
+    };
+
+    static bool post(const outgoing &message);
     static void send_or_delete(DynamicJsonDocument *json, const char* data, size_t len);
-    static void handle_web_socket(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
+    static void handle_control_socket(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
+    static void handle_bulk_socket(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
+    static void handle_disconnect();
+    // before anything is parsed, false -> message is dropped
+    template <typename T>
+    static bool admit(T &throttle, AsyncWebSocketClient *client, const ingress::costs &cost);
+    static bool control_only(const ingress::costs &cost);
+    static void init_throttle();
+    // message that came in a single frame, parsed from the socket buffer
+    static void handle_whole(AsyncWebSocketClient *client, const char *text, size_t len, endpoint source);
+    static void handle_text(AsyncWebSocketClient *client, char *text, size_t len, size_t values);
+    static void handle_json(AsyncWebSocketClient *client, JsonDocument &json, endpoint source);
+    // text message that comes in more than one piece
+    static void reassemble(AsyncWebSocketClient *client, AwsFrameInfo *frame, uint8_t *data, size_t len);
+    static void reply_error(AsyncWebSocketClient *client, const char *reason, size_t limit);
     static void init_access_point();
     static void init_web_server();
+    static void serve_asset(AsyncWebServerRequest *request);
     static void init_web_socket();
     static void init_dns();
+    static void flush_ws();
 
-    static constexpr const char *WEB_SOCKET_ROOT = "/ws";
+    static constexpr const char *CONTROL_ROOT = "/ws/ctl";
+    static constexpr const char *BULK_ROOT = "/ws/bulk";
     static constexpr const char *SSID = "TankWiFi";
     static constexpr const char *PASSWORD = "eurobeat";
     static constexpr uint8_t HTTP_PORT = 80;
+    static constexpr size_t OUTBOX_DEPTH = 8U;
+    // clients that can send a long message at the same time and how long it may be
+    static constexpr uint8_t REASSEMBLY_SLOTS = 2U;
+    static constexpr size_t MESSAGE_CAPACITY = 2048U;
+    // control messages come in a single frame or not at all, a batch of 8 setpoints fits
+    static constexpr size_t CONTROL_MESSAGE_CAPACITY = 512U;
+    static constexpr size_t MAX_CONTROLLERS = 16U;
+    // bigger messages go once the tcp window has this much room, the rest only when all of it fits
+    static constexpr size_t SEND_WINDOW = 2048U;
 
     static AsyncWebServer web_server;
-    static AsyncWebSocket web_socket;
+    static AsyncWebSocket control_socket;
+    static AsyncWebSocket bulk_socket;
     static DNSServer dns;
+    // serialized messages (heap), async_tcp doesn't like clients being touched from other tasks
+    static command_queue::mpmc_ring<outgoing, OUTBOX_DEPTH> outbox;
+    // client ids are counted by each socket on its own -> everything kept by id belongs to one of them
+    static reassembly::message_pool<REASSEMBLY_SLOTS, MESSAGE_CAPACITY> fragments;
+    static client_throttle throttle;
+    static control_throttle control_buckets;
+    // only touched by the network task
+    static client_queues queues;
+    // by position of the controller, for binary messages
+    static ingress::traffic traffic_of[MAX_CONTROLLERS];
+    // updated by the socket events, read by the control task
+    static std::atomic<uint8_t> control_clients;
+    static std::atomic<uint8_t> bulk_clients;
+    // set once in setup, before any task sends
+    static TaskHandle_t network_task;
 };
 
 #endif // __WEBSERVER_H__
\ No newline at end of file
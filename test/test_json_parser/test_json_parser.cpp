@@ -14,7 +14,7 @@ void test_adding()
     TEST_ASSERT_TRUE(parser.add_controller(std::unique_ptr<json_parser::controller>(new json_parser::engines_controller())));
     TEST_ASSERT_TRUE(parser.add_controller(std::unique_ptr<json_parser::controller>(new json_parser::leds_controller())));
     TEST_ASSERT_TRUE(parser.add_controller(std::unique_ptr<json_parser::controller>(new json_parser::mp3_controller())));
-    TEST_ASSERT_TRUE(parser.add_controller(std::unique_ptr<json_parser::controller>(new json_parser::sd_controller())));
+    TEST_ASSERT_TRUE(parser.add_controller(std::unique_ptr<json_parser::controller>(new json_parser::sd_controller(parser))));
 }
 
 void test_handle_resoult()
@@ -0,0 +1,177 @@
+#include <unity.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "command_queue/batch_queue.hpp"
+#include "command_queue/command_queue.hpp"
+
+typedef command_queue::batch_queue<8, 4> batch_queue;
+
+// preset of the leds page -> 5 commands of one controller
+constexpr uint8_t PRESET = 5U;
+
+void fill(batch_queue::batch &batch, uint8_t count, uint8_t first_id)
+{
+    batch.count = count;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        batch.commands[i] = commands::command{};
+        batch.commands[i].controller = 2;
+        batch.commands[i].id = first_id + i;
+    }
+}
+
+// ================
+// TESTS
+// ================
+
+void test_batches_keep_their_order()
+{
+    batch_queue queue;
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        auto *batch = queue.acquire();
+        TEST_ASSERT_NOT_NULL(batch);
+        fill(*batch, i + 1, i * 10);
+        TEST_ASSERT_TRUE(queue.push(batch));
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, queue.pending());
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        auto *batch = queue.read();
+        TEST_ASSERT_NOT_NULL(batch);
+        TEST_ASSERT_EQUAL_UINT8(i + 1, batch->count);
+        for (uint8_t j = 0; j < batch->count; j++)
+            TEST_ASSERT_EQUAL_UINT8(i * 10 + j, batch->commands[j].id);
+        queue.release(batch);
+    }
+    TEST_ASSERT_NULL(queue.read());
+}
+
+void test_slots_are_bounded()
+{
+    batch_queue queue;
+    batch_queue::batch *taken[4];
+    for (auto &batch : taken)
+    {
+        batch = queue.acquire();
+        TEST_ASSERT_NOT_NULL(batch);
+    }
+    TEST_ASSERT_NULL(queue.acquire());
+    TEST_ASSERT_FALSE(queue.push(nullptr));
+    TEST_ASSERT_EQUAL_UINT32(1, queue.stats().dropped);
+
+    // decoding failed -> slot goes back without being seen by the consumer
+    queue.release(taken[0]);
+    auto *batch = queue.acquire();
+    TEST_ASSERT_NOT_NULL(batch);
+    TEST_ASSERT_EQUAL_UINT8(0, batch->count);
+    TEST_ASSERT_NULL(queue.read());
+}
+
+void test_producers_and_consumer()
+{
+    static batch_queue queue;
+    constexpr uint32_t PER_PRODUCER = 20000U;
+    std::atomic<bool> running{true};
+    std::atomic<uint32_t> pushed{0};
+
+    std::vector<std::thread> producers;
+    for (uint8_t p = 0; p < 2; p++)
+    {
+        producers.emplace_back([&pushed, p]() {
+            for (uint32_t i = 0; i < PER_PRODUCER; i++)
+            {
+                auto *batch = queue.acquire();
+                if (!batch)
+                    continue;
+                // every command of a batch carries the same marker -> a torn batch would show
+                fill(*batch, PRESET, 0);
+                for (uint8_t j = 0; j < PRESET; j++)
+                    batch->commands[j].target = p;
+                pushed += queue.push(batch);
+            }
+        });
+    }
+
+    uint32_t read = 0;
+    uint32_t torn = 0;
+    std::thread consumer([&running, &read, &torn]() {
+        while (running || queue.pending())
+        {
+            auto *batch = queue.read();
+            if (!batch)
+                continue;
+            for (uint8_t j = 1; j < batch->count; j++)
+                torn += batch->commands[j].target != batch->commands[0].target;
+            torn += batch->count != PRESET;
+            read++;
+            queue.release(batch);
+        }
+    });
+
+    for (auto &producer : producers)
+        producer.join();
+    running = false;
+    consumer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(pushed.load(), read);
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+}
+
+// ================
+// BENCHMARK
+// ================
+
+constexpr uint32_t ITERATIONS = 200000U;
+
+void benchmark_against_single_commands()
+{
+    static command_queue::command_queue<16> singles;
+    static batch_queue batches;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        for (uint8_t j = 0; j < PRESET; j++)
+        {
+            auto *command = singles.acquire();
+            command->controller = 2;
+            command->id = j;
+            command->set_lane(command_queue::priority::BULK);
+            singles.push(command);
+        }
+        while (auto *command = singles.read())
+            singles.release(command);
+    }
+    auto single = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        auto *batch = batches.acquire();
+        fill(*batch, PRESET, 0);
+        batches.push(batch);
+        batches.release(batches.read());
+    }
+    auto batched = std::chrono::steady_clock::now() - start;
+
+    auto ns = [](std::chrono::steady_clock::duration time) {
+        return (long long)(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() / ITERATIONS);
+    };
+    printf("[benchmark] preset of %u commands: one by one %lld ns, as a batch %lld ns\n", PRESET, ns(single), ns(batched));
+    TEST_ASSERT_EQUAL_UINT32(ITERATIONS, batches.stats().pushed);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_batches_keep_their_order);
+    RUN_TEST(test_slots_are_bounded);
+    RUN_TEST(test_producers_and_consumer);
+    RUN_TEST(benchmark_against_single_commands);
+    return UNITY_END();
+}
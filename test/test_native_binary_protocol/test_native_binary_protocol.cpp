@@ -0,0 +1,200 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "controllers/abstract/command_table.hpp"
+
+// ================
+// same table as engines_controller and a command for every other codec
+// ================
+
+class car
+{
+public:
+    bool drive(const commands::command &) { return true; }
+
+    static constexpr auto COMMANDS = json_parser::make_command_table<car>({
+        {"forward", &car::drive, commands::codecs::ENGINE, nullptr, command_queue::priority::CONTROL},
+        {"backward", &car::drive, commands::codecs::ENGINE, nullptr, command_queue::priority::CONTROL},
+        {"stop", &car::drive, commands::codecs::ENGINE, nullptr, command_queue::priority::SAFETY},
+        {"faster", &car::drive, commands::codecs::ENGINE, nullptr, command_queue::priority::CONTROL},
+        {"slower", &car::drive, commands::codecs::ENGINE, nullptr, command_queue::priority::CONTROL},
+        {"keep_speed", &car::drive, commands::codecs::ENGINE, nullptr, command_queue::priority::CONTROL},
+        {"speed", &car::drive, commands::codecs::ENGINE_SPEED, nullptr, command_queue::priority::CONTROL, true},
+        {"rotate", &car::drive, commands::codecs::ENGINE, nullptr, command_queue::priority::CONTROL},
+        {"color", &car::drive, commands::codecs::COLOR, nullptr, command_queue::priority::BULK, true},
+        {"volume", &car::drive, commands::codecs::OPTIONAL_VALUE, "volume", command_queue::priority::BULK},
+        {"execute", &car::drive, commands::codecs::FILE_NAME, "file"},
+        {"get", &car::drive},
+    });
+};
+
+constexpr uint8_t STOP = 2U;
+constexpr uint8_t SPEED = 6U;
+constexpr uint8_t COLOR = 8U;
+constexpr uint8_t VOLUME = 9U;
+constexpr uint8_t EXECUTE = 10U;
+constexpr uint8_t GET = 11U;
+
+// what templated_controller::decode does with a json message
+bool decode_json(const char *text, commands::command &command)
+{
+    StaticJsonDocument<256> json;
+    if (deserializeJson(json, text))
+        return false;
+
+    auto index = car::COMMANDS.find(json["command"]);
+    if (index == car::COMMANDS.NOT_FOUND)
+        return false;
+
+    const auto &entry = car::COMMANDS[index];
+    command.id = static_cast<uint8_t>(index);
+    command.set_lane(entry.lane);
+    if (!entry.codec.decode(json.as<JsonObject>(), entry.key, command))
+        return false;
+    if (!entry.coalesced)
+        command.target = commands::NO_TARGET;
+    return true;
+}
+
+bool decode_binary(const uint8_t *data, size_t length, commands::command &command)
+{
+    return car::COMMANDS.decode_binary(data, length, command);
+}
+
+// both forms of the same command
+struct message
+{
+    const char *json;
+    uint8_t binary[16];
+    size_t length;
+};
+
+const message MESSAGES[] = {
+    {"{\"controller\":\"engines\",\"command\":\"stop\",\"engine\":\"both\"}", {STOP, commands::BOTH}, 2},
+    {"{\"controller\":\"engines\",\"command\":\"speed\",\"engine\":\"left\",\"speed\":1000}", {SPEED, commands::LEFT, 0xE8, 0x03}, 4},
+    {"{\"controller\":\"leds\",\"command\":\"color\",\"index\":7,\"colors\":[255,128,0]}", {COLOR, 7, 255, 128, 0}, 5},
+    {"{\"controller\":\"mp3\",\"command\":\"volume\",\"volume\":70000}", {VOLUME, 0x70, 0x11, 0x01, 0x00}, 5},
+    {"{\"controller\":\"mp3\",\"command\":\"volume\"}", {VOLUME}, 1},
+    {"{\"controller\":\"sd\",\"command\":\"execute\",\"file\":\"dance.txt\"}", {EXECUTE, 'd', 'a', 'n', 'c', 'e', '.', 't', 'x', 't'}, 10},
+    {"{\"controller\":\"config\",\"command\":\"get\"}", {GET}, 1},
+};
+constexpr size_t MESSAGES_COUNT = sizeof(MESSAGES) / sizeof(MESSAGES[0]);
+
+// ================
+// TESTS
+// ================
+
+void test_binary_decodes_the_same_command_as_json()
+{
+    for (size_t i = 0; i < MESSAGES_COUNT; i++)
+    {
+        commands::command from_json;
+        commands::command from_binary;
+        memset(&from_json, 0, sizeof(from_json));
+        memset(&from_binary, 0, sizeof(from_binary));
+
+        TEST_ASSERT_TRUE_MESSAGE(decode_json(MESSAGES[i].json, from_json), MESSAGES[i].json);
+        TEST_ASSERT_TRUE_MESSAGE(decode_binary(MESSAGES[i].binary, MESSAGES[i].length, from_binary), MESSAGES[i].json);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(&from_json, &from_binary, sizeof(commands::command), MESSAGES[i].json);
+    }
+}
+
+void test_arguments_are_little_endian()
+{
+    commands::command command{};
+    const uint8_t speed[] = {SPEED, commands::RIGHT, 0x34, 0x12};
+    TEST_ASSERT_TRUE(decode_binary(speed, sizeof(speed), command));
+    TEST_ASSERT_EQUAL_UINT16(0x1234, command.args.engine.speed);
+    TEST_ASSERT_EQUAL_UINT8(commands::RIGHT, command.target);
+    TEST_ASSERT_EQUAL(command_queue::priority::CONTROL, command.lane());
+
+    const uint8_t volume[] = {VOLUME, 0x78, 0x56, 0x34, 0x12};
+    TEST_ASSERT_TRUE(decode_binary(volume, sizeof(volume), command));
+    TEST_ASSERT_TRUE(command.args.value.present);
+    TEST_ASSERT_EQUAL_UINT32(0x12345678, command.args.value.value);
+}
+
+void test_invalid_messages_are_rejected()
+{
+    commands::command command{};
+    const uint8_t unknown[] = {12};
+    const uint8_t no_sides[] = {STOP, 0};
+    const uint8_t bad_sides[] = {STOP, 4};
+    const uint8_t short_speed[] = {SPEED, commands::LEFT, 1};
+    const uint8_t long_stop[] = {STOP, commands::BOTH, 0};
+    const uint8_t short_color[] = {COLOR, 1, 2, 3};
+    const uint8_t short_volume[] = {VOLUME, 1, 2};
+    const uint8_t empty_file[] = {EXECUTE};
+    const uint8_t long_file[] = {EXECUTE, 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l'};
+    const uint8_t zero_in_file[] = {EXECUTE, 'a', 0, 'b'};
+    const uint8_t get_with_args[] = {GET, 1};
+
+    TEST_ASSERT_FALSE(decode_binary(nullptr, 0, command));
+    TEST_ASSERT_FALSE(decode_binary(unknown, sizeof(unknown), command));
+    TEST_ASSERT_FALSE(decode_binary(no_sides, sizeof(no_sides), command));
+    TEST_ASSERT_FALSE(decode_binary(bad_sides, sizeof(bad_sides), command));
+    TEST_ASSERT_FALSE(decode_binary(short_speed, sizeof(short_speed), command));
+    TEST_ASSERT_FALSE(decode_binary(long_stop, sizeof(long_stop), command));
+    TEST_ASSERT_FALSE(decode_binary(short_color, sizeof(short_color), command));
+    TEST_ASSERT_FALSE(decode_binary(short_volume, sizeof(short_volume), command));
+    TEST_ASSERT_FALSE(decode_binary(empty_file, sizeof(empty_file), command));
+    TEST_ASSERT_FALSE(decode_binary(long_file, sizeof(long_file), command));
+    TEST_ASSERT_FALSE(decode_binary(zero_in_file, sizeof(zero_in_file), command));
+    TEST_ASSERT_FALSE(decode_binary(get_with_args, sizeof(get_with_args), command));
+}
+
+// ================
+// BENCHMARK
+// ================
+
+constexpr uint32_t ITERATIONS = 200000U;
+
+void benchmark_binary_against_json()
+{
+    size_t json_bytes = 0;
+    size_t binary_bytes = 0;
+    uint32_t decoded = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        commands::command command{};
+        const auto &message = MESSAGES[i % MESSAGES_COUNT];
+        decoded += decode_json(message.json, command);
+        json_bytes += strlen(message.json);
+    }
+    auto json = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        commands::command command{};
+        const auto &message = MESSAGES[i % MESSAGES_COUNT];
+        decoded += decode_binary(message.binary, message.length, command);
+        // controller byte, the table above is a single controller
+        binary_bytes += message.length + 1U;
+    }
+    auto binary = std::chrono::steady_clock::now() - start;
+
+    auto ns = [](std::chrono::steady_clock::duration time) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() / (double)ITERATIONS;
+    };
+    auto per_second = [&ns](std::chrono::steady_clock::duration time) { return 1e9 / ns(time); };
+    printf("[benchmark] json: %.1f ns/command, %.0f commands/s, %u B avg | binary: %.1f ns/command, %.0f commands/s, %u B avg\n",
+           ns(json), per_second(json), (unsigned)(json_bytes / ITERATIONS),
+           ns(binary), per_second(binary), (unsigned)(binary_bytes / ITERATIONS));
+    TEST_ASSERT_EQUAL_UINT32(2 * ITERATIONS, decoded);
+    TEST_ASSERT_TRUE(binary < json);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_binary_decodes_the_same_command_as_json);
+    RUN_TEST(test_arguments_are_little_endian);
+    RUN_TEST(test_invalid_messages_are_rejected);
+    RUN_TEST(benchmark_binary_against_json);
+    return UNITY_END();
+}
@@ -0,0 +1,602 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "command_queue/command_queue.hpp"
+#include "command_queue/drainer.hpp"
+
+// ================
+// allocation tracking -> every heap allocation made by the process is counted
+// ================
+
+std::atomic<uint32_t> allocations{0};
+std::atomic<uint32_t> live_allocations{0};
+std::atomic<uint32_t> peak_live_allocations{0};
+
+void *operator new(size_t size)
+{
+    allocations++;
+    uint32_t live = ++live_allocations;
+    uint32_t peak = peak_live_allocations.load();
+    while (live > peak && !peak_live_allocations.compare_exchange_weak(peak, live))
+        ;
+    void *ptr = malloc(size);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (ptr)
+        live_allocations--;
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void reset_allocations()
+{
+    allocations = 0;
+    peak_live_allocations = live_allocations.load();
+}
+
+// ================
+// previous implementation -> heap document + mutex + 10 deep queue
+// ================
+
+class legacy_queue
+{
+public:
+    bool push(DynamicJsonDocument **json)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_queue.size() >= DEPTH)
+            return false;
+        _queue.push(*json);
+        return true;
+    }
+
+    bool read(DynamicJsonDocument **json)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_queue.empty())
+            return false;
+        *json = _queue.front();
+        _queue.pop();
+        return true;
+    }
+
+private:
+    static constexpr size_t DEPTH = 10U;
+    std::mutex _mutex;
+    std::queue<DynamicJsonDocument *> _queue;
+};
+
+typedef command_queue::command_queue<16> test_queue;
+typedef commands::command command;
+
+// indexes the parser and the command tables would give them
+constexpr uint8_t ENGINES = 0U;
+constexpr uint8_t ARM = 1U;
+constexpr uint8_t LEDS = 2U;
+constexpr uint8_t STOP = 0U;
+constexpr uint8_t SPEED = 7U;
+constexpr uint8_t ANGLE = 1U;
+constexpr uint8_t SERVO_STOP = 2U;
+constexpr uint8_t CUSTOM_COLOR = 4U;
+constexpr uint8_t BASE = 0U;
+constexpr uint8_t SHOULDER = 1U;
+constexpr uint8_t CLAW = 4U;
+
+const char *MESSAGE = "{\"controller\":\"engines\",\"command\":\"speed\",\"engine\":\"both\",\"speed\":512}";
+constexpr uint32_t ITERATIONS = 100000U;
+
+// ================
+// TESTS
+// ================
+
+void test_fifo_order()
+{
+    test_queue queue;
+    for (int i = 0; i < 3; i++)
+    {
+        auto *cmd = queue.acquire();
+        TEST_ASSERT_NOT_NULL(cmd);
+        cmd->args.value.value = i;
+        TEST_ASSERT_TRUE(queue.push(cmd));
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, queue.pending());
+
+    for (int i = 0; i < 3; i++)
+    {
+        auto *cmd = queue.read();
+        TEST_ASSERT_NOT_NULL(cmd);
+        TEST_ASSERT_EQUAL_UINT32(i, cmd->args.value.value);
+        queue.release(cmd);
+    }
+    TEST_ASSERT_NULL(queue.read());
+    TEST_ASSERT_EQUAL_UINT32(0, queue.pending());
+}
+
+void test_pool_exhaustion()
+{
+    test_queue queue;
+    std::vector<command *> taken;
+    for (size_t i = 0; i < test_queue::depth(); i++)
+    {
+        auto *cmd = queue.acquire();
+        TEST_ASSERT_NOT_NULL(cmd);
+        taken.push_back(cmd);
+    }
+
+    // every slot is taken
+    TEST_ASSERT_NULL(queue.acquire());
+    TEST_ASSERT_EQUAL_UINT32(1, queue.stats().dropped);
+    TEST_ASSERT_EQUAL_UINT32(test_queue::depth(), queue.stats().in_use);
+
+    queue.release(taken.back());
+    TEST_ASSERT_NOT_NULL(queue.acquire());
+}
+
+void test_multiple_producers()
+{
+    constexpr int PRODUCERS = 4;
+    constexpr int MESSAGES = 5000;
+
+    test_queue queue;
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < PRODUCERS; producer++)
+    {
+        producers.emplace_back([&queue, producer]() {
+            for (int i = 0; i < MESSAGES; i++)
+            {
+                // lossless producer -> retries until the lane accepts the message
+                for (;;)
+                {
+                    auto *cmd = queue.acquire();
+                    if (cmd)
+                    {
+                        cmd->controller = producer;
+                        cmd->args.value.value = i;
+                        if (queue.push(cmd))
+                            break;
+                    }
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // every producer's messages have to come out in the order they went in
+    int next_index[PRODUCERS] = {0};
+    int received = 0;
+    bool in_order = true;
+    while (received < PRODUCERS * MESSAGES)
+    {
+        auto *cmd = queue.read();
+        if (!cmd)
+            continue;
+        int producer = cmd->controller;
+        int index = cmd->args.value.value;
+        in_order &= next_index[producer] == index;
+        next_index[producer] = index + 1;
+        queue.release(cmd);
+        received++;
+    }
+
+    for (auto &producer : producers)
+        producer.join();
+
+    TEST_ASSERT_TRUE(in_order);
+    TEST_ASSERT_NULL(queue.read());
+    TEST_ASSERT_EQUAL_UINT32(PRODUCERS * MESSAGES, queue.stats().pushed);
+    TEST_ASSERT_EQUAL_UINT32(0, queue.stats().in_use);
+}
+
+command *fill(command *cmd, uint8_t controller, uint8_t id, command_queue::priority lane, uint8_t target = commands::NO_TARGET)
+{
+    cmd->controller = controller;
+    cmd->id = id;
+    cmd->target = target;
+    cmd->set_lane(lane);
+    return cmd;
+}
+
+bool is_stop(const command *cmd)
+{
+    return cmd->controller == ENGINES && cmd->id == STOP;
+}
+
+void test_meta_bits()
+{
+    command cmd{};
+    TEST_ASSERT_EQUAL(command_queue::priority::SAFETY, cmd.lane());
+    TEST_ASSERT_EQUAL(commands::origin::NETWORK, cmd.source());
+
+    // lane and origin share a byte without stepping on each other
+    cmd.set_source(commands::origin::INTERNAL);
+    cmd.set_lane(command_queue::priority::BULK);
+    TEST_ASSERT_EQUAL(command_queue::priority::BULK, cmd.lane());
+    TEST_ASSERT_EQUAL(commands::origin::INTERNAL, cmd.source());
+    cmd.set_lane(command_queue::priority::CONTROL);
+    cmd.set_source(commands::origin::SCRIPT);
+    TEST_ASSERT_EQUAL(command_queue::priority::CONTROL, cmd.lane());
+    TEST_ASSERT_EQUAL(commands::origin::SCRIPT, cmd.source());
+}
+
+void test_safety_lane_goes_first()
+{
+    test_queue queue;
+    // bulk flood until its quota is used up
+    uint32_t accepted = 0;
+    for (size_t i = 0; i < test_queue::depth(); i++)
+    {
+        auto *cmd = queue.acquire();
+        fill(cmd, LEDS, CUSTOM_COLOR, command_queue::priority::BULK);
+        accepted += queue.push(cmd);
+    }
+    TEST_ASSERT_EQUAL_UINT32(test_queue::quota(command_queue::priority::BULK), accepted);
+    TEST_ASSERT_EQUAL_UINT32(test_queue::depth() - accepted, queue.stats(command_queue::priority::BULK).dropped);
+
+    // stop still gets a slot and is read before the whole backlog
+    auto *cmd = queue.acquire();
+    TEST_ASSERT_NOT_NULL(cmd);
+    fill(cmd, ENGINES, STOP, command_queue::priority::SAFETY);
+    TEST_ASSERT_TRUE(queue.push(cmd));
+
+    cmd = queue.read();
+    TEST_ASSERT_TRUE(is_stop(cmd));
+    queue.release(cmd);
+    TEST_ASSERT_EQUAL_UINT32(accepted, queue.stats(command_queue::priority::BULK).depth);
+    TEST_ASSERT_EQUAL_UINT32(0, queue.stats(command_queue::priority::SAFETY).depth);
+    TEST_ASSERT_EQUAL_UINT32(accepted, queue.pending());
+}
+
+void test_stop_latency_under_flood()
+{
+    constexpr int STOPS = 200;
+
+    test_queue queue;
+    std::atomic<bool> running{true};
+    std::thread flood([&queue, &running]() {
+        while (running)
+        {
+            auto *cmd = queue.acquire();
+            if (!cmd)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            queue.push(fill(cmd, LEDS, CUSTOM_COLOR, command_queue::priority::BULK));
+        }
+    });
+
+    // consumer drains the flood, every time a stop shows up in the queue
+    // at most the message being handled at that moment can be in front of it
+    uint32_t worst_wait = 0;
+    for (int i = 0; i < STOPS; i++)
+    {
+        command *stop;
+        while (!(stop = queue.acquire()))
+        {
+            auto *cmd = queue.read();
+            if (cmd)
+                queue.release(cmd);
+        }
+        fill(stop, ENGINES, STOP, command_queue::priority::SAFETY);
+        TEST_ASSERT_TRUE(queue.push(stop));
+
+        uint32_t waited = 0;
+        for (;;)
+        {
+            auto *cmd = queue.read();
+            if (!cmd)
+                continue;
+            bool stopped = is_stop(cmd);
+            queue.release(cmd);
+            if (stopped)
+                break;
+            waited++;
+        }
+        if (waited > worst_wait)
+            worst_wait = waited;
+    }
+    running = false;
+    flood.join();
+
+    printf("[benchmark] worst stop wait under bulk flood: %u messages\n", worst_wait);
+    TEST_ASSERT_EQUAL_UINT32(0, worst_wait);
+    TEST_ASSERT_EQUAL_UINT32(0, queue.stats(command_queue::priority::SAFETY).dropped);
+}
+
+bool push_angle(test_queue &queue, uint8_t servo, int angle)
+{
+    auto *cmd = queue.acquire();
+    if (!cmd)
+        return false;
+    fill(cmd, ARM, ANGLE, command_queue::priority::CONTROL, servo);
+    cmd->args.servo.servo = servo;
+    cmd->args.servo.angle = angle;
+    return queue.push(cmd);
+}
+
+void test_coalescing_keys()
+{
+    command cmd{};
+    fill(&cmd, ARM, ANGLE, command_queue::priority::CONTROL);
+    // no target -> command table didn't mark it as a setpoint
+    TEST_ASSERT_EQUAL_UINT32(command_queue::NOT_COALESCED, command_queue::coalescing_key(cmd));
+    cmd.target = BASE;
+    uint32_t base = command_queue::coalescing_key(cmd);
+    cmd.target = CLAW;
+    uint32_t claw = command_queue::coalescing_key(cmd);
+    TEST_ASSERT_TRUE(base != command_queue::NOT_COALESCED);
+    TEST_ASSERT_TRUE(base != claw);
+
+    // same target of another command or controller is something else
+    fill(&cmd, LEDS, CUSTOM_COLOR, command_queue::priority::BULK, 3);
+    uint32_t third = command_queue::coalescing_key(cmd);
+    cmd.target = 4;
+    TEST_ASSERT_TRUE(third != command_queue::coalescing_key(cmd));
+    fill(&cmd, LEDS, ANGLE, command_queue::priority::BULK, 3);
+    TEST_ASSERT_TRUE(third != command_queue::coalescing_key(cmd));
+    fill(&cmd, ENGINES, CUSTOM_COLOR, command_queue::priority::BULK, 3);
+    TEST_ASSERT_TRUE(third != command_queue::coalescing_key(cmd));
+}
+
+void test_latest_wins()
+{
+    test_queue queue;
+    queue.set_coalescing(true);
+    for (int angle = 0; angle < 100; angle++)
+    {
+        TEST_ASSERT_TRUE(push_angle(queue, BASE, angle));
+        TEST_ASSERT_TRUE(push_angle(queue, CLAW, 100 - angle));
+    }
+
+    auto lane = queue.stats(command_queue::priority::CONTROL);
+    TEST_ASSERT_EQUAL_UINT32(2, lane.depth);
+    TEST_ASSERT_EQUAL_UINT32(198, lane.coalesced);
+    TEST_ASSERT_EQUAL_UINT32(0, lane.dropped);
+    TEST_ASSERT_EQUAL_UINT32(2, queue.stats().in_use);
+
+    // order of the first messages is kept, values are the newest ones
+    auto *cmd = queue.read();
+    TEST_ASSERT_EQUAL_UINT8(BASE, cmd->args.servo.servo);
+    TEST_ASSERT_EQUAL_UINT8(99, cmd->args.servo.angle);
+    queue.release(cmd);
+    cmd = queue.read();
+    TEST_ASSERT_EQUAL_UINT8(CLAW, cmd->args.servo.servo);
+    TEST_ASSERT_EQUAL_UINT8(1, cmd->args.servo.angle);
+    queue.release(cmd);
+    TEST_ASSERT_NULL(queue.read());
+}
+
+command *read_one(test_queue &queue, uint8_t id, uint8_t target)
+{
+    auto *cmd = queue.read();
+    TEST_ASSERT_NOT_NULL(cmd);
+    TEST_ASSERT_EQUAL_UINT8(id, cmd->id);
+    TEST_ASSERT_EQUAL_UINT8(target, cmd->target);
+    return cmd;
+}
+
+void test_coalescing_keeps_order()
+{
+    test_queue queue;
+    queue.set_coalescing(true);
+    // angle -> stop -> angle, the last angle can't jump in front of the stop
+    TEST_ASSERT_TRUE(push_angle(queue, BASE, 10));
+    auto *stop = queue.acquire();
+    fill(stop, ARM, SERVO_STOP, command_queue::priority::CONTROL);
+    stop->args.servo.servo = BASE;
+    TEST_ASSERT_TRUE(queue.push(stop));
+    TEST_ASSERT_TRUE(push_angle(queue, BASE, 20));
+    TEST_ASSERT_EQUAL_UINT32(0, queue.stats(command_queue::priority::CONTROL).coalesced);
+
+    auto *cmd = read_one(queue, ANGLE, BASE);
+    TEST_ASSERT_EQUAL_UINT8(10, cmd->args.servo.angle);
+    queue.release(cmd);
+    queue.release(read_one(queue, SERVO_STOP, commands::NO_TARGET));
+    cmd = read_one(queue, ANGLE, BASE);
+    TEST_ASSERT_EQUAL_UINT8(20, cmd->args.servo.angle);
+    queue.release(cmd);
+    TEST_ASSERT_NULL(queue.read());
+
+    // both sides -> left -> both sides, left overlaps both of them
+    for (uint8_t sides : {commands::BOTH, commands::LEFT, commands::BOTH})
+    {
+        auto *speed = queue.acquire();
+        fill(speed, ENGINES, SPEED, command_queue::priority::CONTROL, sides);
+        TEST_ASSERT_TRUE(queue.push(speed));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, queue.stats(command_queue::priority::CONTROL).coalesced);
+    queue.release(read_one(queue, SPEED, commands::BOTH));
+    queue.release(read_one(queue, SPEED, commands::LEFT));
+    queue.release(read_one(queue, SPEED, commands::BOTH));
+
+    // other servo in between -> still latest wins
+    TEST_ASSERT_TRUE(push_angle(queue, BASE, 30));
+    TEST_ASSERT_TRUE(push_angle(queue, CLAW, 40));
+    TEST_ASSERT_TRUE(push_angle(queue, BASE, 50));
+    TEST_ASSERT_EQUAL_UINT32(1, queue.stats(command_queue::priority::CONTROL).coalesced);
+    cmd = read_one(queue, ANGLE, BASE);
+    TEST_ASSERT_EQUAL_UINT8(50, cmd->args.servo.angle);
+    queue.release(cmd);
+    queue.release(read_one(queue, ANGLE, CLAW));
+    TEST_ASSERT_NULL(queue.read());
+}
+
+uint32_t slider_drops(bool coalescing)
+{
+    // two sliders dragged at ~200 msgs/s each, main loop busy for 50 ms between reads
+    test_queue queue;
+    queue.set_coalescing(coalescing);
+    std::atomic<bool> running{true};
+    std::atomic<int> last_angle{0};
+    std::thread slider([&queue, &running, &last_angle]() {
+        int angle = 0;
+        while (running)
+        {
+            angle = (angle + 1) % 180;
+            push_angle(queue, BASE, angle);
+            push_angle(queue, SHOULDER, angle);
+            last_angle = angle;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+
+    int last = -1;
+    for (int i = 0; i <= 10; i++)
+    {
+        if (i == 10)
+        {
+            running = false;
+            slider.join();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+
+        while (auto *cmd = queue.read())
+        {
+            last = cmd->args.servo.angle;
+            queue.release(cmd);
+        }
+    }
+
+    // the last applied angle has to be the position the slider stopped at
+    if (coalescing)
+        TEST_ASSERT_EQUAL_INT(last_angle.load(), last);
+
+    return queue.stats(command_queue::priority::CONTROL).dropped + queue.stats().dropped;
+}
+
+void test_slider_traffic_does_not_overflow()
+{
+    uint32_t without = slider_drops(false);
+    uint32_t with = slider_drops(true);
+    printf("[benchmark] slider traffic drops: %u without coalescing, %u with\n", without, with);
+    TEST_ASSERT_GREATER_THAN(0, without);
+    TEST_ASSERT_EQUAL_UINT32(0, with);
+}
+
+// every message handled moves the fake clock forward
+uint32_t fake_time = 0;
+uint32_t fake_clock() { return fake_time; }
+
+void test_drain_whole_burst()
+{
+    test_queue queue;
+    command_queue::drainer<test_queue> drain(queue, fake_clock, 1000);
+    for (int i = 0; i < 10; i++)
+        push_angle(queue, BASE, i);
+
+    uint32_t handled = drain.run([](const command &) { fake_time += 50; });
+    TEST_ASSERT_EQUAL_UINT32(10, handled);
+    TEST_ASSERT_EQUAL_UINT32(10, drain.stats().drained);
+    TEST_ASSERT_EQUAL_UINT32(500, drain.stats().time_us);
+    TEST_ASSERT_EQUAL_UINT32(0, drain.stats().overruns);
+    TEST_ASSERT_NULL(queue.read());
+
+    // empty pass doesn't touch the maximums
+    TEST_ASSERT_EQUAL_UINT32(0, drain.run([](const command &) {}));
+    TEST_ASSERT_EQUAL_UINT32(2, drain.stats().passes);
+    TEST_ASSERT_EQUAL_UINT32(10, drain.stats().max_drained);
+}
+
+void test_drain_respects_budget()
+{
+    test_queue queue;
+    command_queue::drainer<test_queue> drain(queue, fake_clock, 1000);
+    for (int i = 0; i < 10; i++)
+        push_angle(queue, BASE, i);
+
+    // 300 us each -> 4th message crosses the budget, the rest waits for the next pass
+    TEST_ASSERT_EQUAL_UINT32(4, drain.run([](const command &) { fake_time += 300; }));
+    TEST_ASSERT_EQUAL_UINT32(1200, drain.stats().time_us);
+    TEST_ASSERT_EQUAL_UINT32(1, drain.stats().overruns);
+    TEST_ASSERT_EQUAL_UINT32(6, queue.stats(command_queue::priority::CONTROL).depth);
+
+    // budget smaller than a single message still moves the queue forward
+    drain.set_budget(0);
+    TEST_ASSERT_EQUAL_UINT32(1, drain.run([](const command &) { fake_time += 300; }));
+    TEST_ASSERT_EQUAL_UINT32(2, drain.stats().overruns);
+    TEST_ASSERT_EQUAL_UINT32(5, drain.stats().total_drained);
+}
+
+void benchmark_against_legacy_queue()
+{
+    legacy_queue legacy;
+    reset_allocations();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        DynamicJsonDocument *json = new DynamicJsonDocument(256);
+        deserializeJson(*json, MESSAGE);
+        if (!legacy.push(&json))
+            delete json;
+        if (legacy.read(&json))
+            delete json;
+    }
+    auto legacy_time = std::chrono::steady_clock::now() - start;
+    uint32_t legacy_allocations = allocations;
+
+    static test_queue queue;
+    reset_allocations();
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        // message is parsed on the stack and only the decoded command is queued
+        StaticJsonDocument<256> json;
+        deserializeJson(json, MESSAGE);
+        auto *cmd = queue.acquire();
+        fill(cmd, ENGINES, SPEED, command_queue::priority::CONTROL, commands::BOTH);
+        cmd->args.engine.sides = commands::BOTH;
+        cmd->args.engine.speed = json["speed"];
+        queue.push(cmd);
+        cmd = queue.read();
+        queue.release(cmd);
+    }
+    auto ring_time = std::chrono::steady_clock::now() - start;
+    uint32_t ring_allocations = allocations;
+
+    auto legacy_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(legacy_time).count() / ITERATIONS;
+    auto ring_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(ring_time).count() / ITERATIONS;
+    printf("[benchmark] legacy queue: %lld ns per push/pop, %u allocations\n", (long long)legacy_ns, legacy_allocations);
+    printf("[benchmark] pooled ring:  %lld ns per push/pop, %u allocations\n", (long long)ring_ns, ring_allocations);
+
+    // pooled ring never touches the heap, so it cannot fragment it
+    TEST_ASSERT_EQUAL_UINT32(0, ring_allocations);
+    TEST_ASSERT_GREATER_OR_EQUAL(ITERATIONS, legacy_allocations);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fifo_order);
+    RUN_TEST(test_pool_exhaustion);
+    RUN_TEST(test_multiple_producers);
+    RUN_TEST(test_meta_bits);
+    RUN_TEST(test_safety_lane_goes_first);
+    RUN_TEST(test_stop_latency_under_flood);
+    RUN_TEST(test_coalescing_keys);
+    RUN_TEST(test_latest_wins);
+    RUN_TEST(test_coalescing_keeps_order);
+    RUN_TEST(test_slider_traffic_does_not_overflow);
+    RUN_TEST(test_drain_whole_burst);
+    RUN_TEST(test_drain_respects_budget);
+    RUN_TEST(benchmark_against_legacy_queue);
+    return UNITY_END();
+}
@@ -0,0 +1,138 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "controllers/abstract/command_table.hpp"
+
+// ================
+// same shape as mp3_controller -> 28 commands
+// ================
+
+class jukebox
+{
+public:
+    bool play(const commands::command &) { return ++_played; }
+    bool stop(const commands::command &) { return ++_stopped; }
+    uint32_t played() const { return _played; }
+    uint32_t stopped() const { return _stopped; }
+
+    static constexpr const char *NAMES[] = {
+        "windows_xp", "mighty_polish_tank", "high_ground", "fine_addition", "i_dont_like_sand",
+        "hello_there", "im_the_senate", "forever_young", "revenge", "silhouette",
+        "the_bad_touch", "hero", "gas_gas_gas", "running_in_the_90s", "deja_vu",
+        "running_in_the_90s_short", "deja_vu_short", "true_survivor", "propaganda", "giorno",
+        "noble_pope", "torture_dance", "awaken", "dio_vs_jotaro", "error", "stop", "volume", "resume"};
+
+    static constexpr auto COMMANDS = json_parser::make_command_table<jukebox>({
+        {NAMES[0], &jukebox::play}, {NAMES[1], &jukebox::play}, {NAMES[2], &jukebox::play},
+        {NAMES[3], &jukebox::play}, {NAMES[4], &jukebox::play}, {NAMES[5], &jukebox::play},
+        {NAMES[6], &jukebox::play}, {NAMES[7], &jukebox::play}, {NAMES[8], &jukebox::play},
+        {NAMES[9], &jukebox::play}, {NAMES[10], &jukebox::play}, {NAMES[11], &jukebox::play},
+        {NAMES[12], &jukebox::play}, {NAMES[13], &jukebox::play}, {NAMES[14], &jukebox::play},
+        {NAMES[15], &jukebox::play}, {NAMES[16], &jukebox::play}, {NAMES[17], &jukebox::play},
+        {NAMES[18], &jukebox::play}, {NAMES[19], &jukebox::play}, {NAMES[20], &jukebox::play},
+        {NAMES[21], &jukebox::play}, {NAMES[22], &jukebox::play}, {NAMES[23], &jukebox::play},
+        {NAMES[24], &jukebox::play}, {NAMES[25], &jukebox::stop, commands::codecs::NONE, nullptr, command_queue::priority::SAFETY},
+        {NAMES[26], &jukebox::play, commands::codecs::VALUE, "volume", command_queue::priority::BULK, true},
+        {NAMES[27], &jukebox::play},
+    });
+
+private:
+    uint32_t _played = 0;
+    uint32_t _stopped = 0;
+};
+
+constexpr size_t NAMES_COUNT = sizeof(jukebox::NAMES) / sizeof(jukebox::NAMES[0]);
+constexpr uint32_t ITERATIONS = 200000U;
+
+// lookups are resolved by the compiler as well
+// (a duplicated name doesn't compile at all -> call to non-constexpr duplicated_command_name)
+static_assert(jukebox::COMMANDS.size() == NAMES_COUNT, "every command is in the table");
+static_assert(jukebox::COMMANDS.find("stop") == 25, "stop is found");
+static_assert(jukebox::COMMANDS[jukebox::COMMANDS.find("stop")].fun == &jukebox::stop, "entry keeps its handler");
+static_assert(jukebox::COMMANDS[25].lane == command_queue::priority::SAFETY, "entry keeps its lane");
+static_assert(jukebox::COMMANDS[26].coalesced && !jukebox::COMMANDS[0].coalesced, "only volume is coalesced");
+static_assert(jukebox::COMMANDS.find("sto") == json_parser::command_table<jukebox, 1>::NOT_FOUND, "prefix is not a command");
+static_assert(json_parser::command_table<jukebox, 0>().find("stop") < 0, "empty table");
+
+// ================
+// TESTS
+// ================
+
+void test_every_command_is_found()
+{
+    jukebox box;
+    for (size_t i = 0; i < NAMES_COUNT; i++)
+    {
+        // copy -> lookup can't rely on comparing pointers
+        char name[32];
+        strcpy(name, jukebox::NAMES[i]);
+        auto index = jukebox::COMMANDS.find(name);
+        TEST_ASSERT_EQUAL_INT16(i, index);
+        (box.*jukebox::COMMANDS[index].fun)(commands::command{});
+    }
+    // every command but stop plays
+    TEST_ASSERT_EQUAL_UINT32(NAMES_COUNT - 1, box.played());
+    TEST_ASSERT_EQUAL_UINT32(1, box.stopped());
+}
+
+void test_unknown_commands()
+{
+    TEST_ASSERT_LESS_THAN_INT16(0, jukebox::COMMANDS.find(nullptr));
+    TEST_ASSERT_LESS_THAN_INT16(0, jukebox::COMMANDS.find(""));
+    TEST_ASSERT_LESS_THAN_INT16(0, jukebox::COMMANDS.find("heroes"));
+    TEST_ASSERT_LESS_THAN_INT16(0, jukebox::COMMANDS.find("Hero"));
+    TEST_ASSERT_LESS_THAN_INT16(0, jukebox::COMMANDS.find("deja_vu_"));
+}
+
+void benchmark_against_linear_scan()
+{
+    // what templated_controller did before -> vector filled at runtime, strcmp over every entry
+    struct event_data
+    {
+        const char *command;
+        bool (jukebox::*fun)(const commands::command &);
+    };
+    std::vector<event_data> events;
+    for (size_t i = 0; i < NAMES_COUNT; i++)
+        events.push_back({jukebox::NAMES[i], &jukebox::play});
+
+    volatile uint32_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        const char *name = jukebox::NAMES[i % NAMES_COUNT];
+        for (auto &event : events)
+        {
+            if (!strcmp(event.command, name))
+            {
+                found += 1;
+                break;
+            }
+        }
+    }
+    auto linear = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+        found += jukebox::COMMANDS.find(jukebox::NAMES[i % NAMES_COUNT]) >= 0;
+    auto hashed = std::chrono::steady_clock::now() - start;
+
+    auto linear_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(linear).count() / ITERATIONS;
+    auto hashed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(hashed).count() / ITERATIONS;
+    printf("[benchmark] %u commands: linear scan %lld ns, command table %lld ns\n",
+           (unsigned)NAMES_COUNT, (long long)linear_ns, (long long)hashed_ns);
+
+    TEST_ASSERT_EQUAL_UINT32(2 * ITERATIONS, found);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_every_command_is_found);
+    RUN_TEST(test_unknown_commands);
+    RUN_TEST(benchmark_against_linear_scan);
+    return UNITY_END();
+}
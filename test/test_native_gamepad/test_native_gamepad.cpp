@@ -0,0 +1,196 @@
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include "gamepad/mapping.hpp"
+
+using gamepad::event;
+namespace buttons = gamepad::buttons;
+namespace axes = gamepad::axes;
+
+// ================
+// actions are told apart by id, dispatch records them in order
+// ================
+
+uint8_t dispatched[32];
+uint8_t dispatched_count = 0;
+
+void record(const commands::command &command)
+{
+    if (dispatched_count < sizeof(dispatched))
+        dispatched[dispatched_count] = command.id;
+    dispatched_count++;
+}
+
+void reset()
+{
+    dispatched_count = 0;
+}
+
+commands::command action(uint8_t id)
+{
+    commands::command command{};
+    command.id = id;
+    return command;
+}
+
+commands::gamepad_args frame(uint16_t pressed, int8_t a0 = 0, int8_t a1 = 0, int8_t a2 = 0, int8_t a3 = 0)
+{
+    return {pressed, {a0, a1, a2, a3}};
+}
+
+uint16_t bit(uint8_t button) { return static_cast<uint16_t>(1U << button); }
+
+// ================
+// TESTS
+// ================
+
+void test_buttons_run_on_edges_only()
+{
+    reset();
+    gamepad::mapping mapping;
+    TEST_ASSERT_TRUE(mapping.assign(buttons::A, event::PRESSED, action(1)));
+    TEST_ASSERT_TRUE(mapping.assign(buttons::A, event::RELEASED, action(2)));
+    // buttons have no axis events
+    TEST_ASSERT_FALSE(mapping.assign(buttons::A, event::IDLE, action(3)));
+
+    TEST_ASSERT_EQUAL_UINT8(1, mapping.process(frame(bit(buttons::A)), record));
+    // held -> nothing
+    TEST_ASSERT_EQUAL_UINT8(0, mapping.process(frame(bit(buttons::A)), record));
+    // unmapped button changes -> nothing
+    TEST_ASSERT_EQUAL_UINT8(0, mapping.process(frame(bit(buttons::A) | bit(buttons::B)), record));
+    TEST_ASSERT_EQUAL_UINT8(1, mapping.process(frame(0), record));
+
+    TEST_ASSERT_EQUAL_UINT8(2, dispatched_count);
+    TEST_ASSERT_EQUAL_UINT8(1, dispatched[0]);
+    TEST_ASSERT_EQUAL_UINT8(2, dispatched[1]);
+}
+
+void test_axes_run_when_they_change_zone()
+{
+    reset();
+    gamepad::mapping mapping;
+    uint8_t input = gamepad::AXIS_INPUT + axes::LEFT_VERTICAL;
+    mapping.assign(input, event::NEGATIVE, action(1));
+    mapping.assign(input, event::IDLE, action(2));
+    mapping.assign(input, event::POSITIVE, action(3));
+    TEST_ASSERT_FALSE(mapping.assign(input, event::PRESSED, action(4)));
+
+    // inside the pivot -> still idle
+    mapping.process(frame(0, 0, 80), record);
+    TEST_ASSERT_EQUAL_UINT8(0, dispatched_count);
+    mapping.process(frame(0, 0, 100), record);
+    mapping.process(frame(0, 0, 127), record);
+    // straight from one end to the other
+    mapping.process(frame(0, 0, -127), record);
+    mapping.process(frame(0, 0, 10), record);
+
+    TEST_ASSERT_EQUAL_UINT8(3, dispatched_count);
+    TEST_ASSERT_EQUAL_UINT8(3, dispatched[0]);
+    TEST_ASSERT_EQUAL_UINT8(1, dispatched[1]);
+    TEST_ASSERT_EQUAL_UINT8(2, dispatched[2]);
+
+    // smaller pivot -> 80 is out of the middle
+    reset();
+    TEST_ASSERT_TRUE(mapping.set_pivot(axes::LEFT_VERTICAL, 50));
+    TEST_ASSERT_FALSE(mapping.set_pivot(gamepad::AXES, 50));
+    mapping.process(frame(0, 0, 80), record);
+    TEST_ASSERT_EQUAL_UINT8(1, dispatched_count);
+    TEST_ASSERT_EQUAL_UINT8(3, dispatched[0]);
+}
+
+void test_combinations_are_entered_and_left()
+{
+    reset();
+    gamepad::mapping mapping;
+    // both released
+    int16_t input = mapping.add_combination(bit(buttons::LT) | bit(buttons::LB), 0);
+    TEST_ASSERT_EQUAL_INT16(gamepad::COMBINATION_INPUT, input);
+    mapping.assign(buttons::LT, event::PRESSED, action(1));
+    mapping.assign(buttons::LB, event::PRESSED, action(2));
+    mapping.assign(input, event::PRESSED, action(3));
+    // combination that isn't there
+    TEST_ASSERT_FALSE(mapping.assign(input + 1, event::PRESSED, action(4)));
+
+    mapping.process(frame(bit(buttons::LT)), record);
+    mapping.process(frame(bit(buttons::LT) | bit(buttons::LB)), record);
+    mapping.process(frame(bit(buttons::LB)), record);
+    // last one let go -> combination after the buttons
+    mapping.process(frame(0), record);
+
+    TEST_ASSERT_EQUAL_UINT8(3, dispatched_count);
+    TEST_ASSERT_EQUAL_UINT8(1, dispatched[0]);
+    TEST_ASSERT_EQUAL_UINT8(2, dispatched[1]);
+    TEST_ASSERT_EQUAL_UINT8(3, dispatched[2]);
+
+    for (uint8_t i = 1; i < gamepad::COMBINATIONS; i++)
+        TEST_ASSERT_TRUE(mapping.add_combination(bit(i), bit(i)) >= 0);
+    TEST_ASSERT_EQUAL_INT16(-1, mapping.add_combination(bit(buttons::A), 0));
+}
+
+void test_clear_and_reset()
+{
+    reset();
+    gamepad::mapping mapping;
+    mapping.assign(buttons::X, event::PRESSED, action(1));
+    mapping.process(frame(bit(buttons::X)), record);
+    TEST_ASSERT_EQUAL_UINT8(1, dispatched_count);
+
+    // gamepad reconnected -> held button is pressed again
+    mapping.reset();
+    TEST_ASSERT_EQUAL_UINT16(0, mapping.previous().buttons);
+    mapping.process(frame(bit(buttons::X)), record);
+    TEST_ASSERT_EQUAL_UINT8(2, dispatched_count);
+
+    TEST_ASSERT_TRUE(mapping.clear(buttons::X, event::PRESSED));
+    TEST_ASSERT_FALSE(mapping.clear(gamepad::AXIS_INPUT + gamepad::AXES, event::IDLE));
+    mapping.process(frame(0), record);
+    mapping.process(frame(bit(buttons::X)), record);
+    TEST_ASSERT_EQUAL_UINT8(2, dispatched_count);
+}
+
+// ================
+// BENCHMARK
+// ================
+
+void benchmark_process()
+{
+    reset();
+    gamepad::mapping mapping;
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        mapping.assign(i, event::PRESSED, action(i));
+        mapping.assign(i, event::RELEASED, action(i));
+    }
+    for (uint8_t i = 0; i < gamepad::AXES; i++)
+    {
+        mapping.assign(gamepad::AXIS_INPUT + i, event::NEGATIVE, action(i));
+        mapping.assign(gamepad::AXIS_INPUT + i, event::IDLE, action(i));
+        mapping.assign(gamepad::AXIS_INPUT + i, event::POSITIVE, action(i));
+    }
+    mapping.add_combination(bit(buttons::LT) | bit(buttons::LB), 0);
+
+    // a frame every 33 ms, a few of them change something
+    const uint32_t FRAMES = 1000000;
+    uint32_t changes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < FRAMES; i++)
+    {
+        uint16_t pressed = (i / 16U) % 4U == 0 ? bit(buttons::LT) : 0;
+        changes += mapping.process(frame(pressed, static_cast<int8_t>((i % 64U) * 4U - 127)), [](const commands::command &) {});
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    printf("[benchmark] %u frames -> %u commands, %.1f ns per frame\n", (unsigned)FRAMES, (unsigned)changes,
+           (double)elapsed / FRAMES);
+    TEST_ASSERT_TRUE(changes > 0);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_buttons_run_on_edges_only);
+    RUN_TEST(test_axes_run_when_they_change_zone);
+    RUN_TEST(test_combinations_are_entered_and_left);
+    RUN_TEST(test_clear_and_reset);
+    RUN_TEST(benchmark_process);
+    return UNITY_END();
+}
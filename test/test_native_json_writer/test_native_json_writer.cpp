@@ -0,0 +1,225 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+#include "json_parser/json_writer.hpp"
+
+using json_parser::json_writer;
+
+// ================
+// state like the one the controllers have
+// ================
+
+constexpr uint8_t SERVOS = 6U;
+constexpr uint8_t LEDS = 90U;
+const char *SERVO_NAMES[SERVOS] = {"base", "shoulder", "elbow", "wrist", "wrist_rotation", "grip"};
+
+void write_state(json_writer &json)
+{
+    json.begin_array();
+
+    json.begin_object().member("name", "arm").key("data").begin_array();
+    for (uint8_t i = 0; i < SERVOS; i++)
+    {
+        json.begin_object();
+        json.member("servo", SERVO_NAMES[i]);
+        json.member("min", 0);
+        json.member("max", 180);
+        json.member("angle", 90 + i);
+        json.end_object();
+    }
+    json.end_array().end_object();
+
+    json.begin_object().member("name", "leds").key("data").begin_object();
+    json.member("brightness", 100).member("interval", 50).key("colors").begin_array();
+    for (uint32_t i = 0; i < LEDS; i++)
+        json.value(i * 1000U);
+    json.end_array().end_object().end_object();
+
+    json.begin_object().member("name", "mp3").key("data").begin_object();
+    json.member("playing", static_cast<const char *>(nullptr)).member("volume", 15);
+    json.end_object().end_object();
+
+    json.begin_object().member("name", "version").member("data", 42U).end_object();
+    json.end_array();
+}
+
+// what retrive_data did before -> a document for every controller copied into one for all of them
+size_t document_state(char *buffer, size_t capacity, size_t &peak_heap)
+{
+    const size_t arm_size = JSON_ARRAY_SIZE(SERVOS) + JSON_OBJECT_SIZE(SERVOS * 4) + JSON_OBJECT_SIZE(2);
+    const size_t leds_size = JSON_OBJECT_SIZE(5) + JSON_ARRAY_SIZE(LEDS);
+    const size_t mp3_size = JSON_OBJECT_SIZE(4);
+    const size_t version_size = JSON_OBJECT_SIZE(2);
+    const size_t all_size = arm_size + leds_size + mp3_size + version_size + JSON_ARRAY_SIZE(4);
+    DynamicJsonDocument all(all_size);
+
+    {
+        DynamicJsonDocument arm(arm_size);
+        arm["name"] = "arm";
+        JsonArray data = arm.createNestedArray("data");
+        for (uint8_t i = 0; i < SERVOS; i++)
+        {
+            JsonObject servo = data.createNestedObject();
+            servo["servo"] = SERVO_NAMES[i];
+            servo["min"] = 0;
+            servo["max"] = 180;
+            servo["angle"] = 90 + i;
+        }
+        all.add(arm);
+    }
+    {
+        DynamicJsonDocument leds(leds_size);
+        leds["name"] = "leds";
+        JsonObject data = leds.createNestedObject("data");
+        data["brightness"] = 100;
+        data["interval"] = 50;
+        JsonArray colors = data.createNestedArray("colors");
+        for (uint32_t i = 0; i < LEDS; i++)
+            colors.add(i * 1000U);
+        all.add(leds);
+    }
+    {
+        DynamicJsonDocument mp3(mp3_size);
+        mp3["name"] = "mp3";
+        JsonObject data = mp3.createNestedObject("data");
+        data["playing"] = static_cast<const char *>(nullptr);
+        data["volume"] = 15;
+        all.add(mp3);
+    }
+    JsonObject version = all.createNestedObject();
+    version["name"] = "version";
+    version["data"] = 42U;
+
+    size_t length = measureJson(all);
+    // leds is the biggest document alive next to the one for all, then the message
+    peak_heap = all_size + (leds_size > length + 1 ? leds_size : length + 1);
+    return serializeJson(all, buffer, capacity);
+}
+
+// ================
+// TESTS
+// ================
+
+void test_commas_and_nesting()
+{
+    char buffer[128];
+    json_writer json(buffer, sizeof(buffer));
+    json.begin_object();
+    json.member("a", 1).key("b").begin_array().value(true).value(false).value(nullptr).end_array();
+    json.key("c").begin_object().end_object();
+    json.key("d").begin_array().begin_array().end_array().begin_object().member("e", "f").end_object().end_array();
+    json.end_object();
+
+    TEST_ASSERT_EQUAL_STRING("{\"a\":1,\"b\":[true,false,null],\"c\":{},\"d\":[[],{\"e\":\"f\"}]}", json.c_str());
+    TEST_ASSERT_EQUAL(strlen(buffer), json.length());
+    TEST_ASSERT_FALSE(json.overflowed());
+}
+
+void test_numbers()
+{
+    char buffer[128];
+    json_writer json(buffer, sizeof(buffer));
+    json.begin_array();
+    json.value(0).value(-1).value(INT32_MIN).value(UINT32_MAX);
+    json.value(static_cast<uint8_t>(255)).value(static_cast<int16_t>(-300));
+    json.end_array();
+
+    TEST_ASSERT_EQUAL_STRING("[0,-1,-2147483648,4294967295,255,-300]", buffer);
+}
+
+void test_strings_are_escaped()
+{
+    char buffer[64];
+    json_writer json(buffer, sizeof(buffer));
+    json.value("a\"b\\c\nd\x01");
+
+    TEST_ASSERT_EQUAL_STRING("\"a\\\"b\\\\c\\u000ad\\u0001\"", buffer);
+}
+
+void test_counting_matches_writing()
+{
+    json_writer measure;
+    write_state(measure);
+    TEST_ASSERT_FALSE(measure.overflowed());
+    TEST_ASSERT_NULL(measure.c_str());
+
+    char *text = json_parser::write_to_heap(write_state);
+    TEST_ASSERT_NOT_NULL(text);
+    TEST_ASSERT_EQUAL(measure.length(), strlen(text));
+    free(text);
+}
+
+void test_overflow_keeps_the_buffer_terminated()
+{
+    char buffer[8];
+    json_writer json(buffer, sizeof(buffer));
+    json.begin_array().value("too long for it").end_array();
+
+    TEST_ASSERT_TRUE(json.overflowed());
+    TEST_ASSERT_EQUAL(sizeof(buffer) - 1, strlen(buffer));
+    TEST_ASSERT_EQUAL_STRING("[\"too l", buffer);
+    TEST_ASSERT_TRUE(json.length() > sizeof(buffer));
+}
+
+void test_same_text_as_documents()
+{
+    static char written[4096];
+    static char serialized[4096];
+    size_t peak_heap;
+
+    json_writer json(written, sizeof(written));
+    write_state(json);
+    document_state(serialized, sizeof(serialized), peak_heap);
+
+    TEST_ASSERT_EQUAL_STRING(serialized, written);
+}
+
+// ================
+// BENCHMARK
+// ================
+
+constexpr uint32_t ITERATIONS = 10000U;
+
+void benchmark_against_documents()
+{
+    static char buffer[4096];
+    size_t document_peak = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+        document_state(buffer, sizeof(buffer), document_peak);
+    auto documents = std::chrono::steady_clock::now() - start;
+
+    size_t length = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        char *text = json_parser::write_to_heap(write_state);
+        length = strlen(text);
+        free(text);
+    }
+    auto writer = std::chrono::steady_clock::now() - start;
+
+    auto ns = [](std::chrono::steady_clock::duration time) {
+        return (long long)(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() / ITERATIONS);
+    };
+    printf("[benchmark] state of %u bytes: documents %lld ns, peak heap %u B | writer %lld ns, peak heap %u B\n",
+           (unsigned)length, ns(documents), (unsigned)document_peak, ns(writer), (unsigned)(length + 1));
+    TEST_ASSERT_TRUE(length + 1 < document_peak);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_commas_and_nesting);
+    RUN_TEST(test_numbers);
+    RUN_TEST(test_strings_are_escaped);
+    RUN_TEST(test_counting_matches_writing);
+    RUN_TEST(test_overflow_keeps_the_buffer_terminated);
+    RUN_TEST(test_same_text_as_documents);
+    RUN_TEST(benchmark_against_documents);
+    return UNITY_END();
+}
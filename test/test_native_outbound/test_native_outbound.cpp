@@ -0,0 +1,263 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "outbound/client_queues.hpp"
+
+using outbound::kind;
+
+typedef outbound::client_queues<2, 4, 64> queues;
+typedef queues::statistics statistics;
+
+// ================
+// fake clients -> what they got and how much they can take
+// ================
+
+struct fake_client
+{
+    uint32_t id;
+    // messages it can take in this flush
+    uint32_t window;
+    std::vector<std::string> received;
+};
+
+fake_client clients[2];
+
+char *text(const char *value)
+{
+    return strdup(value);
+}
+
+void connect(queues &outgoing, uint8_t count)
+{
+    uint32_t ids[2] = {clients[0].id, clients[1].id};
+    outgoing.sync(ids, count);
+}
+
+void flush(queues &outgoing, uint32_t now_us)
+{
+    outgoing.flush(
+        [](uint32_t id, size_t) {
+            return clients[id - 1].window > 0;
+        },
+        [](uint32_t id, const char *message, size_t length) {
+            clients[id - 1].window--;
+            clients[id - 1].received.push_back(std::string(message, length));
+        },
+        now_us);
+}
+
+statistics stats_of(queues &outgoing, uint32_t id)
+{
+    statistics stats[2];
+    uint8_t count = outgoing.stats(stats);
+    for (uint8_t i = 0; i < count; i++)
+        if (stats[i].client == id)
+            return stats[i];
+    return {};
+}
+
+// both of them connected, taking everything
+void reset()
+{
+    clients[0] = {1, 100, {}};
+    clients[1] = {2, 100, {}};
+}
+
+// ================
+// TESTS
+// ================
+
+void test_messages_reach_every_client_in_order()
+{
+    reset();
+    queues outgoing;
+    connect(outgoing, 2);
+    TEST_ASSERT_TRUE(outgoing.post(text("a"), kind::EVENT, 0));
+    TEST_ASSERT_TRUE(outgoing.post(text("b"), kind::STATE, 0));
+    flush(outgoing, 250);
+
+    for (auto &client : clients)
+    {
+        TEST_ASSERT_EQUAL_UINT32(2, client.received.size());
+        TEST_ASSERT_EQUAL_STRING("a", client.received[0].c_str());
+        TEST_ASSERT_EQUAL_STRING("b", client.received[1].c_str());
+    }
+    statistics stats = stats_of(outgoing, 1);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.sent);
+    TEST_ASSERT_EQUAL_UINT8(0, stats.depth);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.bytes);
+    TEST_ASSERT_EQUAL_UINT32(250, stats.max_latency_us);
+}
+
+void test_slow_client_resyncs_alone()
+{
+    reset();
+    queues outgoing;
+    connect(outgoing, 2);
+    clients[1].window = 0;
+
+    outgoing.post(text("event"), kind::EVENT, 0);
+    outgoing.post(text("state 1"), kind::STATE, 0);
+    flush(outgoing, 10);
+    // slow one still has state 1 waiting -> misses state 2
+    outgoing.post(text("state 2"), kind::STATE, 20);
+    flush(outgoing, 21);
+
+    statistics slow = stats_of(outgoing, 2);
+    TEST_ASSERT_EQUAL_UINT8(2, slow.depth);
+    TEST_ASSERT_EQUAL_UINT32(1, slow.replaced);
+    TEST_ASSERT_EQUAL_UINT8(1, outgoing.resyncing());
+    TEST_ASSERT_TRUE(outgoing.take_missed_state());
+    TEST_ASSERT_FALSE(outgoing.take_missed_state());
+
+    // whole state takes the place of state 1, only for the slow one
+    outgoing.post(text("whole"), kind::RESYNC, 25);
+    TEST_ASSERT_EQUAL_UINT8(0, outgoing.resyncing());
+    flush(outgoing, 26);
+    clients[1].window = 100;
+    flush(outgoing, 1030);
+    outgoing.post(text("state 3"), kind::STATE, 1040);
+    flush(outgoing, 1050);
+
+    const char *fast[] = {"event", "state 1", "state 2", "state 3"};
+    TEST_ASSERT_EQUAL_UINT32(4, clients[0].received.size());
+    for (uint8_t i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL_STRING(fast[i], clients[0].received[i].c_str());
+    const char *slow_got[] = {"event", "whole", "state 3"};
+    TEST_ASSERT_EQUAL_UINT32(3, clients[1].received.size());
+    for (uint8_t i = 0; i < 3; i++)
+        TEST_ASSERT_EQUAL_STRING(slow_got[i], clients[1].received[i].c_str());
+    TEST_ASSERT_EQUAL_UINT32(0, stats_of(outgoing, 1).replaced);
+    TEST_ASSERT_EQUAL_UINT32(1030, stats_of(outgoing, 2).max_latency_us);
+}
+
+void test_resync_is_asked_for_until_it_gets_there()
+{
+    reset();
+    queues outgoing;
+    connect(outgoing, 2);
+    clients[1].window = 0;
+    outgoing.post(text("state 1"), kind::STATE, 0);
+    flush(outgoing, 10);
+    outgoing.post(text("state 2"), kind::STATE, 20);
+    flush(outgoing, 30);
+    TEST_ASSERT_TRUE(outgoing.take_missed_state());
+
+    // the whole state never came -> every frame of changes asks for it again
+    outgoing.post(text("state 3"), kind::STATE, 40);
+    flush(outgoing, 50);
+    TEST_ASSERT_TRUE(outgoing.take_missed_state());
+    outgoing.post(text("whole"), kind::RESYNC, 60);
+    flush(outgoing, 70);
+    TEST_ASSERT_FALSE(outgoing.take_missed_state());
+
+    // fast one took every frame as it came -> never needed the whole state
+    TEST_ASSERT_EQUAL_UINT32(3, clients[0].received.size());
+    TEST_ASSERT_EQUAL_UINT32(0, stats_of(outgoing, 1).replaced);
+    TEST_ASSERT_EQUAL_UINT32(1, stats_of(outgoing, 2).replaced);
+    TEST_ASSERT_EQUAL_UINT8(1, stats_of(outgoing, 2).depth);
+}
+
+void test_events_over_the_budget_are_dropped()
+{
+    reset();
+    queues outgoing;
+    connect(outgoing, 1);
+    clients[0].window = 0;
+
+    // 4 messages at most
+    for (int i = 0; i < 5; i++)
+        outgoing.post(text("e"), kind::EVENT, 0);
+    statistics stats = stats_of(outgoing, 1);
+    TEST_ASSERT_EQUAL_UINT8(4, stats.depth);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.dropped);
+
+    // 64 bytes at most, but a big one still goes when the queue is empty
+    clients[0].window = 100;
+    flush(outgoing, 0);
+    std::string big(100, 'x');
+    TEST_ASSERT_TRUE(outgoing.post(text(big.c_str()), kind::EVENT, 0));
+    TEST_ASSERT_FALSE(outgoing.post(text("e"), kind::EVENT, 0));
+    TEST_ASSERT_EQUAL_UINT32(2, stats_of(outgoing, 1).dropped);
+    TEST_ASSERT_EQUAL_UINT32(100, stats_of(outgoing, 1).bytes);
+}
+
+void test_disconnected_clients_are_forgotten()
+{
+    reset();
+    queues outgoing;
+    TEST_ASSERT_FALSE(outgoing.post(text("nobody"), kind::EVENT, 0));
+
+    connect(outgoing, 2);
+    clients[1].window = 0;
+    outgoing.post(text("a"), kind::EVENT, 0);
+    connect(outgoing, 1);
+
+    statistics stats[2];
+    TEST_ASSERT_EQUAL_UINT8(1, outgoing.stats(stats));
+    TEST_ASSERT_EQUAL_UINT32(1, stats[0].client);
+
+    // new client starts empty
+    clients[1] = {3, 100, {}};
+    connect(outgoing, 2);
+    TEST_ASSERT_EQUAL_UINT8(0, stats_of(outgoing, 3).depth);
+}
+
+// ================
+// BENCHMARK
+// ================
+
+void benchmark_slow_client()
+{
+    // 20 frames per second for 10 s, slow client takes one every 200 ms
+    reset();
+    queues outgoing;
+    connect(outgoing, 2);
+    uint32_t slow_backlog = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < 200; frame++)
+    {
+        char message[16];
+        snprintf(message, sizeof(message), "{\"f\":%u}", frame);
+        outgoing.post(text(message), kind::STATE, frame * 50000U);
+        // what the publisher does -> the whole state for the ones that missed a frame
+        if (outgoing.take_missed_state())
+        {
+            snprintf(message, sizeof(message), "{\"all\":%u}", frame);
+            outgoing.post(text(message), kind::RESYNC, frame * 50000U);
+        }
+        clients[0].window = 1;
+        clients[1].window = frame % 4U == 0U ? 1 : 0;
+        flush(outgoing, frame * 50000U + 1000U);
+        uint8_t depth = stats_of(outgoing, 2).depth;
+        if (depth > slow_backlog)
+            slow_backlog = depth;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    statistics slow = stats_of(outgoing, 2);
+    printf("[benchmark] %.1f us per frame, slow client: %u sent, %u replaced, backlog %u, avg latency %u us\n",
+           (double)elapsed.count() / 200 / 1000, slow.sent, slow.replaced, slow_backlog, slow.average_latency_us);
+    TEST_ASSERT_EQUAL_UINT32(200, clients[0].received.size());
+    // fast one only ever gets the changes, whatever the slow one misses
+    for (const auto &message : clients[0].received)
+        TEST_ASSERT_EQUAL_UINT32(0, message.find("{\"f\""));
+    TEST_ASSERT_EQUAL_UINT32(1, slow_backlog);
+    // without replacing it would wait for 150 frames at the end
+    TEST_ASSERT_TRUE(slow.max_latency_us <= 4U * 50000U);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_messages_reach_every_client_in_order);
+    RUN_TEST(test_slow_client_resyncs_alone);
+    RUN_TEST(test_resync_is_asked_for_until_it_gets_there);
+    RUN_TEST(test_events_over_the_budget_are_dropped);
+    RUN_TEST(test_disconnected_clients_are_forgotten);
+    RUN_TEST(benchmark_slow_client);
+    return UNITY_END();
+}
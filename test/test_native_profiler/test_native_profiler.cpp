@@ -0,0 +1,220 @@
+#define PROFILING 1
+
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "profiler/profiler.hpp"
+#include "json_parser/static_parser.hpp"
+
+// ================
+// fake clocks -> one cycle is one microsecond
+// ================
+
+uint32_t now_ms = 0;
+uint32_t cycles = 0;
+uint32_t fake_clock() { return now_ms; }
+uint32_t fake_cycles() { return cycles; }
+
+profiler::profiler profiler::instance(fake_cycles, 1U, 100U);
+
+// every call takes as long as its controller says
+template <size_t N>
+class timed final : public json_parser::controller
+{
+public:
+    explicit timed() : controller(NAMES[N]) {}
+
+    bool decode(const JsonObject &json, commands::command &command) const override { return false; }
+    bool encode(const commands::command &command, JsonObject &json) const override { return false; }
+    bool initialize() override { return true; }
+
+    void schedule(json_parser::task_scheduler &scheduler) override
+    {
+        scheduler.add<timed, &timed::tick>(*this, 10U);
+    }
+
+    void retrive_data(json_parser::json_writer &json, uint32_t since) override
+    {
+        cycles += DURATION;
+        json.value(nullptr);
+    }
+
+    static constexpr const char *NAMES[] = {"engines", "leds"};
+    // leds is the slow one
+    static constexpr uint32_t DURATION = N ? 3000U : 20U;
+
+private:
+    template <typename... Controllers>
+    friend class json_parser::static_parser;
+
+    void tick() { cycles += DURATION; }
+    bool can_handle(const JsonObject &json) const override { return false; }
+    bool handle(const commands::command &command) override
+    {
+        cycles += DURATION;
+        return true;
+    }
+};
+
+typedef json_parser::static_parser<timed<0>, timed<1>> test_parser;
+
+// ================
+// TESTS
+// ================
+
+void test_bucket_bounds()
+{
+    typedef profiler::histogram histogram;
+    for (uint32_t value : {0U, 1U, 2U, 3U, 4U, 5U, 7U, 8U, 100U, 1000U, 65535U, 65536U, 1000000U})
+    {
+        uint8_t index = histogram::index(value);
+        TEST_ASSERT_TRUE(value <= histogram::upper_bound(index));
+        if (index)
+            TEST_ASSERT_TRUE(value > histogram::upper_bound(index - 1));
+    }
+    TEST_ASSERT_EQUAL_UINT8(histogram::BUCKETS - 1, histogram::index(UINT32_MAX));
+    TEST_ASSERT_EQUAL_UINT8(histogram::BUCKETS - 1, histogram::index(5000000U));
+}
+
+void test_histogram_statistics()
+{
+    profiler::histogram calls;
+    TEST_ASSERT_EQUAL_UINT32(0, calls.percentile(99));
+    TEST_ASSERT_EQUAL_UINT32(0, calls.average());
+
+    // 99 fast calls, one slow
+    for (int i = 0; i < 99; i++)
+        calls.record(10, 100);
+    calls.record(5000, 100);
+
+    TEST_ASSERT_EQUAL_UINT32(100, calls.count());
+    TEST_ASSERT_EQUAL_UINT32(10, calls.min());
+    TEST_ASSERT_EQUAL_UINT32(5000, calls.max());
+    TEST_ASSERT_EQUAL_UINT32((99 * 10 + 5000) / 100, calls.average());
+    TEST_ASSERT_EQUAL_UINT32(1, calls.over_budget());
+    // 10 is in the 8 - 11 bucket
+    TEST_ASSERT_EQUAL_UINT32(11, calls.percentile(99));
+    TEST_ASSERT_EQUAL_UINT32(11, calls.percentile(50));
+    TEST_ASSERT_EQUAL_UINT32(5000, calls.percentile(100));
+
+    calls.record(20000, 100);
+    TEST_ASSERT_TRUE(calls.percentile(99) >= 5000);
+}
+
+void test_saturated_bucket_halves_the_rest()
+{
+    profiler::histogram calls;
+    for (uint32_t i = 0; i < UINT16_MAX + 10U; i++)
+        calls.record(1, 100);
+    calls.record(500, 100);
+
+    // the exact numbers are kept
+    TEST_ASSERT_EQUAL_UINT32(UINT16_MAX + 11U, calls.count());
+    TEST_ASSERT_EQUAL_UINT32(1, calls.percentile(99));
+    TEST_ASSERT_EQUAL_UINT32(500, calls.percentile(100));
+}
+
+void test_parser_calls_are_profiled()
+{
+    now_ms = 0;
+    profiler::instance.reset();
+    test_parser parser(fake_clock);
+    TEST_ASSERT_TRUE(parser.initialize_all());
+    TEST_ASSERT_EQUAL_UINT8(2, profiler::instance.size());
+    TEST_ASSERT_EQUAL_STRING("leds", profiler::instance.get(1)->name);
+    TEST_ASSERT_NULL(profiler::instance.get(2));
+
+    commands::command command{};
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        command.controller = i % 2;
+        parser.handle(command);
+    }
+    for (; now_ms < 30; now_ms++)
+        parser.handle_updates();
+    // measures and writes -> one sample per controller, not two
+    char *message = json_parser::write_to_heap([&parser](json_parser::json_writer &json) {
+        parser.retrive_data(json, json_parser::state_version::ALL);
+    });
+    TEST_ASSERT_NOT_NULL(message);
+    free(message);
+
+    const auto *engines = profiler::instance.get(0);
+    const auto *leds = profiler::instance.get(1);
+    const auto &engines_handle = engines->calls[static_cast<uint8_t>(profiler::kind::HANDLE)];
+    const auto &leds_tasks = leds->calls[static_cast<uint8_t>(profiler::kind::TASK)];
+    TEST_ASSERT_EQUAL_UINT32(5, engines_handle.count());
+    TEST_ASSERT_EQUAL_UINT32(20, engines_handle.max());
+    TEST_ASSERT_EQUAL_UINT32(0, engines_handle.over_budget());
+    TEST_ASSERT_EQUAL_UINT32(3, leds_tasks.count());
+    TEST_ASSERT_EQUAL_UINT32(3000, leds_tasks.min());
+    TEST_ASSERT_EQUAL_UINT32(3, leds_tasks.over_budget());
+    TEST_ASSERT_EQUAL_UINT32(1, leds->calls[static_cast<uint8_t>(profiler::kind::DATA)].count());
+
+    // leds is over the budget (100 us) in every call
+    TEST_ASSERT_EQUAL_UINT32(5 + 3 + 1, profiler::instance.overruns());
+    TEST_ASSERT_EQUAL_UINT8(1, profiler::instance.last_overrun().controller);
+    TEST_ASSERT_TRUE(profiler::kind::DATA == profiler::instance.last_overrun().type);
+
+    profiler::instance.set_budget(5000);
+    parser.handle(command);
+    TEST_ASSERT_EQUAL_UINT32(5 + 3 + 1, profiler::instance.overruns());
+
+    profiler::instance.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, profiler::instance.get(1)->calls[0].count());
+    TEST_ASSERT_EQUAL_STRING("leds", profiler::instance.get(1)->name);
+    profiler::instance.set_budget(100);
+}
+
+void test_unknown_controller_is_ignored()
+{
+    profiler::instance.reset();
+    profiler::instance.stop(profiler::profiler::MAX_CONTROLLERS, profiler::kind::HANDLE, 0);
+    profiler::instance.stop(profiler::profiler::NOT_PROFILED, profiler::kind::TASK, 0);
+    TEST_ASSERT_EQUAL_UINT32(0, profiler::instance.overruns());
+    TEST_ASSERT_EQUAL_UINT8(profiler::profiler::NOT_PROFILED, profiler::instance.task_owner(-1));
+    TEST_ASSERT_EQUAL_UINT8(profiler::profiler::NOT_PROFILED, profiler::instance.task_owner(20));
+}
+
+// ================
+// BENCHMARK
+// ================
+
+constexpr uint32_t ITERATIONS = 1000000U;
+volatile uint32_t work = 0;
+
+void benchmark_scope_cost()
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+        work = work + 1;
+    auto bare = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        PROFILE_SCOPE(0, HANDLE)
+        work = work + 1;
+    }
+    auto profiled = std::chrono::steady_clock::now() - start;
+
+    auto ps = [](std::chrono::steady_clock::duration time) {
+        return (long long)(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() * 1000 / ITERATIONS);
+    };
+    printf("[benchmark] call: bare %lld ps, profiled %lld ps\n", ps(bare), ps(profiled));
+    TEST_ASSERT_EQUAL_UINT32(ITERATIONS, profiler::instance.get(0)->calls[0].count());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bucket_bounds);
+    RUN_TEST(test_histogram_statistics);
+    RUN_TEST(test_saturated_bucket_halves_the_rest);
+    RUN_TEST(test_parser_calls_are_profiled);
+    RUN_TEST(test_unknown_controller_is_ignored);
+    RUN_TEST(benchmark_scope_cost);
+    return UNITY_END();
+}
@@ -0,0 +1,210 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <chrono>
+#include "reassembly/message_pool.hpp"
+
+using reassembly::json_scanner;
+
+typedef reassembly::message_pool<2, 64> pool;
+typedef pool::result result;
+
+// colors of all 90 leds in one message -> more than one tcp segment
+std::string palette()
+{
+    std::string text = "{\"controller\":\"leds\",\"command\":\"palette\",\"colors\":[";
+    for (int i = 0; i < 90; i++)
+        text += (i ? ",[" : "[") + std::to_string(i) + ",128,255]";
+    return text + "]}";
+}
+
+json_scanner::state scan(const char *text, json_scanner &scanner)
+{
+    return scanner.feed(text, strlen(text));
+}
+
+// ================
+// TESTS
+// ================
+
+void test_scanner_counts_values()
+{
+    json_scanner scanner;
+    TEST_ASSERT_EQUAL(json_scanner::state::complete, scan("{\"a\":1,\"b\":[1,2,[]],\"c\":{}}", scanner));
+    // a, b, c, 1, 2, []
+    TEST_ASSERT_EQUAL(6, scanner.values());
+
+    scanner.reset();
+    TEST_ASSERT_EQUAL(json_scanner::state::complete, scan(" [ ] \n", scanner));
+    TEST_ASSERT_EQUAL(0, scanner.values());
+}
+
+void test_scanner_skips_strings()
+{
+    json_scanner scanner;
+    TEST_ASSERT_EQUAL(json_scanner::state::complete, scan("{\"a\":\"]},\\\"[{\"}", scanner));
+    TEST_ASSERT_EQUAL(1, scanner.values());
+}
+
+void test_scanner_follows_pieces()
+{
+    json_scanner scanner;
+    TEST_ASSERT_EQUAL(json_scanner::state::incomplete, scan("{\"a\":[1,", scanner));
+    TEST_ASSERT_EQUAL(json_scanner::state::incomplete, scan("2],\"b\":\"x", scanner));
+    TEST_ASSERT_EQUAL(json_scanner::state::complete, scan("y\"}", scanner));
+    TEST_ASSERT_EQUAL(4, scanner.values());
+
+    // byte by byte -> same as all at once
+    std::string text = palette();
+    json_scanner whole;
+    json_scanner bytes;
+    whole.feed(text.c_str(), text.size());
+    for (char c : text)
+        bytes.feed(&c, 1);
+    TEST_ASSERT_EQUAL(json_scanner::state::complete, bytes.current());
+    TEST_ASSERT_EQUAL(whole.values(), bytes.values());
+    // 3 members, 90 colors, 3 numbers in each
+    TEST_ASSERT_EQUAL(3 + 90 + 90 * 3, whole.values());
+}
+
+void test_scanner_rejects_broken_messages()
+{
+    const char *broken[] = {"{]", "[}", "]", "{}{}", "{} x", "1", "\"text\"", ",{}"};
+    for (auto text : broken)
+    {
+        json_scanner scanner;
+        TEST_ASSERT_EQUAL_MESSAGE(json_scanner::state::malformed, scan(text, scanner), text);
+    }
+
+    json_scanner scanner;
+    std::string deep(json_scanner::MAX_DEPTH + 1, '[');
+    TEST_ASSERT_EQUAL(json_scanner::state::malformed, scan(deep.c_str(), scanner));
+}
+
+void test_pieces_are_put_together()
+{
+    static pool fragments;
+    TEST_ASSERT_EQUAL(result::incomplete, fragments.append(7, "{\"a\":", 5, true, false));
+    TEST_ASSERT_EQUAL(result::incomplete, fragments.append(7, "[1,2", 4, false, false));
+    TEST_ASSERT_EQUAL(result::complete, fragments.append(7, "]}", 2, false, true));
+
+    TEST_ASSERT_EQUAL_STRING("{\"a\":[1,2]}", fragments.message(7));
+    TEST_ASSERT_EQUAL(11, fragments.length(7));
+    TEST_ASSERT_EQUAL(3, fragments.values(7));
+    TEST_ASSERT_EQUAL(1, fragments.in_use());
+
+    fragments.release(7);
+    TEST_ASSERT_EQUAL(0, fragments.in_use());
+    TEST_ASSERT_NULL(fragments.message(7));
+}
+
+void test_too_long_message_is_rejected_once()
+{
+    static pool fragments;
+    char piece[40];
+    memset(piece, ' ', sizeof(piece));
+    piece[0] = '[';
+
+    TEST_ASSERT_EQUAL(result::incomplete, fragments.append(1, piece, sizeof(piece), true, false));
+    TEST_ASSERT_EQUAL(result::too_long, fragments.append(1, piece, sizeof(piece), false, false));
+    // rest of it is swallowed, the slot is free after the last piece
+    TEST_ASSERT_EQUAL(result::ignored, fragments.append(1, piece, sizeof(piece), false, false));
+    TEST_ASSERT_EQUAL(1, fragments.in_use());
+    TEST_ASSERT_EQUAL(result::ignored, fragments.append(1, "]", 1, false, true));
+    TEST_ASSERT_EQUAL(0, fragments.in_use());
+    TEST_ASSERT_EQUAL(1, fragments.stats().too_long);
+
+    // next one is fine again
+    TEST_ASSERT_EQUAL(result::incomplete, fragments.append(1, "[", 1, true, false));
+    TEST_ASSERT_EQUAL(result::complete, fragments.append(1, "]", 1, false, true));
+}
+
+void test_broken_message_is_rejected_early()
+{
+    static pool fragments;
+    TEST_ASSERT_EQUAL(result::malformed, fragments.append(1, "{]", 2, true, false));
+    TEST_ASSERT_EQUAL(result::ignored, fragments.append(1, "}", 1, false, true));
+
+    // last piece, root is still open
+    TEST_ASSERT_EQUAL(result::incomplete, fragments.append(1, "{", 1, true, false));
+    TEST_ASSERT_EQUAL(result::malformed, fragments.append(1, "\"a\":1", 5, false, true));
+    TEST_ASSERT_EQUAL(0, fragments.in_use());
+    TEST_ASSERT_EQUAL(2, fragments.stats().malformed);
+}
+
+void test_slots_are_bounded()
+{
+    static pool fragments;
+    TEST_ASSERT_EQUAL(result::incomplete, fragments.append(1, "[", 1, true, false));
+    TEST_ASSERT_EQUAL(result::incomplete, fragments.append(2, "[", 1, true, false));
+    TEST_ASSERT_EQUAL(result::no_slot, fragments.append(3, "[", 1, true, false));
+    TEST_ASSERT_EQUAL(result::ignored, fragments.append(3, "]", 1, false, true));
+
+    // a client starting over takes its own slot again
+    TEST_ASSERT_EQUAL(result::incomplete, fragments.append(1, "{", 1, true, false));
+    TEST_ASSERT_EQUAL(result::complete, fragments.append(1, "}", 1, false, true));
+    TEST_ASSERT_EQUAL_STRING("{}", fragments.message(1));
+
+    // disconnected
+    fragments.release(2);
+    TEST_ASSERT_EQUAL(result::incomplete, fragments.append(3, "[", 1, true, false));
+}
+
+void test_document_sized_by_the_scanner_fits()
+{
+    std::string text = palette();
+    json_scanner scanner;
+    scanner.feed(text.c_str(), text.size());
+
+    // parsed in place like in the webserver -> only slots for the values
+    DynamicJsonDocument json(JSON_ARRAY_SIZE(scanner.values()));
+    TEST_ASSERT_FALSE(deserializeJson(json, &text[0], text.size()));
+    TEST_ASSERT_EQUAL(90, json["colors"].size());
+    TEST_ASSERT_EQUAL(255, json["colors"][89][2].as<int>());
+}
+
+// ================
+// BENCHMARK
+// ================
+
+constexpr uint32_t ITERATIONS = 10000U;
+
+void benchmark_scanner()
+{
+    std::string text = palette();
+    size_t values = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        json_scanner scanner;
+        // pieces of a typical tcp segment
+        for (size_t offset = 0; offset < text.size(); offset += 536)
+            scanner.feed(text.c_str() + offset, text.size() - offset < 536 ? text.size() - offset : 536);
+        values = scanner.values();
+    }
+    auto time = std::chrono::steady_clock::now() - start;
+
+    long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() / ITERATIONS;
+    printf("[benchmark] message of %u B: scanned in %lld ns, document %u B (%u values)\n",
+           (unsigned)text.size(), ns, (unsigned)JSON_ARRAY_SIZE(values), (unsigned)values);
+    TEST_ASSERT_TRUE(values > 0);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_scanner_counts_values);
+    RUN_TEST(test_scanner_skips_strings);
+    RUN_TEST(test_scanner_follows_pieces);
+    RUN_TEST(test_scanner_rejects_broken_messages);
+    RUN_TEST(test_pieces_are_put_together);
+    RUN_TEST(test_too_long_message_is_rejected_once);
+    RUN_TEST(test_broken_message_is_rejected_early);
+    RUN_TEST(test_slots_are_bounded);
+    RUN_TEST(test_document_sized_by_the_scanner_fits);
+    RUN_TEST(benchmark_scanner);
+    return UNITY_END();
+}
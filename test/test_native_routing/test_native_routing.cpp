@@ -0,0 +1,108 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <chrono>
+#include "json_parser/routing_table.hpp"
+
+const char *NAMES[] = {
+    "engines", "arm", "leds", "mp3", "sd", "config",
+    "gamepad", "camera", "sensors", "horn", "lights", "turret"};
+constexpr size_t NAMES_COUNT = sizeof(NAMES) / sizeof(NAMES[0]);
+constexpr uint32_t ITERATIONS = 200000U;
+
+// ================
+// TESTS
+// ================
+
+void test_adding_and_finding()
+{
+    json_parser::routing_table<16> table;
+    for (size_t i = 0; i < 6; i++)
+        TEST_ASSERT_TRUE(table.add(NAMES[i], i));
+
+    for (size_t i = 0; i < 6; i++)
+        TEST_ASSERT_EQUAL_INT(i, table.find(NAMES[i]));
+
+    TEST_ASSERT_EQUAL_INT(table.NOT_FOUND, table.find("enginess"));
+    TEST_ASSERT_EQUAL_INT(table.NOT_FOUND, table.find(""));
+    TEST_ASSERT_EQUAL_INT(table.NOT_FOUND, table.find(nullptr));
+}
+
+void test_duplicates_and_capacity()
+{
+    json_parser::routing_table<8> table;
+    TEST_ASSERT_TRUE(table.add("arm", 0));
+    // same name, different pointer
+    char copy[] = "arm";
+    TEST_ASSERT_FALSE(table.add(copy, 1));
+    TEST_ASSERT_FALSE(table.add(nullptr, 1));
+
+    // 3/4 of the entries at most, so lookups of missing names always finish
+    size_t added = 1;
+    for (size_t i = 2; i < NAMES_COUNT; i++)
+        added += table.add(NAMES[i], i);
+    TEST_ASSERT_EQUAL_UINT32(6, added);
+    TEST_ASSERT_EQUAL_INT(table.NOT_FOUND, table.find("missing"));
+}
+
+// what every controller did in can_handle before routing
+bool can_handle(const JsonObject &json, const char *name)
+{
+    if (json.containsKey("controller"))
+    {
+        const char *controller = json["controller"];
+        return !strcmp(controller, name);
+    }
+    return false;
+}
+
+void benchmark_broadcast_against_routing()
+{
+    StaticJsonDocument<256> json;
+    json["command"] = "forward";
+    json["engine"] = "both";
+
+    printf("[benchmark] controllers | broadcast ns | routed ns\n");
+    for (size_t controllers : {2U, 4U, 6U, 8U, 12U})
+    {
+        json_parser::routing_table<32> table;
+        for (size_t i = 0; i < controllers; i++)
+            table.add(NAMES[i], i);
+
+        // worst case for the broadcast -> message for the last controller
+        json["controller"] = NAMES[controllers - 1];
+        JsonObject object = json.as<JsonObject>();
+
+        volatile uint32_t matched = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < ITERATIONS; i++)
+        {
+            for (size_t c = 0; c < controllers; c++)
+                matched += can_handle(object, NAMES[c]);
+        }
+        auto broadcast = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < ITERATIONS; i++)
+        {
+            const char *name = object["controller"];
+            matched += table.find(name) != table.NOT_FOUND;
+        }
+        auto routed = std::chrono::steady_clock::now() - start;
+
+        auto broadcast_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(broadcast).count() / ITERATIONS;
+        auto routed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(routed).count() / ITERATIONS;
+        printf("[benchmark] %11u | %12lld | %9lld\n", (unsigned)controllers, (long long)broadcast_ns, (long long)routed_ns);
+
+        TEST_ASSERT_EQUAL_UINT32(2 * ITERATIONS, matched);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_adding_and_finding);
+    RUN_TEST(test_duplicates_and_capacity);
+    RUN_TEST(benchmark_broadcast_against_routing);
+    return UNITY_END();
+}
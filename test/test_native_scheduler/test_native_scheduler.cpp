@@ -0,0 +1,370 @@
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "scheduler/scheduler.hpp"
+#include "scheduler/idle_meter.hpp"
+
+typedef scheduler::scheduler<8> test_scheduler;
+
+// ================
+// fake clock -> tests decide when time moves
+// ================
+
+uint32_t now_ms = 0;
+uint32_t fake_clock() { return now_ms; }
+
+// order in which tasks ran, ids of the tasks
+std::vector<int> runs;
+
+struct recorder
+{
+    int id;
+    void run() { runs.push_back(id); }
+};
+
+void record(void *context)
+{
+    runs.push_back(*static_cast<int *>(context));
+}
+
+void reset(uint32_t start = 0)
+{
+    now_ms = start;
+    runs.clear();
+}
+
+// ================
+// TESTS
+// ================
+
+void test_phase_and_order()
+{
+    reset();
+    test_scheduler tasks(fake_clock);
+    recorder first{0}, second{1}, third{2};
+    tasks.add<recorder, &recorder::run>(third, 10, 2);
+    tasks.add<recorder, &recorder::run>(first, 10, 0);
+    tasks.add<recorder, &recorder::run>(second, 10, 1);
+
+    TEST_ASSERT_EQUAL_UINT32(1, tasks.run());
+    now_ms = 2;
+    TEST_ASSERT_EQUAL_UINT32(2, tasks.run());
+    TEST_ASSERT_EQUAL(3, runs.size());
+    TEST_ASSERT_EQUAL_INT(0, runs[0]);
+    TEST_ASSERT_EQUAL_INT(1, runs[1]);
+    TEST_ASSERT_EQUAL_INT(2, runs[2]);
+
+    // phases stay the same in the next period
+    now_ms = 11;
+    TEST_ASSERT_EQUAL_UINT32(2, tasks.run());
+    TEST_ASSERT_EQUAL_UINT32(1, tasks.until_next());
+}
+
+void test_periods()
+{
+    reset();
+    test_scheduler tasks(fake_clock);
+    int fast = 0, slow = 1;
+    tasks.add(record, &fast, 5);
+    tasks.add(record, &slow, 20);
+
+    uint32_t counts[2] = {};
+    for (; now_ms < 100; now_ms++)
+    {
+        runs.clear();
+        tasks.run();
+        for (int id : runs)
+            counts[id]++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(20, counts[0]);
+    TEST_ASSERT_EQUAL_UINT32(5, counts[1]);
+    TEST_ASSERT_EQUAL_UINT32(0, tasks.stats().late);
+}
+
+void test_missed_periods_are_skipped()
+{
+    reset();
+    test_scheduler tasks(fake_clock);
+    int id = 0;
+    tasks.add(record, &id, 10, 3);
+
+    now_ms = 55;
+    // runs once, not five times
+    TEST_ASSERT_EQUAL_UINT32(1, tasks.run());
+    TEST_ASSERT_EQUAL_UINT32(1, tasks.stats().late);
+    TEST_ASSERT_EQUAL_UINT32(52, tasks.stats().max_late_ms);
+    // and keeps its phase -> 63
+    TEST_ASSERT_EQUAL_UINT32(8, tasks.until_next());
+}
+
+void test_suspend_and_resume()
+{
+    reset();
+    test_scheduler tasks(fake_clock);
+    int first = 0, second = 1;
+    int16_t id = tasks.add(record, &first, 1);
+    tasks.add(record, &second, 50);
+
+    TEST_ASSERT_TRUE(tasks.suspend(id));
+    TEST_ASSERT_TRUE(tasks.suspend(id));
+    TEST_ASSERT_EQUAL(1, tasks.active());
+    TEST_ASSERT_EQUAL(2, tasks.size());
+    now_ms = 10;
+    tasks.run();
+    TEST_ASSERT_EQUAL(1, runs.size());
+    TEST_ASSERT_EQUAL_UINT32(40, tasks.until_next());
+
+    TEST_ASSERT_TRUE(tasks.resume(id, 5));
+    TEST_ASSERT_EQUAL_UINT32(5, tasks.until_next());
+    now_ms = 15;
+    tasks.run();
+    TEST_ASSERT_EQUAL(2, runs.size());
+    TEST_ASSERT_EQUAL_INT(0, runs[1]);
+
+    TEST_ASSERT_FALSE(tasks.suspend(test_scheduler::NO_TASK));
+    TEST_ASSERT_FALSE(tasks.resume(7));
+}
+
+// task that stops itself, like sd at the end of a script
+test_scheduler *self_scheduler = nullptr;
+int16_t self_id = test_scheduler::NO_TASK;
+uint32_t self_runs = 0;
+
+void suspend_self(void *)
+{
+    if (++self_runs == 3)
+        self_scheduler->suspend(self_id);
+}
+
+void test_task_suspends_itself()
+{
+    reset();
+    test_scheduler tasks(fake_clock);
+    self_scheduler = &tasks;
+    self_runs = 0;
+    self_id = tasks.add(suspend_self, nullptr, 1);
+
+    for (; now_ms < 10; now_ms++)
+        tasks.run();
+    TEST_ASSERT_EQUAL_UINT32(3, self_runs);
+    TEST_ASSERT_EQUAL(0, tasks.active());
+    TEST_ASSERT_EQUAL_UINT32(test_scheduler::IDLE, tasks.until_next());
+}
+
+void test_set_period()
+{
+    reset();
+    test_scheduler tasks(fake_clock);
+    int id = 0;
+    int16_t task = tasks.add(record, &id, 50);
+
+    now_ms = 10;
+    TEST_ASSERT_TRUE(tasks.set_period(task, 20));
+    TEST_ASSERT_EQUAL_UINT32(20, tasks.until_next());
+
+    // period 0 would spin forever
+    TEST_ASSERT_TRUE(tasks.set_period(task, 0));
+    now_ms = 11;
+    TEST_ASSERT_EQUAL_UINT32(1, tasks.run());
+    TEST_ASSERT_EQUAL_UINT32(0, tasks.run());
+    TEST_ASSERT_FALSE(tasks.set_period(3, 20));
+}
+
+void test_until_next()
+{
+    reset();
+    test_scheduler tasks(fake_clock);
+    TEST_ASSERT_EQUAL_UINT32(test_scheduler::IDLE, tasks.until_next());
+    TEST_ASSERT_EQUAL_UINT32(0, tasks.run());
+
+    int id = 0;
+    tasks.add(record, &id, 30, 12);
+    TEST_ASSERT_EQUAL_UINT32(12, tasks.until_next());
+    now_ms = 20;
+    TEST_ASSERT_EQUAL_UINT32(0, tasks.until_next());
+}
+
+void test_clock_wraps_around()
+{
+    reset(UINT32_MAX - 5);
+    test_scheduler tasks(fake_clock);
+    int first = 0, second = 1;
+    tasks.add(record, &first, 10);
+    tasks.add(record, &second, 10, 8);
+
+    tasks.run();
+    TEST_ASSERT_EQUAL(1, runs.size());
+    // deadlines past zero still come after the ones before it
+    TEST_ASSERT_EQUAL_UINT32(8, tasks.until_next());
+    now_ms += 8;
+    tasks.run();
+    TEST_ASSERT_EQUAL(2, runs.size());
+    TEST_ASSERT_EQUAL_INT(1, runs[1]);
+    TEST_ASSERT_EQUAL_UINT32(2, tasks.until_next());
+}
+
+void test_capacity()
+{
+    reset();
+    test_scheduler tasks(fake_clock);
+    int id = 0;
+    for (size_t i = 0; i < test_scheduler::capacity(); i++)
+        TEST_ASSERT_EQUAL_INT16(i, tasks.add(record, &id, 1));
+    TEST_ASSERT_EQUAL_INT16(test_scheduler::NO_TASK, tasks.add(record, &id, 1));
+    TEST_ASSERT_EQUAL_INT16(test_scheduler::NO_TASK, scheduler::scheduler<1>(fake_clock).add(nullptr, nullptr, 1));
+
+    // every task runs once per pass, even with period 1 and a late pass
+    now_ms = 5;
+    TEST_ASSERT_EQUAL_UINT32(test_scheduler::capacity(), tasks.run());
+}
+
+// idle meter counts microseconds, the fake clock is reused
+void test_idle_percent()
+{
+    reset();
+    scheduler::idle_meter idle(fake_clock, 1000);
+
+    // 3 x 200 us asleep, 100 us busy between them
+    for (int i = 0; i < 3; i++)
+    {
+        idle.sleep();
+        now_ms += 200;
+        idle.wake(i == 1);
+        now_ms += 100;
+    }
+    // window not finished yet
+    TEST_ASSERT_EQUAL_UINT8(0, idle.idle_percent());
+
+    idle.sleep();
+    now_ms += 100;
+    idle.wake(false);
+    // 700 of 1000 us
+    TEST_ASSERT_EQUAL_UINT8(70, idle.idle_percent());
+    TEST_ASSERT_EQUAL_UINT32(4, idle.stats().waits);
+    TEST_ASSERT_EQUAL_UINT32(1, idle.stats().early_wakeups);
+    TEST_ASSERT_EQUAL_UINT32(200, idle.stats().max_sleep_us);
+
+    // busy window -> waits without timeout only
+    for (int i = 0; i < 11; i++)
+    {
+        idle.sleep();
+        idle.wake(false);
+        now_ms += 100;
+    }
+    TEST_ASSERT_EQUAL_UINT8(0, idle.idle_percent());
+}
+
+void test_idle_sleep_longer_than_window()
+{
+    reset();
+    scheduler::idle_meter idle(fake_clock, 1000);
+    idle.sleep();
+    now_ms += 2500;
+    idle.wake(false);
+    TEST_ASSERT_EQUAL_UINT8(100, idle.idle_percent());
+}
+
+// ================
+// BENCHMARK
+// ================
+
+constexpr size_t CONTROLLERS = 6U;
+constexpr uint32_t ITERATIONS = 200000U;
+volatile uint32_t ticks[CONTROLLERS];
+
+// what every controller did before -> update() called each loop, checks millis() on its own
+struct polling
+{
+    virtual ~polling() = default;
+    virtual void update() = 0;
+};
+
+template <size_t N>
+struct polled final : polling
+{
+    void update() override
+    {
+        static uint32_t last_update = fake_clock();
+        if (fake_clock() - last_update > 20U)
+        {
+            ticks[N] = ticks[N] + 1;
+            last_update = fake_clock();
+        }
+    }
+};
+
+template <size_t N>
+void scheduled(void *)
+{
+    ticks[N] = ticks[N] + 1;
+}
+
+void benchmark_against_polling()
+{
+    reset();
+    std::vector<std::unique_ptr<polling>> controllers;
+    controllers.emplace_back(new polled<0>());
+    controllers.emplace_back(new polled<1>());
+    controllers.emplace_back(new polled<2>());
+    controllers.emplace_back(new polled<3>());
+    controllers.emplace_back(new polled<4>());
+    controllers.emplace_back(new polled<5>());
+
+    test_scheduler tasks(fake_clock);
+    tasks.add(scheduled<0>, nullptr, 21U, 21U);
+    tasks.add(scheduled<1>, nullptr, 21U, 21U);
+    tasks.add(scheduled<2>, nullptr, 21U, 21U);
+    tasks.add(scheduled<3>, nullptr, 21U, 21U);
+    tasks.add(scheduled<4>, nullptr, 21U, 21U);
+    tasks.add(scheduled<5>, nullptr, 21U, 21U);
+
+    // the first polled run is after 21 ms, so is the first scheduled one
+    // loop() runs much more often than anything is due, the clock moves every 64 passes
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        now_ms = i / 64;
+        for (const auto &controller : controllers)
+            controller->update();
+    }
+    auto polling_pass = std::chrono::steady_clock::now() - start;
+    uint32_t polled_ticks = ticks[0];
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        now_ms = i / 64;
+        tasks.run();
+    }
+    auto scheduler_pass = std::chrono::steady_clock::now() - start;
+
+    auto ps = [](std::chrono::steady_clock::duration time) {
+        return (long long)(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() * 1000 / ITERATIONS);
+    };
+    printf("[benchmark] update pass of %u controllers: polling %lld ps, scheduler %lld ps\n",
+           (unsigned)CONTROLLERS, ps(polling_pass), ps(scheduler_pass));
+
+    // both run every task the same number of times
+    for (size_t i = 0; i < CONTROLLERS; i++)
+        TEST_ASSERT_EQUAL_UINT32(2 * polled_ticks, ticks[i]);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_phase_and_order);
+    RUN_TEST(test_periods);
+    RUN_TEST(test_missed_periods_are_skipped);
+    RUN_TEST(test_suspend_and_resume);
+    RUN_TEST(test_task_suspends_itself);
+    RUN_TEST(test_set_period);
+    RUN_TEST(test_until_next);
+    RUN_TEST(test_clock_wraps_around);
+    RUN_TEST(test_capacity);
+    RUN_TEST(test_idle_percent);
+    RUN_TEST(test_idle_sleep_longer_than_window);
+    RUN_TEST(benchmark_against_polling);
+    return UNITY_END();
+}
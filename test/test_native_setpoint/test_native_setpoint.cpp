@@ -0,0 +1,203 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "setpoint/axis_filter.hpp"
+
+using setpoint::axis_filter;
+using setpoint::FULL_SCALE;
+
+// no deadzone, no expo, no low-pass, never times out
+constexpr setpoint::shape LINEAR = {0, 0U, 256U, 0U};
+
+// ================
+// TESTS
+// ================
+
+void test_conversions()
+{
+    TEST_ASSERT_EQUAL_INT16(FULL_SCALE, setpoint::from_axis(127));
+    TEST_ASSERT_EQUAL_INT16(-FULL_SCALE, setpoint::from_axis(-127));
+    TEST_ASSERT_EQUAL_INT16(-FULL_SCALE, setpoint::from_axis(-128));
+    TEST_ASSERT_EQUAL_INT16(0, setpoint::from_axis(0));
+    TEST_ASSERT_EQUAL_INT16(FULL_SCALE, setpoint::from_unit(2.0F));
+    TEST_ASSERT_EQUAL_INT16(-FULL_SCALE / 2, setpoint::from_unit(-0.5F));
+}
+
+void test_deadzone_and_expo()
+{
+    setpoint::shape deadzone = {FULL_SCALE / 10, 0U, 256U, 0U};
+    TEST_ASSERT_EQUAL_INT16(0, axis_filter::shaped(FULL_SCALE / 10, deadzone));
+    TEST_ASSERT_EQUAL_INT16(0, axis_filter::shaped(-FULL_SCALE / 20, deadzone));
+    // rest is stretched -> still reaches the ends and starts right at 0
+    TEST_ASSERT_EQUAL_INT16(FULL_SCALE, axis_filter::shaped(FULL_SCALE, deadzone));
+    TEST_ASSERT_EQUAL_INT16(-FULL_SCALE, axis_filter::shaped(-FULL_SCALE, deadzone));
+    TEST_ASSERT_INT16_WITHIN(40, 0, axis_filter::shaped(FULL_SCALE / 10 + 30, deadzone));
+    TEST_ASSERT_INT16_WITHIN(2, FULL_SCALE / 2, axis_filter::shaped(FULL_SCALE * 11 / 20, deadzone));
+
+    setpoint::shape expo = {0, 256U, 256U, 0U};
+    // full cubic: half way -> an eighth
+    TEST_ASSERT_INT16_WITHIN(2, FULL_SCALE / 8, axis_filter::shaped(FULL_SCALE / 2, expo));
+    TEST_ASSERT_INT16_WITHIN(2, -FULL_SCALE / 8, axis_filter::shaped(-FULL_SCALE / 2, expo));
+    TEST_ASSERT_INT16_WITHIN(1, FULL_SCALE, axis_filter::shaped(FULL_SCALE, expo));
+
+    // same on both sides, never more than the input
+    setpoint::shape mixed = {1000, 128U, 256U, 0U};
+    for (int32_t raw = 0; raw <= FULL_SCALE; raw += 97)
+    {
+        int16_t positive = axis_filter::shaped(static_cast<int16_t>(raw), mixed);
+        TEST_ASSERT_EQUAL_INT16(-positive, axis_filter::shaped(static_cast<int16_t>(-raw), mixed));
+        TEST_ASSERT_TRUE(positive <= raw);
+    }
+}
+
+void test_samples_are_interpolated()
+{
+    axis_filter filter(LINEAR);
+    filter.sample(0, 0);
+    filter.update(0);
+    // regular 20 ms samples -> that's the interval
+    for (uint32_t t = 20; t <= 400; t += 20)
+        filter.sample(0, t);
+    TEST_ASSERT_UINT16_WITHIN(1, 20, filter.interval());
+
+    filter.sample(FULL_SCALE, 420);
+    TEST_ASSERT_EQUAL_INT16(0, filter.update(420));
+    TEST_ASSERT_INT16_WITHIN(FULL_SCALE / 100, FULL_SCALE / 4, filter.update(425));
+    TEST_ASSERT_INT16_WITHIN(FULL_SCALE / 100, FULL_SCALE / 2, filter.update(430));
+    TEST_ASSERT_EQUAL_INT16(FULL_SCALE, filter.update(440));
+    TEST_ASSERT_TRUE(filter.settled());
+
+    // new sample half way -> continues from where the output is, no jump back
+    filter.sample(0, 460);
+    int16_t before = filter.update(468);
+    TEST_ASSERT_TRUE(before > 0 && before < FULL_SCALE);
+    filter.sample(FULL_SCALE, 468);
+    TEST_ASSERT_EQUAL_INT16(before, filter.update(468));
+    TEST_ASSERT_TRUE(filter.update(472) > before);
+    TEST_ASSERT_EQUAL_INT16(FULL_SCALE, filter.update(500));
+
+    // a long pause isn't taken for the interval
+    uint16_t interval = filter.interval();
+    filter.sample(0, 2000);
+    TEST_ASSERT_EQUAL_UINT16(interval, filter.interval());
+}
+
+void test_low_pass_settles_exactly()
+{
+    axis_filter filter({0, 0U, 32U, 0U});
+    filter.sample(FULL_SCALE, 0);
+    int16_t previous = 0;
+    uint32_t t = 40;
+    // monotonic and it gets all the way there
+    for (; t < 2000 && !filter.settled(); t += 5)
+    {
+        int16_t output = filter.update(t);
+        TEST_ASSERT_TRUE(output >= previous);
+        previous = output;
+    }
+    TEST_ASSERT_TRUE(filter.settled());
+    TEST_ASSERT_EQUAL_INT16(FULL_SCALE, filter.output());
+
+    filter.sample(0, t);
+    for (t += 5; t < 4000 && !filter.settled(); t += 5)
+        filter.update(t);
+    TEST_ASSERT_EQUAL_INT16(0, filter.output());
+}
+
+void test_timeout_and_reset()
+{
+    axis_filter filter({0, 0U, 256U, 100U});
+    filter.sample(FULL_SCALE, 0);
+    TEST_ASSERT_EQUAL_INT16(FULL_SCALE, filter.update(50));
+    TEST_ASSERT_FALSE(filter.timed_out());
+    // sender gone -> back to 0, over an interval like any other sample
+    filter.update(100);
+    TEST_ASSERT_TRUE(filter.timed_out());
+    TEST_ASSERT_EQUAL_INT16(0, filter.update(200));
+    filter.sample(FULL_SCALE / 2, 210);
+    TEST_ASSERT_FALSE(filter.timed_out());
+
+    // taken over at a position -> starts there, first sample moves away from it
+    filter.reset(-FULL_SCALE);
+    TEST_ASSERT_EQUAL_INT16(-FULL_SCALE, filter.output());
+    TEST_ASSERT_EQUAL_INT16(-FULL_SCALE, filter.update(300));
+    filter.sample(0, 300);
+    TEST_ASSERT_TRUE(filter.update(310) < 0);
+    TEST_ASSERT_EQUAL_INT16(0, filter.update(400));
+}
+
+// ================
+// BENCHMARK
+// ================
+
+// largest change of the output between two ticks, samples 16 ms apart with up to +-12 ms of jitter
+// raw -> the latest sample as it came, what the outputs did before
+void largest_steps(const setpoint::shape &shape, int32_t &raw, int32_t &filtered)
+{
+    axis_filter filter(shape);
+    srand(7);
+    raw = filtered = 0;
+    // sweep starts there
+    filter.reset(-FULL_SCALE);
+    int16_t previous_output = -FULL_SCALE;
+    int16_t previous_value = -FULL_SCALE;
+    uint32_t next = 0;
+    int16_t value = -FULL_SCALE;
+    for (uint32_t t = 0; t < 20000; t++)
+    {
+        if (t == next)
+        {
+            // stick swept back and forth, one full sweep a second
+            uint32_t phase = t % 1000U;
+            value = static_cast<int16_t>(phase < 500U ? -FULL_SCALE + phase * 131 : FULL_SCALE - (phase - 500U) * 131);
+            filter.sample(value, t);
+            next = t + 4U + static_cast<uint32_t>(rand() % 25);
+        }
+        // outputs tick every 5 ms
+        if (t % 5U)
+            continue;
+        int16_t output = filter.update(t);
+        raw = abs(value - previous_value) > raw ? abs(value - previous_value) : raw;
+        filtered = abs(output - previous_output) > filtered ? abs(output - previous_output) : filtered;
+        previous_output = output;
+        previous_value = value;
+    }
+}
+
+void benchmark_smoothing()
+{
+    int32_t raw, interpolated, smoothed;
+    largest_steps({0, 0U, 256U, 0U}, raw, interpolated);
+    largest_steps({0, 0U, 64U, 0U}, raw, smoothed);
+
+    axis_filter filter({2600, 96U, 64U, 500U});
+    const uint32_t UPDATES = 1000000;
+    int32_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t t = 0; t < UPDATES; t++)
+    {
+        if (!(t % 16U))
+            filter.sample(static_cast<int16_t>((t * 37U) % FULL_SCALE), t);
+        sum += filter.update(t);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    printf("[benchmark] largest step per 5 ms tick with jittered samples: %d raw, %d interpolated, %d interpolated + low-pass, "
+           "%.1f ns per update (%d)\n",
+           (int)raw, (int)interpolated, (int)smoothed, (double)elapsed / UPDATES, (int)(sum & 1));
+    TEST_ASSERT_TRUE(interpolated < raw);
+    TEST_ASSERT_TRUE(smoothed < interpolated);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_conversions);
+    RUN_TEST(test_deadzone_and_expo);
+    RUN_TEST(test_samples_are_interpolated);
+    RUN_TEST(test_low_pass_settles_exactly);
+    RUN_TEST(test_timeout_and_reset);
+    RUN_TEST(benchmark_smoothing);
+    return UNITY_END();
+}
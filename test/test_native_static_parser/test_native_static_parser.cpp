@@ -0,0 +1,329 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "json_parser/static_parser.hpp"
+
+// ================
+// six controllers, the same number main.cpp has
+// ================
+
+constexpr size_t CONTROLLERS = 6U;
+const char *NAMES[CONTROLLERS] = {"engines", "arm", "leds", "mp3", "sd", "config"};
+constexpr uint32_t ITERATIONS = 200000U;
+
+// volatile -> every call has to happen, the compiler can't merge them
+volatile uint32_t updates[CONTROLLERS];
+volatile uint32_t handled[CONTROLLERS];
+volatile uint32_t observed[CONTROLLERS];
+const json_parser::abstract_parser *given_parser = nullptr;
+
+// the parsers get their time from here instead of millis()
+uint32_t now_ms = 0;
+uint32_t fake_clock() { return now_ms; }
+
+void reset_counters()
+{
+    for (size_t i = 0; i < CONTROLLERS; i++)
+        updates[i] = handled[i] = observed[i] = 0;
+}
+
+template <size_t N>
+class dummy final : public json_parser::controller
+{
+public:
+    dummy() : controller(NAMES[N]) {}
+
+    bool decode(const JsonObject &json, commands::command &command) const override
+    {
+        const char *name = json[COMMAND_KEY];
+        command.id = 0;
+        return name && !strcmp(name, COMMAND);
+    }
+
+    bool encode(const commands::command &command, JsonObject &json) const override
+    {
+        json[COMMAND_KEY] = COMMAND;
+        return true;
+    }
+
+    void observe(const commands::command &command) override { observed[N] = observed[N] + 1; }
+    void schedule(json_parser::task_scheduler &scheduler) override
+    {
+        scheduler.add<dummy, &dummy::tick>(*this, 1U);
+    }
+    bool initialize() override { return true; }
+
+    void retrive_data(json_parser::json_writer &json, uint32_t since) override
+    {
+        json.begin_object().member("handled", handled[N]).end_object();
+    }
+    uint32_t version() const override { return _state.latest(); }
+
+private:
+    template <typename... Controllers>
+    friend class json_parser::static_parser;
+
+    static constexpr const char *COMMAND = "tick";
+
+    void tick() { updates[N] = updates[N] + 1; }
+
+    bool can_handle(const JsonObject &json) const override { return false; }
+    bool handle(const commands::command &command) override
+    {
+        _state.touch(0);
+        return (handled[N] = handled[N] + 1);
+    }
+
+    json_parser::state_stamps<1> _state;
+};
+
+// like sd and config -> needs the parser it is added to
+class linked final : public json_parser::controller
+{
+public:
+    explicit linked(const json_parser::abstract_parser &parser) : controller("linked") { given_parser = &parser; }
+
+    bool decode(const JsonObject &json, commands::command &command) const override { return false; }
+    bool encode(const commands::command &command, JsonObject &json) const override { return false; }
+    bool initialize() override { return false; }
+    void retrive_data(json_parser::json_writer &json, uint32_t since) override { json.value(nullptr); }
+
+private:
+    template <typename... Controllers>
+    friend class json_parser::static_parser;
+
+    bool can_handle(const JsonObject &json) const override { return false; }
+    bool handle(const commands::command &command) override { return false; }
+};
+
+typedef json_parser::static_parser<dummy<0>, dummy<1>, dummy<2>, dummy<3>, dummy<4>, dummy<5>> test_parser;
+
+// state the way a client gets it
+DynamicJsonDocument retrive(const json_parser::abstract_parser &parser, uint32_t since)
+{
+    char *text = json_parser::write_to_heap([&](json_parser::json_writer &json) { parser.retrive_data(json, since); });
+    DynamicJsonDocument data(2048);
+    deserializeJson(data, text);
+    free(text);
+    return data;
+}
+
+// ================
+// TESTS
+// ================
+
+void test_routing_and_dispatch()
+{
+    reset_counters();
+    test_parser parser(fake_clock);
+    StaticJsonDocument<128> json;
+    json["controller"] = "mp3";
+    json["command"] = "tick";
+
+    auto res = parser.handle(json.as<JsonObject>());
+    TEST_ASSERT_EQUAL_UINT8(1, res.first);
+    TEST_ASSERT_EQUAL_UINT8(1, res.second);
+    TEST_ASSERT_EQUAL_UINT32(1, handled[3]);
+    TEST_ASSERT_EQUAL_UINT32(1, handled[0] + handled[1] + handled[2] + handled[3] + handled[4] + handled[5]);
+
+    // known controller, unknown command
+    json["command"] = "tock";
+    res = parser.handle(json.as<JsonObject>());
+    TEST_ASSERT_EQUAL_UINT8(1, res.first);
+    TEST_ASSERT_EQUAL_UINT8(0, res.second);
+
+    json["controller"] = "camera";
+    res = parser.handle(json.as<JsonObject>());
+    TEST_ASSERT_EQUAL_UINT8(0, res.first);
+    TEST_ASSERT_EQUAL_UINT8(0, res.second);
+
+    commands::command command{};
+    command.controller = CONTROLLERS;
+    res = parser.handle(command);
+    TEST_ASSERT_EQUAL_UINT8(0, res.first);
+}
+
+void test_decode_and_encode()
+{
+    test_parser parser(fake_clock);
+    StaticJsonDocument<128> json;
+    json["controller"] = "config";
+    json["command"] = "tick";
+
+    commands::command command{};
+    TEST_ASSERT_TRUE(parser.decode(json.as<JsonObject>(), command));
+    TEST_ASSERT_EQUAL_UINT8(5, command.controller);
+
+    StaticJsonDocument<128> encoded;
+    JsonObject object = encoded.to<JsonObject>();
+    TEST_ASSERT_TRUE(parser.encode(command, object));
+    TEST_ASSERT_EQUAL_STRING("config", object["controller"].as<const char *>());
+    TEST_ASSERT_EQUAL_STRING("tick", object["command"].as<const char *>());
+
+    command.controller = CONTROLLERS;
+    TEST_ASSERT_FALSE(parser.encode(command, object));
+}
+
+void test_observers()
+{
+    reset_counters();
+    test_parser parser(fake_clock);
+    TEST_ASSERT_TRUE(parser.add_observer("sd"));
+    TEST_ASSERT_TRUE(parser.add_observer("leds"));
+    TEST_ASSERT_FALSE(parser.add_observer("camera"));
+
+    commands::command command{};
+    for (uint8_t i = 0; i < CONTROLLERS; i++)
+    {
+        command.controller = i;
+        parser.handle(command);
+    }
+    TEST_ASSERT_EQUAL_UINT32(CONTROLLERS, observed[4]);
+    TEST_ASSERT_EQUAL_UINT32(CONTROLLERS, observed[2]);
+    TEST_ASSERT_EQUAL_UINT32(0, observed[0] + observed[1] + observed[3] + observed[5]);
+}
+
+void test_updates_initialize_and_data()
+{
+    reset_counters();
+    now_ms = 0;
+    test_parser parser(fake_clock);
+    TEST_ASSERT_TRUE(parser.initialize_all());
+    TEST_ASSERT_EQUAL_UINT32(0, parser.until_next_update());
+    parser.handle_updates();
+    // nothing is due until the clock moves
+    parser.handle_updates();
+    for (size_t i = 0; i < CONTROLLERS; i++)
+        TEST_ASSERT_EQUAL_UINT32(1, updates[i]);
+    TEST_ASSERT_EQUAL_UINT32(1, parser.until_next_update());
+
+    now_ms++;
+    parser.handle_updates();
+    for (size_t i = 0; i < CONTROLLERS; i++)
+        TEST_ASSERT_EQUAL_UINT32(2, updates[i]);
+    TEST_ASSERT_EQUAL(CONTROLLERS, parser.tasks().size());
+
+    auto data = retrive(parser, json_parser::state_version::ALL);
+    // and the version
+    TEST_ASSERT_EQUAL(CONTROLLERS + 1, data.size());
+}
+
+void test_state_stamps()
+{
+    json_parser::state_stamps<3> state;
+    uint32_t start = json_parser::state_version::current();
+    TEST_ASSERT_EQUAL_UINT32(json_parser::state_version::FIRST, state.latest());
+    TEST_ASSERT_TRUE(state.changed(1, json_parser::state_version::ALL));
+    TEST_ASSERT_FALSE(state.changed(1, start));
+
+    state.touch(1);
+    TEST_ASSERT_TRUE(state.changed(1, start));
+    TEST_ASSERT_FALSE(state.changed(0, start));
+    TEST_ASSERT_EQUAL_UINT32(json_parser::state_version::current(), state.latest());
+    TEST_ASSERT_FALSE(state.changed(1, state.latest()));
+
+    uint32_t before_all = json_parser::state_version::current();
+    state.touch_all();
+    for (uint8_t i = 0; i < 3; i++)
+        TEST_ASSERT_TRUE(state.changed(i, before_all));
+}
+
+void test_only_changed_controllers_are_retrived()
+{
+    test_parser parser(fake_clock);
+    TEST_ASSERT_TRUE(parser.initialize_all());
+
+    auto all = retrive(parser, json_parser::state_version::ALL);
+    TEST_ASSERT_EQUAL(CONTROLLERS + 1, all.size());
+    JsonObject version = all[CONTROLLERS];
+    TEST_ASSERT_EQUAL_STRING("version", version["name"]);
+    uint32_t since = version["data"];
+    TEST_ASSERT_EQUAL_UINT32(json_parser::state_version::current(), since);
+
+    commands::command command{};
+    command.controller = 2;
+    parser.handle(command);
+
+    auto changes = retrive(parser, since);
+    TEST_ASSERT_EQUAL(2, changes.size());
+    TEST_ASSERT_EQUAL_STRING("leds", changes[0]["name"]);
+    since = changes[1]["data"];
+
+    // nothing changed -> only the version
+    auto nothing = retrive(parser, since);
+    TEST_ASSERT_EQUAL(1, nothing.size());
+    TEST_ASSERT_EQUAL_UINT32(since, nothing[0]["data"].as<uint32_t>());
+}
+
+void test_controllers_get_the_parser()
+{
+    json_parser::static_parser<dummy<0>, linked> parser(fake_clock);
+    TEST_ASSERT_EQUAL_PTR(&parser, given_parser);
+    // linked fails to initialize, the rest still runs
+    TEST_ASSERT_FALSE(parser.initialize_all());
+}
+
+void benchmark_against_virtual_calls()
+{
+    // what parser does -> controllers on the heap, a virtual call for each one
+    std::vector<std::unique_ptr<json_parser::controller>> controllers;
+    std::vector<json_parser::controller *> observers;
+    controllers.emplace_back(new dummy<0>());
+    controllers.emplace_back(new dummy<1>());
+    controllers.emplace_back(new dummy<2>());
+    controllers.emplace_back(new dummy<3>());
+    controllers.emplace_back(new dummy<4>());
+    controllers.emplace_back(new dummy<5>());
+    static test_parser parser(fake_clock);
+    reset_counters();
+
+    commands::command command{};
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        command.controller = i % CONTROLLERS;
+        for (auto observer : observers)
+            observer->observe(command);
+        if (command.controller < controllers.size())
+            controllers[command.controller]->dispatch(command);
+    }
+    auto dynamic_dispatch = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        command.controller = i % CONTROLLERS;
+        parser.handle(command);
+    }
+    auto static_dispatch = std::chrono::steady_clock::now() - start;
+
+    auto ps = [](std::chrono::steady_clock::duration time) {
+        return (long long)(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() * 1000 / ITERATIONS);
+    };
+    // update passes are compared in test_native_scheduler
+    printf("[benchmark] dispatch: vector of pointers %lld ps, static parser %lld ps\n",
+           ps(dynamic_dispatch), ps(static_dispatch));
+
+    uint32_t total = 0;
+    for (size_t i = 0; i < CONTROLLERS; i++)
+        total += handled[i];
+    TEST_ASSERT_EQUAL_UINT32(2 * ITERATIONS, total);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_routing_and_dispatch);
+    RUN_TEST(test_decode_and_encode);
+    RUN_TEST(test_observers);
+    RUN_TEST(test_updates_initialize_and_data);
+    RUN_TEST(test_controllers_get_the_parser);
+    RUN_TEST(test_state_stamps);
+    RUN_TEST(test_only_changed_controllers_are_retrived);
+    RUN_TEST(benchmark_against_virtual_calls);
+    return UNITY_END();
+}
@@ -0,0 +1,186 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "telemetry/publisher.hpp"
+#include "telemetry/report.hpp"
+
+// ================
+// fake clock and state -> one field that tests change
+// ================
+
+uint32_t now_us = 0;
+uint32_t fake_clock() { return now_us; }
+
+json_parser::state_stamps<2> state;
+uint32_t values[2] = {0, 0};
+
+// like retrive_data -> only fields that changed after since, writing takes 100 us
+void write_state(json_parser::json_writer &json, uint32_t since)
+{
+    now_us += 100U;
+    json.begin_object();
+    if (state.changed(0, since))
+        json.member("a", values[0]);
+    if (state.changed(1, since))
+        json.member("b", values[1]);
+    json.end_object();
+}
+
+void change(uint8_t field, uint32_t value)
+{
+    values[field] = value;
+    state.touch(field);
+}
+
+// frame as a string, empty when there was none
+std::string frame(telemetry::publisher &publisher)
+{
+    char *text = publisher.frame(write_state);
+    if (!text)
+        return "";
+    std::string copy(text);
+    free(text);
+    return copy;
+}
+
+// ================
+// TESTS
+// ================
+
+void test_rate_and_period()
+{
+    telemetry::publisher publisher(fake_clock);
+    TEST_ASSERT_EQUAL_UINT8(0, publisher.rate());
+    TEST_ASSERT_EQUAL_UINT32(0, publisher.period_ms());
+
+    publisher.set_rate(20);
+    TEST_ASSERT_EQUAL_UINT32(50, publisher.period_ms());
+    publisher.set_rate(1000);
+    TEST_ASSERT_EQUAL_UINT8(telemetry::publisher::MAX_RATE, publisher.rate());
+    TEST_ASSERT_EQUAL_UINT32(1000 / telemetry::publisher::MAX_RATE, publisher.period_ms());
+}
+
+void test_frames_carry_only_changes()
+{
+    telemetry::publisher publisher(fake_clock);
+    publisher.set_rate(20);
+
+    // first one has everything
+    TEST_ASSERT_EQUAL_STRING("{\"a\":0,\"b\":0}", frame(publisher).c_str());
+    // nothing changed -> no frame
+    TEST_ASSERT_EQUAL_STRING("", frame(publisher).c_str());
+
+    change(1, 7);
+    TEST_ASSERT_EQUAL_STRING("{\"b\":7}", frame(publisher).c_str());
+    change(0, 3);
+    change(0, 4);
+    TEST_ASSERT_EQUAL_STRING("{\"a\":4}", frame(publisher).c_str());
+
+    const auto &stats = publisher.stats();
+    TEST_ASSERT_EQUAL_UINT32(3, stats.frames);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.full_frames);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.unchanged);
+    TEST_ASSERT_EQUAL_UINT32(7, stats.last_bytes);
+    TEST_ASSERT_EQUAL_UINT32(13, stats.max_bytes);
+    TEST_ASSERT_EQUAL_UINT32((13 + 7 + 7) / 3, publisher.average_bytes());
+    // measured and written
+    TEST_ASSERT_EQUAL_UINT32(200, stats.max_time_us);
+    TEST_ASSERT_EQUAL_UINT32(200, publisher.average_time_us());
+}
+
+void test_dropped_frame_sends_everything_again()
+{
+    telemetry::publisher publisher(fake_clock);
+    publisher.set_rate(10);
+    frame(publisher);
+
+    change(0, 1);
+    TEST_ASSERT_EQUAL_STRING("{\"a\":1}", frame(publisher).c_str());
+    // a client never got it
+    publisher.drop();
+    TEST_ASSERT_EQUAL_STRING("{\"a\":1,\"b\":7}", frame(publisher).c_str());
+    TEST_ASSERT_EQUAL_UINT32(1, publisher.stats().dropped);
+
+    publisher.resync();
+    TEST_ASSERT_EQUAL_STRING("{\"a\":1,\"b\":7}", frame(publisher).c_str());
+    TEST_ASSERT_EQUAL_UINT32(3, publisher.stats().full_frames);
+}
+
+void test_whole_frame_leaves_the_changes_alone()
+{
+    telemetry::publisher publisher(fake_clock);
+    publisher.set_rate(10);
+    frame(publisher);
+
+    change(1, 8);
+    // for a client that missed a frame, the rest still gets what changed
+    char *whole = publisher.whole_frame(write_state);
+    TEST_ASSERT_EQUAL_STRING("{\"a\":1,\"b\":8}", whole);
+    free(whole);
+    TEST_ASSERT_EQUAL_STRING("{\"b\":8}", frame(publisher).c_str());
+    TEST_ASSERT_EQUAL_STRING("", frame(publisher).c_str());
+    TEST_ASSERT_EQUAL_UINT32(2, publisher.stats().full_frames);
+}
+
+void test_report_has_every_key()
+{
+    telemetry::publisher publisher(fake_clock);
+    publisher.set_rate(10);
+    frame(publisher);
+
+    // sized like the config/telemetry reply, a member that doesn't fit is dropped silently
+    StaticJsonDocument<JSON_OBJECT_SIZE(2) + telemetry::REPORT_SIZE> reply;
+    reply["name"] = "telemetry";
+    telemetry::report(publisher, 1U, reply.createNestedObject("data"));
+    TEST_ASSERT_FALSE(reply.overflowed());
+
+    JsonObject data = reply["data"];
+    const char *keys[] = {"rate", "frames", "full_frames", "unchanged", "dropped", "skipped", "bandwidth", "bytes", "time"};
+    for (const char *key : keys)
+        TEST_ASSERT_TRUE_MESSAGE(data.containsKey(key), key);
+    const char *stats[] = {"last", "avg", "max"};
+    for (const char *key : stats)
+    {
+        TEST_ASSERT_TRUE_MESSAGE(data["bytes"].containsKey(key), key);
+        TEST_ASSERT_TRUE_MESSAGE(data["time"].containsKey(key), key);
+    }
+    TEST_ASSERT_EQUAL_UINT32(publisher.stats().max_time_us, data["time"]["max"].as<uint32_t>());
+    TEST_ASSERT_EQUAL_UINT32(1, data["skipped"].as<uint32_t>());
+}
+
+// ================
+// BENCHMARK
+// ================
+
+void benchmark_frame_sizes()
+{
+    telemetry::publisher publisher(fake_clock);
+    publisher.set_rate(20);
+    size_t full = frame(publisher).size();
+
+    // one field changes every frame
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        change(i % 2, i);
+        frame(publisher);
+    }
+    printf("[benchmark] full state %u B, delta frame %u B avg -> %u B/s at %u Hz\n", (unsigned)full,
+           (unsigned)publisher.average_bytes(), (unsigned)(publisher.average_bytes() * publisher.rate()),
+           (unsigned)publisher.rate());
+    TEST_ASSERT_TRUE(publisher.average_bytes() <= full);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_rate_and_period);
+    RUN_TEST(test_frames_carry_only_changes);
+    RUN_TEST(test_dropped_frame_sends_everything_again);
+    RUN_TEST(test_whole_frame_leaves_the_changes_alone);
+    RUN_TEST(test_report_has_every_key);
+    RUN_TEST(benchmark_frame_sizes);
+    return UNITY_END();
+}
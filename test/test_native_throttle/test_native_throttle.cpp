@@ -0,0 +1,209 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "ingress/throttle.hpp"
+#include "ingress/traffic.hpp"
+
+using ingress::costs;
+using ingress::traffic;
+using ingress::traffic_meter;
+
+typedef ingress::throttle<2, ingress::TRAFFIC_CLASSES> throttle;
+typedef throttle::result result;
+
+static constexpr uint8_t BATCH = 0xFFU;
+
+// same split as the webserver
+traffic by_name(const char *name, size_t length)
+{
+    if ((length == 7 && !memcmp(name, "engines", 7)) || (length == 3 && !memcmp(name, "arm", 3)))
+        return traffic::CONTROL;
+    if (length == 6 && !memcmp(name, "config", 6))
+        return traffic::CONFIG;
+    return traffic::BULK;
+}
+
+// engines 0, arm 1, leds 2, mp3 3, sd 4, config 5
+traffic by_index(uint8_t index)
+{
+    return index < 2 ? traffic::CONTROL : index == 5 ? traffic::CONFIG : traffic::BULK;
+}
+
+void text_cost(const char *text, costs &cost)
+{
+    traffic_meter::text(text, strlen(text), by_name, cost);
+}
+
+void configure(throttle &limiter)
+{
+    limiter.configure(static_cast<uint8_t>(traffic::CONTROL), {100, 10});
+    limiter.configure(static_cast<uint8_t>(traffic::BULK), {2, 2});
+    limiter.configure(static_cast<uint8_t>(traffic::CONFIG), {0, 0});
+}
+
+// ================
+// TESTS
+// ================
+
+void test_bucket_refills_at_rate_up_to_burst()
+{
+    ingress::limit limits = {10, 5};
+    ingress::token_bucket bucket;
+    bucket.fill(limits, 0);
+    TEST_ASSERT_EQUAL_UINT32(5, bucket.tokens());
+
+    for (int i = 0; i < 5; i++)
+        bucket.take(limits, 1);
+    TEST_ASSERT_FALSE(bucket.has(limits, 1));
+
+    // 10 per second -> one every 100 ms
+    bucket.refill(limits, 99);
+    TEST_ASSERT_FALSE(bucket.has(limits, 1));
+    bucket.refill(limits, 100);
+    TEST_ASSERT_TRUE(bucket.has(limits, 1));
+
+    // never more than burst, also after a long pause and a wrapped clock
+    bucket.refill(limits, 0xFFFFFFF0U);
+    TEST_ASSERT_EQUAL_UINT32(5, bucket.tokens());
+    bucket.refill(limits, 0x10U);
+    TEST_ASSERT_EQUAL_UINT32(5, bucket.tokens());
+}
+
+void test_text_messages_are_charged_by_controller()
+{
+    costs cost;
+    text_cost("{\"controller\":\"engines\",\"command\":\"forward\",\"engine\":\"left\"}", cost);
+    TEST_ASSERT_EQUAL_UINT8(1, cost[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, cost[1]);
+
+    text_cost("[{\"controller\" : \"arm\"},{\"controller\":\"leds\"},{\"command\":\"controller\",\"controller\":\"arm\"}]", cost);
+    TEST_ASSERT_EQUAL_UINT8(2, cost[0]);
+    TEST_ASSERT_EQUAL_UINT8(1, cost[1]);
+    TEST_ASSERT_EQUAL_UINT8(0, cost[2]);
+
+    text_cost("{\"controller\":\"config\",\"command\":\"get\"}", cost);
+    TEST_ASSERT_EQUAL_UINT8(1, cost[2]);
+
+    // anything else is a bulk command
+    text_cost("garbage", cost);
+    TEST_ASSERT_EQUAL_UINT8(0, cost[0]);
+    TEST_ASSERT_EQUAL_UINT8(1, cost[1]);
+}
+
+void test_binary_messages_are_charged_by_controller()
+{
+    costs cost;
+    const uint8_t single[] = {1, 0, 90, 0};
+    traffic_meter::binary(single, sizeof(single), BATCH, by_index, cost);
+    TEST_ASSERT_EQUAL_UINT8(1, cost[0]);
+
+    const uint8_t batch[] = {BATCH, 3, 0, 0, 2, 3, 2, 1, 7, 2, 5, 0};
+    traffic_meter::binary(batch, sizeof(batch), BATCH, by_index, cost);
+    TEST_ASSERT_EQUAL_UINT8(1, cost[0]);
+    TEST_ASSERT_EQUAL_UINT8(1, cost[1]);
+    TEST_ASSERT_EQUAL_UINT8(1, cost[2]);
+
+    traffic_meter::binary(single, 0, BATCH, by_index, cost);
+    TEST_ASSERT_EQUAL_UINT8(1, cost[1]);
+}
+
+void test_flooding_one_class_leaves_the_other_alone()
+{
+    throttle limiter;
+    configure(limiter);
+    costs bulk = {0, 1, 0};
+    costs control = {1, 0, 0};
+
+    TEST_ASSERT_EQUAL(result::admitted, limiter.admit(7, bulk, 0));
+    TEST_ASSERT_EQUAL(result::admitted, limiter.admit(7, bulk, 0));
+    TEST_ASSERT_EQUAL(result::throttled, limiter.admit(7, bulk, 0));
+    TEST_ASSERT_EQUAL(result::admitted, limiter.admit(7, control, 0));
+    // other client has buckets of its own
+    TEST_ASSERT_EQUAL(result::admitted, limiter.admit(8, bulk, 0));
+    // 2 per second
+    TEST_ASSERT_EQUAL(result::admitted, limiter.admit(7, bulk, 500));
+
+    throttle::client_stats stats[2];
+    TEST_ASSERT_EQUAL_UINT8(2, limiter.stats(stats));
+    TEST_ASSERT_EQUAL_UINT32(7, stats[0].client);
+    TEST_ASSERT_EQUAL_UINT32(4, stats[0].admitted);
+    TEST_ASSERT_EQUAL_UINT32(1, stats[0].throttled);
+    TEST_ASSERT_EQUAL_UINT32(1, stats[1].admitted);
+}
+
+void test_mixed_batch_is_all_or_nothing()
+{
+    throttle limiter;
+    configure(limiter);
+    costs mixed = {5, 2, 0};
+    TEST_ASSERT_EQUAL(result::admitted, limiter.admit(1, mixed, 0));
+    // bulk is empty -> control tokens aren't taken either
+    TEST_ASSERT_EQUAL(result::throttled, limiter.admit(1, mixed, 0));
+    costs control = {5, 0, 0};
+    TEST_ASSERT_EQUAL(result::admitted, limiter.admit(1, control, 0));
+    TEST_ASSERT_EQUAL(result::throttled, limiter.admit(1, control, 0));
+
+    // config isn't limited
+    costs config = {0, 0, 200};
+    TEST_ASSERT_EQUAL(result::admitted, limiter.admit(1, config, 0));
+}
+
+void test_slots_are_freed_on_disconnect()
+{
+    throttle limiter;
+    configure(limiter);
+    costs bulk = {0, 1, 0};
+    limiter.admit(1, bulk, 0);
+    limiter.admit(2, bulk, 0);
+    TEST_ASSERT_EQUAL(result::no_slot, limiter.admit(3, bulk, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, limiter.no_slot());
+
+    limiter.forget(1);
+    TEST_ASSERT_EQUAL(result::admitted, limiter.admit(3, bulk, 0));
+    throttle::client_stats stats[2];
+    TEST_ASSERT_EQUAL_UINT8(2, limiter.stats(stats));
+    TEST_ASSERT_EQUAL_UINT32(3, stats[0].client);
+    TEST_ASSERT_EQUAL_UINT32(1, stats[0].admitted);
+}
+
+// ================
+// BENCHMARK
+// ================
+
+void benchmark_admission()
+{
+    const char *message = "{\"controller\":\"engines\",\"command\":\"speed\",\"engine\":\"both\",\"speed\":2048}";
+    size_t length = strlen(message);
+    constexpr uint32_t ROUNDS = 200000U;
+
+    throttle limiter;
+    configure(limiter);
+    uint32_t admitted = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ROUNDS; i++)
+    {
+        costs cost;
+        traffic_meter::text(message, length, by_name, cost);
+        // a message every 5 ms from a client that floods at 200 per second
+        admitted += limiter.admit(1, cost, i * 5U) == result::admitted;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    printf("[benchmark] %u messages, %.1f ns to classify and admit, %u let through at 100/s\n", ROUNDS,
+           (double)elapsed.count() / ROUNDS, admitted);
+    // every one from the burst plus 100 per second
+    TEST_ASSERT_UINT32_WITHIN(11, ROUNDS / 2U, admitted);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bucket_refills_at_rate_up_to_burst);
+    RUN_TEST(test_text_messages_are_charged_by_controller);
+    RUN_TEST(test_binary_messages_are_charged_by_controller);
+    RUN_TEST(test_flooding_one_class_leaves_the_other_alone);
+    RUN_TEST(test_mixed_batch_is_all_or_nothing);
+    RUN_TEST(test_slots_are_freed_on_disconnect);
+    RUN_TEST(benchmark_admission);
+    return UNITY_END();
+}
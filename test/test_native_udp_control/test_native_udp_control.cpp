@@ -0,0 +1,293 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "udp_control/setpoint_channel.hpp"
+#include "udp_control/deadman.hpp"
+#include "command_queue/batch_queue.hpp"
+
+using udp_control::setpoint;
+using udp_control::setpoint_channel;
+typedef setpoint_channel::result result;
+
+setpoint make(uint16_t speed)
+{
+    setpoint value = {{1, -1}, {speed, speed}, {90, 90, 90, 90, setpoint::KEEP, 10}};
+    return value;
+}
+
+result receive(setpoint_channel &channel, uint32_t sequence, const setpoint &value, setpoint &out)
+{
+    uint8_t data[setpoint_channel::DATAGRAM_SIZE];
+    setpoint_channel::write(sequence, value, data);
+    return channel.receive(data, sizeof(data), out);
+}
+
+// ================
+// TESTS
+// ================
+
+void test_datagram_round_trip()
+{
+    setpoint_channel channel;
+    setpoint out = {};
+    TEST_ASSERT_EQUAL(result::applied, receive(channel, 1, make(1234), out));
+    TEST_ASSERT_EQUAL_INT(1, out.direction[0]);
+    TEST_ASSERT_EQUAL_INT(-1, out.direction[1]);
+    TEST_ASSERT_EQUAL_UINT16(1234, out.speed[1]);
+    TEST_ASSERT_EQUAL_UINT8(setpoint::KEEP, out.angle[4]);
+    TEST_ASSERT_EQUAL_UINT8(10, out.angle[5]);
+}
+
+void test_only_newer_datagrams_are_applied()
+{
+    setpoint_channel channel;
+    setpoint out = {};
+    TEST_ASSERT_EQUAL(result::applied, receive(channel, 10, make(1), out));
+    TEST_ASSERT_EQUAL(result::duplicate, receive(channel, 10, make(2), out));
+    // 11 and 12 are missing
+    TEST_ASSERT_EQUAL(result::applied, receive(channel, 13, make(3), out));
+    TEST_ASSERT_EQUAL_UINT32(2, channel.stats().lost);
+    // 12 came late -> dropped, not lost after all
+    TEST_ASSERT_EQUAL(result::stale, receive(channel, 12, make(4), out));
+    TEST_ASSERT_EQUAL_UINT16(3, out.speed[0]);
+
+    const auto &stats = channel.stats();
+    TEST_ASSERT_EQUAL_UINT32(4, stats.received);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.applied);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.lost);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.reordered);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.duplicates);
+}
+
+void test_sequence_wraps_and_sender_restarts()
+{
+    setpoint_channel channel;
+    setpoint out = {};
+    TEST_ASSERT_EQUAL(result::applied, receive(channel, UINT32_MAX, make(1), out));
+    TEST_ASSERT_EQUAL(result::applied, receive(channel, 0, make(2), out));
+    TEST_ASSERT_EQUAL_UINT32(0, channel.stats().lost);
+
+    TEST_ASSERT_EQUAL(result::applied, receive(channel, 50000, make(3), out));
+    // far behind -> new sender, not a late datagram
+    TEST_ASSERT_EQUAL(result::applied, receive(channel, 1, make(4), out));
+    TEST_ASSERT_EQUAL_UINT32(1, channel.stats().restarts);
+    TEST_ASSERT_EQUAL_UINT16(4, out.speed[0]);
+}
+
+void test_invalid_datagrams_are_rejected()
+{
+    setpoint_channel channel;
+    setpoint out = make(7);
+    uint8_t data[setpoint_channel::DATAGRAM_SIZE];
+    setpoint_channel::write(1, make(1), data);
+
+    TEST_ASSERT_EQUAL(result::invalid, channel.receive(data, sizeof(data) - 1, out));
+    data[4] = 2;
+    TEST_ASSERT_EQUAL(result::invalid, channel.receive(data, sizeof(data), out));
+    TEST_ASSERT_EQUAL_UINT16(7, out.speed[0]);
+    TEST_ASSERT_EQUAL_UINT32(2, channel.stats().invalid);
+}
+
+// ================
+// LOOPBACK -> sender drops every 10th datagram and swaps every 7th with the one after it
+// ================
+
+constexpr uint32_t DATAGRAMS = 2000U;
+
+void test_loopback_sender_and_receiver()
+{
+    int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+    TEST_ASSERT_TRUE(receiver >= 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    TEST_ASSERT_EQUAL_INT(0, bind(receiver, (sockaddr *)&address, sizeof(address)));
+    socklen_t length = sizeof(address);
+    getsockname(receiver, (sockaddr *)&address, &length);
+    timeval timeout = {0, 200000};
+    setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    uint32_t dropped = 0;
+    uint32_t swapped = 0;
+    std::thread sender([&address, &dropped, &swapped]() {
+        int sender = socket(AF_INET, SOCK_DGRAM, 0);
+        std::vector<uint32_t> order;
+        for (uint32_t sequence = 1; sequence <= DATAGRAMS; sequence++)
+        {
+            if (sequence % 10U == 0U)
+            {
+                dropped++;
+                continue;
+            }
+            order.push_back(sequence);
+        }
+        for (size_t i = 0; i + 1 < order.size(); i++)
+        {
+            if (order[i] % 7U == 0U)
+            {
+                std::swap(order[i], order[i + 1]);
+                swapped++;
+                i++;
+            }
+        }
+        for (uint32_t sequence : order)
+        {
+            uint8_t data[setpoint_channel::DATAGRAM_SIZE];
+            setpoint_channel::write(sequence, make(static_cast<uint16_t>(sequence)), data);
+            sendto(sender, data, sizeof(data), 0, (const sockaddr *)&address, sizeof(address));
+            // loopback doesn't drop as long as the receiver keeps up
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+        close(sender);
+    });
+
+    setpoint_channel channel;
+    setpoint applied = {};
+    uint8_t data[64];
+    ssize_t received;
+    while ((received = recv(receiver, data, sizeof(data), 0)) > 0)
+        channel.receive(data, received, applied);
+    sender.join();
+    close(receiver);
+
+    const auto &stats = channel.stats();
+    printf("[loopback] sent %u, dropped %u, swapped %u -> received %u, applied %u, lost %u, reordered %u\n",
+           DATAGRAMS, dropped, swapped, stats.received, stats.applied, stats.lost, stats.reordered);
+    TEST_ASSERT_EQUAL_UINT32(DATAGRAMS - dropped, stats.received);
+    TEST_ASSERT_EQUAL_UINT32(swapped, stats.reordered);
+    // the very last one was dropped too, nothing came after it to show the gap
+    TEST_ASSERT_EQUAL_UINT32(dropped - 1U, stats.lost);
+    TEST_ASSERT_EQUAL_UINT32(stats.received - stats.reordered, stats.applied);
+    // the newest one wins, whatever came after it
+    TEST_ASSERT_EQUAL_UINT32(DATAGRAMS - 1, channel.last_sequence());
+    TEST_ASSERT_EQUAL_UINT16(DATAGRAMS - 1, applied.speed[0]);
+}
+
+void test_deadman_stops_a_silent_sender()
+{
+    udp_control::deadman sender(500U);
+    // nothing ever came -> nothing to stop
+    TEST_ASSERT_FALSE(sender.expired(10000U));
+
+    sender.feed(1000U);
+    TEST_ASSERT_FALSE(sender.expired(1499U));
+    sender.feed(1400U);
+    TEST_ASSERT_FALSE(sender.expired(1800U));
+    TEST_ASSERT_TRUE(sender.expired(1900U));
+    // once, not on every check after it
+    TEST_ASSERT_FALSE(sender.expired(1901U));
+    TEST_ASSERT_FALSE(sender.expired(5000U));
+    TEST_ASSERT_EQUAL_UINT32(1, sender.trips());
+
+    // clock wraps
+    sender.feed(UINT32_MAX - 100U);
+    TEST_ASSERT_FALSE(sender.expired(200U));
+    TEST_ASSERT_TRUE(sender.expired(400U));
+    TEST_ASSERT_EQUAL_UINT32(2, sender.trips());
+}
+
+// same as global_queue::batches
+typedef command_queue::batch_queue<8, 4> batch_queue;
+
+// like control_port -> engines and arm batch of every applied datagram (push_unacked when ack is false)
+bool push_setpoint(batch_queue &batches, const setpoint &value, bool ack)
+{
+    for (uint8_t controller = 0; controller < 2; controller++)
+    {
+        auto *batch = batches.acquire();
+        if (!batch)
+            return false;
+        batch->count = controller ? setpoint::SERVOS : setpoint::SIDES * 2U;
+        for (uint8_t i = 0; i < batch->count; i++)
+        {
+            batch->commands[i] = commands::command{};
+            batch->commands[i].controller = controller;
+            batch->commands[i].target = i;
+        }
+        batch->ack = ack;
+        if (!batches.push(batch))
+            return false;
+    }
+    return true;
+}
+
+void test_datagrams_are_not_acked()
+{
+    setpoint_channel channel;
+    batch_queue batches;
+    uint32_t handled = 0;
+    uint32_t events = 0;
+    auto handle = [&handled](const commands::command &) {
+        handled++;
+        return 1U;
+    };
+    auto acked = [&events](uint8_t, uint8_t) { events++; };
+
+    setpoint value = {};
+    for (uint32_t sequence = 1; sequence <= 500U; sequence++)
+    {
+        TEST_ASSERT_EQUAL(result::applied, receive(channel, sequence, make(sequence), value));
+        TEST_ASSERT_TRUE(push_setpoint(batches, value, false));
+        batches.apply(handle, acked);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, events);
+    TEST_ASSERT_EQUAL_UINT32(500U * (setpoint::SIDES * 2U + setpoint::SERVOS), handled);
+
+    // a batch from the websocket in between still gets its ack
+    TEST_ASSERT_TRUE(push_setpoint(batches, make(1), false));
+    auto *preset = batches.acquire();
+    preset->count = 1;
+    preset->commands[0] = commands::command{};
+    TEST_ASSERT_TRUE(batches.push(preset));
+    batches.apply(handle, acked);
+    TEST_ASSERT_EQUAL_UINT32(1, events);
+    TEST_ASSERT_EQUAL_UINT32(0, batches.pending());
+}
+
+// ================
+// BENCHMARK
+// ================
+
+void benchmark_receive()
+{
+    constexpr uint32_t ROUNDS = 1000000U;
+    static uint8_t data[4096U][setpoint_channel::DATAGRAM_SIZE];
+    for (uint32_t i = 0; i < 4096U; i++)
+        setpoint_channel::write(i + 1U, make(static_cast<uint16_t>(i)), data[i]);
+
+    setpoint_channel channel;
+    setpoint out = {};
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ROUNDS; i++)
+    {
+        if (i % 4096U == 0U)
+            channel.restart();
+        channel.receive(data[i % 4096U], setpoint_channel::DATAGRAM_SIZE, out);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    printf("[benchmark] %u datagrams, %.1f ns per receive\n", ROUNDS, (double)elapsed.count() / ROUNDS);
+    TEST_ASSERT_EQUAL_UINT32(ROUNDS, channel.stats().applied);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_datagram_round_trip);
+    RUN_TEST(test_only_newer_datagrams_are_applied);
+    RUN_TEST(test_sequence_wraps_and_sender_restarts);
+    RUN_TEST(test_invalid_datagrams_are_rejected);
+    RUN_TEST(test_loopback_sender_and_receiver);
+    RUN_TEST(test_deadman_stops_a_silent_sender);
+    RUN_TEST(test_datagrams_are_not_acked);
+    RUN_TEST(benchmark_receive);
+    return UNITY_END();
+}
@@ -0,0 +1,85 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "web_assets/asset.hpp"
+
+using web_assets::asset;
+
+static constexpr uint8_t PAGE[] = {0x1f, 0x8b};
+static constexpr uint8_t SCRIPT[] = {0x1f, 0x8b};
+static constexpr uint8_t ICON[] = {0x00, 0x00, 0x01};
+
+// like generated_assets.hpp
+static constexpr asset ASSETS[] = {
+    {"/favicon.ico", "image/x-icon", ICON, sizeof(ICON), "\"0643b075ebeebca0\"", "0643b075", false},
+    {"/index.html", "text/html", PAGE, sizeof(PAGE), "\"cb51ea1add015be4\"", "cb51ea1a", true},
+    {"/js/index.js", "text/javascript", SCRIPT, sizeof(SCRIPT), "\"ba14d25d02b6f559\"", "ba14d25d", true},
+};
+
+// ================
+// TESTS
+// ================
+
+void test_files_are_found_by_path()
+{
+    TEST_ASSERT_EQUAL_PTR(&ASSETS[1], web_assets::find(ASSETS, "/"));
+    TEST_ASSERT_EQUAL_PTR(&ASSETS[1], web_assets::find(ASSETS, "/index.html"));
+    TEST_ASSERT_EQUAL_PTR(&ASSETS[2], web_assets::find(ASSETS, "/js/index.js"));
+    TEST_ASSERT_NULL(web_assets::find(ASSETS, "/js/"));
+    TEST_ASSERT_NULL(web_assets::find(ASSETS, "/generate_204"));
+}
+
+void test_only_the_right_version_is_immutable()
+{
+    const asset &script = ASSETS[2];
+    TEST_ASSERT_EQUAL_STRING(web_assets::CACHE_IMMUTABLE, web_assets::cache_control(script, "ba14d25d"));
+    // page from an older firmware
+    TEST_ASSERT_EQUAL_STRING(web_assets::CACHE_REVALIDATE, web_assets::cache_control(script, "00000000"));
+    TEST_ASSERT_EQUAL_STRING(web_assets::CACHE_REVALIDATE, web_assets::cache_control(script, nullptr));
+}
+
+void test_if_none_match()
+{
+    const char *etag = ASSETS[1].etag;
+    TEST_ASSERT_TRUE(web_assets::etag_matches("\"cb51ea1add015be4\"", etag));
+    TEST_ASSERT_TRUE(web_assets::etag_matches("W/\"cb51ea1add015be4\"", etag));
+    TEST_ASSERT_TRUE(web_assets::etag_matches("\"0643b075ebeebca0\", \"cb51ea1add015be4\"", etag));
+    TEST_ASSERT_TRUE(web_assets::etag_matches("*", etag));
+
+    TEST_ASSERT_FALSE(web_assets::etag_matches("", etag));
+    TEST_ASSERT_FALSE(web_assets::etag_matches("\"cb51ea1add015be\"", etag));
+    TEST_ASSERT_FALSE(web_assets::etag_matches("\"0643b075ebeebca0\"", etag));
+    TEST_ASSERT_FALSE(web_assets::etag_matches("cb51ea1add015be4", etag));
+    TEST_ASSERT_FALSE(web_assets::etag_matches("\"cb51ea1add015be4", etag));
+}
+
+// ================
+// BENCHMARK
+// ================
+
+void benchmark_lookup()
+{
+    constexpr uint32_t ROUNDS = 1000000U;
+    const char *paths[] = {"/", "/js/index.js", "/favicon.ico", "/missing"};
+    uint32_t hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ROUNDS; i++)
+    {
+        const asset *file = web_assets::find(ASSETS, paths[i % 4U]);
+        hits += file && web_assets::etag_matches("W/\"0643b075ebeebca0\", \"ba14d25d02b6f559\"", file->etag);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    printf("[benchmark] %.1f ns to find a file and check If-None-Match\n", (double)elapsed.count() / ROUNDS);
+    TEST_ASSERT_EQUAL_UINT32(ROUNDS / 2U, hits);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_files_are_found_by_path);
+    RUN_TEST(test_only_the_right_version_is_immutable);
+    RUN_TEST(test_if_none_match);
+    RUN_TEST(benchmark_lookup);
+    return UNITY_END();
+}
@@ -5,7 +5,7 @@ from time import sleep
 
 
 async def connect_and_send(messages):
-    uri = "ws://192.168.4.1/ws"
+    uri = "ws://192.168.4.1/ws/ctl"
     async with websockets.connect(uri) as websocket:
         for message in messages:
             await websocket.send(message)
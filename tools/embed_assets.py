@@ -0,0 +1,148 @@
+# gzips the web page (data/) into src/web_assets/generated_assets.hpp, served from flash by webserver
+# runs before every build (extra_scripts in platformio.ini) or by hand: python tools/embed_assets.py
+#
+# every file gets an etag from the hash of its content, references between files ("./js/index.js")
+# get that hash as ?v=... so the browser can keep them for good and only asks for index.html again
+
+import gzip
+import hashlib
+import os
+import posixpath
+import re
+
+TYPES = {
+    ".html": "text/html",
+    ".js": "text/javascript",
+    ".css": "text/css",
+    ".ico": "image/x-icon",
+}
+# files other files point to, have to be hashed first
+TEXT = {".html", ".js", ".css"}
+REFERENCE = re.compile(r"""(["'])(\./[^"'?#]+)\1""")
+OUTPUT = os.path.join("src", "web_assets", "generated_assets.hpp")
+
+
+def project_dir():
+    try:
+        Import("env")  # noqa: F821 (defined by platformio)
+        return env.subst("$PROJECT_DIR")  # noqa: F821
+    except NameError:
+        return os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+def find_assets(data_dir):
+    assets = {}
+    for root, _, files in os.walk(data_dir):
+        for name in sorted(files):
+            extension = os.path.splitext(name)[1].lower()
+            if extension not in TYPES:
+                continue
+            full = os.path.join(root, name)
+            path = "/" + os.path.relpath(full, data_dir).replace(os.sep, "/")
+            assets[path] = full
+    return assets
+
+
+class embedder:
+    def __init__(self, assets):
+        self.assets = assets
+        self.content = {}
+        self.referenced = set()
+        self.in_progress = set()
+
+    def digest(self, path):
+        return hashlib.sha256(self.process(path)).hexdigest()
+
+    # content with references pointing to versions of the files
+    def process(self, path):
+        if path in self.content:
+            return self.content[path]
+
+        with open(self.assets[path], "rb") as source:
+            data = source.read()
+        if os.path.splitext(path)[1].lower() in TEXT:
+            self.in_progress.add(path)
+            text = data.decode("utf-8")
+            text = REFERENCE.sub(lambda match: self.versioned(path, match), text)
+            data = text.encode("utf-8")
+            self.in_progress.discard(path)
+
+        self.content[path] = data
+        return data
+
+    def versioned(self, path, match):
+        quote, reference = match.group(1), match.group(2)
+        target = posixpath.normpath(posixpath.join(posixpath.dirname(path), reference))
+        # unknown file or files that point at each other -> left as it is
+        if target not in self.assets or target in self.in_progress:
+            return match.group(0)
+        self.referenced.add(target)
+        return "%s%s?v=%s%s" % (quote, reference, self.digest(target)[:8], quote)
+
+
+def identifier(path):
+    return re.sub(r"[^A-Za-z0-9]", "_", path.strip("/")).upper()
+
+
+def array(name, data):
+    lines = []
+    for offset in range(0, len(data), 16):
+        lines.append("        " + ", ".join("0x%02x" % byte for byte in data[offset:offset + 16]) + ",")
+    return "    static constexpr uint8_t %s[] = {\n%s\n    };\n" % (name, "\n".join(lines))
+
+
+def generate(data_dir):
+    assets = find_assets(data_dir)
+    files = embedder(assets)
+    arrays = []
+    entries = []
+    raw_total = 0
+    served_total = 0
+    for path in sorted(assets):
+        data = files.process(path)
+        digest = files.digest(path)
+        # mtime 0 -> same bytes for the same page, no rebuild when nothing changed
+        compressed = gzip.compress(data, 9, mtime=0)
+        gzipped = len(compressed) < len(data)
+        served = compressed if gzipped else data
+        raw_total += len(data)
+        served_total += len(served)
+
+        name = identifier(path)
+        arrays.append(array(name, served))
+        entries.append('        {"%s", "%s", %s, sizeof(%s), "\\"%s\\"", "%s", %s},' % (
+            path, TYPES[os.path.splitext(path)[1].lower()], name, name, digest[:16], digest[:8],
+            "true" if gzipped else "false"))
+
+    return (
+        "#ifndef __GENERATED_ASSETS_HPP__\n"
+        "#define __GENERATED_ASSETS_HPP__\n\n"
+        "// generated by tools/embed_assets.py from data/, don't edit\n"
+        "// %d files, %d bytes -> %d bytes\n\n"
+        "#include <stdint.h>\n"
+        "#include \"asset.hpp\"\n\n"
+        "namespace web_assets\n{\n"
+        "%s\n"
+        "    static constexpr asset ASSETS[] = {\n%s\n    };\n"
+        "} // namespace web_assets\n\n"
+        "#endif // __GENERATED_ASSETS_HPP__\n"
+    ) % (len(assets), raw_total, served_total, "\n".join(arrays), "\n".join(entries))
+
+
+def main():
+    root = project_dir()
+    output = os.path.join(root, OUTPUT)
+    header = generate(os.path.join(root, "data"))
+
+    previous = None
+    if os.path.exists(output):
+        with open(output, "r") as current:
+            previous = current.read()
+    # untouched file isn't compiled again
+    if header != previous:
+        with open(output, "w") as target:
+            target.write(header)
+        print("web assets embedded into %s" % OUTPUT)
+
+
+main()